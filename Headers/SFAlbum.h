@@ -17,6 +17,7 @@
 #ifndef _SF_PUBLIC_ALBUM_H
 #define _SF_PUBLIC_ALBUM_H
 
+#include "SFAllocator.h"
 #include "SFBase.h"
 
 /**
@@ -32,6 +33,17 @@ typedef struct _SFAlbum *SFAlbumRef;
  */
 SFAlbumRef SFAlbumCreate(void);
 
+/**
+ * Creates an instance of an open type album which makes all of its allocations with the given
+ * allocator.
+ *
+ * @param allocator
+ *      The allocator to use, which is copied. Passing NULL uses the default allocator.
+ * @return
+ *      A reference to an album object.
+ */
+SFAlbumRef SFAlbumCreateWithAllocator(const SFAllocator *allocator);
+
 /**
  * Returns the number of code units processed by the shaping engine.
  *
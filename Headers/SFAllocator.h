@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_PUBLIC_ALLOCATOR_H
+#define _SF_PUBLIC_ALLOCATOR_H
+
+#include "SFBase.h"
+
+/**
+ * The function used to allocate a block of memory.
+ *
+ * @param object
+ *      The object associated with the allocator.
+ * @param size
+ *      The size of the block in bytes, which is never zero.
+ * @return
+ *      A pointer to the allocated block, suitably aligned for any type.
+ */
+typedef void *(*SFAllocatorProtocolAllocateFunc)(void *object, SFUInteger size);
+
+/**
+ * The function used to resize a block of memory, keeping its contents.
+ *
+ * @param object
+ *      The object associated with the allocator.
+ * @param pointer
+ *      A block previously returned by the allocator, which is never NULL.
+ * @param size
+ *      The new size of the block in bytes, which is never zero.
+ * @return
+ *      A pointer to the resized block, which may differ from the passed-in one.
+ */
+typedef void *(*SFAllocatorProtocolReallocateFunc)(void *object, void *pointer, SFUInteger size);
+
+/**
+ * The function used to release a block of memory.
+ *
+ * @param object
+ *      The object associated with the allocator.
+ * @param pointer
+ *      A block previously returned by the allocator, which is never NULL.
+ */
+typedef void (*SFAllocatorProtocolDeallocateFunc)(void *object, void *pointer);
+
+/**
+ * Structure containing the functions of an allocator.
+ */
+typedef struct _SFAllocatorProtocol {
+    /**
+     * The function used to allocate a block of memory.
+     */
+    SFAllocatorProtocolAllocateFunc allocate;
+    /**
+     * The function used to resize a block of memory.
+     */
+    SFAllocatorProtocolReallocateFunc reallocate;
+    /**
+     * The function used to release a block of memory. This function may be NULL if the memory is
+     * released all at once by the owner of the allocator, such as an arena.
+     */
+    SFAllocatorProtocolDeallocateFunc deallocate;
+} SFAllocatorProtocol;
+
+/**
+ * The type used to represent an allocator, pairing its functions with an object such as an arena.
+ */
+typedef struct _SFAllocator {
+    const SFAllocatorProtocol *protocol;    /**< Functions of the allocator. */
+    void *object;                           /**< Object passed to the functions. */
+} SFAllocator;
+
+/**
+ * Sets the allocator used by the objects that are created without one. Each object keeps using the
+ * allocator that was in effect when it was created, along with everything it allocates later on.
+ *
+ * @param allocator
+ *      The allocator to use by default, which is copied. Passing NULL restores the standard
+ *      malloc, realloc and free functions.
+ * @note
+ *      The default allocator is shared by all threads, so it should be set before creating any
+ *      object.
+ */
+void SFAllocatorSetDefault(const SFAllocator *allocator);
+
+#endif
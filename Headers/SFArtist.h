@@ -18,6 +18,7 @@
 #define _SF_PUBLIC_ARTIST_H
 
 #include "SFAlbum.h"
+#include "SFAllocator.h"
 #include "SFBase.h"
 #include "SFPattern.h"
 
@@ -28,6 +29,16 @@ typedef struct _SFArtist *SFArtistRef;
 
 SFArtistRef SFArtistCreate(void);
 
+/**
+ * Creates an artist which is allocated with the given allocator.
+ *
+ * @param allocator
+ *      The allocator to use, which is copied. Passing NULL uses the default allocator.
+ * @return
+ *      A reference to an artist object.
+ */
+SFArtistRef SFArtistCreateWithAllocator(const SFAllocator *allocator);
+
 /**
  * Sets the pattern which an artist will use while shaping.
  *
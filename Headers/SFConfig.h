@@ -19,6 +19,12 @@
 
 /* #define SF_CONFIG_UNITY */
 
+/**
+ * Stores glyph associations in 32 bits, reducing the memory used by albums on 64-bit platforms.
+ * Texts longer than 4G code units are not supported with this option.
+ */
+/* #define SF_CONFIG_COMPACT_ALBUM */
+
 #ifdef SF_CONFIG_UNITY
 #define SF_INTERNAL static
 #define SF_PRIVATE  static
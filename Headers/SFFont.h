@@ -17,6 +17,7 @@
 #ifndef _SF_PUBLIC_FONT_H
 #define _SF_PUBLIC_FONT_H
 
+#include "SFAllocator.h"
 #include "SFBase.h"
 
 enum {
@@ -25,6 +26,13 @@ enum {
 };
 typedef SFUInt32 SFFontLayout;
 
+enum {
+    SFFontOptionNone = 0,
+    SFFontOptionParsedMetrics = 1 << 0,  /**< Take the advances from the metrics tables of the font. */
+    SFFontOptionCompiledTables = 1 << 1  /**< Compile the layout tables of the font at creation. */
+};
+typedef SFUInt32 SFFontOptions;
+
 /**
  * The type used to represent a font.
  */
@@ -53,6 +61,21 @@ typedef void (*SFFontProtocolFinalizeFunc)(void *object);
  */
 typedef void (*SFFontProtocolLoadTableFunc)(void *object, SFTag tableTag, SFUInt8 *buffer, SFUInteger *length);
 
+/**
+ * The function used to get a font table in place, without copying it.
+ *
+ * @param object
+ *      The object associated with the font.
+ * @param tableTag
+ *      The tag of the table to get.
+ * @param length
+ *      The pointer that takes the length of the table.
+ * @return
+ *      The data of the table, or NULL if the table does not exist. The data must remain valid and
+ *      unchanged until the font is finalized.
+ */
+typedef const SFUInt8 *(*SFFontProtocolGetTableFunc)(void *object, SFTag tableTag, SFUInteger *length);
+
 /**
  * The function used to get the glyph ID of a code point.
  *
@@ -79,6 +102,38 @@ typedef SFGlyphID (*SFFontProtocolGetGlyphIDForCodepointFunc)(void *object, SFCo
  */
 typedef SFAdvance (*SFFontProtocolGetAdvanceForGlyphFunc)(void *object, SFFontLayout fontLayout, SFGlyphID glyphID);
 
+/**
+ * The function used to get the glyph IDs of a run of code points at once.
+ *
+ * @param object
+ *      The object associated with the font.
+ * @param codepoints
+ *      The code points for which to get the glyph IDs.
+ * @param glyphIDs
+ *      The buffer that takes the glyph ID of each code point.
+ * @param count
+ *      The number of code points.
+ */
+typedef void (*SFFontProtocolGetGlyphIDsForCodepointsFunc)(void *object,
+    const SFCodepoint *codepoints, SFGlyphID *glyphIDs, SFUInteger count);
+
+/**
+ * The function used to get the advances of a run of glyphs at once.
+ *
+ * @param object
+ *      The object associated with the font.
+ * @param fontLayout
+ *      The drawing layout of the glyphs.
+ * @param glyphIDs
+ *      The glyph IDs for which to get the advances.
+ * @param advances
+ *      The buffer that takes the advance of each glyph.
+ * @param count
+ *      The number of glyphs.
+ */
+typedef void (*SFFontProtocolGetAdvancesForGlyphsFunc)(void *object, SFFontLayout fontLayout,
+    const SFGlyphID *glyphIDs, SFAdvance *advances, SFUInteger count);
+
 /**
  * Structure containing the functions of a SFFont.
  */
@@ -103,7 +158,57 @@ typedef struct _SFFontProtocol {
 } SFFontProtocol;
 
 /**
- * Creates a font object with a given protocol.
+ * Structure containing the functions of a SFFont along with the optional ones added after the
+ * original protocol. It is kept apart from SFFontProtocol so that the layout of the latter never
+ * changes.
+ */
+typedef struct _SFFontExtendedProtocol {
+    /**
+     * The size of the structure in bytes, which must be sizeof(SFFontExtendedProtocol). The fields
+     * appended in later versions are taken as NULL or zero for a smaller size.
+     */
+    SFUInteger size;
+    /**
+     * The functions of the original protocol. Here loadTable may be NULL if getTable is provided,
+     * and getGlyphIDForCodepoint may be NULL, in which case the glyph IDs are taken from
+     * getGlyphIDsForCodepoints if available, or otherwise from the unicode subtable of the cmap
+     * table of the font, which is compiled for fast lookups.
+     */
+    SFFontProtocol base;
+    /**
+     * The function used to get the table of a font in place, such as from a memory mapped file.
+     * This function may be NULL. The tables it returns are used without copying, whereas the ones
+     * it does not return are loaded with loadTable, if available.
+     */
+    SFFontProtocolGetTableFunc getTable;
+    /**
+     * The function used to get the glyph IDs of a run of code points. This function may be NULL.
+     * If available, it is preferred over getGlyphIDForCodepoint so that the cost of each call,
+     * such as locking a shared face, is paid once per run.
+     */
+    SFFontProtocolGetGlyphIDsForCodepointsFunc getGlyphIDsForCodepoints;
+    /**
+     * The function used to get the advances of a run of glyphs. This function may be NULL. If
+     * available, it is preferred over getAdvanceForGlyph.
+     */
+    SFFontProtocolGetAdvancesForGlyphsFunc getAdvancesForGlyphs;
+    /**
+     * The options of the font. With SFFontOptionParsedMetrics, the hmtx and vmtx tables are parsed
+     * at creation and the advances are taken from them if neither getAdvanceForGlyph nor
+     * getAdvancesForGlyphs is provided. A glyph then has zero advance if the table of its layout is
+     * missing, except that the vertical advance falls back to the units per em of the head table.
+     *
+     * With SFFontOptionCompiledTables, the coverage, class definition, lookup, pair adjustment,
+     * ligature and contextual tables of GDEF, GSUB and GPOS are compiled at creation into native
+     * structures, which makes the font slower to create but faster to shape with. Anchors, value
+     * records and the remaining subtable data are read from the tables in either case.
+     */
+    SFFontOptions options;
+} SFFontExtendedProtocol;
+
+/**
+ * Creates a font object with a given protocol. The layout tables are compiled, as with
+ * SFFontOptionCompiledTables.
  *
  * @param protocol
  *      A structure holding pointers to the implemented functions for this font.
@@ -114,6 +219,131 @@ typedef struct _SFFontProtocol {
  */
 SFFontRef SFFontCreateWithProtocol(const SFFontProtocol *protocol, void *object);
 
+/**
+ * Creates a font object with a given protocol, making the copies of its tables and all of its
+ * compiled data with the given allocator. The layout tables are compiled, as with
+ * SFFontOptionCompiledTables.
+ *
+ * @param protocol
+ *      A structure holding pointers to the implemented functions for this font.
+ * @param object
+ *      An object associated with the font to identify it.
+ * @param allocator
+ *      The allocator to use, which is copied. Passing NULL uses the default allocator.
+ * @return
+ *      A reference to a font object if the call was successful, NULL otherwise.
+ */
+SFFontRef SFFontCreateWithAllocator(const SFFontProtocol *protocol, void *object,
+    const SFAllocator *allocator);
+
+/**
+ * Creates a font object with a given extended protocol.
+ *
+ * @param protocol
+ *      A structure holding pointers to the implemented functions for this font, with its size
+ *      field set.
+ * @param object
+ *      An object associated with the font to identify it.
+ * @param allocator
+ *      The allocator to use, which is copied. Passing NULL uses the default allocator.
+ * @param cacheData
+ *      The cache data previously written by SFFontWriteCache, or NULL. It is used only with
+ *      SFFontOptionCompiledTables. See SFFontCreateWithCache for its requirements.
+ * @param cacheLength
+ *      The length of cache data in bytes.
+ * @return
+ *      A reference to a font object if the call was successful, NULL otherwise.
+ */
+SFFontRef SFFontCreateWithExtendedProtocol(const SFFontExtendedProtocol *protocol, void *object,
+    const SFAllocator *allocator, const SFUInt8 *cacheData, SFUInteger cacheLength);
+
+/**
+ * Creates a font object from a TrueType, OpenType or collection font held in memory. The tables
+ * are used in place, and the glyph IDs and advances are taken from the cmap and metrics tables of
+ * the font, as with SFFontOptionParsedMetrics, and the layout tables are compiled, as with
+ * SFFontOptionCompiledTables.
+ *
+ * @param data
+ *      The data of the font, which must remain valid until the font is released.
+ * @param length
+ *      The length of the data in bytes.
+ * @param faceIndex
+ *      The index of the face within a collection, zero otherwise.
+ * @param allocator
+ *      The allocator of the font and all of its compiled data, which is copied. Passing NULL uses
+ *      the default allocator.
+ * @param cacheData
+ *      The cache data previously written by SFFontWriteCache, or NULL. See SFFontCreateWithCache
+ *      for its requirements.
+ * @param cacheLength
+ *      The length of cache data in bytes.
+ * @return
+ *      A reference to a font object if the data holds the face, NULL otherwise.
+ */
+SFFontRef SFFontCreateWithMemory(const SFUInt8 *data, SFUInteger length, SFUInteger faceIndex,
+    const SFAllocator *allocator, const SFUInt8 *cacheData, SFUInteger cacheLength);
+
+/**
+ * Creates a font object by memory-mapping a TrueType, OpenType or collection font file. The file
+ * stays mapped until the font is released.
+ *
+ * @param path
+ *      The path of the font file.
+ * @param faceIndex
+ *      The index of the face within a collection, zero otherwise.
+ * @param allocator
+ *      The allocator of the font and all of its compiled data, which is copied. It also holds the
+ *      file on platforms that cannot map it. Passing NULL uses the default allocator.
+ * @param cacheData
+ *      The cache data previously written by SFFontWriteCache, or NULL. See SFFontCreateWithCache
+ *      for its requirements.
+ * @param cacheLength
+ *      The length of cache data in bytes.
+ * @return
+ *      A reference to a font object if the file could be mapped and holds the face, NULL
+ *      otherwise.
+ */
+SFFontRef SFFontCreateWithFile(const char *path, SFUInteger faceIndex,
+    const SFAllocator *allocator, const SFUInt8 *cacheData, SFUInteger cacheLength);
+
+/**
+ * Creates a font object with a given protocol, reusing the compiled data previously written by
+ * SFFontWriteCache for the same font. The layout tables are compiled as with
+ * SFFontOptionCompiledTables, except for the parts found in the cache data.
+ *
+ * @param protocol
+ *      A structure holding pointers to the implemented functions for this font.
+ * @param object
+ *      An object associated with the font to identify it.
+ * @param allocator
+ *      The allocator to use, which is copied. Passing NULL uses the default allocator.
+ * @param cacheData
+ *      The cache data aligned to four bytes. It is used in place, so it can be a read-only memory
+ *      mapped file shared between processes, but it must remain valid until the font is released.
+ *      The data is ignored if it does not belong to the tables of the font.
+ * @param cacheLength
+ *      The length of cache data in bytes.
+ * @return
+ *      A reference to a font object if the call was successful, NULL otherwise.
+ */
+SFFontRef SFFontCreateWithCache(const SFFontProtocol *protocol, void *object,
+    const SFAllocator *allocator, const SFUInt8 *cacheData, SFUInteger cacheLength);
+
+/**
+ * Writes the compiled data of the font so that it can be persisted and passed to
+ * SFFontCreateWithCache afterwards.
+ *
+ * @param font
+ *      The font whose compiled data is to be written.
+ * @param buffer
+ *      The buffer in which the data should be written. It should be NULL if only the length of the
+ *      data is needed.
+ * @param length
+ *      A pointer to a variable that receives the length of the data. It can be NULL if only the data
+ *      is needed. The length is zero if the layout tables of the font are not compiled.
+ */
+void SFFontWriteCache(SFFontRef font, SFUInt8 *buffer, SFUInteger *length);
+
 SFFontRef SFFontRetain(SFFontRef font);
 void SFFontRelease(SFFontRef font);
 
@@ -17,6 +17,7 @@
 #ifndef _SF_PUBLIC_SCHEME_H
 #define _SF_PUBLIC_SCHEME_H
 
+#include "SFAllocator.h"
 #include "SFBase.h"
 #include "SFFont.h"
 #include "SFPattern.h"
@@ -28,6 +29,17 @@ typedef struct _SFScheme *SFSchemeRef;
 
 SFSchemeRef SFSchemeCreate(void);
 
+/**
+ * Creates a scheme which makes its own allocations and the ones of the patterns it builds with the
+ * given allocator.
+ *
+ * @param allocator
+ *      The allocator to use, which is copied. Passing NULL uses the default allocator.
+ * @return
+ *      A reference to a scheme object.
+ */
+SFSchemeRef SFSchemeCreateWithAllocator(const SFAllocator *allocator);
+
 /**
  * Sets the font in a scheme.
  *
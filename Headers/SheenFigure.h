@@ -18,6 +18,7 @@
 #define _SHEEN_FIGURE_H
 
 #include <SFAlbum.h>
+#include <SFAllocator.h>
 #include <SFArtist.h>
 #include <SFBase.h>
 #include <SFFont.h>
@@ -17,9 +17,9 @@
 #include <SFConfig.h>
 
 #include <stddef.h>
-#include <stdlib.h>
 #include <string.h>
 
+#include "SFAllocator.h"
 #include "SFAssert.h"
 #include "SFBase.h"
 #include "SFCodepoints.h"
@@ -29,7 +29,11 @@ static const SFGlyphMask _SFGlyphMaskEmpty = { { SFUInt16Max, 0 } };
 static const SFGlyphMask _SFGlyphMaskPlaceholder = { { SFUInt16Max, SFGlyphTraitPlaceholder } };
 
 static void _SFAlbumSetGlyphMask(SFAlbumRef album, SFUInteger index, SFGlyphMask glyphMask);
-static void _SFAlbumRemoveGlyphs(SFAlbumRef album, SFUInteger index, SFUInteger count);
+static void _SFAlbumMoveGap(SFAlbumRef album, SFUInteger index);
+static void _SFAlbumOpenGap(SFAlbumRef album, SFUInteger index, SFUInteger count);
+static void _SFAlbumCloseGap(SFAlbumRef album);
+static void _SFAlbumMoveGlyphs(SFAlbumRef album, SFUInteger srcIndex, SFUInteger dstIndex, SFUInteger count);
+static void _SFAlbumTruncateGlyphs(SFAlbumRef album, SFUInteger glyphCount);
 static void _SFAlbumRemovePlaceholders(SFAlbumRef album);
 static void _SFAlbumBuildCodeunitToGlyphMap(SFAlbumRef album);
 
@@ -43,8 +47,18 @@ SF_PRIVATE SFUInt16 _SFAlbumGetAntiFeatureMask(SFUInt16 featureMask)
 
 SFAlbumRef SFAlbumCreate(void)
 {
-    SFAlbumRef album = malloc(sizeof(SFAlbum));
-    SFAlbumInitialize(album);
+    return SFAlbumCreateWithAllocator(NULL);
+}
+
+SFAlbumRef SFAlbumCreateWithAllocator(const SFAllocator *allocator)
+{
+    SFAllocator albumAllocator;
+    SFAlbumRef album;
+
+    SFAllocatorInitialize(&albumAllocator, allocator);
+
+    album = SFAllocatorAllocate(&albumAllocator, sizeof(SFAlbum));
+    SFAlbumInitialize(album, &albumAllocator);
 
     return album;
 }
@@ -91,21 +105,31 @@ SFAlbumRef SFAlbumRetain(SFAlbumRef album)
 void SFAlbumRelease(SFAlbumRef album)
 {
     if (album && --album->_retainCount == 0) {
+        SFAllocator allocator = album->_allocator;
+
         SFAlbumFinalize(album);
+        SFAllocatorDeallocate(&allocator, album);
     }
 }
 
-SF_INTERNAL void SFAlbumInitialize(SFAlbumRef album)
+SF_INTERNAL void SFAlbumInitialize(SFAlbumRef album, const SFAllocator *allocator)
 {
+    SFAllocatorInitialize(&album->_allocator, allocator);
+
     album->codepoints = NULL;
     album->codeunitCount = 0;
     album->glyphCount = 0;
 
-    SFListInitialize(&album->_indexMap, sizeof(SFUInteger));
-    SFListInitialize(&album->_glyphs, sizeof(SFGlyphID));
-    SFListInitialize(&album->_details, sizeof(SFGlyphDetail));
-    SFListInitialize(&album->_offsets, sizeof(SFPoint));
-    SFListInitialize(&album->_advances, sizeof(SFAdvance));
+    SFListInitialize(&album->_indexMap, sizeof(SFUInteger), &album->_allocator);
+    SFListInitialize(&album->_glyphs, sizeof(SFGlyphID), &album->_allocator);
+    SFListInitialize(&album->_masks, sizeof(SFGlyphMask), &album->_allocator);
+    SFListInitialize(&album->_associations, sizeof(SFGlyphAssociation), &album->_allocator);
+    SFListInitialize(&album->_details, sizeof(SFGlyphDetail), &album->_allocator);
+    SFListInitialize(&album->_offsets, sizeof(SFPoint), &album->_allocator);
+    SFListInitialize(&album->_advances, sizeof(SFAdvance), &album->_allocator);
+
+    album->_gapIndex = 0;
+    album->_gapLength = 0;
 
     album->_version = 0;
     album->_state = _SFAlbumStateEmpty;
@@ -114,6 +138,11 @@ SF_INTERNAL void SFAlbumInitialize(SFAlbumRef album)
 
 SF_INTERNAL void SFAlbumReset(SFAlbumRef album, SFCodepointsRef codepoints, SFUInteger codeunitCount)
 {
+#ifdef SF_CONFIG_COMPACT_ALBUM
+    /* Every code unit index must fit in a compact association. */
+    SFAssert(codeunitCount <= SFUInt32Max);
+#endif
+
     album->codepoints = codepoints;
     album->codeunitCount = codeunitCount;
     album->glyphCount = 0;
@@ -122,47 +151,139 @@ SF_INTERNAL void SFAlbumReset(SFAlbumRef album, SFCodepointsRef codepoints, SFUI
     SFListReserveRange(&album->_indexMap, 0, codeunitCount);
 
     SFListClear(&album->_glyphs);
+    SFListClear(&album->_masks);
+    SFListClear(&album->_associations);
     SFListClear(&album->_details);
     SFListClear(&album->_offsets);
     SFListClear(&album->_advances);
 
+    album->_gapIndex = 0;
+    album->_gapLength = 0;
     album->_version = 0;
     album->_state = _SFAlbumStateEmpty;
 }
 
 SF_INTERNAL void SFAlbumBeginFilling(SFAlbumRef album)
 {
-	SFUInteger glyphCapacity = album->codeunitCount;
+    SFUInteger glyphCapacity = album->codeunitCount;
 
+    /* Start with a gap large enough for one glyph per code unit. */
     SFListReserveRange(&album->_glyphs, 0, glyphCapacity);
+    SFListReserveRange(&album->_masks, 0, glyphCapacity);
+    SFListReserveRange(&album->_associations, 0, glyphCapacity);
     SFListReserveRange(&album->_details, 0, glyphCapacity);
 
-	album->_state = _SFAlbumStateFilling;
+    album->_gapIndex = 0;
+    album->_gapLength = glyphCapacity;
+    album->_state = _SFAlbumStateFilling;
+}
+
+/**
+ * Moves the gap so that it starts at the given glyph index, shifting only the glyphs in between.
+ */
+static void _SFAlbumMoveGap(SFAlbumRef album, SFUInteger index)
+{
+    SFUInteger gapIndex = album->_gapIndex;
+    SFUInteger gapLength = album->_gapLength;
+
+    if (index < gapIndex) {
+        SFUInteger count = gapIndex - index;
+
+        SFListMoveRange(&album->_glyphs, index, index + gapLength, count);
+        SFListMoveRange(&album->_masks, index, index + gapLength, count);
+        SFListMoveRange(&album->_associations, index, index + gapLength, count);
+        SFListMoveRange(&album->_details, index, index + gapLength, count);
+    } else if (index > gapIndex) {
+        SFUInteger count = index - gapIndex;
+
+        SFListMoveRange(&album->_glyphs, gapIndex + gapLength, gapIndex, count);
+        SFListMoveRange(&album->_masks, gapIndex + gapLength, gapIndex, count);
+        SFListMoveRange(&album->_associations, gapIndex + gapLength, gapIndex, count);
+        SFListMoveRange(&album->_details, gapIndex + gapLength, gapIndex, count);
+    }
+
+    album->_gapIndex = index;
+}
+
+/**
+ * Takes the specified number of uninitialized glyphs from the gap after moving it to the given
+ * index. The gap is grown in proportion to the glyph count so that reserving is amortized constant
+ * time as long as the insertion point moves forward.
+ */
+static void _SFAlbumOpenGap(SFAlbumRef album, SFUInteger index, SFUInteger count)
+{
+    SFGlyphDetail *details;
+    SFUInteger detailIndex;
+
+    _SFAlbumMoveGap(album, index);
+
+    if (album->_gapLength < count) {
+        SFUInteger gapLimit = album->_gapIndex + album->_gapLength;
+        SFUInteger extraLength = count + album->glyphCount;
+
+        SFListReserveRange(&album->_glyphs, gapLimit, extraLength);
+        SFListReserveRange(&album->_masks, gapLimit, extraLength);
+        SFListReserveRange(&album->_associations, gapLimit, extraLength);
+        SFListReserveRange(&album->_details, gapLimit, extraLength);
+
+        album->_gapLength += extraLength;
+    }
+
+    details = album->_details.items;
+
+    /* New glyphs have not taken over any placeholders. */
+    for (detailIndex = 0; detailIndex < count; detailIndex++) {
+        details[album->_gapIndex + detailIndex].removedCount = 0;
+    }
+
+    album->_gapIndex += count;
+    album->_gapLength -= count;
+    album->glyphCount += count;
+}
+
+/**
+ * Moves the gap past the last glyph and removes it, making the lists contiguous.
+ */
+static void _SFAlbumCloseGap(SFAlbumRef album)
+{
+    SFUInteger glyphCount = album->glyphCount;
+
+    _SFAlbumMoveGap(album, glyphCount);
+
+    SFListRemoveRange(&album->_glyphs, glyphCount, album->_gapLength);
+    SFListRemoveRange(&album->_masks, glyphCount, album->_gapLength);
+    SFListRemoveRange(&album->_associations, glyphCount, album->_gapLength);
+    SFListRemoveRange(&album->_details, glyphCount, album->_gapLength);
+
+    album->_gapLength = 0;
 }
 
 SF_INTERNAL void SFAlbumAddGlyph(SFAlbumRef album, SFGlyphID glyph, SFGlyphTraits traits, SFUInteger association)
 {
     SFUInteger index;
-    SFGlyphDetailRef detail;
+    SFGlyphMask *mask;
 
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
     album->_version++;
-    index = album->glyphCount++;
-    detail = SFListGetRef(&album->_details, index);
+    _SFAlbumOpenGap(album, album->glyphCount, 1);
 
-    /* Initialize the glyph along with its details. */
+    /* The new glyph lies just before the gap. */
+    index = album->_gapIndex - 1;
+
+    /* Initialize the glyph along with its association and mask. */
     SFListSetVal(&album->_glyphs, index, glyph);
-    detail->association = association;
-    detail->mask.section.featureMask = SFUInt16Max;
-    detail->mask.section.glyphTraits = traits;
+    SFListSetVal(&album->_associations, index, (SFGlyphAssociation)association);
+    mask = SFListGetRef(&album->_masks, index);
+    mask->section.featureMask = SFUInt16Max;
+    mask->section.glyphTraits = traits;
 }
 
 SF_INTERNAL SFUInteger *SFAlbumGetTemporaryIndexArray(SFAlbumRef album, SFUInteger count)
 {
-    /* The album must be in filling state. */
-    SFAssert(album->_state == _SFAlbumStateFilling);
+    /* The album must be either in filling state or arranging state. */
+    SFAssert(album->_state == _SFAlbumStateFilling || album->_state == _SFAlbumStateArranging);
 
     if (album->_indexMap.capacity < count) {
         SFListSetCapacity(&album->_indexMap, count);
@@ -177,15 +298,12 @@ SF_INTERNAL void SFAlbumReserveGlyphs(SFAlbumRef album, SFUInteger index, SFUInt
     SFAssert(album->_state == _SFAlbumStateFilling);
 
     album->_version++;
-    album->glyphCount += count;
-
-    SFListReserveRange(&album->_glyphs, index, count);
-    SFListReserveRange(&album->_details, index, count);
+    _SFAlbumOpenGap(album, index, count);
 }
 
 SF_INTERNAL SFGlyphID SFAlbumGetGlyph(SFAlbumRef album, SFUInteger index)
 {
-    return SFListGetVal(&album->_glyphs, index);
+    return SFListGetVal(&album->_glyphs, _SFAlbumStorageIndex(album, index));
 }
 
 SF_INTERNAL void SFAlbumSetGlyph(SFAlbumRef album, SFUInteger index, SFGlyphID glyph)
@@ -193,12 +311,12 @@ SF_INTERNAL void SFAlbumSetGlyph(SFAlbumRef album, SFUInteger index, SFGlyphID g
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
-    SFListSetVal(&album->_glyphs, index, glyph);
+    SFListSetVal(&album->_glyphs, _SFAlbumStorageIndex(album, index), glyph);
 }
 
 SF_INTERNAL SFUInteger SFAlbumGetAssociation(SFAlbumRef album, SFUInteger index)
 {
-    return SFListGetRef(&album->_details, index)->association;
+    return SFListGetVal(&album->_associations, _SFAlbumStorageIndex(album, index));
 }
 
 SF_INTERNAL void SFAlbumSetAssociation(SFAlbumRef album, SFUInteger index, SFUInteger association)
@@ -206,12 +324,17 @@ SF_INTERNAL void SFAlbumSetAssociation(SFAlbumRef album, SFUInteger index, SFUIn
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
-    SFListGetRef(&album->_details, index)->association = association;
+    SFListSetVal(&album->_associations, _SFAlbumStorageIndex(album, index), (SFGlyphAssociation)association);
 }
 
 SF_PRIVATE SFGlyphMask _SFAlbumGetGlyphMask(SFAlbumRef album, SFUInteger index)
 {
-    return SFListGetRef(&album->_details, index)->mask;
+    return SFListGetVal(&album->_masks, _SFAlbumStorageIndex(album, index));
+}
+
+SF_PRIVATE const SFGlyphMask *_SFAlbumGetGlyphMasksPtr(SFAlbumRef album)
+{
+    return album->_masks.items;
 }
 
 static void _SFAlbumSetGlyphMask(SFAlbumRef album, SFUInteger index, SFGlyphMask glyphMask)
@@ -219,12 +342,12 @@ static void _SFAlbumSetGlyphMask(SFAlbumRef album, SFUInteger index, SFGlyphMask
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
-    SFListGetRef(&album->_details, index)->mask = glyphMask;
+    SFListSetVal(&album->_masks, _SFAlbumStorageIndex(album, index), glyphMask);
 }
 
 SF_INTERNAL SFUInt16 SFAlbumGetFeatureMask(SFAlbumRef album, SFUInteger index)
 {
-    return SFListGetRef(&album->_details, index)->mask.section.featureMask;
+    return SFListGetRef(&album->_masks, _SFAlbumStorageIndex(album, index))->section.featureMask;
 }
 
 SF_INTERNAL void SFAlbumSetFeatureMask(SFAlbumRef album, SFUInteger index, SFUInt16 featureMask)
@@ -232,12 +355,12 @@ SF_INTERNAL void SFAlbumSetFeatureMask(SFAlbumRef album, SFUInteger index, SFUIn
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
-    SFListGetRef(&album->_details, index)->mask.section.featureMask = featureMask;
+    SFListGetRef(&album->_masks, _SFAlbumStorageIndex(album, index))->section.featureMask = featureMask;
 }
 
 SF_INTERNAL SFGlyphTraits SFAlbumGetTraits(SFAlbumRef album, SFUInteger index)
 {
-    return (SFGlyphTraits)SFListGetRef(&album->_details, index)->mask.section.glyphTraits;
+    return (SFGlyphTraits)SFListGetRef(&album->_masks, _SFAlbumStorageIndex(album, index))->section.glyphTraits;
 }
 
 SF_INTERNAL void SFAlbumSetTraits(SFAlbumRef album, SFUInteger index, SFGlyphTraits traits)
@@ -245,7 +368,7 @@ SF_INTERNAL void SFAlbumSetTraits(SFAlbumRef album, SFUInteger index, SFGlyphTra
     /* The album must be either in filling state or arranging state. */
     SFAssert(album->_state == _SFAlbumStateFilling || album->_state == _SFAlbumStateArranging);
 
-    SFListGetRef(&album->_details, index)->mask.section.glyphTraits = (SFUInt16)traits;
+    SFListGetRef(&album->_masks, _SFAlbumStorageIndex(album, index))->section.glyphTraits = (SFUInt16)traits;
 }
 
 SF_INTERNAL void SFAlbumInsertTraits(SFAlbumRef album, SFUInteger index, SFGlyphTraits traits)
@@ -253,7 +376,7 @@ SF_INTERNAL void SFAlbumInsertTraits(SFAlbumRef album, SFUInteger index, SFGlyph
     /* The album must be either in filling state or arranging state. */
     SFAssert(album->_state == _SFAlbumStateFilling || album->_state == _SFAlbumStateArranging);
 
-    SFListGetRef(&album->_details, index)->mask.section.glyphTraits |= (SFUInt16)traits;
+    SFListGetRef(&album->_masks, _SFAlbumStorageIndex(album, index))->section.glyphTraits |= (SFUInt16)traits;
 }
 
 SF_INTERNAL void SFAlbumRemoveTraits(SFAlbumRef album, SFUInteger index, SFGlyphTraits traits)
@@ -261,7 +384,26 @@ SF_INTERNAL void SFAlbumRemoveTraits(SFAlbumRef album, SFUInteger index, SFGlyph
     /* The album must be either in filling state or arranging state. */
     SFAssert(album->_state == _SFAlbumStateFilling || album->_state == _SFAlbumStateArranging);
 
-    SFListGetRef(&album->_details, index)->mask.section.glyphTraits &= (SFUInt16)~traits;
+    SFListGetRef(&album->_masks, _SFAlbumStorageIndex(album, index))->section.glyphTraits &= (SFUInt16)~traits;
+}
+
+SF_INTERNAL SFUInteger SFAlbumGetRemovedCount(SFAlbumRef album, SFUInteger index)
+{
+    return SFListGetRef(&album->_details, _SFAlbumStorageIndex(album, index))->removedCount;
+}
+
+SF_INTERNAL void SFAlbumCompact(SFAlbumRef album)
+{
+    /* The album must be in filling state. */
+    SFAssert(album->_state == _SFAlbumStateFilling);
+
+    album->_version++;
+
+    _SFAlbumCloseGap(album);
+    _SFAlbumRemovePlaceholders(album);
+
+    /* Keep the empty gap at the end of the remaining glyphs. */
+    album->_gapIndex = album->glyphCount;
 }
 
 SF_INTERNAL void SFAlbumEndFilling(SFAlbumRef album)
@@ -269,6 +411,7 @@ SF_INTERNAL void SFAlbumEndFilling(SFAlbumRef album)
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
+    _SFAlbumCloseGap(album);
     album->_state = _SFAlbumStateFilled;
 }
 
@@ -324,7 +467,7 @@ SF_INTERNAL void SFAlbumSetAdvance(SFAlbumRef album, SFUInteger index, SFAdvance
 
 SF_INTERNAL SFUInt16 SFAlbumGetCursiveOffset(SFAlbumRef album, SFUInteger index)
 {
-    return SFListGetRef(&album->_details, index)->cursiveOffset;
+    return SFListGetRef(&album->_details, _SFAlbumStorageIndex(album, index))->cursiveOffset;
 }
 
 SF_INTERNAL void SFAlbumSetCursiveOffset(SFAlbumRef album, SFUInteger index, SFUInt16 offset)
@@ -332,12 +475,12 @@ SF_INTERNAL void SFAlbumSetCursiveOffset(SFAlbumRef album, SFUInteger index, SFU
     /* The album must be in arranging state. */
     SFAssert(album->_state == _SFAlbumStateArranging);
 
-    SFListGetRef(&album->_details, index)->cursiveOffset = offset;
+    SFListGetRef(&album->_details, _SFAlbumStorageIndex(album, index))->cursiveOffset = offset;
 }
 
 SF_INTERNAL SFUInt16 SFAlbumGetAttachmentOffset(SFAlbumRef album, SFUInteger index)
 {
-    return SFListGetRef(&album->_details, index)->attachmentOffset;
+    return SFListGetRef(&album->_details, _SFAlbumStorageIndex(album, index))->attachmentOffset;
 }
 
 SF_INTERNAL void SFAlbumSetAttachmentOffset(SFAlbumRef album, SFUInteger index, SFUInt16 offset)
@@ -345,7 +488,7 @@ SF_INTERNAL void SFAlbumSetAttachmentOffset(SFAlbumRef album, SFUInteger index,
     /* The album must be in arranging state. */
     SFAssert(album->_state == _SFAlbumStateArranging);
 
-    SFListGetRef(&album->_details, index)->attachmentOffset = offset;
+    SFListGetRef(&album->_details, _SFAlbumStorageIndex(album, index))->attachmentOffset = offset;
 }
 
 SF_INTERNAL void SFAlbumEndArranging(SFAlbumRef album)
@@ -356,35 +499,93 @@ SF_INTERNAL void SFAlbumEndArranging(SFAlbumRef album)
     album->_state = _SFAlbumStateArranged;
 }
 
-static void _SFAlbumRemoveGlyphs(SFAlbumRef album, SFUInteger index, SFUInteger count)
+/**
+ * Moves a run of glyphs to a lower index in all of the lists holding glyph data.
+ */
+static void _SFAlbumMoveGlyphs(SFAlbumRef album, SFUInteger srcIndex, SFUInteger dstIndex, SFUInteger count)
+{
+    SFListMoveRange(&album->_glyphs, srcIndex, dstIndex, count);
+    SFListMoveRange(&album->_masks, srcIndex, dstIndex, count);
+    SFListMoveRange(&album->_associations, srcIndex, dstIndex, count);
+    SFListMoveRange(&album->_details, srcIndex, dstIndex, count);
+
+    if (album->_state == _SFAlbumStateArranged) {
+        SFListMoveRange(&album->_offsets, srcIndex, dstIndex, count);
+        SFListMoveRange(&album->_advances, srcIndex, dstIndex, count);
+    }
+}
+
+/**
+ * Drops the glyphs following the given count from all of the lists holding glyph data.
+ */
+static void _SFAlbumTruncateGlyphs(SFAlbumRef album, SFUInteger glyphCount)
 {
-    SFListRemoveRange(&album->_glyphs, index, count);
-    SFListRemoveRange(&album->_details, index, count);
-    SFListRemoveRange(&album->_offsets, index, count);
-    SFListRemoveRange(&album->_advances, index, count);
+    SFUInteger extraCount = album->glyphCount - glyphCount;
+
+    SFListRemoveRange(&album->_glyphs, glyphCount, extraCount);
+    SFListRemoveRange(&album->_masks, glyphCount, extraCount);
+    SFListRemoveRange(&album->_associations, glyphCount, extraCount);
+    SFListRemoveRange(&album->_details, glyphCount, extraCount);
+
+    if (album->_state == _SFAlbumStateArranged) {
+        SFListRemoveRange(&album->_offsets, glyphCount, extraCount);
+        SFListRemoveRange(&album->_advances, glyphCount, extraCount);
+    }
+
+    album->glyphCount = glyphCount;
 }
 
+/**
+ * Removes placeholder glyphs in a single pass by sliding each run of remaining glyphs down to its
+ * final position. The lists must not have a gap.
+ */
 static void _SFAlbumRemovePlaceholders(SFAlbumRef album)
 {
-    SFUInteger placeholderCount = 0;
-    SFUInteger index = album->glyphCount;
-
-    while (index--) {
-        SFGlyphTraits traits = SFAlbumGetTraits(album, index);
-        if (traits & SFGlyphTraitPlaceholder) {
-            placeholderCount++;
-        } else {
-            if (placeholderCount) {
-                _SFAlbumRemoveGlyphs(album, index + 1, placeholderCount);
-                album->glyphCount -= placeholderCount;
-                placeholderCount = 0;
-            }
+    SFGlyphMask *masks = album->_masks.items;
+    SFGlyphDetail *details = album->_details.items;
+    SFUInteger glyphCount = album->glyphCount;
+    SFUInteger removedCount = 0;
+    SFUInteger readIndex = 0;
+    SFUInteger writeIndex = 0;
+
+    /* The lists must be contiguous. */
+    SFAssert(album->_gapLength == 0);
+
+    while (readIndex < glyphCount) {
+        SFUInteger runIndex;
+
+        /* Skip the placeholders, along with the ones they had taken over. */
+        if (masks[readIndex].section.glyphTraits & SFGlyphTraitPlaceholder) {
+            removedCount += details[readIndex].removedCount + 1;
+            readIndex++;
+            continue;
         }
+
+        /*
+         * Hand over the skipped placeholders to the first glyph of the run. The count is only used
+         * to find the component of a ligature, so it is saturated rather than wrapped around.
+         */
+        removedCount += details[readIndex].removedCount;
+        SFAssert(removedCount <= SFUInt16Max);
+        details[readIndex].removedCount = (SFUInt16)(removedCount < SFUInt16Max ? removedCount : SFUInt16Max);
+        removedCount = 0;
+
+        /* Find the end of the run of remaining glyphs. */
+        runIndex = readIndex;
+        do {
+            readIndex++;
+        } while (readIndex < glyphCount
+                 && !(masks[readIndex].section.glyphTraits & SFGlyphTraitPlaceholder));
+
+        if (writeIndex != runIndex) {
+            _SFAlbumMoveGlyphs(album, runIndex, writeIndex, readIndex - runIndex);
+        }
+
+        writeIndex += readIndex - runIndex;
     }
 
-    if (placeholderCount) {
-        _SFAlbumRemoveGlyphs(album, 0, placeholderCount);
-        album->glyphCount -= placeholderCount;
+    if (writeIndex != glyphCount) {
+        _SFAlbumTruncateGlyphs(album, writeIndex);
     }
 }
 
@@ -429,6 +630,8 @@ SF_INTERNAL void SFAlbumWrapUp(SFAlbumRef album)
 SF_INTERNAL void SFAlbumFinalize(SFAlbumRef album) {
     SFListFinalize(&album->_indexMap);
     SFListFinalize(&album->_glyphs);
+    SFListFinalize(&album->_masks);
+    SFListFinalize(&album->_associations);
     SFListFinalize(&album->_details);
     SFListFinalize(&album->_offsets);
     SFListFinalize(&album->_advances);
@@ -20,6 +20,7 @@
 #include <SFAlbum.h>
 #include <SFConfig.h>
 
+#include "SFAllocator.h"
 #include "SFAssert.h"
 #include "SFBase.h"
 #include "SFCodepoints.h"
@@ -55,11 +56,20 @@ typedef union {
     SFUInt32 full;
 } SFGlyphMask;
 
+#ifdef SF_CONFIG_COMPACT_ALBUM
+typedef SFUInt32 SFGlyphAssociation;
+#else
+typedef SFUInteger SFGlyphAssociation;
+#endif
+
+/**
+ * Holds the rarely accessed fields of a glyph, kept apart from its id and mask which are read by
+ * every lookup.
+ */
 typedef struct _SFGlyphDetail {
-    SFUInteger association;     /**< Index of the code point to which the glyph maps. */
-    SFGlyphMask mask;           /**< Mask of the glyph. */
     SFUInt16 cursiveOffset;     /**< Offset to the next cursively connected glyph. */
     SFUInt16 attachmentOffset;  /**< Offset to the previous glyph attached with this one. */
+    SFUInt16 removedCount;      /**< Number of placeholders removed just before the glyph. */
 } SFGlyphDetail, *SFGlyphDetailRef;
 
 typedef struct _SFAlbum {
@@ -69,19 +79,36 @@ typedef struct _SFAlbum {
 
     SF_LIST(SFUInteger) _indexMap;      /**< Code unit index to glyph index mapping list. */
     SF_LIST(SFGlyphID) _glyphs;         /**< List of ids of all glyphs in the album. */
+    SF_LIST(SFGlyphMask) _masks;        /**< List of masks of all glyphs in the album, kept contiguous for scanning. */
+    SF_LIST(SFGlyphAssociation) _associations; /**< List of code unit indexes to which the glyphs map. */
     SF_LIST(SFGlyphDetail) _details;    /**< List of details of all glyphs in the album. */
+    SFUInteger _gapIndex;               /**< Index of the glyph following the gap in per glyph lists. */
+    SFUInteger _gapLength;              /**< Number of unused items in the gap of per glyph lists. */
     SF_LIST(SFPoint) _offsets;          /**< List of offsets of all glyphs in the album. */
     SF_LIST(SFAdvance) _advances;       /**< List of advances of all glyphs in the album. */
 
+    SFAllocator _allocator;             /**< Allocator of the album and its lists. */
     SFUInteger _version;                /**< Current version of the album. */
     _SFAlbumState _state;               /**< Current state of the album. */
 
     SFUInteger _retainCount;
 } SFAlbum;
 
+/**
+ * Returns the position of a glyph in the per glyph lists of ids, masks, associations and details.
+ * While filling, the lists keep a gap at the last insertion point so that glyphs can be reserved in
+ * the middle without moving all of the following ones. The gap is closed once the album is filled.
+ */
+#define _SFAlbumStorageIndex(album, index)              \
+(                                                       \
+    (index) < (album)->_gapIndex                        \
+        ? (index)                                       \
+        : (index) + (album)->_gapLength                 \
+)
+
 SF_PRIVATE SFUInt16 _SFAlbumGetAntiFeatureMask(SFUInt16 featureMask);
 
-SF_INTERNAL void SFAlbumInitialize(SFAlbumRef album);
+SF_INTERNAL void SFAlbumInitialize(SFAlbumRef album, const SFAllocator *allocator);
 
 /**
  * Initializes the album for given code points.
@@ -93,6 +120,10 @@ SF_INTERNAL void SFAlbumReset(SFAlbumRef album, SFCodepointsRef codepoints, SFUI
  */
 SF_INTERNAL void SFAlbumBeginFilling(SFAlbumRef album);
 
+/**
+ * Returns a scratch array of at least the given count, which stays valid until the album is
+ * wrapped up.
+ */
 SF_INTERNAL SFUInteger *SFAlbumGetTemporaryIndexArray(SFAlbumRef album, SFUInteger count);
 
 /**
@@ -115,6 +146,11 @@ SF_INTERNAL void SFAlbumSetAssociation(SFAlbumRef album, SFUInteger index, SFUIn
 
 SF_PRIVATE SFGlyphMask _SFAlbumGetGlyphMask(SFAlbumRef album, SFUInteger index);
 
+/**
+ * Returns the contiguous array of glyph masks, indexed by storage index of the glyphs.
+ */
+SF_PRIVATE const SFGlyphMask *_SFAlbumGetGlyphMasksPtr(SFAlbumRef album);
+
 SF_INTERNAL SFUInt16 SFAlbumGetFeatureMask(SFAlbumRef album, SFUInteger index);
 SF_INTERNAL void SFAlbumSetFeatureMask(SFAlbumRef album, SFUInteger index, SFUInt16 featureMask);
 
@@ -123,6 +159,18 @@ SF_INTERNAL void SFAlbumSetTraits(SFAlbumRef album, SFUInteger index, SFGlyphTra
 SF_INTERNAL void SFAlbumInsertTraits(SFAlbumRef album, SFUInteger index, SFGlyphTraits traits);
 SF_INTERNAL void SFAlbumRemoveTraits(SFAlbumRef album, SFUInteger index, SFGlyphTraits traits);
 
+/**
+ * Returns the number of placeholder glyphs that were removed just before the glyph at given index.
+ */
+SF_INTERNAL SFUInteger SFAlbumGetRemovedCount(SFAlbumRef album, SFUInteger index);
+
+/**
+ * Removes all placeholder glyphs from the album while it is being filled, so that the remaining
+ * lookups do not have to walk over them. Each remaining glyph keeps the number of placeholders
+ * removed before it, so that ligature components can still be counted.
+ */
+SF_INTERNAL void SFAlbumCompact(SFAlbumRef album);
+
 /**
  * Ends filling the album with glyphs.
  */
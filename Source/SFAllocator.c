@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SFConfig.h>
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "SFAssert.h"
+#include "SFBase.h"
+#include "SFAllocator.h"
+
+static void *_SFSystemAllocate(void *object, SFUInteger size);
+static void *_SFSystemReallocate(void *object, void *pointer, SFUInteger size);
+static void _SFSystemDeallocate(void *object, void *pointer);
+
+static const SFAllocatorProtocol _SFSystemProtocol = {
+    _SFSystemAllocate,
+    _SFSystemReallocate,
+    _SFSystemDeallocate
+};
+
+static SFAllocator _SFDefaultAllocator = { &_SFSystemProtocol, NULL };
+
+static void *_SFSystemAllocate(void *object, SFUInteger size)
+{
+    return malloc(size);
+}
+
+static void *_SFSystemReallocate(void *object, void *pointer, SFUInteger size)
+{
+    return realloc(pointer, size);
+}
+
+static void _SFSystemDeallocate(void *object, void *pointer)
+{
+    free(pointer);
+}
+
+void SFAllocatorSetDefault(const SFAllocator *allocator)
+{
+    if (allocator) {
+        /* The allocator must be able to allocate and reallocate. */
+        SFAssert(allocator->protocol && allocator->protocol->allocate && allocator->protocol->reallocate);
+
+        _SFDefaultAllocator = *allocator;
+    } else {
+        _SFDefaultAllocator.protocol = &_SFSystemProtocol;
+        _SFDefaultAllocator.object = NULL;
+    }
+}
+
+SF_INTERNAL void SFAllocatorInitialize(SFAllocator *allocator, const SFAllocator *source)
+{
+    *allocator = (source ? *source : _SFDefaultAllocator);
+}
+
+SF_INTERNAL void *SFAllocatorAllocate(const SFAllocator *allocator, SFUInteger size)
+{
+    if (size) {
+        return allocator->protocol->allocate(allocator->object, size);
+    }
+
+    return NULL;
+}
+
+SF_INTERNAL void *SFAllocatorReallocate(const SFAllocator *allocator, void *pointer, SFUInteger size)
+{
+    if (!pointer) {
+        return SFAllocatorAllocate(allocator, size);
+    }
+
+    if (!size) {
+        SFAllocatorDeallocate(allocator, pointer);
+        return NULL;
+    }
+
+    return allocator->protocol->reallocate(allocator->object, pointer, size);
+}
+
+SF_INTERNAL void SFAllocatorDeallocate(const SFAllocator *allocator, void *pointer)
+{
+    if (pointer && allocator->protocol->deallocate) {
+        allocator->protocol->deallocate(allocator->object, pointer);
+    }
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_ALLOCATOR_H
+#define _SF_INTERNAL_ALLOCATOR_H
+
+#include <SFAllocator.h>
+#include <SFConfig.h>
+
+#include "SFBase.h"
+
+/**
+ * Initializes an allocator with a copy of the given one, or the default allocator if it is NULL.
+ */
+SF_INTERNAL void SFAllocatorInitialize(SFAllocator *allocator, const SFAllocator *source);
+
+/**
+ * Allocates a block of given size, returning NULL if the size is zero.
+ */
+SF_INTERNAL void *SFAllocatorAllocate(const SFAllocator *allocator, SFUInteger size);
+
+/**
+ * Resizes a block to the given size. A NULL block is allocated afresh, and a zero size releases
+ * the block and returns NULL.
+ */
+SF_INTERNAL void *SFAllocatorReallocate(const SFAllocator *allocator, void *pointer, SFUInteger size);
+
+/**
+ * Releases a block allocated by the allocator. The block can be NULL.
+ */
+SF_INTERNAL void SFAllocatorDeallocate(const SFAllocator *allocator, void *pointer);
+
+#endif
@@ -18,7 +18,6 @@
 
 #include <SBCodepointSequence.h>
 #include <stddef.h>
-#include <stdlib.h>
 
 #include "SFBase.h"
 #include "SFUnifiedEngine.h"
@@ -38,7 +37,18 @@ static SFBoolean _SFIsValidCodepointSequence(SBCodepointSequence *codepointSeque
 
 SFArtistRef SFArtistCreate(void)
 {
-    SFArtistRef artist = malloc(sizeof(SFArtist));
+    return SFArtistCreateWithAllocator(NULL);
+}
+
+SFArtistRef SFArtistCreateWithAllocator(const SFAllocator *allocator)
+{
+    SFAllocator artistAllocator;
+    SFArtistRef artist;
+
+    SFAllocatorInitialize(&artistAllocator, allocator);
+
+    artist = SFAllocatorAllocate(&artistAllocator, sizeof(SFArtist));
+    artist->_allocator = artistAllocator;
     _SFLoadCodepointSequence(&artist->codepointSequence, 0, NULL, 0);
     artist->pattern = NULL;
     artist->textDirection = SFTextDirectionLeftToRight;
@@ -123,6 +133,7 @@ SFArtistRef SFArtistRetain(SFArtistRef artist)
 void SFArtistRelease(SFArtistRef artist)
 {
     if (artist && --artist->_retainCount == 0) {
-        free(artist);
+        SFAllocator allocator = artist->_allocator;
+        SFAllocatorDeallocate(&allocator, artist);
     }
 }
@@ -22,6 +22,7 @@
 
 #include <SBCodepointSequence.h>
 
+#include "SFAllocator.h"
 #include "SFBase.h"
 #include "SFPattern.h"
 
@@ -30,6 +31,7 @@ typedef struct _SFArtist {
     SFPatternRef pattern;
     SFTextDirection textDirection;
     SFTextMode textMode;
+    SFAllocator _allocator;
     SFUInteger _retainCount;
 } SFArtist;
 
@@ -0,0 +1,427 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SFConfig.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFCmap.h"
+#include "SFData.h"
+
+#define SF_CMAP_PAGE_SIZE           256
+#define SF_CMAP_PAGE_SHIFT          8
+#define SF_CMAP_PAGE_MASK           (SF_CMAP_PAGE_SIZE - 1)
+
+#define SF_CMAP_PLANE_LIMIT         0x10000
+#define SF_CMAP_CODEPOINT_MAX       0x10FFFF
+
+/**
+ * Number of pages allocated at first, including the unmapped one.
+ */
+#define SF_CMAP_INITIAL_PAGES       8
+
+/**
+ * Offset of the private use area into which symbol fonts move the code points of the first block.
+ */
+#define SF_CMAP_SYMBOL_OFFSET       0xF000
+
+/**
+ * Gets the glyph of a code point of the basic multilingual plane.
+ */
+#define _SFCmapGetPlaneGlyph(cmap, codepoint)                                                   \
+(                                                                                               \
+    (cmap)->_pages[((SFUInteger)(cmap)->_pageIndexes[(codepoint) >> SF_CMAP_PAGE_SHIFT]         \
+                        << SF_CMAP_PAGE_SHIFT) | ((codepoint) & SF_CMAP_PAGE_MASK)]             \
+)
+
+typedef struct _SFCmapBuilder {
+    SFCmapRef cmap;
+    const SFAllocator *allocator;
+    SFUInteger pageCount;
+    SFUInteger pageCapacity;
+    SFUInteger budget;          /**< Number of plane code points that may still be expanded. */
+} _SFCmapBuilder;
+
+static SFData _SFCmapSelectSubtable(SFData cmapTable, SFUInteger length, SFUInteger *outLength,
+    SFBoolean *outSymbol);
+static SFUInteger _SFCmapChargeRange(_SFCmapBuilder *builder, SFCodepoint startCode, SFCodepoint endCode);
+static void _SFCmapSetGlyph(_SFCmapBuilder *builder, SFCodepoint codepoint, SFGlyphID glyph);
+static void _SFCmapLoadFormat4(_SFCmapBuilder *builder, SFData subtable, SFUInteger length);
+static void _SFCmapLoadFormat12(_SFCmapBuilder *builder, SFData subtable);
+static void _SFCmapAddSymbolFallback(_SFCmapBuilder *builder);
+static SFGlyphID _SFCmapSearchGroups(SFCmapRef cmap, SFCodepoint codepoint);
+
+static SFData _SFCmapSelectSubtable(SFData cmapTable, SFUInteger length, SFUInteger *outLength,
+    SFBoolean *outSymbol)
+{
+    SFData bestSubtable = NULL;
+    SFUInteger bestLength = 0;
+    SFUInteger bestRank = 0;
+    SFUInteger recordCount;
+    SFUInteger recordIndex;
+
+    if (!cmapTable || length < 4) {
+        return NULL;
+    }
+
+    recordCount = SFData_UInt16(cmapTable, 2);
+
+    if (recordCount > (length - 4) / 8) {
+        recordCount = (length - 4) / 8;
+    }
+
+    for (recordIndex = 0; recordIndex < recordCount; recordIndex++) {
+        SFData record = SFData_Subdata(cmapTable, 4 + (recordIndex * 8));
+        SFUInt16 platformID = SFData_UInt16(record, 0);
+        SFUInt16 encodingID = SFData_UInt16(record, 2);
+        SFUInteger offset = SFData_UInt32(record, 4);
+        SFUInteger available;
+        SFData subtable;
+        SFUInt16 format;
+        SFUInteger rank = 0;
+
+        if (offset > length - 4) {
+            continue;
+        }
+
+        subtable = SFData_Subdata(cmapTable, offset);
+        available = length - offset;
+        format = SFData_UInt16(subtable, 0);
+
+        /*
+         * Prefer the full unicode repertoire over the basic multilingual plane, and fall back to
+         * the symbol encoding only if there is nothing else.
+         */
+        if (format == 12 && (platformID == 0 || (platformID == 3 && encodingID == 10))) {
+            if (available < 16 || SFData_UInt32(subtable, 12) > (available - 16) / 12) {
+                continue;
+            }
+            rank = 3;
+        } else if (format == 4 && (platformID == 0 || (platformID == 3 && (encodingID == 1 || encodingID == 0)))) {
+            if (available < 14 || 16 + ((SFUInteger)SFData_UInt16(subtable, 6) * 4) > available) {
+                continue;
+            }
+            rank = (platformID == 3 && encodingID == 0 ? 1 : 2);
+        }
+
+        if (rank > bestRank) {
+            bestSubtable = subtable;
+            bestLength = available;
+            bestRank = rank;
+        }
+    }
+
+    *outLength = bestLength;
+    *outSymbol = (bestRank == 1);
+
+    return bestSubtable;
+}
+
+/**
+ * Returns how many code points of a range, starting from its first one, may be expanded into the
+ * plane within the budget of the builder, and charges the budget for them. The budget allows as
+ * many code points as the plane holds, which no valid subtable exceeds, so that overlapping ranges
+ * cannot make the expansion run away.
+ */
+static SFUInteger _SFCmapChargeRange(_SFCmapBuilder *builder, SFCodepoint startCode, SFCodepoint endCode)
+{
+    SFUInteger count;
+
+    if (startCode > endCode || startCode >= SF_CMAP_PLANE_LIMIT) {
+        return 0;
+    }
+
+    if (endCode >= SF_CMAP_PLANE_LIMIT) {
+        endCode = SF_CMAP_PLANE_LIMIT - 1;
+    }
+
+    count = endCode - startCode + 1;
+
+    if (count > builder->budget) {
+        count = builder->budget;
+    }
+
+    builder->budget -= count;
+
+    return count;
+}
+
+static void _SFCmapSetGlyph(_SFCmapBuilder *builder, SFCodepoint codepoint, SFGlyphID glyph)
+{
+    SFCmapRef cmap = builder->cmap;
+    SFUInteger block = codepoint >> SF_CMAP_PAGE_SHIFT;
+    SFUInteger pageIndex = cmap->_pageIndexes[block];
+
+    /* Give the block a page of its own on its first glyph. */
+    if (!pageIndex) {
+        if (builder->pageCount == builder->pageCapacity) {
+            builder->pageCapacity *= 2;
+            cmap->_pages = SFAllocatorReallocate(builder->allocator, cmap->_pages,
+                                                 sizeof(SFGlyphID) * builder->pageCapacity * SF_CMAP_PAGE_SIZE);
+        }
+
+        pageIndex = builder->pageCount++;
+        cmap->_pageIndexes[block] = (SFUInt16)pageIndex;
+
+        memset(&cmap->_pages[pageIndex << SF_CMAP_PAGE_SHIFT], 0, sizeof(SFGlyphID) * SF_CMAP_PAGE_SIZE);
+    }
+
+    cmap->_pages[(pageIndex << SF_CMAP_PAGE_SHIFT) | (codepoint & SF_CMAP_PAGE_MASK)] = glyph;
+}
+
+static void _SFCmapLoadFormat4(_SFCmapBuilder *builder, SFData subtable, SFUInteger length)
+{
+    SFUInteger segCount = SFData_UInt16(subtable, 6) / 2;
+    SFUInteger endCodes = 14;
+    SFUInteger startCodes = endCodes + (segCount * 2) + 2;
+    SFUInteger idDeltas = startCodes + (segCount * 2);
+    SFUInteger idRangeOffsets = idDeltas + (segCount * 2);
+    SFUInteger segment;
+
+    for (segment = 0; segment < segCount * 2; segment += 2) {
+        SFCodepoint endCode = SFData_UInt16(subtable, endCodes + segment);
+        SFCodepoint startCode = SFData_UInt16(subtable, startCodes + segment);
+        SFUInt16 idDelta = SFData_UInt16(subtable, idDeltas + segment);
+        SFUInteger idRangeOffset = SFData_UInt16(subtable, idRangeOffsets + segment);
+        SFUInteger count = _SFCmapChargeRange(builder, startCode, endCode);
+        SFCodepoint codepoint;
+
+        for (codepoint = startCode; codepoint < startCode + count; codepoint++) {
+            SFGlyphID glyph = 0;
+
+            if (!idRangeOffset) {
+                glyph = (SFGlyphID)(codepoint + idDelta);
+            } else {
+                /* The range offset is relative to its own location in the subtable. */
+                SFUInteger glyphOffset = idRangeOffsets + segment + idRangeOffset + ((codepoint - startCode) * 2);
+
+                if (glyphOffset <= length - 2) {
+                    SFUInt16 value = SFData_UInt16(subtable, glyphOffset);
+
+                    if (value) {
+                        glyph = (SFGlyphID)(value + idDelta);
+                    }
+                }
+            }
+
+            if (glyph) {
+                _SFCmapSetGlyph(builder, codepoint, glyph);
+            }
+        }
+    }
+}
+
+static void _SFCmapLoadFormat12(_SFCmapBuilder *builder, SFData subtable)
+{
+    SFCmapRef cmap = builder->cmap;
+    SFUInteger groupCount = SFData_UInt32(subtable, 12);
+    SFData groups = SFData_Subdata(subtable, 16);
+    SFUInteger groupIndex;
+
+    cmap->_groups = SFAllocatorAllocate(builder->allocator, sizeof(SFUInt32) * 3 * groupCount);
+
+    for (groupIndex = 0; groupIndex < groupCount; groupIndex++) {
+        SFData group = SFData_Subdata(groups, groupIndex * 12);
+        SFCodepoint startCode = SFData_UInt32(group, 0);
+        SFCodepoint endCode = SFData_UInt32(group, 4);
+        SFUInt32 startGlyph = SFData_UInt32(group, 8);
+        SFUInteger count;
+        SFCodepoint codepoint;
+
+        if (startCode > endCode || startCode > SF_CMAP_CODEPOINT_MAX || startGlyph > SFUInt16Max) {
+            continue;
+        }
+        if (endCode > SF_CMAP_CODEPOINT_MAX) {
+            endCode = SF_CMAP_CODEPOINT_MAX;
+        }
+
+        /* Spread the part lying in the basic multilingual plane over its pages. */
+        count = _SFCmapChargeRange(builder, startCode, endCode);
+
+        for (codepoint = startCode; codepoint < startCode + count; codepoint++) {
+            SFUInt32 glyph = startGlyph + (codepoint - startCode);
+
+            if (glyph > SFUInt16Max) {
+                break;
+            }
+            if (glyph) {
+                _SFCmapSetGlyph(builder, codepoint, (SFGlyphID)glyph);
+            }
+        }
+
+        /* Keep the supplementary part as a native group. */
+        if (endCode >= SF_CMAP_PLANE_LIMIT) {
+            if (startCode < SF_CMAP_PLANE_LIMIT) {
+                startGlyph += SF_CMAP_PLANE_LIMIT - startCode;
+                startCode = SF_CMAP_PLANE_LIMIT;
+            }
+
+            if (startGlyph <= SFUInt16Max) {
+                SFUInt32 *native = &cmap->_groups[cmap->_groupCount * 3];
+                native[0] = startCode;
+                native[1] = endCode;
+                native[2] = startGlyph;
+
+                cmap->_groupCount += 1;
+            }
+        }
+    }
+
+    cmap->_groups = SFAllocatorReallocate(builder->allocator, cmap->_groups,
+                                          sizeof(SFUInt32) * 3 * cmap->_groupCount);
+}
+
+/**
+ * Maps the unmapped code points of the first block to the glyphs that a symbol subtable gives to
+ * their counterparts in the private use area, as symbol fonts are usually fed with plain text.
+ */
+static void _SFCmapAddSymbolFallback(_SFCmapBuilder *builder)
+{
+    SFCmapRef cmap = builder->cmap;
+    SFCodepoint codepoint;
+
+    for (codepoint = 0; codepoint < SF_CMAP_PAGE_SIZE; codepoint++) {
+        if (!_SFCmapGetPlaneGlyph(cmap, codepoint)) {
+            SFGlyphID glyph = _SFCmapGetPlaneGlyph(cmap, SF_CMAP_SYMBOL_OFFSET + codepoint);
+
+            if (glyph) {
+                _SFCmapSetGlyph(builder, codepoint, glyph);
+            }
+        }
+    }
+}
+
+SF_INTERNAL void SFCmapInitialize(SFCmapRef cmap, const SFAllocator *allocator, SFData cmapTable, SFUInteger length)
+{
+    _SFCmapBuilder builder;
+    SFUInteger subtableLength = 0;
+    SFBoolean isSymbol = SFFalse;
+    SFData subtable = _SFCmapSelectSubtable(cmapTable, length, &subtableLength, &isSymbol);
+
+    cmap->_pages = SFAllocatorAllocate(allocator, sizeof(SFGlyphID) * SF_CMAP_INITIAL_PAGES * SF_CMAP_PAGE_SIZE);
+    cmap->_groups = NULL;
+    cmap->_groupCount = 0;
+
+    memset(cmap->_pages, 0, sizeof(SFGlyphID) * SF_CMAP_PAGE_SIZE);
+    memset(cmap->_pageIndexes, 0, sizeof(cmap->_pageIndexes));
+
+    builder.cmap = cmap;
+    builder.allocator = allocator;
+    builder.pageCount = 1;
+    builder.pageCapacity = SF_CMAP_INITIAL_PAGES;
+    builder.budget = SF_CMAP_PLANE_LIMIT;
+
+    if (subtable) {
+        switch (SFData_UInt16(subtable, 0)) {
+            case 4:
+                _SFCmapLoadFormat4(&builder, subtable, subtableLength);
+                break;
+
+            case 12:
+                _SFCmapLoadFormat12(&builder, subtable);
+                break;
+        }
+
+        if (isSymbol) {
+            _SFCmapAddSymbolFallback(&builder);
+        }
+    }
+
+    /* Release the capacity left unused by the pages. */
+    if (builder.pageCount < builder.pageCapacity) {
+        cmap->_pages = SFAllocatorReallocate(allocator, cmap->_pages,
+                                             sizeof(SFGlyphID) * builder.pageCount * SF_CMAP_PAGE_SIZE);
+    }
+}
+
+SF_INTERNAL void SFCmapFinalize(SFCmapRef cmap, const SFAllocator *allocator)
+{
+    SFAllocatorDeallocate(allocator, cmap->_pages);
+    SFAllocatorDeallocate(allocator, cmap->_groups);
+}
+
+static SFGlyphID _SFCmapSearchGroups(SFCmapRef cmap, SFCodepoint codepoint)
+{
+    const SFUInt32 *groups = cmap->_groups;
+    SFUInteger low = 0;
+    SFUInteger high = cmap->_groupCount;
+
+    /* Find the first group whose end code is not less than the code point. */
+    while (low < high) {
+        SFUInteger mid = (low + high) / 2;
+
+        if (groups[(mid * 3) + 1] < codepoint) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (low < cmap->_groupCount) {
+        const SFUInt32 *group = &groups[low * 3];
+
+        if (codepoint >= group[0]) {
+            SFUInt32 glyph = group[2] + (codepoint - group[0]);
+
+            if (glyph <= SFUInt16Max) {
+                return (SFGlyphID)glyph;
+            }
+        }
+    }
+
+    return 0;
+}
+
+SF_INTERNAL SFGlyphID SFCmapGetGlyph(SFCmapRef cmap, SFCodepoint codepoint)
+{
+    if (codepoint < SF_CMAP_PLANE_LIMIT) {
+        return _SFCmapGetPlaneGlyph(cmap, codepoint);
+    }
+
+    return _SFCmapSearchGroups(cmap, codepoint);
+}
+
+SF_INTERNAL void SFCmapCacheInitialize(SFCmapCacheRef cache)
+{
+    /* No supplementary code point is zero, so the cache starts empty. */
+    memset(cache->_codepoints, 0, sizeof(cache->_codepoints));
+}
+
+SF_INTERNAL SFGlyphID SFCmapGetCachedGlyph(SFCmapRef cmap, SFCmapCacheRef cache, SFCodepoint codepoint)
+{
+    SFUInteger slot;
+    SFGlyphID glyph;
+
+    if (codepoint < SF_CMAP_PLANE_LIMIT) {
+        return _SFCmapGetPlaneGlyph(cmap, codepoint);
+    }
+
+    /* Fold the next bits in so that nearby code points of a script spread over the slots. */
+    slot = (codepoint ^ (codepoint >> 4)) & (SF_CMAP_CACHE_SIZE - 1);
+
+    if (cache->_codepoints[slot] == codepoint) {
+        return cache->_glyphs[slot];
+    }
+
+    glyph = _SFCmapSearchGroups(cmap, codepoint);
+    cache->_codepoints[slot] = codepoint;
+    cache->_glyphs[slot] = glyph;
+
+    return glyph;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_CMAP_H
+#define _SF_INTERNAL_CMAP_H
+
+#include <SFConfig.h>
+
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFData.h"
+
+/**
+ * Number of entries in the cache of supplementary code points, which must be a power of two.
+ */
+#define SF_CMAP_CACHE_SIZE  16
+
+/**
+ * A native representation of the unicode subtable of a cmap table. The basic multilingual plane is
+ * directly mapped with a two-level table of 256 pages, whose unused blocks share the first page
+ * left unmapped. Supplementary code points are kept in sorted groups of sequential glyphs.
+ */
+typedef struct _SFCmap {
+    SFGlyphID *_pages;              /**< Glyphs of all pages, the first one being left unmapped. */
+    SFUInt32 *_groups;              /**< Start code, end code and start glyph of each group. */
+    SFUInteger _groupCount;         /**< Number of supplementary groups. */
+    SFUInt16 _pageIndexes[256];     /**< Index of the page holding each block of the plane. */
+} SFCmap, *SFCmapRef;
+
+/**
+ * A small direct-mapped cache of recently looked up supplementary code points. Being owned by the
+ * caller, it keeps the cmap itself immutable so that a font can be shared between threads.
+ */
+typedef struct _SFCmapCache {
+    SFCodepoint _codepoints[SF_CMAP_CACHE_SIZE];
+    SFGlyphID _glyphs[SF_CMAP_CACHE_SIZE];
+} SFCmapCache, *SFCmapCacheRef;
+
+/**
+ * Compiles the preferred unicode subtable of a cmap table, either of format 12 or 4, or else the
+ * symbol subtable of format 4, whose glyphs in U+F000 to U+F0FF are also given to U+0000 to U+00FF.
+ * The cmap maps every code point to zero if the table is NULL or does not have such a subtable. The
+ * arrays are allocated with the given allocator, which must be passed again when finalizing the
+ * cmap.
+ */
+SF_INTERNAL void SFCmapInitialize(SFCmapRef cmap, const SFAllocator *allocator, SFData cmapTable, SFUInteger length);
+SF_INTERNAL void SFCmapFinalize(SFCmapRef cmap, const SFAllocator *allocator);
+
+/**
+ * Returns the glyph of a code point, or zero if it is not mapped.
+ */
+SF_INTERNAL SFGlyphID SFCmapGetGlyph(SFCmapRef cmap, SFCodepoint codepoint);
+
+SF_INTERNAL void SFCmapCacheInitialize(SFCmapCacheRef cache);
+
+/**
+ * Returns the glyph of a code point like SFCmapGetGlyph, remembering supplementary code points in
+ * the cache so that repeated ones are not searched again.
+ */
+SF_INTERNAL SFGlyphID SFCmapGetCachedGlyph(SFCmapRef cmap, SFCmapCacheRef cache, SFCodepoint codepoint);
+
+#endif
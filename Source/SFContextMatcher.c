@@ -0,0 +1,537 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <SFConfig.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#include "SFAllocator.h"
+#include "SFAssert.h"
+#include "SFBase.h"
+#include "SFData.h"
+#include "SFList.h"
+#include "SFTableMap.h"
+#include "SFContextMatcher.h"
+
+#define SF_CONTEXT_MATCHER_IMAGE_FIELDS 9
+
+static SFBoolean _SFContextMatcherRead(SFData subtable, SFUInteger length, SFUInteger offset, SFUInteger *outValue);
+static SFBoolean _SFContextMatcherAddValues(SFContextMatcherRef contextMatcher,
+    SFData subtable, SFUInteger length, SFUInteger arrayOffset, SFUInteger valueCount,
+    SFContextZone contextZone, SFTableMapRef coverageMap);
+static SFBoolean _SFContextMatcherAddRule(SFContextMatcherRef contextMatcher,
+    SFData subtable, SFUInteger length, SFUInteger ruleOffset, SFBoolean isChained,
+    SFTableMapRef coverageMap);
+static SFBoolean _SFContextMatcherAddRuleSet(SFContextMatcherRef contextMatcher,
+    SFData subtable, SFUInteger length, SFUInteger ruleSetOffset, SFBoolean isChained);
+static SFUInteger _SFContextMatcherResolveClassDef(SFData subtable, SFUInteger length,
+    SFUInteger fieldOffset, SFTableMapRef classDefMap);
+static SFBoolean _SFContextMatcherCompile(SFContextMatcherRef contextMatcher,
+    SFData subtable, SFUInteger length, SFBoolean isChained,
+    SFTableMapRef coverageMap, SFTableMapRef classDefMap);
+static SFBoolean _SFContextMatcherValidateImage(SFContextMatcherRef contextMatcher,
+    SFUInteger length, SFUInteger mapCount);
+
+static SFBoolean _SFContextMatcherRead(SFData subtable, SFUInteger length, SFUInteger offset, SFUInteger *outValue)
+{
+    if (offset < length && length - offset >= 2) {
+        *outValue = SFData_UInt16(subtable, offset);
+        return SFTrue;
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFContextMatcherAddValues(SFContextMatcherRef contextMatcher,
+    SFData subtable, SFUInteger length, SFUInteger arrayOffset, SFUInteger valueCount,
+    SFContextZone contextZone, SFTableMapRef coverageMap)
+{
+    SFUInteger index;
+
+    if (valueCount == 0) {
+        return SFTrue;
+    }
+
+    if (arrayOffset + (valueCount * 2) > length) {
+        return SFFalse;
+    }
+
+    /* Class values are meaningful only if the class definition of the zone was compiled. */
+    if (contextMatcher->format == 2 && contextMatcher->classMaps[contextZone] == SFInvalidIndex) {
+        return SFFalse;
+    }
+
+    for (index = 0; index < valueCount; index++) {
+        SFUInteger value = SFData_UInt16(subtable, arrayOffset + (index * 2));
+
+        /* Resolve the coverage offsets to the glyph maps of the compiled tables. */
+        if (contextMatcher->format == 3) {
+            value = (value ? SFTableMapGetValue(coverageMap, SFData_Subdata(subtable, value)) : SFInvalidIndex);
+
+            if (value == SFInvalidIndex) {
+                return SFFalse;
+            }
+        }
+
+        SFListAdd(&contextMatcher->_values, (SFUInt32)value);
+    }
+
+    return SFTrue;
+}
+
+static SFBoolean _SFContextMatcherAddRule(SFContextMatcherRef contextMatcher,
+    SFData subtable, SFUInteger length, SFUInteger ruleOffset, SFBoolean isChained,
+    SFTableMapRef coverageMap)
+{
+    SFBoolean includeFirst = (contextMatcher->format == 3);
+    SFUInteger backtrackCount = 0;
+    SFUInteger lookaheadCount = 0;
+    SFUInteger inputCount;
+    SFUInteger lookupCount;
+    SFUInteger backtrackArray = 0;
+    SFUInteger lookaheadArray = 0;
+    SFUInteger inputArray;
+    SFUInteger lookupArray;
+    SFUInteger forwardCount;
+    SFContextRule contextRule;
+
+    if (isChained) {
+        SFUInteger offset = ruleOffset;
+
+        if (!_SFContextMatcherRead(subtable, length, offset, &backtrackCount)) {
+            return SFFalse;
+        }
+        backtrackArray = offset + 2;
+        offset = backtrackArray + (backtrackCount * 2);
+
+        if (!_SFContextMatcherRead(subtable, length, offset, &inputCount)) {
+            return SFFalse;
+        }
+        /* A rule without any input glyph can never be matched. */
+        if (inputCount == 0) {
+            return SFTrue;
+        }
+        inputArray = offset + 2;
+        offset = inputArray + ((inputCount - !includeFirst) * 2);
+
+        if (!_SFContextMatcherRead(subtable, length, offset, &lookaheadCount)) {
+            return SFFalse;
+        }
+        lookaheadArray = offset + 2;
+        offset = lookaheadArray + (lookaheadCount * 2);
+
+        if (!_SFContextMatcherRead(subtable, length, offset, &lookupCount)) {
+            return SFFalse;
+        }
+        lookupArray = offset + 2;
+    } else {
+        if (!_SFContextMatcherRead(subtable, length, ruleOffset, &inputCount)
+            || !_SFContextMatcherRead(subtable, length, ruleOffset + 2, &lookupCount)) {
+            return SFFalse;
+        }
+        /* A rule without any input glyph can never be matched. */
+        if (inputCount == 0) {
+            return SFTrue;
+        }
+        inputArray = ruleOffset + 4;
+        lookupArray = inputArray + ((inputCount - !includeFirst) * 2);
+    }
+
+    if (lookupArray + (lookupCount * 4) > length) {
+        return SFFalse;
+    }
+
+    contextRule.lookupArray = (SFUInt32)lookupArray;
+    contextRule.values = (SFUInt32)contextMatcher->_values.count;
+    contextRule.inputCount = (SFUInt16)inputCount;
+    contextRule.backtrackCount = (SFUInt16)backtrackCount;
+    contextRule.lookaheadCount = (SFUInt16)lookaheadCount;
+    contextRule.lookupCount = (SFUInt16)lookupCount;
+
+    /* Keep the values in the order in which they are matched. */
+    if (!_SFContextMatcherAddValues(contextMatcher, subtable, length, inputArray,
+                                    inputCount - !includeFirst, SFContextZoneInput, coverageMap)
+        || !_SFContextMatcherAddValues(contextMatcher, subtable, length, backtrackArray,
+                                       backtrackCount, SFContextZoneBacktrack, coverageMap)
+        || !_SFContextMatcherAddValues(contextMatcher, subtable, length, lookaheadArray,
+                                       lookaheadCount, SFContextZoneLookahead, coverageMap)) {
+        return SFFalse;
+    }
+
+    forwardCount = (inputCount - 1) + lookaheadCount;
+
+    if (forwardCount > contextMatcher->forwardLimit) {
+        contextMatcher->forwardLimit = forwardCount;
+    }
+    if (backtrackCount > contextMatcher->backtrackLimit) {
+        contextMatcher->backtrackLimit = backtrackCount;
+    }
+
+    SFListAdd(&contextMatcher->_rules, contextRule);
+
+    return SFTrue;
+}
+
+static SFBoolean _SFContextMatcherAddRuleSet(SFContextMatcherRef contextMatcher,
+    SFData subtable, SFUInteger length, SFUInteger ruleSetOffset, SFBoolean isChained)
+{
+    SFUInteger ruleCount;
+    SFUInteger ruleIndex;
+
+    if (!_SFContextMatcherRead(subtable, length, ruleSetOffset, &ruleCount)
+        || ruleSetOffset + 2 + (ruleCount * 2) > length) {
+        return SFFalse;
+    }
+
+    for (ruleIndex = 0; ruleIndex < ruleCount; ruleIndex++) {
+        SFUInteger ruleOffset = SFData_UInt16(subtable, ruleSetOffset + 2 + (ruleIndex * 2));
+
+        if (ruleOffset) {
+            if (!_SFContextMatcherAddRule(contextMatcher, subtable, length,
+                                          ruleSetOffset + ruleOffset, isChained, NULL)) {
+                return SFFalse;
+            }
+        }
+    }
+
+    return SFTrue;
+}
+
+static SFUInteger _SFContextMatcherResolveClassDef(SFData subtable, SFUInteger length,
+    SFUInteger fieldOffset, SFTableMapRef classDefMap)
+{
+    SFUInteger classDefOffset;
+
+    if (_SFContextMatcherRead(subtable, length, fieldOffset, &classDefOffset) && classDefOffset) {
+        return SFTableMapGetValue(classDefMap, SFData_Subdata(subtable, classDefOffset));
+    }
+
+    return SFInvalidIndex;
+}
+
+static SFBoolean _SFContextMatcherCompile(SFContextMatcherRef contextMatcher,
+    SFData subtable, SFUInteger length, SFBoolean isChained,
+    SFTableMapRef coverageMap, SFTableMapRef classDefMap)
+{
+    switch (contextMatcher->format) {
+        case 1:
+        case 2: {
+            SFUInteger countOffset;
+            SFUInteger ruleSetCount;
+            SFUInteger setIndex;
+
+            if (contextMatcher->format == 1) {
+                countOffset = 4;
+            } else if (isChained) {
+                contextMatcher->classMaps[SFContextZoneBacktrack] = _SFContextMatcherResolveClassDef(subtable, length, 4, classDefMap);
+                contextMatcher->classMaps[SFContextZoneInput] = _SFContextMatcherResolveClassDef(subtable, length, 6, classDefMap);
+                contextMatcher->classMaps[SFContextZoneLookahead] = _SFContextMatcherResolveClassDef(subtable, length, 8, classDefMap);
+                countOffset = 10;
+            } else {
+                contextMatcher->classMaps[SFContextZoneInput] = _SFContextMatcherResolveClassDef(subtable, length, 4, classDefMap);
+                countOffset = 6;
+            }
+
+            /* The class of first glyph selects the rule set, so input classes must be available. */
+            if (contextMatcher->format == 2 && contextMatcher->classMaps[SFContextZoneInput] == SFInvalidIndex) {
+                return SFFalse;
+            }
+
+            if (!_SFContextMatcherRead(subtable, length, countOffset, &ruleSetCount)
+                || countOffset + 2 + (ruleSetCount * 2) > length) {
+                return SFFalse;
+            }
+
+            contextMatcher->_ruleStarts = SFAllocatorAllocate(&contextMatcher->_rules._allocator,
+                                                              sizeof(SFUInt32) * (ruleSetCount + 1));
+            contextMatcher->_ruleSetCount = ruleSetCount;
+
+            for (setIndex = 0; setIndex < ruleSetCount; setIndex++) {
+                SFUInteger ruleSetOffset = SFData_UInt16(subtable, countOffset + 2 + (setIndex * 2));
+
+                contextMatcher->_ruleStarts[setIndex] = (SFUInt32)contextMatcher->_rules.count;
+
+                /* A missing rule set behaves as an empty one. */
+                if (ruleSetOffset) {
+                    if (!_SFContextMatcherAddRuleSet(contextMatcher, subtable, length, ruleSetOffset, isChained)) {
+                        return SFFalse;
+                    }
+                }
+            }
+
+            contextMatcher->_ruleStarts[ruleSetCount] = (SFUInt32)contextMatcher->_rules.count;
+            return SFTrue;
+        }
+
+        case 3:
+            /* Keep the only rule in a single rule set. */
+            contextMatcher->_ruleStarts = SFAllocatorAllocate(&contextMatcher->_rules._allocator, sizeof(SFUInt32) * 2);
+            contextMatcher->_ruleSetCount = 1;
+
+            if (!_SFContextMatcherAddRule(contextMatcher, subtable, length, 2, isChained, coverageMap)) {
+                return SFFalse;
+            }
+
+            contextMatcher->_ruleStarts[0] = 0;
+            contextMatcher->_ruleStarts[1] = (SFUInt32)contextMatcher->_rules.count;
+            return SFTrue;
+    }
+
+    return SFFalse;
+}
+
+SF_INTERNAL SFBoolean SFContextMatcherInitialize(SFContextMatcherRef contextMatcher, const SFAllocator *allocator,
+    SFData subtable, SFUInteger length, SFBoolean isChained,
+    SFTableMapRef coverageMap, SFTableMapRef classDefMap)
+{
+    SFUInteger format;
+    SFUInteger zone;
+
+    if (!_SFContextMatcherRead(subtable, length, 0, &format)) {
+        return SFFalse;
+    }
+
+    contextMatcher->_subtable = subtable;
+    contextMatcher->_ruleStarts = NULL;
+    contextMatcher->_ruleSetCount = 0;
+    SFListInitialize(&contextMatcher->_rules, sizeof(SFContextRule), allocator);
+    SFListInitialize(&contextMatcher->_values, sizeof(SFUInt32), allocator);
+    contextMatcher->backtrackLimit = 0;
+    contextMatcher->forwardLimit = 0;
+    contextMatcher->format = (SFUInt16)format;
+
+    for (zone = 0; zone < SF_CONTEXT_ZONE_COUNT; zone++) {
+        contextMatcher->classMaps[zone] = SFInvalidIndex;
+    }
+
+    if (!_SFContextMatcherCompile(contextMatcher, subtable, length, isChained, coverageMap, classDefMap)) {
+        SFContextMatcherFinalize(contextMatcher);
+        return SFFalse;
+    }
+
+    SFListTrimExcess(&contextMatcher->_rules);
+    SFListTrimExcess(&contextMatcher->_values);
+
+    return SFTrue;
+}
+
+/**
+ * Ensures that all rules of a matcher read from an image refer to existing values, glyph maps and
+ * lookup records, and that they agree with the limits of the matcher.
+ */
+static SFBoolean _SFContextMatcherValidateImage(SFContextMatcherRef contextMatcher,
+    SFUInteger length, SFUInteger mapCount)
+{
+    SFBoolean includeFirst = (contextMatcher->format == 3);
+    SFUInteger zone;
+    SFUInteger index;
+
+    if (contextMatcher->format < 1 || contextMatcher->format > 3
+        || (contextMatcher->format == 3 && contextMatcher->_ruleSetCount != 1)) {
+        return SFFalse;
+    }
+
+    for (zone = 0; zone < SF_CONTEXT_ZONE_COUNT; zone++) {
+        if (contextMatcher->classMaps[zone] != SFInvalidIndex && contextMatcher->classMaps[zone] >= mapCount) {
+            return SFFalse;
+        }
+    }
+
+    if (contextMatcher->format == 2 && contextMatcher->classMaps[SFContextZoneInput] == SFInvalidIndex) {
+        return SFFalse;
+    }
+
+    for (index = 0; index < contextMatcher->_ruleSetCount; index++) {
+        if (contextMatcher->_ruleStarts[index] > contextMatcher->_ruleStarts[index + 1]) {
+            return SFFalse;
+        }
+    }
+
+    if (contextMatcher->_ruleStarts[0] != 0
+        || contextMatcher->_ruleStarts[contextMatcher->_ruleSetCount] != contextMatcher->_rules.count) {
+        return SFFalse;
+    }
+
+    for (index = 0; index < contextMatcher->_rules.count; index++) {
+        SFContextRuleRef contextRule = SFListGetRef(&contextMatcher->_rules, index);
+        SFUInteger valueCount;
+
+        if (contextRule->inputCount == 0
+            || contextRule->backtrackCount > contextMatcher->backtrackLimit
+            || (SFUInteger)(contextRule->inputCount - 1) + contextRule->lookaheadCount > contextMatcher->forwardLimit
+            || contextRule->lookupArray > length
+            || (SFUInteger)contextRule->lookupCount * 4 > length - contextRule->lookupArray) {
+            return SFFalse;
+        }
+
+        valueCount = (contextRule->inputCount - !includeFirst) + contextRule->backtrackCount + contextRule->lookaheadCount;
+
+        if (contextRule->values > contextMatcher->_values.count
+            || valueCount > contextMatcher->_values.count - contextRule->values) {
+            return SFFalse;
+        }
+
+        /* Class values are meaningful only with the class definition of their zone. */
+        if (contextMatcher->format == 2
+            && ((contextRule->backtrackCount && contextMatcher->classMaps[SFContextZoneBacktrack] == SFInvalidIndex)
+                || (contextRule->lookaheadCount && contextMatcher->classMaps[SFContextZoneLookahead] == SFInvalidIndex))) {
+            return SFFalse;
+        }
+    }
+
+    /* The values of format 3 are glyph map indexes. */
+    if (contextMatcher->format == 3) {
+        for (index = 0; index < contextMatcher->_values.count; index++) {
+            if (contextMatcher->_values.items[index] >= mapCount) {
+                return SFFalse;
+            }
+        }
+    }
+
+    return SFTrue;
+}
+
+SF_INTERNAL SFUInteger SFContextMatcherInitializeWithImage(SFContextMatcherRef contextMatcher,
+    SFData subtable, SFUInteger length, SFUInteger mapCount, const SFUInt8 *image, SFUInteger imageLength)
+{
+    const SFUInt32 *fields = (const SFUInt32 *)image;
+    SFUInteger size = sizeof(SFUInt32) * SF_CONTEXT_MATCHER_IMAGE_FIELDS;
+    SFUInteger ruleSetCount;
+    SFUInteger ruleCount;
+    SFUInteger valueCount;
+    SFUInteger zone;
+
+    if (imageLength < size) {
+        return 0;
+    }
+
+    ruleSetCount = fields[1];
+    ruleCount = fields[2];
+    valueCount = fields[3];
+
+    if (ruleSetCount > SFUInt16Max || (imageLength - size) / sizeof(SFUInt32) < ruleSetCount + 1) {
+        return 0;
+    }
+    contextMatcher->_ruleStarts = (SFUInt32 *)(image + size);
+    size += sizeof(SFUInt32) * (ruleSetCount + 1);
+
+    if ((imageLength - size) / sizeof(SFContextRule) < ruleCount) {
+        return 0;
+    }
+    SFListInitialize(&contextMatcher->_rules, sizeof(SFContextRule), NULL);
+    contextMatcher->_rules.items = (SFContextRule *)(image + size);
+    contextMatcher->_rules.count = ruleCount;
+    contextMatcher->_rules.capacity = ruleCount;
+    size += sizeof(SFContextRule) * ruleCount;
+
+    if ((imageLength - size) / sizeof(SFUInt32) < valueCount) {
+        return 0;
+    }
+    SFListInitialize(&contextMatcher->_values, sizeof(SFUInt32), NULL);
+    contextMatcher->_values.items = (SFUInt32 *)(image + size);
+    contextMatcher->_values.count = valueCount;
+    contextMatcher->_values.capacity = valueCount;
+    size += sizeof(SFUInt32) * valueCount;
+
+    contextMatcher->_subtable = subtable;
+    contextMatcher->_ruleSetCount = ruleSetCount;
+    contextMatcher->backtrackLimit = fields[7];
+    contextMatcher->forwardLimit = fields[8];
+    contextMatcher->format = (SFUInt16)fields[0];
+
+    for (zone = 0; zone < SF_CONTEXT_ZONE_COUNT; zone++) {
+        SFUInt32 classMap = fields[4 + zone];
+        contextMatcher->classMaps[zone] = (classMap == SFUInt32Max ? SFInvalidIndex : classMap);
+    }
+
+    if (fields[0] > SFUInt16Max || !_SFContextMatcherValidateImage(contextMatcher, length, mapCount)) {
+        return 0;
+    }
+
+    return size;
+}
+
+SF_INTERNAL SFUInteger SFContextMatcherWriteImage(SFContextMatcherRef contextMatcher, SFUInt8 *buffer)
+{
+    SFUInteger startSize = sizeof(SFUInt32) * (contextMatcher->_ruleSetCount + 1);
+    SFUInteger ruleSize = sizeof(SFContextRule) * contextMatcher->_rules.count;
+    SFUInteger valueSize = sizeof(SFUInt32) * contextMatcher->_values.count;
+    SFUInt32 fields[SF_CONTEXT_MATCHER_IMAGE_FIELDS];
+    SFUInteger size = sizeof(fields);
+
+    if (buffer) {
+        SFUInteger zone;
+
+        fields[0] = contextMatcher->format;
+        fields[1] = (SFUInt32)contextMatcher->_ruleSetCount;
+        fields[2] = (SFUInt32)contextMatcher->_rules.count;
+        fields[3] = (SFUInt32)contextMatcher->_values.count;
+        fields[7] = (SFUInt32)contextMatcher->backtrackLimit;
+        fields[8] = (SFUInt32)contextMatcher->forwardLimit;
+
+        for (zone = 0; zone < SF_CONTEXT_ZONE_COUNT; zone++) {
+            SFUInteger classMap = contextMatcher->classMaps[zone];
+            fields[4 + zone] = (classMap == SFInvalidIndex ? SFUInt32Max : (SFUInt32)classMap);
+        }
+
+        memcpy(buffer, fields, sizeof(fields));
+        memcpy(buffer + size, contextMatcher->_ruleStarts, startSize);
+        if (ruleSize) {
+            memcpy(buffer + size + startSize, contextMatcher->_rules.items, ruleSize);
+        }
+        if (valueSize) {
+            memcpy(buffer + size + startSize + ruleSize, contextMatcher->_values.items, valueSize);
+        }
+    }
+
+    return size + startSize + ruleSize + valueSize;
+}
+
+SF_INTERNAL void SFContextMatcherFinalize(SFContextMatcherRef contextMatcher)
+{
+    SFAllocatorDeallocate(&contextMatcher->_rules._allocator, contextMatcher->_ruleStarts);
+    SFListFinalize(&contextMatcher->_rules);
+    SFListFinalize(&contextMatcher->_values);
+}
+
+SF_INTERNAL SFContextRuleRef SFContextMatcherGetRules(SFContextMatcherRef contextMatcher,
+    SFUInteger ruleSetIndex, SFUInteger *outRuleCount)
+{
+    if (ruleSetIndex < contextMatcher->_ruleSetCount) {
+        SFUInt32 ruleStart = contextMatcher->_ruleStarts[ruleSetIndex];
+        SFUInt32 ruleEnd = contextMatcher->_ruleStarts[ruleSetIndex + 1];
+
+        if (ruleStart < ruleEnd) {
+            *outRuleCount = ruleEnd - ruleStart;
+            return SFListGetRef(&contextMatcher->_rules, ruleStart);
+        }
+    }
+
+    *outRuleCount = 0;
+    return NULL;
+}
+
+SF_INTERNAL const SFUInt32 *SFContextMatcherGetValues(SFContextMatcherRef contextMatcher, SFContextRuleRef contextRule)
+{
+    return contextMatcher->_values.items + contextRule->values;
+}
+
+SF_INTERNAL SFData SFContextMatcherGetLookupArray(SFContextMatcherRef contextMatcher, SFContextRuleRef contextRule)
+{
+    return SFData_Subdata(contextMatcher->_subtable, contextRule->lookupArray);
+}
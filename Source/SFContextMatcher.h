@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_CONTEXT_MATCHER_H
+#define _SF_INTERNAL_CONTEXT_MATCHER_H
+
+#include <SFConfig.h>
+
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFData.h"
+#include "SFList.h"
+#include "SFTableMap.h"
+
+enum {
+    SFContextZoneInput = 0,
+    SFContextZoneBacktrack = 1,
+    SFContextZoneLookahead = 2
+};
+typedef SFUInt8 SFContextZone;
+
+#define SF_CONTEXT_ZONE_COUNT   3
+
+typedef struct _SFContextRule {
+    SFUInt32 lookupArray;       /**< Offset of the lookup records to apply once the rule matches. */
+    SFUInt32 values;            /**< Index of the first value, in order of input, backtrack and lookahead. */
+    SFUInt16 inputCount;        /**< Number of input glyphs including the first one. */
+    SFUInt16 backtrackCount;    /**< Number of backtrack glyphs. */
+    SFUInt16 lookaheadCount;    /**< Number of lookahead glyphs. */
+    SFUInt16 lookupCount;       /**< Number of lookup records. */
+} SFContextRule, *SFContextRuleRef;
+
+/**
+ * A native form of a contextual or chaining contextual subtable. The rules of all rule sets are
+ * decoded into a flat array along with their values, which are glyph ids in format 1, classes in
+ * format 2 and indexes of compiled coverage glyph maps in format 3. Format 3 has a single rule set
+ * whose rule also carries the value of first input glyph.
+ */
+typedef struct _SFContextMatcher {
+    SFData _subtable;                   /**< The compiled subtable. */
+    SFUInt32 *_ruleStarts;              /**< First rule of each rule set, followed by the rule count. */
+    SFUInteger _ruleSetCount;           /**< Number of rule sets. */
+    SF_LIST(SFContextRule) _rules;      /**< Rules of all rule sets in preference order. */
+    SF_LIST(SFUInt32) _values;          /**< Values of all rules. */
+    SFUInteger classMaps[SF_CONTEXT_ZONE_COUNT]; /**< Glyph map indexes of format 2 class definitions. */
+    SFUInteger backtrackLimit;          /**< Maximum number of backtrack glyphs in any rule. */
+    SFUInteger forwardLimit;            /**< Maximum number of glyphs following the first one in any rule. */
+    SFUInt16 format;                    /**< Format of the compiled subtable. */
+} SFContextMatcher, *SFContextMatcherRef;
+
+/**
+ * Compiles the contextual or chaining contextual subtable. Coverage and class definition tables
+ * are resolved to glyph map indexes through the given table maps. The matcher is allocated with
+ * the given allocator. Returns SFFalse, leaving the matcher uninitialized, if the subtable is
+ * malformed or refers to an uncompiled table.
+ */
+SF_INTERNAL SFBoolean SFContextMatcherInitialize(SFContextMatcherRef contextMatcher, const SFAllocator *allocator,
+    SFData subtable, SFUInteger length, SFBoolean isChained,
+    SFTableMapRef coverageMap, SFTableMapRef classDefMap);
+
+/**
+ * Initializes the matcher of the subtable from an image written by SFContextMatcherWriteImage.
+ * The arrays of the matcher refer to the image in place, so it must not be finalized and the
+ * image must outlive it.
+ *
+ * @param mapCount
+ *      The number of glyph maps that the values and class maps may refer to.
+ * @return
+ *      The size of the image in bytes if it was valid, zero otherwise.
+ */
+SF_INTERNAL SFUInteger SFContextMatcherInitializeWithImage(SFContextMatcherRef contextMatcher,
+    SFData subtable, SFUInteger length, SFUInteger mapCount, const SFUInt8 *image, SFUInteger imageLength);
+SF_INTERNAL void SFContextMatcherFinalize(SFContextMatcherRef contextMatcher);
+
+/**
+ * Writes a self-contained image of the matcher in native byte order.
+ *
+ * @param buffer
+ *      The target buffer that is large enough to hold the image. This parameter can be NULL if
+ *      only the size of the image is needed.
+ * @return
+ *      The size of the image in bytes.
+ */
+SF_INTERNAL SFUInteger SFContextMatcherWriteImage(SFContextMatcherRef contextMatcher, SFUInt8 *buffer);
+
+/**
+ * Returns the first rule of the rule set at specified index, or NULL if the set does not exist.
+ */
+SF_INTERNAL SFContextRuleRef SFContextMatcherGetRules(SFContextMatcherRef contextMatcher,
+    SFUInteger ruleSetIndex, SFUInteger *outRuleCount);
+
+/**
+ * Returns the values of the rule in order of input, backtrack and lookahead glyphs.
+ */
+SF_INTERNAL const SFUInt32 *SFContextMatcherGetValues(SFContextMatcherRef contextMatcher, SFContextRuleRef contextRule);
+
+/**
+ * Returns the lookup records of the rule.
+ */
+SF_INTERNAL SFData SFContextMatcherGetLookupArray(SFContextMatcherRef contextMatcher, SFContextRuleRef contextRule);
+
+#endif
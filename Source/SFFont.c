@@ -17,39 +17,206 @@
 #include <SFConfig.h>
 
 #include <stddef.h>
-#include <stdlib.h>
+#include <string.h>
 
+#include "SFAllocator.h"
 #include "SFBase.h"
+#include "SFCmap.h"
 #include "SFData.h"
 #include "SFFont.h"
+#include "SFFontCache.h"
+#include "SFFontFile.h"
+#include "SFMetrics.h"
 
-static SFUInt8 *_SFFontCopyTable(SFFontRef font, SFTag tag) {
+static void _SFFontFileFinalize(void *object)
+{
+    SFFontFileRelease(object);
+}
+
+static const SFUInt8 *_SFFontFileGetTable(void *object, SFTag tableTag, SFUInteger *length)
+{
+    return SFFontFileGetTable(object, tableTag, length);
+}
+
+/**
+ * The protocol of fonts served by a built-in sfnt file. It only provides the tables, leaving the
+ * glyph IDs and advances to the compiled cmap and the parsed metrics of the font.
+ */
+static const SFFontExtendedProtocol _SFFontFileProtocol = {
+    sizeof(SFFontExtendedProtocol),
+    { _SFFontFileFinalize, NULL, NULL, NULL },
+    _SFFontFileGetTable,
+    NULL,
+    NULL,
+    SFFontOptionParsedMetrics | SFFontOptionCompiledTables
+};
+
+/**
+ * The size of the first version of the extended protocol, which the later ones only append to.
+ */
+#define SF_EXTENDED_PROTOCOL_MIN_SIZE                                   \
+    (offsetof(SFFontExtendedProtocol, getAdvancesForGlyphs)             \
+     + sizeof(SFFontProtocolGetAdvancesForGlyphsFunc))
+
+static SFBoolean _SFFontUsesCmap(const SFFontExtendedProtocol *protocol)
+{
+    return !protocol->base.getGlyphIDForCodepoint && !protocol->getGlyphIDsForCodepoints;
+}
+
+static SFBoolean _SFFontUsesMetrics(const SFFontExtendedProtocol *protocol)
+{
+    return (protocol->options & SFFontOptionParsedMetrics)
+        && !protocol->base.getAdvanceForGlyph && !protocol->getAdvancesForGlyphs;
+}
+
+static SFBoolean _SFFontUsesCompiledTables(const SFFontExtendedProtocol *protocol)
+{
+    return (protocol->options & SFFontOptionCompiledTables) != 0;
+}
+
+static SFData _SFFontGetTable(SFFontRef font, SFTag tag, SFUInteger *outLength, SFBoolean *outOwned)
+{
     SFUInt8 *data = NULL;
     SFUInteger length = 0;
 
-    SFFontLoadTable(font, tag, NULL, &length);
+    /* Borrow the table if the protocol can provide it in place. */
+    if (font->_protocol.getTable) {
+        SFData table = font->_protocol.getTable(font->_object, tag, &length);
 
-    if (length) {
-        data = malloc(length);
-        SFFontLoadTable(font, tag, data, NULL);
+        if (table && length) {
+            *outLength = length;
+            *outOwned = SFFalse;
+
+            return table;
+        }
+
+        length = 0;
     }
 
+    if (font->_protocol.base.loadTable) {
+        SFFontLoadTable(font, tag, NULL, &length);
+
+        if (length) {
+            data = SFAllocatorAllocate(&font->_allocator, length);
+            SFFontLoadTable(font, tag, data, NULL);
+        }
+    }
+
+    *outLength = length;
+    *outOwned = (data != NULL);
+
     return data;
 }
 
-SFFontRef SFFontCreateWithProtocol(const SFFontProtocol *protocol, void *object)
+static void _SFFontReleaseTable(SFFontRef font, SFData table, SFBoolean owned)
 {
-    /* Verify that required functions exist in protocol. */
-    if (protocol && protocol->loadTable && protocol->getGlyphIDForCodepoint) {
-        SFFontRef font = malloc(sizeof(SFFont));
-        font->_protocol = *protocol;
+    if (owned) {
+        SFAllocatorDeallocate(&font->_allocator, (void *)table);
+    }
+}
+
+static void _SFFontLoadMetrics(SFFontRef font, SFFontLayout fontLayout, SFTag headerTag, SFTag metricsTag)
+{
+    SFUInteger headerLength;
+    SFUInteger metricsLength;
+    SFBoolean ownsHeader;
+    SFBoolean ownsMetrics;
+    SFData header = _SFFontGetTable(font, headerTag, &headerLength, &ownsHeader);
+    SFData metrics = _SFFontGetTable(font, metricsTag, &metricsLength, &ownsMetrics);
+
+    SFMetricsLoad(&font->_metrics, &font->_allocator, fontLayout, header, headerLength, metrics, metricsLength);
+
+    _SFFontReleaseTable(font, header, ownsHeader);
+    _SFFontReleaseTable(font, metrics, ownsMetrics);
+}
+
+static void _SFFontGetTables(SFFontRef font, SFData *tables, SFUInteger *lengths)
+{
+    tables[0] = font->tables.gdef;
+    tables[1] = font->tables.gsub;
+    tables[2] = font->tables.gpos;
+    lengths[0] = font->tables.gdefLength;
+    lengths[1] = font->tables.gsubLength;
+    lengths[2] = font->tables.gposLength;
+}
+
+static SFFontRef _SFFontCreate(const SFFontExtendedProtocol *protocol, void *object,
+    const SFAllocator *allocator, const SFUInt8 *cacheData, SFUInteger cacheLength)
+{
+    /* Verify that the protocol is known and that the required functions exist in it. */
+    if (protocol && protocol->size >= SF_EXTENDED_PROTOCOL_MIN_SIZE
+        && (protocol->base.loadTable || protocol->getTable)) {
+        SFUInteger protocolSize = protocol->size;
+        SFAllocator fontAllocator;
+        SFFontRef font;
+
+        if (protocolSize > sizeof(SFFontExtendedProtocol)) {
+            protocolSize = sizeof(SFFontExtendedProtocol);
+        }
+
+        SFAllocatorInitialize(&fontAllocator, allocator);
+
+        font = SFAllocatorAllocate(&fontAllocator, sizeof(SFFont));
+        font->_allocator = fontAllocator;
         font->_object = object;
+
+        /* Leave the fields that the protocol of the host does not know about as NULL. */
+        memset(&font->_protocol, 0, sizeof(SFFontExtendedProtocol));
+        memcpy(&font->_protocol, protocol, protocolSize);
+        font->_protocol.size = sizeof(SFFontExtendedProtocol);
         font->_retainCount = 1;
 
         /* Load open type tables. */
-        font->tables.gdef = _SFFontCopyTable(font, SFTagMake('G', 'D', 'E', 'F'));
-        font->tables.gsub = _SFFontCopyTable(font, SFTagMake('G', 'S', 'U', 'B'));
-        font->tables.gpos = _SFFontCopyTable(font, SFTagMake('G', 'P', 'O', 'S'));
+        font->tables.gdef = _SFFontGetTable(font, SFTagMake('G', 'D', 'E', 'F'),
+                                            &font->tables.gdefLength, &font->tables._ownsGDEF);
+        font->tables.gsub = _SFFontGetTable(font, SFTagMake('G', 'S', 'U', 'B'),
+                                            &font->tables.gsubLength, &font->tables._ownsGSUB);
+        font->tables.gpos = _SFFontGetTable(font, SFTagMake('G', 'P', 'O', 'S'),
+                                            &font->tables.gposLength, &font->tables._ownsGPOS);
+
+        /* Compile the cmap if the protocol leaves the code points to the font. */
+        if (_SFFontUsesCmap(&font->_protocol)) {
+            SFUInteger cmapLength;
+            SFBoolean ownsCmap;
+            SFData cmap = _SFFontGetTable(font, SFTagMake('c', 'm', 'a', 'p'), &cmapLength, &ownsCmap);
+
+            SFCmapInitialize(&font->_cmap, &font->_allocator, cmap, cmapLength);
+            _SFFontReleaseTable(font, cmap, ownsCmap);
+        }
+
+        /* Parse the metrics tables if requested and the protocol leaves the advances to the font. */
+        if (_SFFontUsesMetrics(&font->_protocol)) {
+            SFUInteger headLength;
+            SFBoolean ownsHead;
+            SFData head = _SFFontGetTable(font, SFTagMake('h', 'e', 'a', 'd'), &headLength, &ownsHead);
+
+            SFMetricsInitialize(&font->_metrics, head, headLength);
+            _SFFontReleaseTable(font, head, ownsHead);
+
+            _SFFontLoadMetrics(font, SFFontLayoutHorizontal,
+                               SFTagMake('h', 'h', 'e', 'a'), SFTagMake('h', 'm', 't', 'x'));
+            _SFFontLoadMetrics(font, SFFontLayoutVertical,
+                               SFTagMake('v', 'h', 'e', 'a'), SFTagMake('v', 'm', 't', 'x'));
+        }
+
+        SFFontCacheInitialize(&font->cache, &font->_allocator);
+        SFFontCacheAttachGDEF(&font->cache, font->tables.gdef, font->tables.gdefLength);
+
+        /* Compile the tables if requested so that they can be processed faster. */
+        if (_SFFontUsesCompiledTables(&font->_protocol)) {
+            /* Reuse the compiled glyph maps if available. */
+            if (cacheData) {
+                SFData tables[3];
+                SFUInteger lengths[3];
+
+                _SFFontGetTables(font, tables, lengths);
+                SFFontCacheLoadImage(&font->cache, tables, lengths, 3, cacheData, cacheLength);
+            }
+
+            SFFontCacheLoadGDEF(&font->cache, font->tables.gdef, font->tables.gdefLength);
+            SFFontCacheLoadGSUB(&font->cache, font->tables.gsub, font->tables.gsubLength);
+            SFFontCacheLoadGPOS(&font->cache, font->tables.gpos, font->tables.gposLength);
+        }
 
         return font;
     }
@@ -57,25 +224,193 @@ SFFontRef SFFontCreateWithProtocol(const SFFontProtocol *protocol, void *object)
     return NULL;
 }
 
+static SFFontRef _SFFontCreateWithProtocol(const SFFontProtocol *protocol, void *object,
+    const SFAllocator *allocator, const SFUInt8 *cacheData, SFUInteger cacheLength)
+{
+    /* Verify that required functions exist in protocol. */
+    if (protocol && protocol->loadTable && protocol->getGlyphIDForCodepoint) {
+        SFFontExtendedProtocol extended;
+
+        extended.size = sizeof(SFFontExtendedProtocol);
+        extended.base = *protocol;
+        extended.getTable = NULL;
+        extended.getGlyphIDsForCodepoints = NULL;
+        extended.getAdvancesForGlyphs = NULL;
+        /* Compile the tables so that the fonts of the original protocol are processed faster. */
+        extended.options = SFFontOptionCompiledTables;
+
+        return _SFFontCreate(&extended, object, allocator, cacheData, cacheLength);
+    }
+
+    return NULL;
+}
+
+SFFontRef SFFontCreateWithProtocol(const SFFontProtocol *protocol, void *object)
+{
+    return _SFFontCreateWithProtocol(protocol, object, NULL, NULL, 0);
+}
+
+SFFontRef SFFontCreateWithAllocator(const SFFontProtocol *protocol, void *object,
+    const SFAllocator *allocator)
+{
+    return _SFFontCreateWithProtocol(protocol, object, allocator, NULL, 0);
+}
+
+SFFontRef SFFontCreateWithExtendedProtocol(const SFFontExtendedProtocol *protocol, void *object,
+    const SFAllocator *allocator, const SFUInt8 *cacheData, SFUInteger cacheLength)
+{
+    return _SFFontCreate(protocol, object, allocator, cacheData, cacheLength);
+}
+
+static SFFontRef _SFFontCreateWithFile(SFFontFileRef fontFile,
+    const SFUInt8 *cacheData, SFUInteger cacheLength)
+{
+    if (!fontFile) {
+        return NULL;
+    }
+
+    /* Let the font allocate with the same allocator as its file. */
+    return _SFFontCreate(&_SFFontFileProtocol, fontFile, &fontFile->_allocator, cacheData, cacheLength);
+}
+
+SFFontRef SFFontCreateWithMemory(const SFUInt8 *data, SFUInteger length, SFUInteger faceIndex,
+    const SFAllocator *allocator, const SFUInt8 *cacheData, SFUInteger cacheLength)
+{
+    SFAllocator fontAllocator;
+    SFAllocatorInitialize(&fontAllocator, allocator);
+
+    return _SFFontCreateWithFile(SFFontFileCreateWithMemory(&fontAllocator, data, length, faceIndex),
+                                 cacheData, cacheLength);
+}
+
+SFFontRef SFFontCreateWithFile(const char *path, SFUInteger faceIndex,
+    const SFAllocator *allocator, const SFUInt8 *cacheData, SFUInteger cacheLength)
+{
+    SFAllocator fontAllocator;
+    SFAllocatorInitialize(&fontAllocator, allocator);
+
+    return _SFFontCreateWithFile(SFFontFileCreateWithPath(&fontAllocator, path, faceIndex),
+                                 cacheData, cacheLength);
+}
+
+SFFontRef SFFontCreateWithCache(const SFFontProtocol *protocol, void *object,
+    const SFAllocator *allocator, const SFUInt8 *cacheData, SFUInteger cacheLength)
+{
+    return _SFFontCreateWithProtocol(protocol, object, allocator, cacheData, cacheLength);
+}
+
+void SFFontWriteCache(SFFontRef font, SFUInt8 *buffer, SFUInteger *length)
+{
+    SFData tables[3];
+    SFUInteger lengths[3];
+    SFUInteger size;
+
+    if (_SFFontUsesCompiledTables(&font->_protocol)) {
+        _SFFontGetTables(font, tables, lengths);
+        size = SFFontCacheWriteImage(&font->cache, tables, lengths, 3, buffer);
+    } else {
+        size = 0;
+    }
+
+    if (length) {
+        *length = size;
+    }
+}
+
 SF_INTERNAL void SFFontLoadTable(SFFontRef font, SFTag tableTag, SFUInt8 *buffer, SFUInteger *length)
 {
-    font->_protocol.loadTable(font->_object, tableTag, buffer, length);
+    font->_protocol.base.loadTable(font->_object, tableTag, buffer, length);
 }
 
 SF_INTERNAL SFGlyphID SFFontGetGlyphIDForCodepoint(SFFontRef font, SFCodepoint codepoint)
 {
-    return font->_protocol.getGlyphIDForCodepoint(font->_object, codepoint);
+    if (font->_protocol.base.getGlyphIDForCodepoint) {
+        return font->_protocol.base.getGlyphIDForCodepoint(font->_object, codepoint);
+    }
+
+    if (font->_protocol.getGlyphIDsForCodepoints) {
+        SFGlyphID glyphID;
+        font->_protocol.getGlyphIDsForCodepoints(font->_object, &codepoint, &glyphID, 1);
+
+        return glyphID;
+    }
+
+    return SFCmapGetGlyph(&font->_cmap, codepoint);
+}
+
+SF_INTERNAL void SFFontGetGlyphIDsForCodepoints(SFFontRef font,
+    const SFCodepoint *codepoints, SFGlyphID *glyphIDs, SFUInteger count)
+{
+    SFUInteger index;
+
+    if (!count) {
+        return;
+    }
+
+    if (font->_protocol.getGlyphIDsForCodepoints) {
+        font->_protocol.getGlyphIDsForCodepoints(font->_object, codepoints, glyphIDs, count);
+        return;
+    }
+
+    for (index = 0; index < count; index++) {
+        glyphIDs[index] = SFFontGetGlyphIDForCodepoint(font, codepoints[index]);
+    }
+}
+
+SF_INTERNAL SFCmapRef SFFontGetCmap(SFFontRef font)
+{
+    if (_SFFontUsesCmap(&font->_protocol)) {
+        return &font->_cmap;
+    }
+
+    return NULL;
 }
 
 SF_INTERNAL SFAdvance SFFontGetAdvanceForGlyph(SFFontRef font, SFFontLayout fontLayout, SFGlyphID glyphID)
 {
-    if (font->_protocol.getAdvanceForGlyph) {
-        return font->_protocol.getAdvanceForGlyph(font->_object, fontLayout, glyphID);
+    if (font->_protocol.base.getAdvanceForGlyph) {
+        return font->_protocol.base.getAdvanceForGlyph(font->_object, fontLayout, glyphID);
+    }
+
+    if (font->_protocol.getAdvancesForGlyphs) {
+        SFAdvance advance;
+        font->_protocol.getAdvancesForGlyphs(font->_object, fontLayout, &glyphID, &advance, 1);
+
+        return advance;
+    }
+
+    if (_SFFontUsesMetrics(&font->_protocol)) {
+        return SFMetricsGetAdvance(&font->_metrics, fontLayout, glyphID);
     }
 
     return 0;
 }
 
+SF_INTERNAL void SFFontGetAdvancesForGlyphs(SFFontRef font, SFFontLayout fontLayout,
+    const SFGlyphID *glyphIDs, SFAdvance *advances, SFUInteger count)
+{
+    SFUInteger index;
+
+    if (!count) {
+        return;
+    }
+
+    if (font->_protocol.getAdvancesForGlyphs) {
+        font->_protocol.getAdvancesForGlyphs(font->_object, fontLayout, glyphIDs, advances, count);
+        return;
+    }
+
+    /* Gather the advances from the parsed metrics without going through the protocol. */
+    if (_SFFontUsesMetrics(&font->_protocol)) {
+        SFMetricsGetAdvances(&font->_metrics, fontLayout, glyphIDs, advances, count);
+        return;
+    }
+
+    for (index = 0; index < count; index++) {
+        advances[index] = SFFontGetAdvanceForGlyph(font, fontLayout, glyphIDs[index]);
+    }
+}
+
 SFFontRef SFFontRetain(SFFontRef font)
 {
     if (font) {
@@ -88,12 +423,30 @@ SFFontRef SFFontRetain(SFFontRef font)
 void SFFontRelease(SFFontRef font)
 {
     if (font && --font->_retainCount == 0) {
-        if (font->_protocol.finalize) {
-            font->_protocol.finalize(font->_object);
+        SFAllocator allocator = font->_allocator;
+
+        if (font->_protocol.base.finalize) {
+            font->_protocol.base.finalize(font->_object);
+        }
+        SFFontCacheFinalize(&font->cache);
+
+        if (_SFFontUsesCmap(&font->_protocol)) {
+            SFCmapFinalize(&font->_cmap, &allocator);
+        }
+        if (_SFFontUsesMetrics(&font->_protocol)) {
+            SFMetricsFinalize(&font->_metrics, &allocator);
+        }
+
+        /* Borrowed tables belong to the protocol object. */
+        if (font->tables._ownsGDEF) {
+            SFAllocatorDeallocate(&allocator, (void *)font->tables.gdef);
+        }
+        if (font->tables._ownsGSUB) {
+            SFAllocatorDeallocate(&allocator, (void *)font->tables.gsub);
+        }
+        if (font->tables._ownsGPOS) {
+            SFAllocatorDeallocate(&allocator, (void *)font->tables.gpos);
         }
-        free((void *)font->tables.gdef);
-        free((void *)font->tables.gsub);
-        free((void *)font->tables.gpos);
-        free(font);
+        SFAllocatorDeallocate(&allocator, font);
     }
 }
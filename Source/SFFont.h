@@ -20,24 +20,60 @@
 #include <SFConfig.h>
 #include <SFFont.h>
 
+#include "SFAllocator.h"
 #include "SFBase.h"
+#include "SFCmap.h"
 #include "SFData.h"
+#include "SFFontCache.h"
+#include "SFMetrics.h"
 
 typedef struct _SFFontTables {
     SFData gdef;
     SFData gsub;
     SFData gpos;
+    SFUInteger gdefLength;
+    SFUInteger gsubLength;
+    SFUInteger gposLength;
+    SFBoolean _ownsGDEF;    /**< Whether the GDEF table was copied by the font. */
+    SFBoolean _ownsGSUB;    /**< Whether the GSUB table was copied by the font. */
+    SFBoolean _ownsGPOS;    /**< Whether the GPOS table was copied by the font. */
 } SFFontTables;
 
 typedef struct _SFFont {
-    SFFontProtocol _protocol;
+    SFFontExtendedProtocol _protocol;
     void *_object;
     SFFontTables tables;
+    SFFontCache cache;
+    SFCmap _cmap;               /**< Compiled cmap, used if the protocol does not map code points. */
+    SFMetrics _metrics;         /**< Parsed advances, used on request if the protocol does not give them. */
+    SFAllocator _allocator;
     SFUInteger _retainCount;
 } SFFont;
 
+/**
+ * Number of code points or glyphs handed to the font at once by the text processor.
+ */
+#define SF_FONT_BATCH_SIZE  64
+
 SF_INTERNAL void SFFontLoadTable(SFFontRef font, SFTag tableTag, SFUInt8 *buffer, SFUInteger *length);
 SF_INTERNAL SFGlyphID SFFontGetGlyphIDForCodepoint(SFFontRef font, SFCodepoint codepoint);
+
+/**
+ * Gets the glyph IDs of a run of code points, preferring the batch function of the protocol.
+ */
+SF_INTERNAL void SFFontGetGlyphIDsForCodepoints(SFFontRef font,
+    const SFCodepoint *codepoints, SFGlyphID *glyphIDs, SFUInteger count);
+
+/**
+ * Returns the compiled cmap of the font, or NULL if the code points are mapped by its protocol.
+ */
+SF_INTERNAL SFCmapRef SFFontGetCmap(SFFontRef font);
 SF_INTERNAL SFAdvance SFFontGetAdvanceForGlyph(SFFontRef font, SFFontLayout fontLayout, SFGlyphID glyphID);
 
+/**
+ * Gets the advances of a run of glyphs, preferring the batch function of the protocol.
+ */
+SF_INTERNAL void SFFontGetAdvancesForGlyphs(SFFontRef font, SFFontLayout fontLayout,
+    const SFGlyphID *glyphIDs, SFAdvance *advances, SFUInteger count);
+
 #endif
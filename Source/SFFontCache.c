@@ -0,0 +1,1887 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <SFConfig.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#include "SFAlbum.h"
+#include "SFAllocator.h"
+#include "SFAssert.h"
+#include "SFBase.h"
+#include "SFCommon.h"
+#include "SFData.h"
+#include "SFGDEF.h"
+#include "SFGlyphDigest.h"
+#include "SFGlyphMap.h"
+#include "SFGPOS.h"
+#include "SFGSUB.h"
+#include "SFLigatureTrie.h"
+#include "SFList.h"
+#include "SFOpenType.h"
+#include "SFPairIndex.h"
+#include "SFTableMap.h"
+#include "SFFontCache.h"
+
+/**
+ * Identifies the image of a font cache written in native byte order.
+ */
+#define SF_FONT_CACHE_IMAGE_MAGIC       0x53464349
+#define SF_FONT_CACHE_IMAGE_VERSION     3
+#define SF_FONT_CACHE_IMAGE_TABLES      3
+
+/**
+ * Number of 32-bit fields in the header of an image, followed by the hash and length of each table.
+ */
+#define SF_FONT_CACHE_IMAGE_FIELDS      (3 + (SF_FONT_CACHE_IMAGE_TABLES * 2))
+
+/**
+ * Alignment of each array written after the glyph maps of an image, preceded by its item count.
+ */
+#define SF_FONT_CACHE_IMAGE_ALIGNMENT   4
+
+/**
+ * Sections of native subtables written after the arrays of an image, each one holding a count
+ * followed by the origin and image of every subtable.
+ */
+enum {
+    _SFImageSectionLigatureTries = 0,
+    _SFImageSectionContextMatchers = 1
+};
+typedef SFUInteger _SFImageSection;
+
+#define _SFImageSectionCount            2
+
+/**
+ * Maximum number of words taken by the bitsets of all mark glyph sets, enough for eight sets
+ * spanning every glyph id. The sets that do not fit are searched in their coverages.
+ */
+#define SF_MARK_GLYPH_SET_WORD_LIMIT    (8 * (0x10000 / 32))
+
+/**
+ * A function that compiles a table into the glyph map.
+ */
+typedef SFBoolean (*_SFGlyphMapInitializer)(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFData table, SFUInteger length);
+
+/**
+ * A function that compiles the tables referred by a lookup subtable lying at specified offset.
+ */
+typedef void (*_SFSubtableLoader)(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+                                  SFLookupType lookupType, SFUInteger subtableOffset);
+
+/**
+ * A function that returns the offset of the coverage table which decides whether a lookup subtable
+ * lying at specified offset applies at a glyph, or zero if there is no such table.
+ */
+typedef SFUInteger (*_SFCoverageLocator)(SFData table, SFUInteger length,
+                                         SFLookupType lookupType, SFUInteger subtableOffset);
+
+static SFUInteger _SFFontCacheReadUInt16(SFData table, SFUInteger length, SFUInteger offset);
+static SFUInteger _SFFontCacheReadUInt32(SFData table, SFUInteger length, SFUInteger offset);
+
+static SFUInt32 _SFFontCacheHashTable(SFData table, SFUInteger length);
+static SFBoolean _SFFontCacheMatchImageHeader(const SFUInt32 *header,
+    const SFData *tables, const SFUInteger *lengths, SFUInteger tableCount);
+static SFUInteger _SFFontCacheAlignSize(SFUInteger size);
+static void _SFFontCacheDeallocateArray(SFFontCacheRef fontCache, void *array);
+static SFUInteger _SFFontCacheReadImageArray(const SFUInt8 *image, SFUInteger imageLength, SFUInteger offset,
+    SFUInteger itemSize, SFUInteger maxCount, void **outItems, SFUInteger *outCount);
+static SFUInteger _SFFontCacheLoadImageArrays(SFFontCacheRef fontCache, const SFUInt8 *image,
+    SFUInteger imageLength, SFUInteger offset, SFBoolean isApplied);
+static SFUInteger _SFFontCacheWriteImageArray(SFUInt8 *buffer, SFUInteger size,
+    const void *items, SFUInteger count, SFUInteger itemSize);
+static SFUInteger _SFFontCacheLoadImageSubtable(SFFontCacheRef fontCache, _SFImageSection section,
+    SFData subtable, SFUInteger length, SFUInteger mapCount,
+    const SFUInt8 *image, SFUInteger imageLength, SFBoolean isApplied);
+static SFUInteger _SFFontCacheLoadImageSection(SFFontCacheRef fontCache, _SFImageSection section,
+    const SFData *tables, const SFUInteger *lengths, SFUInteger tableCount, SFUInteger mapCount,
+    const SFUInt8 *image, SFUInteger imageLength, SFUInteger offset, SFBoolean isApplied);
+static SFUInteger _SFFontCacheWriteImageSection(SFFontCacheRef fontCache, _SFImageSection section,
+    const SFData *tables, const SFUInteger *lengths, SFUInteger tableCount, SFUInteger mapCount,
+    SFUInt8 *buffer, SFUInteger size);
+static void _SFFontCacheAddGlyphMap(SFFontCacheRef fontCache, SFTableMapRef tableMap,
+    _SFGlyphMapInitializer initializer, SFData table, SFUInteger length, SFUInteger tableOffset);
+static void _SFFontCacheAddCoverage(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger parentOffset, SFUInteger fieldOffset);
+static void _SFFontCacheAddClassDef(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger parentOffset, SFUInteger fieldOffset);
+static void _SFFontCacheAddLigatureTrie(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger subtableOffset);
+static void _SFFontCacheAddContextMatcher(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger subtableOffset, SFBoolean isChained);
+static void _SFFontCacheAddPairIndex(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger subtableOffset);
+static SFGlyphTraits _SFFontCacheConvertGlyphClass(SFUInt16 glyphClass);
+static void _SFFontCacheLoadGlyphTraits(SFFontCacheRef fontCache, SFData gdefTable, SFUInteger length);
+static void _SFFontCacheLoadMarkAttachClasses(SFFontCacheRef fontCache, SFData gdefTable, SFUInteger length);
+static void _SFFontCacheLoadMarkGlyphSets(SFFontCacheRef fontCache, SFData gdefTable, SFUInteger length,
+    SFUInteger markGlyphSetsOffset);
+static void _SFFontCacheLoadContextSubtable(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger subtableOffset);
+static void _SFFontCacheLoadChainContextSubtable(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger subtableOffset);
+static SFUInteger _SFFontCacheResolveExtension(SFData table, SFUInteger length, SFUInteger subtableOffset,
+    SFLookupType *outLookupType);
+static void _SFFontCacheLoadSubstitutionSubtable(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFLookupType lookupType, SFUInteger subtableOffset);
+static void _SFFontCacheLoadPositioningSubtable(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFLookupType lookupType, SFUInteger subtableOffset);
+static SFUInteger _SFFontCacheLocateField(SFData table, SFUInteger length, SFUInteger parentOffset,
+    SFUInteger fieldOffset);
+static SFUInteger _SFFontCacheLocateContextCoverage(SFData table, SFUInteger length, SFUInteger subtableOffset);
+static SFUInteger _SFFontCacheLocateChainContextCoverage(SFData table, SFUInteger length,
+    SFUInteger subtableOffset);
+static SFUInteger _SFFontCacheLocateSubstitutionCoverage(SFData table, SFUInteger length,
+    SFLookupType lookupType, SFUInteger subtableOffset);
+static SFUInteger _SFFontCacheLocatePositioningCoverage(SFData table, SFUInteger length,
+    SFLookupType lookupType, SFUInteger subtableOffset);
+static SFBoolean _SFFontCacheAddCoverageDigest(SFGlyphDigestRef glyphDigest, SFData table, SFUInteger length,
+    SFUInteger coverageOffset);
+static void _SFLookupInfosInitialize(SFLookupInfosRef lookupInfos, const SFAllocator *allocator);
+static void _SFLookupInfosFinalize(SFLookupInfosRef lookupInfos, const SFAllocator *allocator);
+static void _SFFontCacheAddLookupInfo(SFLookupInfosRef lookupInfos, SFLookupInfoRef lookupInfo,
+    SFData table, SFUInteger length, SFUInteger lookupOffset, SFLookupType extensionType);
+static void _SFFontCacheLoadLookupList(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    _SFSubtableLoader subtableLoader, _SFCoverageLocator coverageLocator, SFLookupType extensionType,
+    SFLookupDigestsRef lookupDigests, SFLookupInfosRef lookupInfos);
+
+SF_INTERNAL void SFFontCacheInitialize(SFFontCacheRef fontCache, const SFAllocator *allocator)
+{
+    SFAllocatorInitialize(&fontCache->_allocator, allocator);
+    allocator = &fontCache->_allocator;
+
+    SFListInitialize(&fontCache->_glyphMaps, sizeof(SFGlyphMap), allocator);
+    SFListInitialize(&fontCache->_glyphMapOrigins, sizeof(SFGlyphMapOrigin), allocator);
+    fontCache->_imageMapCount = 0;
+    fontCache->_imageLigatureTrieCount = 0;
+    fontCache->_imageContextMatcherCount = 0;
+    fontCache->_image = NULL;
+    fontCache->_imageLength = 0;
+    SFTableMapInitialize(&fontCache->_coverageMap, allocator);
+    SFTableMapInitialize(&fontCache->_classDefMap, allocator);
+    SFListInitialize(&fontCache->_pairIndexes, sizeof(SFPairIndex), allocator);
+    SFTableMapInitialize(&fontCache->_pairIndexMap, allocator);
+    SFListInitialize(&fontCache->_ligatureTries, sizeof(SFLigatureTrie), allocator);
+    SFTableMapInitialize(&fontCache->_ligatureTrieMap, allocator);
+    SFListInitialize(&fontCache->_contextMatchers, sizeof(SFContextMatcher), allocator);
+    SFTableMapInitialize(&fontCache->_contextMatcherMap, allocator);
+    fontCache->_glyphClassDef = NULL;
+    fontCache->_glyphTraits = NULL;
+    fontCache->_glyphTraitCount = 0;
+    fontCache->_markAttachClasses = NULL;
+    fontCache->_markAttachClassCount = 0;
+    fontCache->_markGlyphSets = NULL;
+    fontCache->_markGlyphSetCount = 0;
+    fontCache->_markGlyphSetWords = NULL;
+    fontCache->_markGlyphSetWordCount = 0;
+    fontCache->gsubDigests.items = NULL;
+    fontCache->gsubDigests.count = 0;
+    fontCache->gposDigests.items = NULL;
+    fontCache->gposDigests.count = 0;
+    _SFLookupInfosInitialize(&fontCache->gsubLookups, allocator);
+    _SFLookupInfosInitialize(&fontCache->gposLookups, allocator);
+}
+
+SF_INTERNAL void SFFontCacheFinalize(SFFontCacheRef fontCache)
+{
+    SFUInteger index;
+
+    /* The glyph maps loaded from an image do not own their arrays. */
+    for (index = fontCache->_imageMapCount; index < fontCache->_glyphMaps.count; index++) {
+        SFGlyphMapFinalize(SFListGetRef(&fontCache->_glyphMaps, index), &fontCache->_allocator);
+    }
+
+    for (index = fontCache->_imageLigatureTrieCount; index < fontCache->_ligatureTries.count; index++) {
+        SFLigatureTrieFinalize(SFListGetRef(&fontCache->_ligatureTries, index));
+    }
+
+    for (index = fontCache->_imageContextMatcherCount; index < fontCache->_contextMatchers.count; index++) {
+        SFContextMatcherFinalize(SFListGetRef(&fontCache->_contextMatchers, index));
+    }
+
+    SFListFinalize(&fontCache->_glyphMaps);
+    SFListFinalize(&fontCache->_glyphMapOrigins);
+    SFTableMapFinalize(&fontCache->_coverageMap);
+    SFTableMapFinalize(&fontCache->_classDefMap);
+    SFListFinalize(&fontCache->_pairIndexes);
+    SFTableMapFinalize(&fontCache->_pairIndexMap);
+    SFListFinalize(&fontCache->_ligatureTries);
+    SFTableMapFinalize(&fontCache->_ligatureTrieMap);
+    SFListFinalize(&fontCache->_contextMatchers);
+    SFTableMapFinalize(&fontCache->_contextMatcherMap);
+    _SFFontCacheDeallocateArray(fontCache, fontCache->_glyphTraits);
+    _SFFontCacheDeallocateArray(fontCache, fontCache->_markAttachClasses);
+    _SFFontCacheDeallocateArray(fontCache, fontCache->_markGlyphSets);
+    _SFFontCacheDeallocateArray(fontCache, fontCache->_markGlyphSetWords);
+    _SFFontCacheDeallocateArray(fontCache, fontCache->gsubDigests.items);
+    _SFFontCacheDeallocateArray(fontCache, fontCache->gposDigests.items);
+    _SFLookupInfosFinalize(&fontCache->gsubLookups, &fontCache->_allocator);
+    _SFLookupInfosFinalize(&fontCache->gposLookups, &fontCache->_allocator);
+}
+
+static void _SFLookupInfosInitialize(SFLookupInfosRef lookupInfos, const SFAllocator *allocator)
+{
+    lookupInfos->items = NULL;
+    lookupInfos->count = 0;
+    SFListInitialize(&lookupInfos->_subtables, sizeof(SFSubtableInfo), allocator);
+}
+
+static void _SFLookupInfosFinalize(SFLookupInfosRef lookupInfos, const SFAllocator *allocator)
+{
+    SFAllocatorDeallocate(allocator, lookupInfos->items);
+    SFListFinalize(&lookupInfos->_subtables);
+}
+
+/**
+ * Reads a 16-bit value lying within the table, returning zero if it is out of bounds. Since a
+ * zero offset or count does not refer to anything, malformed tables are simply left uncompiled.
+ */
+static SFUInteger _SFFontCacheReadUInt16(SFData table, SFUInteger length, SFUInteger offset)
+{
+    if (offset < length && length - offset >= 2) {
+        return SFData_UInt16(table, offset);
+    }
+
+    return 0;
+}
+
+static SFUInteger _SFFontCacheReadUInt32(SFData table, SFUInteger length, SFUInteger offset)
+{
+    if (offset < length && length - offset >= 4) {
+        return SFData_UInt32(table, offset);
+    }
+
+    return 0;
+}
+
+/**
+ * Computes the 32-bit MurmurHash3 of the table bytes, reading them as big endian words so that
+ * the whole table is mixed four bytes at a time.
+ */
+static SFUInt32 _SFFontCacheHashTable(SFData table, SFUInteger length)
+{
+    SFUInt32 hash = 0;
+    SFUInt32 tail = 0;
+    SFUInteger index;
+
+    for (index = 0; length - index >= 4; index += 4) {
+        SFUInt32 word = SFData_UInt32(table, index) * 0xCC9E2D51U;
+        word = ((word << 15) | (word >> 17)) * 0x1B873593U;
+
+        hash ^= word;
+        hash = (hash << 13) | (hash >> 19);
+        hash = (hash * 5) + 0xE6546B64U;
+    }
+
+    if (index < length) {
+        for (; index < length; index++) {
+            tail = (tail << 8) | table[index];
+        }
+
+        tail *= 0xCC9E2D51U;
+        tail = ((tail << 15) | (tail >> 17)) * 0x1B873593U;
+        hash ^= tail;
+    }
+
+    hash ^= (SFUInt32)length;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BU;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35U;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+static SFBoolean _SFFontCacheMatchImageHeader(const SFUInt32 *header,
+    const SFData *tables, const SFUInteger *lengths, SFUInteger tableCount)
+{
+    SFUInteger index;
+
+    if (header[0] != SF_FONT_CACHE_IMAGE_MAGIC || header[1] != SF_FONT_CACHE_IMAGE_VERSION
+        || tableCount != SF_FONT_CACHE_IMAGE_TABLES) {
+        return SFFalse;
+    }
+
+    for (index = 0; index < tableCount; index++) {
+        const SFUInt32 *tableFields = &header[3 + (index * 2)];
+        SFUInteger length = (tables[index] ? lengths[index] : 0);
+
+        if (tableFields[1] != length) {
+            return SFFalse;
+        }
+        if (length && tableFields[0] != _SFFontCacheHashTable(tables[index], length)) {
+            return SFFalse;
+        }
+    }
+
+    return SFTrue;
+}
+
+static SFUInteger _SFFontCacheAlignSize(SFUInteger size)
+{
+    return (size + (SF_FONT_CACHE_IMAGE_ALIGNMENT - 1)) & ~(SFUInteger)(SF_FONT_CACHE_IMAGE_ALIGNMENT - 1);
+}
+
+/**
+ * Deallocates an array of the cache unless it is borrowed from the image.
+ */
+static void _SFFontCacheDeallocateArray(SFFontCacheRef fontCache, void *array)
+{
+    const SFUInt8 *bytes = array;
+
+    if (fontCache->_image && bytes >= fontCache->_image && bytes < fontCache->_image + fontCache->_imageLength) {
+        return;
+    }
+
+    SFAllocatorDeallocate(&fontCache->_allocator, array);
+}
+
+/**
+ * Reads an array lying at specified offset of the image, returning the offset following it, or
+ * zero if the array does not fit in the image or has more than the given number of items.
+ */
+static SFUInteger _SFFontCacheReadImageArray(const SFUInt8 *image, SFUInteger imageLength, SFUInteger offset,
+    SFUInteger itemSize, SFUInteger maxCount, void **outItems, SFUInteger *outCount)
+{
+    SFUInteger count;
+    SFUInteger arraySize;
+
+    if (imageLength - offset < sizeof(SFUInt32)) {
+        return 0;
+    }
+
+    count = *(const SFUInt32 *)(image + offset);
+    offset += sizeof(SFUInt32);
+
+    if (count > maxCount) {
+        return 0;
+    }
+
+    arraySize = _SFFontCacheAlignSize(itemSize * count);
+
+    if (imageLength - offset < arraySize) {
+        return 0;
+    }
+
+    *outItems = (count ? (void *)(image + offset) : NULL);
+    *outCount = count;
+
+    return offset + arraySize;
+}
+
+/**
+ * Validates the arrays following the glyph maps of the image and borrows them if asked, returning
+ * the offset following them, or zero if any of them is invalid.
+ */
+static SFUInteger _SFFontCacheLoadImageArrays(SFFontCacheRef fontCache, const SFUInt8 *image,
+    SFUInteger imageLength, SFUInteger offset, SFBoolean isApplied)
+{
+    SFUInteger glyphWords = ((SFUInteger)SFUInt16Max + 1) >> 5;
+    void *items[6];
+    SFUInteger counts[6];
+    SFMarkGlyphSet *markGlyphSets;
+    SFUInteger index;
+
+    offset = _SFFontCacheReadImageArray(image, imageLength, offset, sizeof(SFGlyphDigest), SFUInt16Max,
+                                        &items[0], &counts[0]);
+    offset = (offset ? _SFFontCacheReadImageArray(image, imageLength, offset, sizeof(SFGlyphDigest), SFUInt16Max,
+                                                  &items[1], &counts[1]) : 0);
+    offset = (offset ? _SFFontCacheReadImageArray(image, imageLength, offset, sizeof(SFGlyphTraits), SFUInt16Max + 1,
+                                                  &items[2], &counts[2]) : 0);
+    offset = (offset ? _SFFontCacheReadImageArray(image, imageLength, offset, sizeof(SFUInt8), SFUInt16Max + 1,
+                                                  &items[3], &counts[3]) : 0);
+    offset = (offset ? _SFFontCacheReadImageArray(image, imageLength, offset, sizeof(SFMarkGlyphSet), SFUInt16Max,
+                                                  &items[4], &counts[4]) : 0);
+    offset = (offset ? _SFFontCacheReadImageArray(image, imageLength, offset, sizeof(SFUInt32),
+                                                  SF_MARK_GLYPH_SET_WORD_LIMIT, &items[5], &counts[5]) : 0);
+
+    if (!offset) {
+        return 0;
+    }
+
+    /* Make sure that the bitset of each mark glyph set lies within the words. */
+    markGlyphSets = items[4];
+
+    for (index = 0; index < counts[4]; index++) {
+        SFMarkGlyphSet *markGlyphSet = &markGlyphSets[index];
+
+        if (markGlyphSet->wordCount > counts[5] || markGlyphSet->wordOffset > counts[5] - markGlyphSet->wordCount
+            || markGlyphSet->firstWord > glyphWords || markGlyphSet->wordCount > glyphWords - markGlyphSet->firstWord) {
+            return 0;
+        }
+    }
+
+    if (isApplied) {
+        fontCache->gsubDigests.items = items[0];
+        fontCache->gsubDigests.count = counts[0];
+        fontCache->gposDigests.items = items[1];
+        fontCache->gposDigests.count = counts[1];
+        fontCache->_glyphTraits = items[2];
+        fontCache->_glyphTraitCount = counts[2];
+        fontCache->_markAttachClasses = items[3];
+        fontCache->_markAttachClassCount = counts[3];
+        fontCache->_markGlyphSets = markGlyphSets;
+        fontCache->_markGlyphSetCount = counts[4];
+        fontCache->_markGlyphSetWords = items[5];
+        fontCache->_markGlyphSetWordCount = counts[5];
+    }
+
+    return offset;
+}
+
+/**
+ * Writes an array preceded by its item count at specified offset of the buffer, returning the
+ * offset following it.
+ */
+static SFUInteger _SFFontCacheWriteImageArray(SFUInt8 *buffer, SFUInteger size,
+    const void *items, SFUInteger count, SFUInteger itemSize)
+{
+    SFUInteger arraySize = itemSize * count;
+    SFUInteger alignedSize = _SFFontCacheAlignSize(arraySize);
+
+    if (buffer) {
+        SFUInt32 field = (SFUInt32)count;
+
+        memcpy(buffer + size, &field, sizeof(field));
+        if (arraySize) {
+            memcpy(buffer + size + sizeof(field), items, arraySize);
+        }
+        memset(buffer + size + sizeof(field) + arraySize, 0, alignedSize - arraySize);
+    }
+
+    return size + sizeof(SFUInt32) + alignedSize;
+}
+
+/**
+ * Validates the image of a native subtable and adds it to the cache if asked, returning its size,
+ * or zero if it is invalid.
+ */
+static SFUInteger _SFFontCacheLoadImageSubtable(SFFontCacheRef fontCache, _SFImageSection section,
+    SFData subtable, SFUInteger length, SFUInteger mapCount,
+    const SFUInt8 *image, SFUInteger imageLength, SFBoolean isApplied)
+{
+    SFUInteger size = 0;
+
+    switch (section) {
+        case _SFImageSectionLigatureTries: {
+            SFLigatureTrie ligatureTrie;
+
+            size = SFLigatureTrieInitializeWithImage(&ligatureTrie, subtable, image, imageLength);
+
+            if (size && isApplied) {
+                SFTableMapSetValue(&fontCache->_ligatureTrieMap, subtable, fontCache->_ligatureTries.count);
+                SFListAdd(&fontCache->_ligatureTries, ligatureTrie);
+            }
+            break;
+        }
+
+        case _SFImageSectionContextMatchers: {
+            SFContextMatcher contextMatcher;
+
+            size = SFContextMatcherInitializeWithImage(&contextMatcher, subtable, length, mapCount,
+                                                       image, imageLength);
+
+            if (size && isApplied) {
+                SFTableMapSetValue(&fontCache->_contextMatcherMap, subtable, fontCache->_contextMatchers.count);
+                SFListAdd(&fontCache->_contextMatchers, contextMatcher);
+            }
+            break;
+        }
+    }
+
+    return size;
+}
+
+/**
+ * Validates a section of native subtables and loads them if asked, returning the offset
+ * following the section, or zero if any of its subtables is invalid.
+ */
+static SFUInteger _SFFontCacheLoadImageSection(SFFontCacheRef fontCache, _SFImageSection section,
+    const SFData *tables, const SFUInteger *lengths, SFUInteger tableCount, SFUInteger mapCount,
+    const SFUInt8 *image, SFUInteger imageLength, SFUInteger offset, SFBoolean isApplied)
+{
+    SFUInteger subtableCount;
+    SFUInteger subtableIndex;
+
+    if (imageLength - offset < sizeof(SFUInt32)) {
+        return 0;
+    }
+
+    subtableCount = *(const SFUInt32 *)(image + offset);
+    offset += sizeof(SFUInt32);
+
+    for (subtableIndex = 0; subtableIndex < subtableCount; subtableIndex++) {
+        const SFUInt32 *origin = (const SFUInt32 *)(image + offset);
+        SFUInteger tableIndex;
+        SFUInteger tableOffset;
+        SFUInteger subtableSize;
+
+        if (imageLength - offset < sizeof(SFUInt32) * 2) {
+            return 0;
+        }
+
+        tableIndex = origin[0];
+        tableOffset = origin[1];
+        offset += sizeof(SFUInt32) * 2;
+
+        if (tableIndex >= tableCount || !tables[tableIndex] || tableOffset >= lengths[tableIndex]) {
+            return 0;
+        }
+
+        subtableSize = _SFFontCacheLoadImageSubtable(fontCache, section,
+                                                     SFData_Subdata(tables[tableIndex], tableOffset),
+                                                     lengths[tableIndex] - tableOffset, mapCount,
+                                                     image + offset, imageLength - offset, isApplied);
+
+        if (!subtableSize) {
+            return 0;
+        }
+
+        offset += subtableSize;
+    }
+
+    return offset;
+}
+
+/**
+ * Writes a section of native subtables belonging to the given tables at specified offset of the
+ * buffer, returning the offset following it. The map count is the number of glyph maps written
+ * before the section.
+ */
+static SFUInteger _SFFontCacheWriteImageSection(SFFontCacheRef fontCache, _SFImageSection section,
+    const SFData *tables, const SFUInteger *lengths, SFUInteger tableCount, SFUInteger mapCount,
+    SFUInt8 *buffer, SFUInteger size)
+{
+    SFUInteger countOffset = size;
+    SFUInteger itemCount;
+    SFUInteger subtableCount = 0;
+    SFUInteger itemIndex;
+
+    switch (section) {
+        case _SFImageSectionLigatureTries:
+            itemCount = fontCache->_ligatureTries.count;
+            break;
+
+        default:
+            /* The matchers refer to glyph maps by index, which hold only if all of them are written. */
+            itemCount = (mapCount == fontCache->_glyphMaps.count ? fontCache->_contextMatchers.count : 0);
+            break;
+    }
+
+    size += sizeof(SFUInt32);
+
+    for (itemIndex = 0; itemIndex < itemCount; itemIndex++) {
+        SFLigatureTrieRef ligatureTrie = NULL;
+        SFContextMatcherRef contextMatcher = NULL;
+        SFData subtable;
+        SFUInteger tableIndex;
+
+        switch (section) {
+            case _SFImageSectionLigatureTries:
+                ligatureTrie = SFListGetRef(&fontCache->_ligatureTries, itemIndex);
+                subtable = ligatureTrie->_subtable;
+                break;
+
+            default:
+                contextMatcher = SFListGetRef(&fontCache->_contextMatchers, itemIndex);
+                subtable = contextMatcher->_subtable;
+                break;
+        }
+
+        if (!subtable) {
+            continue;
+        }
+
+        for (tableIndex = 0; tableIndex < tableCount; tableIndex++) {
+            if (tables[tableIndex] && subtable >= tables[tableIndex]
+                && subtable < tables[tableIndex] + lengths[tableIndex]) {
+                break;
+            }
+        }
+
+        /* Skip the subtables not belonging to any of the tables. */
+        if (tableIndex == tableCount) {
+            continue;
+        }
+
+        if (buffer) {
+            SFUInt32 fields[2];
+
+            fields[0] = (SFUInt32)tableIndex;
+            fields[1] = (SFUInt32)(subtable - tables[tableIndex]);
+
+            memcpy(buffer + size, fields, sizeof(fields));
+        }
+
+        size += sizeof(SFUInt32) * 2;
+
+        if (ligatureTrie) {
+            size += SFLigatureTrieWriteImage(ligatureTrie, buffer ? buffer + size : NULL);
+        } else {
+            size += SFContextMatcherWriteImage(contextMatcher, buffer ? buffer + size : NULL);
+        }
+
+        subtableCount += 1;
+    }
+
+    if (buffer) {
+        SFUInt32 field = (SFUInt32)subtableCount;
+        memcpy(buffer + countOffset, &field, sizeof(field));
+    }
+
+    return size;
+}
+
+SF_INTERNAL SFBoolean SFFontCacheLoadImage(SFFontCacheRef fontCache,
+    const SFData *tables, const SFUInteger *lengths, SFUInteger tableCount,
+    const SFUInt8 *image, SFUInteger imageLength)
+{
+    const SFUInt32 *header = (const SFUInt32 *)image;
+    SFUInteger headerSize = sizeof(SFUInt32) * SF_FONT_CACHE_IMAGE_FIELDS;
+    SFUInteger mapCount;
+    SFUInteger pass;
+    _SFImageSection section;
+
+    /* The cache must be empty. */
+    SFAssert(fontCache->_glyphMaps.count == 0);
+
+    /* The image is read in place, so it must be aligned for 32-bit fields. */
+    if (!image || ((size_t)image & (sizeof(SFUInt32) - 1)) || imageLength < headerSize
+        || !_SFFontCacheMatchImageHeader(header, tables, lengths, tableCount)) {
+        return SFFalse;
+    }
+
+    mapCount = header[2];
+
+    /* Validate all glyph maps and arrays before loading any of them. */
+    for (pass = 0; pass < 2; pass++) {
+        SFUInteger offset = headerSize;
+        SFUInteger mapIndex;
+
+        for (mapIndex = 0; mapIndex < mapCount; mapIndex++) {
+            const SFUInt32 *origin = (const SFUInt32 *)(image + offset);
+            SFUInteger tableIndex;
+            SFUInteger tableOffset;
+            SFUInteger mapSize;
+            SFGlyphMap glyphMap;
+
+            if (imageLength - offset < sizeof(SFUInt32) * 2) {
+                return SFFalse;
+            }
+
+            tableIndex = origin[0] >> 1;
+            tableOffset = origin[1];
+            offset += sizeof(SFUInt32) * 2;
+
+            if (tableIndex >= tableCount || !tables[tableIndex] || tableOffset >= lengths[tableIndex]) {
+                return SFFalse;
+            }
+
+            mapSize = SFGlyphMapInitializeWithImage(&glyphMap, image + offset, imageLength - offset);
+
+            if (!mapSize) {
+                return SFFalse;
+            }
+
+            if (pass == 1) {
+                SFGlyphMapOrigin mapOrigin;
+                SFTableMapRef tableMap;
+
+                mapOrigin.table = tables[tableIndex];
+                mapOrigin.offset = tableOffset;
+                mapOrigin.isClassDef = (SFBoolean)(origin[0] & 1);
+                tableMap = (mapOrigin.isClassDef ? &fontCache->_classDefMap : &fontCache->_coverageMap);
+
+                SFTableMapSetValue(tableMap, SFData_Subdata(mapOrigin.table, tableOffset), fontCache->_glyphMaps.count);
+                SFListAdd(&fontCache->_glyphMaps, glyphMap);
+                SFListAdd(&fontCache->_glyphMapOrigins, mapOrigin);
+            }
+
+            offset += mapSize;
+        }
+
+        offset = _SFFontCacheLoadImageArrays(fontCache, image, imageLength, offset, (SFBoolean)(pass == 1));
+
+        for (section = 0; offset && section < _SFImageSectionCount; section++) {
+            offset = _SFFontCacheLoadImageSection(fontCache, section, tables, lengths, tableCount, mapCount,
+                                                  image, imageLength, offset, (SFBoolean)(pass == 1));
+        }
+
+        if (!offset) {
+            return SFFalse;
+        }
+    }
+
+    fontCache->_imageMapCount = fontCache->_glyphMaps.count;
+    fontCache->_imageLigatureTrieCount = fontCache->_ligatureTries.count;
+    fontCache->_imageContextMatcherCount = fontCache->_contextMatchers.count;
+    fontCache->_image = image;
+    fontCache->_imageLength = imageLength;
+
+    return SFTrue;
+}
+
+SF_INTERNAL SFUInteger SFFontCacheWriteImage(SFFontCacheRef fontCache,
+    const SFData *tables, const SFUInteger *lengths, SFUInteger tableCount, SFUInt8 *buffer)
+{
+    SFUInteger size = sizeof(SFUInt32) * SF_FONT_CACHE_IMAGE_FIELDS;
+    SFUInteger mapCount = 0;
+    SFUInteger mapIndex;
+    SFUInteger tableIndex;
+    _SFImageSection section;
+
+    /* Only the images of GDEF, GSUB and GPOS tables are supported. */
+    SFAssert(tableCount == SF_FONT_CACHE_IMAGE_TABLES);
+
+    for (mapIndex = 0; mapIndex < fontCache->_glyphMaps.count; mapIndex++) {
+        SFGlyphMapOrigin *origin = SFListGetRef(&fontCache->_glyphMapOrigins, mapIndex);
+        SFGlyphMapRef glyphMap = SFListGetRef(&fontCache->_glyphMaps, mapIndex);
+
+        for (tableIndex = 0; tableIndex < tableCount; tableIndex++) {
+            if (tables[tableIndex] && origin->table == tables[tableIndex]) {
+                break;
+            }
+        }
+
+        /* Skip the glyph maps not belonging to any of the tables. */
+        if (tableIndex == tableCount) {
+            continue;
+        }
+
+        if (buffer) {
+            SFUInt32 fields[2];
+
+            fields[0] = (SFUInt32)((tableIndex << 1) | (origin->isClassDef ? 1 : 0));
+            fields[1] = (SFUInt32)origin->offset;
+
+            memcpy(buffer + size, fields, sizeof(fields));
+        }
+
+        size += sizeof(SFUInt32) * 2;
+        size += SFGlyphMapWriteImage(glyphMap, buffer ? buffer + size : NULL);
+        mapCount += 1;
+    }
+
+    /* Write the arrays in the order in which they are loaded. */
+    size = _SFFontCacheWriteImageArray(buffer, size, fontCache->gsubDigests.items,
+                                       fontCache->gsubDigests.count, sizeof(SFGlyphDigest));
+    size = _SFFontCacheWriteImageArray(buffer, size, fontCache->gposDigests.items,
+                                       fontCache->gposDigests.count, sizeof(SFGlyphDigest));
+    size = _SFFontCacheWriteImageArray(buffer, size, fontCache->_glyphTraits,
+                                       fontCache->_glyphTraitCount, sizeof(SFGlyphTraits));
+    size = _SFFontCacheWriteImageArray(buffer, size, fontCache->_markAttachClasses,
+                                       fontCache->_markAttachClassCount, sizeof(SFUInt8));
+    size = _SFFontCacheWriteImageArray(buffer, size, fontCache->_markGlyphSets,
+                                       fontCache->_markGlyphSetCount, sizeof(SFMarkGlyphSet));
+    size = _SFFontCacheWriteImageArray(buffer, size, fontCache->_markGlyphSetWords,
+                                       fontCache->_markGlyphSetWordCount, sizeof(SFUInt32));
+
+    for (section = 0; section < _SFImageSectionCount; section++) {
+        size = _SFFontCacheWriteImageSection(fontCache, section, tables, lengths, tableCount, mapCount,
+                                             buffer, size);
+    }
+
+    if (buffer) {
+        SFUInt32 header[SF_FONT_CACHE_IMAGE_FIELDS];
+
+        header[0] = SF_FONT_CACHE_IMAGE_MAGIC;
+        header[1] = SF_FONT_CACHE_IMAGE_VERSION;
+        header[2] = (SFUInt32)mapCount;
+
+        for (tableIndex = 0; tableIndex < tableCount; tableIndex++) {
+            SFUInteger length = (tables[tableIndex] ? lengths[tableIndex] : 0);
+
+            header[3 + (tableIndex * 2)] = (length ? _SFFontCacheHashTable(tables[tableIndex], length) : 0);
+            header[4 + (tableIndex * 2)] = (SFUInt32)length;
+        }
+
+        memcpy(buffer, header, sizeof(header));
+    }
+
+    return size;
+}
+
+static void _SFFontCacheAddGlyphMap(SFFontCacheRef fontCache, SFTableMapRef tableMap,
+    _SFGlyphMapInitializer initializer, SFData table, SFUInteger length, SFUInteger tableOffset)
+{
+    if (tableOffset < length) {
+        SFData subtable = SFData_Subdata(table, tableOffset);
+
+        if (SFTableMapGetValue(tableMap, subtable) == SFInvalidIndex) {
+            SFGlyphMap glyphMap;
+
+            if (initializer(&glyphMap, &fontCache->_allocator, subtable, length - tableOffset)) {
+                SFGlyphMapOrigin origin;
+
+                origin.table = table;
+                origin.offset = tableOffset;
+                origin.isClassDef = (tableMap == &fontCache->_classDefMap);
+
+                SFTableMapSetValue(tableMap, subtable, fontCache->_glyphMaps.count);
+                SFListAdd(&fontCache->_glyphMaps, glyphMap);
+                SFListAdd(&fontCache->_glyphMapOrigins, origin);
+            }
+        }
+    }
+}
+
+static void _SFFontCacheAddCoverage(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger parentOffset, SFUInteger fieldOffset)
+{
+    SFUInteger coverageOffset = _SFFontCacheReadUInt16(table, length, fieldOffset);
+
+    if (coverageOffset) {
+        _SFFontCacheAddGlyphMap(fontCache, &fontCache->_coverageMap, SFGlyphMapInitializeWithCoverage,
+                                table, length, parentOffset + coverageOffset);
+    }
+}
+
+static void _SFFontCacheAddClassDef(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger parentOffset, SFUInteger fieldOffset)
+{
+    SFUInteger classDefOffset = _SFFontCacheReadUInt16(table, length, fieldOffset);
+
+    if (classDefOffset) {
+        _SFFontCacheAddGlyphMap(fontCache, &fontCache->_classDefMap, SFGlyphMapInitializeWithClassDef,
+                                table, length, parentOffset + classDefOffset);
+    }
+}
+
+static void _SFFontCacheAddLigatureTrie(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger subtableOffset)
+{
+    if (subtableOffset < length) {
+        SFData ligatureSubst = SFData_Subdata(table, subtableOffset);
+
+        if (SFTableMapGetValue(&fontCache->_ligatureTrieMap, ligatureSubst) == SFInvalidIndex) {
+            SFLigatureTrie ligatureTrie;
+
+            if (SFLigatureTrieInitialize(&ligatureTrie, &fontCache->_allocator, ligatureSubst, length - subtableOffset)) {
+                SFTableMapSetValue(&fontCache->_ligatureTrieMap, ligatureSubst, fontCache->_ligatureTries.count);
+                SFListAdd(&fontCache->_ligatureTries, ligatureTrie);
+            }
+        }
+    }
+}
+
+/**
+ * Compiles the context matcher of a subtable whose coverage and class definition tables have
+ * already been compiled.
+ */
+static void _SFFontCacheAddContextMatcher(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger subtableOffset, SFBoolean isChained)
+{
+    if (subtableOffset < length) {
+        SFData contextSubtable = SFData_Subdata(table, subtableOffset);
+
+        if (SFTableMapGetValue(&fontCache->_contextMatcherMap, contextSubtable) == SFInvalidIndex) {
+            SFContextMatcher contextMatcher;
+
+            if (SFContextMatcherInitialize(&contextMatcher, &fontCache->_allocator,
+                                           contextSubtable, length - subtableOffset, isChained,
+                                           &fontCache->_coverageMap, &fontCache->_classDefMap)) {
+                SFTableMapSetValue(&fontCache->_contextMatcherMap, contextSubtable, fontCache->_contextMatchers.count);
+                SFListAdd(&fontCache->_contextMatchers, contextMatcher);
+            }
+        }
+    }
+}
+
+/**
+ * Indexes a format 2 pair adjustment subtable. Format 1 subtables are left to be searched from the
+ * pair set selected by their compiled coverage.
+ */
+static void _SFFontCacheAddPairIndex(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger subtableOffset)
+{
+    SFUInteger coverageOffset = _SFFontCacheLocateField(table, length, subtableOffset, subtableOffset + 2);
+    SFUInteger valueFormat1 = _SFFontCacheReadUInt16(table, length, subtableOffset + 4);
+    SFUInteger valueFormat2 = _SFFontCacheReadUInt16(table, length, subtableOffset + 6);
+    SFUInteger classDef1Offset = _SFFontCacheLocateField(table, length, subtableOffset, subtableOffset + 8);
+    SFUInteger classDef2Offset = _SFFontCacheLocateField(table, length, subtableOffset, subtableOffset + 10);
+    SFUInteger class1Count = _SFFontCacheReadUInt16(table, length, subtableOffset + 12);
+    SFUInteger class2Count = _SFFontCacheReadUInt16(table, length, subtableOffset + 14);
+    SFUInteger class2Size = SFClass2Record_Value(SFValueRecord_Size(valueFormat1),
+                                                 SFValueRecord_Size(valueFormat2));
+    SFUInteger coverageMap;
+    SFUInteger class1Map;
+    SFUInteger class2Map;
+    SFPairIndex pairIndex;
+
+    if (_SFFontCacheReadUInt16(table, length, subtableOffset) != 2
+        || SFTableMapGetValue(&fontCache->_pairIndexMap, SFData_Subdata(table, subtableOffset)) != SFInvalidIndex) {
+        return;
+    }
+
+    if (!coverageOffset || !classDef1Offset || !classDef2Offset
+        || subtableOffset + 16 + (class1Count * class2Count * class2Size) > length) {
+        return;
+    }
+
+    /* The index relies on the compiled forms of coverage and class definitions. */
+    coverageMap = SFTableMapGetValue(&fontCache->_coverageMap, SFData_Subdata(table, coverageOffset));
+    class1Map = SFTableMapGetValue(&fontCache->_classDefMap, SFData_Subdata(table, classDef1Offset));
+    class2Map = SFTableMapGetValue(&fontCache->_classDefMap, SFData_Subdata(table, classDef2Offset));
+
+    if (coverageMap == SFInvalidIndex || class1Map == SFInvalidIndex || class2Map == SFInvalidIndex) {
+        return;
+    }
+
+    SFPairIndexInitialize(&pairIndex, coverageMap, class1Map, class2Map,
+                          SFData_Subdata(table, subtableOffset + 16),
+                          (SFUInt16)class1Count, (SFUInt16)class2Count, class2Size);
+
+    SFTableMapSetValue(&fontCache->_pairIndexMap, SFData_Subdata(table, subtableOffset),
+                       fontCache->_pairIndexes.count);
+    SFListAdd(&fontCache->_pairIndexes, pairIndex);
+}
+
+static SFGlyphTraits _SFFontCacheConvertGlyphClass(SFUInt16 glyphClass)
+{
+    switch (glyphClass) {
+        case SFGlyphClassValueBase:
+            return SFGlyphTraitBase;
+
+        case SFGlyphClassValueLigature:
+            return SFGlyphTraitLigature;
+
+        case SFGlyphClassValueMark:
+            return SFGlyphTraitMark;
+
+        case SFGlyphClassValueComponent:
+            return SFGlyphTraitComponent;
+    }
+
+    return SFGlyphTraitNone;
+}
+
+static void _SFFontCacheLoadGlyphTraits(SFFontCacheRef fontCache, SFData gdefTable, SFUInteger length)
+{
+    SFUInteger classDefOffset = _SFFontCacheReadUInt16(gdefTable, length, 4);
+
+    if (classDefOffset && classDefOffset < length) {
+        SFData classDefTable = SFData_Subdata(gdefTable, classDefOffset);
+        SFGlyphMapRef glyphMap = SFFontCacheGetClassDef(fontCache, classDefTable);
+        SFUInteger glyphCount = (SFUInteger)SFUInt16Max + 1;
+        SFGlyphTraits *glyphTraits;
+        SFUInteger index;
+
+        /* A compiled table tells the last glyph having a class, otherwise cover all glyphs. */
+        if (glyphMap) {
+            glyphCount = glyphMap->_firstGlyph + glyphMap->_span;
+        }
+
+        glyphTraits = SFAllocatorAllocate(&fontCache->_allocator, sizeof(SFGlyphTraits) * glyphCount);
+
+        for (index = 0; index < glyphCount; index++) {
+            SFUInt16 glyphClass = SFFontCacheSearchGlyphClass(fontCache, classDefTable, (SFGlyphID)index);
+            glyphTraits[index] = _SFFontCacheConvertGlyphClass(glyphClass);
+        }
+
+        fontCache->_glyphTraits = glyphTraits;
+        fontCache->_glyphTraitCount = glyphCount;
+    }
+}
+
+static void _SFFontCacheLoadMarkAttachClasses(SFFontCacheRef fontCache, SFData gdefTable, SFUInteger length)
+{
+    SFUInteger classDefOffset = _SFFontCacheReadUInt16(gdefTable, length, 10);
+
+    if (classDefOffset && classDefOffset < length) {
+        SFData classDefTable = SFData_Subdata(gdefTable, classDefOffset);
+        SFGlyphMapRef glyphMap = SFFontCacheGetClassDef(fontCache, classDefTable);
+
+        /* The raw table is searched as before if it could not be compiled. */
+        if (glyphMap) {
+            SFUInteger glyphCount = glyphMap->_firstGlyph + glyphMap->_span;
+            SFUInt8 *markAttachClasses = SFAllocatorAllocate(&fontCache->_allocator, glyphCount);
+            SFUInteger index;
+
+            for (index = 0; index < glyphCount; index++) {
+                SFUInt16 glyphClass = SFGlyphMapGetValue(glyphMap, (SFGlyphID)index);
+
+                /* A lookup flag can only refer to the first 255 classes, so drop the others. */
+                markAttachClasses[index] = (SFUInt8)(glyphClass <= 0xFF ? glyphClass : 0);
+            }
+
+            fontCache->_markAttachClasses = markAttachClasses;
+            fontCache->_markAttachClassCount = glyphCount;
+        }
+    }
+}
+
+static void _SFFontCacheLoadMarkGlyphSets(SFFontCacheRef fontCache, SFData gdefTable, SFUInteger length,
+    SFUInteger markGlyphSetsOffset)
+{
+    SFData markGlyphSetsDef = SFData_Subdata(gdefTable, markGlyphSetsOffset);
+    SFUInteger markSetCount = _SFFontCacheReadUInt16(gdefTable, length, markGlyphSetsOffset + 2);
+    SFUInteger totalWords = 0;
+    SFUInteger nextOffset = 0;
+    SFMarkGlyphSet *markGlyphSets;
+    SFUInt32 *words;
+    SFTableMap ownerMap;
+    SFUInteger markSetIndex;
+
+    if (!markSetCount) {
+        return;
+    }
+
+    markGlyphSets = SFAllocatorAllocate(&fontCache->_allocator, sizeof(SFMarkGlyphSet) * markSetCount);
+    SFTableMapInitialize(&ownerMap, &fontCache->_allocator);
+
+    /* Lay out a bitset for each distinct coverage as long as the words do not exceed the limit. */
+    for (markSetIndex = 0; markSetIndex < markSetCount; markSetIndex++) {
+        SFMarkGlyphSet *markGlyphSet = &markGlyphSets[markSetIndex];
+        SFUInteger coverageOffset = _SFFontCacheReadUInt32(gdefTable, length, markGlyphSetsOffset + 4 + (markSetIndex * 4));
+        SFData coverageTable = SFData_Subdata(markGlyphSetsDef, coverageOffset);
+        SFGlyphMapRef glyphMap = (coverageOffset ? SFFontCacheGetCoverage(fontCache, coverageTable) : NULL);
+        SFUInteger ownerIndex;
+        SFUInteger firstWord;
+        SFUInteger wordCount;
+
+        markGlyphSet->wordOffset = 0;
+        markGlyphSet->firstWord = 0;
+        markGlyphSet->wordCount = 0;
+
+        if (!glyphMap || !glyphMap->_span) {
+            continue;
+        }
+
+        ownerIndex = SFTableMapGetValue(&ownerMap, coverageTable);
+
+        if (ownerIndex != SFInvalidIndex) {
+            *markGlyphSet = markGlyphSets[ownerIndex];
+            continue;
+        }
+
+        firstWord = glyphMap->_firstGlyph >> 5;
+        wordCount = ((glyphMap->_firstGlyph + glyphMap->_span - 1) >> 5) - firstWord + 1;
+
+        if (wordCount > SF_MARK_GLYPH_SET_WORD_LIMIT - totalWords) {
+            continue;
+        }
+
+        markGlyphSet->wordOffset = (SFUInt32)totalWords;
+        markGlyphSet->firstWord = (SFUInt32)firstWord;
+        markGlyphSet->wordCount = (SFUInt32)wordCount;
+        totalWords += wordCount;
+
+        SFTableMapSetValue(&ownerMap, coverageTable, markSetIndex);
+    }
+
+    SFTableMapFinalize(&ownerMap);
+
+    words = NULL;
+
+    if (totalWords) {
+        words = SFAllocatorAllocate(&fontCache->_allocator, sizeof(SFUInt32) * totalWords);
+        memset(words, 0, sizeof(SFUInt32) * totalWords);
+    }
+
+    /* Fill each bitset once, from the set that laid it out, as the shared ones lie behind it. */
+    for (markSetIndex = 0; markSetIndex < markSetCount; markSetIndex++) {
+        SFMarkGlyphSet *markGlyphSet = &markGlyphSets[markSetIndex];
+
+        if (markGlyphSet->wordCount && markGlyphSet->wordOffset == nextOffset) {
+            SFUInteger coverageOffset = _SFFontCacheReadUInt32(gdefTable, length, markGlyphSetsOffset + 4 + (markSetIndex * 4));
+            SFGlyphMapRef glyphMap = SFFontCacheGetCoverage(fontCache, SFData_Subdata(markGlyphSetsDef, coverageOffset));
+            SFUInt32 *setWords = &words[markGlyphSet->wordOffset];
+            SFUInteger firstGlyph = (SFUInteger)markGlyphSet->firstWord << 5;
+            SFUInteger limit = glyphMap->_firstGlyph + glyphMap->_span;
+            SFUInteger glyph;
+
+            for (glyph = glyphMap->_firstGlyph; glyph < limit; glyph++) {
+                if (SFGlyphMapGetValue(glyphMap, (SFGlyphID)glyph) != SFUInt16Max) {
+                    SFUInteger bit = glyph - firstGlyph;
+                    setWords[bit >> 5] |= (SFUInt32)1 << (bit & 31);
+                }
+            }
+
+            nextOffset += markGlyphSet->wordCount;
+        }
+    }
+
+    fontCache->_markGlyphSets = markGlyphSets;
+    fontCache->_markGlyphSetCount = markSetCount;
+    fontCache->_markGlyphSetWords = words;
+    fontCache->_markGlyphSetWordCount = totalWords;
+}
+
+static void _SFFontCacheLoadContextSubtable(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger subtableOffset)
+{
+    SFUInteger format = _SFFontCacheReadUInt16(table, length, subtableOffset);
+
+    switch (format) {
+        case 1:
+            _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, subtableOffset + 2);
+            break;
+
+        case 2:
+            _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, subtableOffset + 2);
+            _SFFontCacheAddClassDef(fontCache, table, length, subtableOffset, subtableOffset + 4);
+            break;
+
+        case 3: {
+            SFUInteger glyphCount = _SFFontCacheReadUInt16(table, length, subtableOffset + 2);
+            SFUInteger index;
+
+            for (index = 0; index < glyphCount; index++) {
+                _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, subtableOffset + 6 + (index * 2));
+            }
+            break;
+        }
+    }
+
+    _SFFontCacheAddContextMatcher(fontCache, table, length, subtableOffset, SFFalse);
+}
+
+static void _SFFontCacheLoadChainContextSubtable(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFUInteger subtableOffset)
+{
+    SFUInteger format = _SFFontCacheReadUInt16(table, length, subtableOffset);
+
+    switch (format) {
+        case 1:
+            _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, subtableOffset + 2);
+            break;
+
+        case 2:
+            /* Compile the coverage along with backtrack, input and lookahead class definitions. */
+            _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, subtableOffset + 2);
+            _SFFontCacheAddClassDef(fontCache, table, length, subtableOffset, subtableOffset + 4);
+            _SFFontCacheAddClassDef(fontCache, table, length, subtableOffset, subtableOffset + 6);
+            _SFFontCacheAddClassDef(fontCache, table, length, subtableOffset, subtableOffset + 8);
+            break;
+
+        case 3: {
+            SFUInteger recordOffset = subtableOffset + 2;
+            SFUInteger recordIndex;
+
+            /* Compile the coverages of backtrack, input and lookahead records. */
+            for (recordIndex = 0; recordIndex < 3; recordIndex++) {
+                SFUInteger glyphCount = _SFFontCacheReadUInt16(table, length, recordOffset);
+                SFUInteger index;
+
+                for (index = 0; index < glyphCount; index++) {
+                    _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, recordOffset + 2 + (index * 2));
+                }
+
+                recordOffset += 2 + (glyphCount * 2);
+            }
+            break;
+        }
+    }
+
+    _SFFontCacheAddContextMatcher(fontCache, table, length, subtableOffset, SFTrue);
+}
+
+static SFUInteger _SFFontCacheResolveExtension(SFData table, SFUInteger length, SFUInteger subtableOffset,
+    SFLookupType *outLookupType)
+{
+    SFUInteger format = _SFFontCacheReadUInt16(table, length, subtableOffset);
+
+    if (format == 1) {
+        SFUInteger extensionOffset = _SFFontCacheReadUInt32(table, length, subtableOffset + 4);
+
+        if (extensionOffset && extensionOffset < length - subtableOffset) {
+            *outLookupType = (SFLookupType)_SFFontCacheReadUInt16(table, length, subtableOffset + 2);
+            return subtableOffset + extensionOffset;
+        }
+    }
+
+    return 0;
+}
+
+static void _SFFontCacheLoadSubstitutionSubtable(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFLookupType lookupType, SFUInteger subtableOffset)
+{
+    switch (lookupType) {
+        case SFLookupTypeSingle:
+        case SFLookupTypeMultiple:
+        case SFLookupTypeAlternate:
+        case SFLookupTypeReverseChainingContext:
+            _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, subtableOffset + 2);
+            break;
+
+        case SFLookupTypeLigature:
+            _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, subtableOffset + 2);
+            _SFFontCacheAddLigatureTrie(fontCache, table, length, subtableOffset);
+            break;
+
+        case SFLookupTypeContext:
+            _SFFontCacheLoadContextSubtable(fontCache, table, length, subtableOffset);
+            break;
+
+        case SFLookupTypeChainingContext:
+            _SFFontCacheLoadChainContextSubtable(fontCache, table, length, subtableOffset);
+            break;
+
+        case SFLookupTypeExtension: {
+            SFLookupType innerType = 0;
+            SFUInteger innerOffset = _SFFontCacheResolveExtension(table, length, subtableOffset, &innerType);
+
+            /* An extension subtable must not refer to another extension subtable. */
+            if (innerOffset && innerType != SFLookupTypeExtension) {
+                _SFFontCacheLoadSubstitutionSubtable(fontCache, table, length, innerType, innerOffset);
+            }
+            break;
+        }
+    }
+}
+
+static void _SFFontCacheLoadPositioningSubtable(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    SFLookupType lookupType, SFUInteger subtableOffset)
+{
+    switch (lookupType) {
+        case SFLookupTypeSingleAdjustment:
+        case SFLookupTypeCursiveAttachment:
+            _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, subtableOffset + 2);
+            break;
+
+        case SFLookupTypePairAdjustment:
+            _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, subtableOffset + 2);
+
+            /* Format 2 additionally refers to the class definitions of first and second glyphs. */
+            if (_SFFontCacheReadUInt16(table, length, subtableOffset) == 2) {
+                _SFFontCacheAddClassDef(fontCache, table, length, subtableOffset, subtableOffset + 8);
+                _SFFontCacheAddClassDef(fontCache, table, length, subtableOffset, subtableOffset + 10);
+            }
+
+            _SFFontCacheAddPairIndex(fontCache, table, length, subtableOffset);
+            break;
+
+        case SFLookupTypeMarkToBaseAttachment:
+        case SFLookupTypeMarkToLigatureAttachment:
+        case SFLookupTypeMarkToMarkAttachment:
+            _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, subtableOffset + 2);
+            _SFFontCacheAddCoverage(fontCache, table, length, subtableOffset, subtableOffset + 4);
+            break;
+
+        case SFLookupTypeContextPositioning:
+            _SFFontCacheLoadContextSubtable(fontCache, table, length, subtableOffset);
+            break;
+
+        case SFLookupTypeChainedContextPositioning:
+            _SFFontCacheLoadChainContextSubtable(fontCache, table, length, subtableOffset);
+            break;
+
+        case SFLookupTypeExtensionPositioning: {
+            SFLookupType innerType = 0;
+            SFUInteger innerOffset = _SFFontCacheResolveExtension(table, length, subtableOffset, &innerType);
+
+            /* An extension subtable must not refer to another extension subtable. */
+            if (innerOffset && innerType != SFLookupTypeExtensionPositioning) {
+                _SFFontCacheLoadPositioningSubtable(fontCache, table, length, innerType, innerOffset);
+            }
+            break;
+        }
+    }
+}
+
+static SFUInteger _SFFontCacheLocateField(SFData table, SFUInteger length, SFUInteger parentOffset,
+    SFUInteger fieldOffset)
+{
+    SFUInteger offset = _SFFontCacheReadUInt16(table, length, fieldOffset);
+
+    if (offset) {
+        return parentOffset + offset;
+    }
+
+    return 0;
+}
+
+static SFUInteger _SFFontCacheLocateContextCoverage(SFData table, SFUInteger length, SFUInteger subtableOffset)
+{
+    SFUInteger format = _SFFontCacheReadUInt16(table, length, subtableOffset);
+
+    switch (format) {
+        case 1:
+        case 2:
+            return _SFFontCacheLocateField(table, length, subtableOffset, subtableOffset + 2);
+
+        case 3: {
+            SFUInteger glyphCount = _SFFontCacheReadUInt16(table, length, subtableOffset + 2);
+
+            if (glyphCount) {
+                return _SFFontCacheLocateField(table, length, subtableOffset, subtableOffset + 6);
+            }
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static SFUInteger _SFFontCacheLocateChainContextCoverage(SFData table, SFUInteger length,
+    SFUInteger subtableOffset)
+{
+    SFUInteger format = _SFFontCacheReadUInt16(table, length, subtableOffset);
+
+    switch (format) {
+        case 1:
+        case 2:
+            return _SFFontCacheLocateField(table, length, subtableOffset, subtableOffset + 2);
+
+        case 3: {
+            SFUInteger backtrackCount = _SFFontCacheReadUInt16(table, length, subtableOffset + 2);
+            SFUInteger inputOffset = subtableOffset + 4 + (backtrackCount * 2);
+            SFUInteger inputCount = _SFFontCacheReadUInt16(table, length, inputOffset);
+
+            if (inputCount) {
+                return _SFFontCacheLocateField(table, length, subtableOffset, inputOffset + 2);
+            }
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static SFUInteger _SFFontCacheLocateSubstitutionCoverage(SFData table, SFUInteger length,
+    SFLookupType lookupType, SFUInteger subtableOffset)
+{
+    switch (lookupType) {
+        case SFLookupTypeSingle:
+        case SFLookupTypeMultiple:
+        case SFLookupTypeAlternate:
+        case SFLookupTypeLigature:
+        case SFLookupTypeReverseChainingContext:
+            return _SFFontCacheLocateField(table, length, subtableOffset, subtableOffset + 2);
+
+        case SFLookupTypeContext:
+            return _SFFontCacheLocateContextCoverage(table, length, subtableOffset);
+
+        case SFLookupTypeChainingContext:
+            return _SFFontCacheLocateChainContextCoverage(table, length, subtableOffset);
+
+        case SFLookupTypeExtension: {
+            SFLookupType innerType = 0;
+            SFUInteger innerOffset = _SFFontCacheResolveExtension(table, length, subtableOffset, &innerType);
+
+            if (innerOffset && innerType != SFLookupTypeExtension) {
+                return _SFFontCacheLocateSubstitutionCoverage(table, length, innerType, innerOffset);
+            }
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static SFUInteger _SFFontCacheLocatePositioningCoverage(SFData table, SFUInteger length,
+    SFLookupType lookupType, SFUInteger subtableOffset)
+{
+    switch (lookupType) {
+        case SFLookupTypeSingleAdjustment:
+        case SFLookupTypePairAdjustment:
+        case SFLookupTypeCursiveAttachment:
+        case SFLookupTypeMarkToBaseAttachment:
+        case SFLookupTypeMarkToLigatureAttachment:
+        case SFLookupTypeMarkToMarkAttachment:
+            /* Attachment subtables apply at the mark glyph covered by the first coverage. */
+            return _SFFontCacheLocateField(table, length, subtableOffset, subtableOffset + 2);
+
+        case SFLookupTypeContextPositioning:
+            return _SFFontCacheLocateContextCoverage(table, length, subtableOffset);
+
+        case SFLookupTypeChainedContextPositioning:
+            return _SFFontCacheLocateChainContextCoverage(table, length, subtableOffset);
+
+        case SFLookupTypeExtensionPositioning: {
+            SFLookupType innerType = 0;
+            SFUInteger innerOffset = _SFFontCacheResolveExtension(table, length, subtableOffset, &innerType);
+
+            if (innerOffset && innerType != SFLookupTypeExtensionPositioning) {
+                return _SFFontCacheLocatePositioningCoverage(table, length, innerType, innerOffset);
+            }
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static SFBoolean _SFFontCacheAddCoverageDigest(SFGlyphDigestRef glyphDigest, SFData table, SFUInteger length,
+    SFUInteger coverageOffset)
+{
+    SFUInteger format;
+    SFUInteger count;
+    SFUInteger index;
+
+    if (length - coverageOffset < 4) {
+        return SFFalse;
+    }
+
+    format = SFData_UInt16(table, coverageOffset);
+    count = SFData_UInt16(table, coverageOffset + 2);
+
+    switch (format) {
+        case 1:
+            if (count > (length - coverageOffset - 4) / 2) {
+                return SFFalse;
+            }
+
+            for (index = 0; index < count; index++) {
+                SFGlyphID glyph = SFData_UInt16(table, coverageOffset + 4 + (index * 2));
+                SFGlyphDigestAddGlyph(glyphDigest, glyph);
+            }
+            return SFTrue;
+
+        case 2:
+            if (count > (length - coverageOffset - 4) / 6) {
+                return SFFalse;
+            }
+
+            for (index = 0; index < count; index++) {
+                SFUInteger recordOffset = coverageOffset + 4 + (index * 6);
+                SFGlyphID start = SFData_UInt16(table, recordOffset);
+                SFGlyphID end = SFData_UInt16(table, recordOffset + 2);
+
+                if (start <= end) {
+                    SFGlyphDigestAddRange(glyphDigest, start, end);
+                }
+            }
+            return SFTrue;
+    }
+
+    return SFFalse;
+}
+
+/**
+ * Compiles the lookup lying at specified offset, resolving each of its extension subtables to the
+ * actual one along with its type. A malformed lookup is left uncompiled.
+ */
+static void _SFFontCacheAddLookupInfo(SFLookupInfosRef lookupInfos, SFLookupInfoRef lookupInfo,
+    SFData table, SFUInteger length, SFUInteger lookupOffset, SFLookupType extensionType)
+{
+    SFLookupType lookupType = (SFLookupType)_SFFontCacheReadUInt16(table, length, lookupOffset);
+    SFLookupFlag lookupFlag = (SFLookupFlag)_SFFontCacheReadUInt16(table, length, lookupOffset + 2);
+    SFUInteger subtableCount = _SFFontCacheReadUInt16(table, length, lookupOffset + 4);
+    SFUInteger recordsEnd = lookupOffset + 6 + (subtableCount * 2);
+    SFBoolean isExtension = (lookupType == extensionType);
+    SFUInteger subtableIndex;
+
+    if ((lookupFlag & SFLookupFlagUseMarkFilteringSet ? recordsEnd + 2 : recordsEnd) > length
+        || !lookupType || lookupType >= SF_SUBTABLE_TYPE_COUNT) {
+        return;
+    }
+
+    /* Make sure that every subtable can be resolved before adding any of them. */
+    for (subtableIndex = 0; subtableIndex < subtableCount; subtableIndex++) {
+        SFUInteger subtableOffset = SFData_UInt16(table, lookupOffset + 6 + (subtableIndex * 2));
+
+        if (!subtableOffset) {
+            return;
+        }
+
+        if (isExtension) {
+            SFLookupType subtableType;
+
+            if (!_SFFontCacheResolveExtension(table, length, lookupOffset + subtableOffset, &subtableType)
+                || !subtableType || subtableType == extensionType || subtableType >= SF_SUBTABLE_TYPE_COUNT) {
+                return;
+            }
+        }
+    }
+
+    lookupInfo->subtables = NULL;
+    lookupInfo->subtableCount = subtableCount;
+    lookupInfo->lookupType = lookupType;
+    lookupInfo->lookupFlag = lookupFlag;
+    lookupInfo->markFilteringSet = (lookupFlag & SFLookupFlagUseMarkFilteringSet
+                                    ? SFData_UInt16(table, recordsEnd) : 0);
+
+    /* Resolve each extension subtable independently so that their types may differ. */
+    for (subtableIndex = 0; subtableIndex < subtableCount; subtableIndex++) {
+        SFUInteger subtableOffset = lookupOffset + SFData_UInt16(table, lookupOffset + 6 + (subtableIndex * 2));
+        SFSubtableInfo subtableInfo;
+
+        subtableInfo.subtableType = lookupType;
+
+        if (isExtension) {
+            subtableOffset = _SFFontCacheResolveExtension(table, length, subtableOffset, &subtableInfo.subtableType);
+        }
+
+        subtableInfo.table = SFData_Subdata(table, subtableOffset);
+        SFListAdd(&lookupInfos->_subtables, subtableInfo);
+    }
+}
+
+static void _SFFontCacheLoadLookupList(SFFontCacheRef fontCache, SFData table, SFUInteger length,
+    _SFSubtableLoader subtableLoader, _SFCoverageLocator coverageLocator, SFLookupType extensionType,
+    SFLookupDigestsRef lookupDigests, SFLookupInfosRef lookupInfos)
+{
+    SFUInteger lookupListOffset = _SFFontCacheReadUInt16(table, length, 8);
+
+    if (lookupListOffset) {
+        SFUInteger lookupCount = _SFFontCacheReadUInt16(table, length, lookupListOffset);
+        SFUInteger subtableStart;
+        SFUInteger lookupIndex;
+
+        /* The digests of a loaded image are used as they are. */
+        if (!fontCache->_image) {
+            lookupDigests->items = SFAllocatorAllocate(&fontCache->_allocator, sizeof(SFGlyphDigest) * (lookupCount + 1));
+            lookupDigests->count = lookupCount;
+        }
+
+        lookupInfos->items = SFAllocatorAllocate(&fontCache->_allocator, sizeof(SFLookupInfo) * (lookupCount + 1));
+        lookupInfos->count = lookupCount;
+
+        for (lookupIndex = 0; lookupIndex < lookupCount; lookupIndex++) {
+            SFUInteger lookupOffset = _SFFontCacheReadUInt16(table, length, lookupListOffset + 2 + (lookupIndex * 2));
+            SFGlyphDigestRef lookupDigest = (fontCache->_image ? NULL : &lookupDigests->items[lookupIndex]);
+            SFLookupInfoRef lookupInfo = &lookupInfos->items[lookupIndex];
+
+            /* A lookup that could not be walked may apply anywhere. */
+            if (lookupDigest) {
+                SFGlyphDigestFill(lookupDigest);
+            }
+            /* A lookup that could not be compiled is applied from the raw table. */
+            lookupInfo->lookupType = 0;
+
+            if (lookupOffset) {
+                SFLookupType lookupType;
+                SFUInteger subtableCount;
+                SFUInteger subtableIndex;
+
+                lookupOffset += lookupListOffset;
+
+                _SFFontCacheAddLookupInfo(lookupInfos, lookupInfo, table, length, lookupOffset, extensionType);
+                lookupType = (SFLookupType)_SFFontCacheReadUInt16(table, length, lookupOffset);
+                subtableCount = _SFFontCacheReadUInt16(table, length, lookupOffset + 4);
+
+                if (lookupDigest) {
+                    SFGlyphDigestClear(lookupDigest);
+                }
+
+                for (subtableIndex = 0; subtableIndex < subtableCount; subtableIndex++) {
+                    SFUInteger subtableOffset = _SFFontCacheReadUInt16(table, length, lookupOffset + 6 + (subtableIndex * 2));
+
+                    if (subtableOffset) {
+                        subtableOffset += lookupOffset;
+                        subtableLoader(fontCache, table, length, lookupType, subtableOffset);
+
+                        if (lookupDigest) {
+                            SFUInteger coverageOffset = coverageLocator(table, length, lookupType, subtableOffset);
+
+                            /* Accept all glyphs if the coverage of the subtable is unknown. */
+                            if (!coverageOffset || coverageOffset >= length
+                                || !_SFFontCacheAddCoverageDigest(lookupDigest, table, length, coverageOffset)) {
+                                SFGlyphDigestFill(lookupDigest);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /* Point the lookups to their subtables now that the list will not grow any more. */
+        SFListTrimExcess(&lookupInfos->_subtables);
+        subtableStart = 0;
+
+        for (lookupIndex = 0; lookupIndex < lookupCount; lookupIndex++) {
+            SFLookupInfoRef lookupInfo = &lookupInfos->items[lookupIndex];
+
+            if (lookupInfo->lookupType) {
+                lookupInfo->subtables = lookupInfos->_subtables.items + subtableStart;
+                subtableStart += lookupInfo->subtableCount;
+            }
+        }
+    }
+}
+
+SF_INTERNAL void SFFontCacheAttachGDEF(SFFontCacheRef fontCache, SFData gdefTable, SFUInteger length)
+{
+    if (gdefTable) {
+        SFUInteger classDefOffset = _SFFontCacheReadUInt16(gdefTable, length, 4);
+
+        if (classDefOffset && classDefOffset < length) {
+            fontCache->_glyphClassDef = SFData_Subdata(gdefTable, classDefOffset);
+        }
+    }
+}
+
+SF_INTERNAL void SFFontCacheLoadGDEF(SFFontCacheRef fontCache, SFData gdefTable, SFUInteger length)
+{
+    if (gdefTable) {
+        SFUInteger version = _SFFontCacheReadUInt32(gdefTable, length, 0);
+
+        _SFFontCacheAddClassDef(fontCache, gdefTable, length, 0, 4);
+        _SFFontCacheAddClassDef(fontCache, gdefTable, length, 0, 10);
+
+        if (version >= 0x00010002) {
+            SFUInteger markGlyphSetsOffset = _SFFontCacheReadUInt16(gdefTable, length, 12);
+
+            if (markGlyphSetsOffset && _SFFontCacheReadUInt16(gdefTable, length, markGlyphSetsOffset) == 1) {
+                SFUInteger markSetCount = _SFFontCacheReadUInt16(gdefTable, length, markGlyphSetsOffset + 2);
+                SFUInteger markSetIndex;
+
+                for (markSetIndex = 0; markSetIndex < markSetCount; markSetIndex++) {
+                    SFUInteger coverageOffset = _SFFontCacheReadUInt32(gdefTable, length,
+                                                                       markGlyphSetsOffset + 4 + (markSetIndex * 4));
+
+                    if (coverageOffset && coverageOffset < length - markGlyphSetsOffset) {
+                        _SFFontCacheAddGlyphMap(fontCache, &fontCache->_coverageMap, SFGlyphMapInitializeWithCoverage,
+                                                gdefTable, length, markGlyphSetsOffset + coverageOffset);
+                    }
+                }
+
+                /* The arrays of a loaded image are used as they are. */
+                if (!fontCache->_image) {
+                    _SFFontCacheLoadMarkGlyphSets(fontCache, gdefTable, length, markGlyphSetsOffset);
+                }
+            }
+        }
+
+        if (!fontCache->_image) {
+            _SFFontCacheLoadGlyphTraits(fontCache, gdefTable, length);
+            _SFFontCacheLoadMarkAttachClasses(fontCache, gdefTable, length);
+        }
+    }
+}
+
+SF_INTERNAL void SFFontCacheLoadGSUB(SFFontCacheRef fontCache, SFData gsubTable, SFUInteger length)
+{
+    if (gsubTable) {
+        _SFFontCacheLoadLookupList(fontCache, gsubTable, length, _SFFontCacheLoadSubstitutionSubtable,
+                                   _SFFontCacheLocateSubstitutionCoverage, SFLookupTypeExtension,
+                                   &fontCache->gsubDigests, &fontCache->gsubLookups);
+    }
+}
+
+SF_INTERNAL void SFFontCacheLoadGPOS(SFFontCacheRef fontCache, SFData gposTable, SFUInteger length)
+{
+    if (gposTable) {
+        _SFFontCacheLoadLookupList(fontCache, gposTable, length, _SFFontCacheLoadPositioningSubtable,
+                                   _SFFontCacheLocatePositioningCoverage, SFLookupTypeExtensionPositioning,
+                                   &fontCache->gposDigests, &fontCache->gposLookups);
+    }
+}
+
+SF_INTERNAL SFGlyphMapRef SFFontCacheGetCoverage(SFFontCacheRef fontCache, SFData coverageTable)
+{
+    SFUInteger index = SFTableMapGetValue(&fontCache->_coverageMap, coverageTable);
+
+    if (index != SFInvalidIndex) {
+        return SFListGetRef(&fontCache->_glyphMaps, index);
+    }
+
+    return NULL;
+}
+
+SF_INTERNAL SFUInteger SFFontCacheSearchCoverageIndex(SFFontCacheRef fontCache, SFData coverageTable, SFGlyphID glyphID)
+{
+    SFGlyphMapRef glyphMap = SFFontCacheGetCoverage(fontCache, coverageTable);
+
+    if (glyphMap) {
+        SFUInt16 coverageIndex = SFGlyphMapGetValue(glyphMap, glyphID);
+
+        if (coverageIndex != SFUInt16Max) {
+            return coverageIndex;
+        }
+
+        return SFInvalidIndex;
+    }
+
+    /* Fall back to searching the raw table if it could not be compiled. */
+    return SFOpenTypeSearchCoverageIndex(coverageTable, glyphID);
+}
+
+SF_INTERNAL SFUInteger SFFontCacheSearchSingleSubstitute(SFFontCacheRef fontCache, SFData singleSubst, SFGlyphID glyphID)
+{
+    SFUInt16 format = SFSingleSubst_Format(singleSubst);
+
+    switch (format) {
+        case 1: {
+            SFOffset coverageOffset = SFSingleSubstF1_CoverageOffset(singleSubst);
+            SFData coverageTable = SFData_Subdata(singleSubst, coverageOffset);
+            SFUInteger coverageIndex;
+
+            coverageIndex = SFFontCacheSearchCoverageIndex(fontCache, coverageTable, glyphID);
+
+            if (coverageIndex != SFInvalidIndex) {
+                SFInt16 deltaGlyphID = SFSingleSubstF1_DeltaGlyphID(singleSubst);
+                return (SFGlyphID)(glyphID + deltaGlyphID);
+            }
+            break;
+        }
+
+        case 2: {
+            SFOffset coverageOffset = SFSingleSubstF2_CoverageOffset(singleSubst);
+            SFData coverageTable = SFData_Subdata(singleSubst, coverageOffset);
+            SFUInteger coverageIndex;
+
+            coverageIndex = SFFontCacheSearchCoverageIndex(fontCache, coverageTable, glyphID);
+
+            if (coverageIndex != SFInvalidIndex) {
+                SFUInt16 glyphCount = SFSingleSubstF2_GlyphCount(singleSubst);
+
+                if (coverageIndex < glyphCount) {
+                    return SFSingleSubstF2_Substitute(singleSubst, coverageIndex);
+                }
+            }
+            break;
+        }
+    }
+
+    return SFInvalidIndex;
+}
+
+SF_INTERNAL SFGlyphDigestRef SFFontCacheGetLookupDigest(SFLookupDigestsRef lookupDigests, SFUInteger lookupIndex)
+{
+    if (lookupIndex < lookupDigests->count) {
+        return &lookupDigests->items[lookupIndex];
+    }
+
+    return NULL;
+}
+
+SF_INTERNAL SFLookupInfoRef SFFontCacheGetLookupInfo(SFLookupInfosRef lookupInfos, SFUInteger lookupIndex)
+{
+    if (lookupIndex < lookupInfos->count) {
+        SFLookupInfoRef lookupInfo = &lookupInfos->items[lookupIndex];
+
+        if (lookupInfo->lookupType) {
+            return lookupInfo;
+        }
+    }
+
+    return NULL;
+}
+
+SF_INTERNAL SFGlyphTraits SFFontCacheGetGlyphTraits(SFFontCacheRef fontCache, SFGlyphID glyphID)
+{
+    if (glyphID < fontCache->_glyphTraitCount) {
+        return fontCache->_glyphTraits[glyphID];
+    }
+
+    /* Search the raw table if the traits were not expanded. */
+    if (!fontCache->_glyphTraits && fontCache->_glyphClassDef) {
+        SFUInt16 glyphClass = SFFontCacheSearchGlyphClass(fontCache, fontCache->_glyphClassDef, glyphID);
+        return _SFFontCacheConvertGlyphClass(glyphClass);
+    }
+
+    return SFGlyphTraitNone;
+}
+
+SF_INTERNAL const SFUInt8 *SFFontCacheGetMarkAttachClasses(SFFontCacheRef fontCache, SFUInteger *outCount)
+{
+    *outCount = fontCache->_markAttachClassCount;
+    return fontCache->_markAttachClasses;
+}
+
+SF_INTERNAL const SFUInt32 *SFFontCacheGetMarkGlyphSet(SFFontCacheRef fontCache, SFUInteger markSetIndex,
+    SFUInteger *outFirstWord, SFUInteger *outWordCount)
+{
+    if (markSetIndex < fontCache->_markGlyphSetCount) {
+        SFMarkGlyphSet *markGlyphSet = &fontCache->_markGlyphSets[markSetIndex];
+
+        if (markGlyphSet->wordCount) {
+            *outFirstWord = markGlyphSet->firstWord;
+            *outWordCount = markGlyphSet->wordCount;
+
+            return &fontCache->_markGlyphSetWords[markGlyphSet->wordOffset];
+        }
+    }
+
+    *outFirstWord = 0;
+    *outWordCount = 0;
+
+    return NULL;
+}
+
+SF_INTERNAL SFGlyphMapRef SFFontCacheGetClassDef(SFFontCacheRef fontCache, SFData classDefTable)
+{
+    SFUInteger index = SFTableMapGetValue(&fontCache->_classDefMap, classDefTable);
+
+    if (index != SFInvalidIndex) {
+        return SFListGetRef(&fontCache->_glyphMaps, index);
+    }
+
+    return NULL;
+}
+
+SF_INTERNAL SFUInt16 SFFontCacheSearchGlyphClass(SFFontCacheRef fontCache, SFData classDefTable, SFGlyphID glyphID)
+{
+    SFGlyphMapRef glyphMap = SFFontCacheGetClassDef(fontCache, classDefTable);
+
+    if (glyphMap) {
+        return SFGlyphMapGetValue(glyphMap, glyphID);
+    }
+
+    /* Fall back to searching the raw table if it could not be compiled. */
+    return SFOpenTypeSearchGlyphClass(classDefTable, glyphID);
+}
+
+SF_INTERNAL SFGlyphMapRef SFFontCacheGetGlyphMap(SFFontCacheRef fontCache, SFUInteger index)
+{
+    return SFListGetRef(&fontCache->_glyphMaps, index);
+}
+
+SF_INTERNAL SFContextMatcherRef SFFontCacheGetContextMatcher(SFFontCacheRef fontCache, SFData contextSubtable)
+{
+    SFUInteger index = SFTableMapGetValue(&fontCache->_contextMatcherMap, contextSubtable);
+
+    if (index != SFInvalidIndex) {
+        return SFListGetRef(&fontCache->_contextMatchers, index);
+    }
+
+    return NULL;
+}
+
+SF_INTERNAL SFLigatureTrieRef SFFontCacheGetLigatureTrie(SFFontCacheRef fontCache, SFData ligatureSubst)
+{
+    SFUInteger index = SFTableMapGetValue(&fontCache->_ligatureTrieMap, ligatureSubst);
+
+    if (index != SFInvalidIndex) {
+        return SFListGetRef(&fontCache->_ligatureTries, index);
+    }
+
+    return NULL;
+}
+
+SF_INTERNAL SFPairIndexRef SFFontCacheGetPairIndex(SFFontCacheRef fontCache, SFData pairPos)
+{
+    SFUInteger index = SFTableMapGetValue(&fontCache->_pairIndexMap, pairPos);
+
+    if (index != SFInvalidIndex) {
+        return SFListGetRef(&fontCache->_pairIndexes, index);
+    }
+
+    return NULL;
+}
+
+SF_INTERNAL SFData SFFontCacheSearchPairValues(SFFontCacheRef fontCache, SFPairIndexRef pairIndex,
+    SFGlyphID firstGlyph, SFGlyphID secondGlyph)
+{
+    SFGlyphMapRef coverageMap = SFListGetRef(&fontCache->_glyphMaps, pairIndex->_coverageMap);
+
+    if (SFGlyphMapGetValue(coverageMap, firstGlyph) != SFUInt16Max) {
+        SFGlyphMapRef class1Map = SFListGetRef(&fontCache->_glyphMaps, pairIndex->_class1Map);
+        SFGlyphMapRef class2Map = SFListGetRef(&fontCache->_glyphMaps, pairIndex->_class2Map);
+        SFUInt16 class1Value = SFGlyphMapGetValue(class1Map, firstGlyph);
+        SFUInt16 class2Value = SFGlyphMapGetValue(class2Map, secondGlyph);
+
+        return SFPairIndexGetClassValues(pairIndex, class1Value, class2Value);
+    }
+
+    return NULL;
+}
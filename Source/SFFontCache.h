@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _SF_INTERNAL_FONT_CACHE_H
+#define _SF_INTERNAL_FONT_CACHE_H
+
+#include <SFConfig.h>
+
+#include "SFAlbum.h"
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFCommon.h"
+#include "SFContextMatcher.h"
+#include "SFData.h"
+#include "SFGlyphDigest.h"
+#include "SFGlyphMap.h"
+#include "SFLigatureTrie.h"
+#include "SFList.h"
+#include "SFPairIndex.h"
+#include "SFTableMap.h"
+
+/**
+ * Identifies the open type table from which a glyph map was compiled.
+ */
+typedef struct _SFGlyphMapOrigin {
+    SFData table;           /**< The top level table containing the compiled table. */
+    SFUInteger offset;      /**< Offset of the compiled table from the start of top level table. */
+    SFBoolean isClassDef;   /**< Whether the compiled table is a class definition or a coverage. */
+} SFGlyphMapOrigin;
+
+/**
+ * Keeps a digest for each lookup of a table, covering the glyphs at which the lookup may apply.
+ */
+typedef struct _SFLookupDigests {
+    SFGlyphDigest *items;
+    SFUInteger count;
+} SFLookupDigests, *SFLookupDigestsRef;
+
+/**
+ * Number of subtable types that a compiled lookup can refer to, including the unused zero.
+ */
+#define SF_SUBTABLE_TYPE_COUNT  10
+
+/**
+ * A subtable of a compiled lookup whose extension is resolved to the actual one.
+ */
+typedef struct _SFSubtableInfo {
+    SFData table;               /**< The actual subtable. */
+    SFLookupType subtableType;  /**< Type of the actual subtable, less than SF_SUBTABLE_TYPE_COUNT. */
+} SFSubtableInfo, *SFSubtableInfoRef;
+
+/**
+ * A native form of a lookup table whose extension subtables are resolved to the actual ones.
+ */
+typedef struct _SFLookupInfo {
+    SFSubtableInfo *subtables;  /**< Subtables of the lookup in order of preference. */
+    SFUInteger subtableCount;   /**< Number of subtables. */
+    SFLookupType lookupType;    /**< Type of the lookup, or zero if the lookup was not compiled. */
+    SFLookupFlag lookupFlag;    /**< Flag of the lookup. */
+    SFUInt16 markFilteringSet;  /**< Index of the mark glyph set if the flag asks for one. */
+} SFLookupInfo, *SFLookupInfoRef;
+
+/**
+ * Keeps the native form of each lookup of a table.
+ */
+typedef struct _SFLookupInfos {
+    SFLookupInfo *items;
+    SFUInteger count;
+    SF_LIST(SFSubtableInfo) _subtables; /**< Subtables of all lookups. */
+} SFLookupInfos, *SFLookupInfosRef;
+
+/**
+ * Locates the bitset of a mark glyph set among the words of all sets. The bitset only spans the
+ * words of glyph ids from the first to the last glyph of its coverage.
+ */
+typedef struct _SFMarkGlyphSet {
+    SFUInt32 wordOffset;        /**< Offset of the bitset in the words of all sets. */
+    SFUInt32 firstWord;         /**< Word of glyph ids at which the bitset starts. */
+    SFUInt32 wordCount;         /**< Number of words in the bitset, or zero if it was not expanded. */
+} SFMarkGlyphSet;
+
+/**
+ * Holds the native representations of open type tables of a font. The cache is built once while
+ * creating the font and remains immutable afterwards, so it can be shared among multiple threads.
+ */
+typedef struct _SFFontCache {
+    SF_LIST(SFGlyphMap) _glyphMaps; /**< Compiled glyph maps of all referenced tables. */
+    SF_LIST(SFGlyphMapOrigin) _glyphMapOrigins; /**< Origin of each glyph map. */
+    SFUInteger _imageMapCount;      /**< Number of leading glyph maps borrowed from a cache image. */
+    SFUInteger _imageLigatureTrieCount; /**< Number of leading ligature tries borrowed from a cache image. */
+    SFUInteger _imageContextMatcherCount; /**< Number of leading context matchers borrowed from a cache image. */
+    const SFUInt8 *_image;          /**< The cache image whose arrays are borrowed, or NULL. */
+    SFUInteger _imageLength;        /**< Length of the cache image in bytes. */
+    SFTableMap _coverageMap;        /**< Indexes of glyph maps of coverage tables. */
+    SFTableMap _classDefMap;        /**< Indexes of glyph maps of class definition tables. */
+    SF_LIST(SFPairIndex) _pairIndexes; /**< Native indexes of all format 2 pair adjustment subtables. */
+    SFTableMap _pairIndexMap;       /**< Indexes of pair indexes of pair adjustment subtables. */
+    SF_LIST(SFLigatureTrie) _ligatureTries; /**< Compiled tries of all ligature subtables. */
+    SFTableMap _ligatureTrieMap;    /**< Indexes of tries of ligature subtables. */
+    SF_LIST(SFContextMatcher) _contextMatchers; /**< Compiled matchers of all contextual subtables. */
+    SFTableMap _contextMatcherMap;  /**< Indexes of matchers of contextual and chaining contextual subtables. */
+    SFData _glyphClassDef;          /**< Raw glyph class definition used if traits are not expanded. */
+    SFGlyphTraits *_glyphTraits;    /**< Traits of each glyph derived from GDEF glyph classes. */
+    SFUInteger _glyphTraitCount;    /**< Number of glyphs having an entry in the traits array. */
+    SFUInt8 *_markAttachClasses;    /**< Mark attachment class of each glyph, as used by lookup flags. */
+    SFUInteger _markAttachClassCount; /**< Number of glyphs having an entry in the classes array. */
+    SFMarkGlyphSet *_markGlyphSets; /**< Location of the bitset of each mark glyph set of GDEF. */
+    SFUInteger _markGlyphSetCount;  /**< Number of mark glyph sets. */
+    SFUInt32 *_markGlyphSetWords;   /**< Words of all bitsets, shared by the sets of same coverage. */
+    SFUInteger _markGlyphSetWordCount; /**< Number of words of all bitsets. */
+    SFLookupDigests gsubDigests;    /**< Digests of all lookups of GSUB table. */
+    SFLookupDigests gposDigests;    /**< Digests of all lookups of GPOS table. */
+    SFLookupInfos gsubLookups;      /**< Native forms of all lookups of GSUB table. */
+    SFLookupInfos gposLookups;      /**< Native forms of all lookups of GPOS table. */
+    SFAllocator _allocator;         /**< Allocator of all compiled data. */
+} SFFontCache, *SFFontCacheRef;
+
+SF_INTERNAL void SFFontCacheInitialize(SFFontCacheRef fontCache, const SFAllocator *allocator);
+SF_INTERNAL void SFFontCacheFinalize(SFFontCacheRef fontCache);
+
+/**
+ * Loads the glyph maps, lookup digests, expanded GDEF arrays and native subtables from an image
+ * written by SFFontCacheWriteImage for the same top level tables, so that they are not compiled
+ * again. The image is used in place and must outlive the cache. It must be called before loading
+ * any table.
+ *
+ * @return
+ *      SFTrue if the image was valid and belonged to the given tables, SFFalse otherwise.
+ */
+SF_INTERNAL SFBoolean SFFontCacheLoadImage(SFFontCacheRef fontCache,
+    const SFData *tables, const SFUInteger *lengths, SFUInteger tableCount,
+    const SFUInt8 *image, SFUInteger imageLength);
+
+/**
+ * Writes an image of the compiled glyph maps, lookup digests, expanded GDEF arrays, ligature tries
+ * and context matchers keyed by the hashes of the given top level tables. The native lookups and
+ * pair indexes only refer to the tables and glyph maps, so they are cheaply rebuilt on each load
+ * instead.
+ *
+ * @param buffer
+ *      The target buffer that is large enough to hold the image. This parameter can be NULL if
+ *      only the size of the image is needed.
+ * @return
+ *      The size of the image in bytes.
+ */
+SF_INTERNAL SFUInteger SFFontCacheWriteImage(SFFontCacheRef fontCache,
+    const SFData *tables, const SFUInteger *lengths, SFUInteger tableCount, SFUInt8 *buffer);
+
+/**
+ * Keeps the raw glyph class definition of GDEF table so that the glyph traits can be searched
+ * without compiling the table.
+ */
+SF_INTERNAL void SFFontCacheAttachGDEF(SFFontCacheRef fontCache, SFData gdefTable, SFUInteger length);
+
+/**
+ * Compiles the class definition and mark glyph set tables of GDEF table, and expands the glyph
+ * classes into a traits array.
+ */
+SF_INTERNAL void SFFontCacheLoadGDEF(SFFontCacheRef fontCache, SFData gdefTable, SFUInteger length);
+
+/**
+ * Compiles all lookups of GSUB table along with the tables they refer to, and builds their
+ * digests.
+ */
+SF_INTERNAL void SFFontCacheLoadGSUB(SFFontCacheRef fontCache, SFData gsubTable, SFUInteger length);
+
+/**
+ * Compiles all lookups of GPOS table along with the tables they refer to, and builds their
+ * digests.
+ */
+SF_INTERNAL void SFFontCacheLoadGPOS(SFFontCacheRef fontCache, SFData gposTable, SFUInteger length);
+
+/**
+ * Returns the compiled coverage table, or NULL if it was not compiled.
+ */
+SF_INTERNAL SFGlyphMapRef SFFontCacheGetCoverage(SFFontCacheRef fontCache, SFData coverageTable);
+
+/**
+ * Searches the coverage index of the glyph, preferring the compiled coverage table if available.
+ */
+SF_INTERNAL SFUInteger SFFontCacheSearchCoverageIndex(SFFontCacheRef fontCache, SFData coverageTable, SFGlyphID glyphID);
+
+/**
+ * Searches the substitute of the glyph in a single substitution subtable. SFInvalidIndex is
+ * returned if the subtable does not apply to the glyph.
+ */
+SF_INTERNAL SFUInteger SFFontCacheSearchSingleSubstitute(SFFontCacheRef fontCache, SFData singleSubst, SFGlyphID glyphID);
+
+/**
+ * Returns the digest of the lookup at specified index, or NULL if the index is out of bounds.
+ */
+SF_INTERNAL SFGlyphDigestRef SFFontCacheGetLookupDigest(SFLookupDigestsRef lookupDigests, SFUInteger lookupIndex);
+
+/**
+ * Returns the native form of the lookup at specified index, or NULL if the index is out of bounds
+ * or the lookup could not be compiled.
+ */
+SF_INTERNAL SFLookupInfoRef SFFontCacheGetLookupInfo(SFLookupInfosRef lookupInfos, SFUInteger lookupIndex);
+
+/**
+ * Returns the traits of the glyph as defined by the glyph class definition table of GDEF.
+ */
+SF_INTERNAL SFGlyphTraits SFFontCacheGetGlyphTraits(SFFontCacheRef fontCache, SFGlyphID glyphID);
+
+/**
+ * Returns the mark attachment classes of all glyphs as defined by GDEF, or NULL if the class
+ * definition table was not compiled. The classes are indexed by glyph id.
+ */
+SF_INTERNAL const SFUInt8 *SFFontCacheGetMarkAttachClasses(SFFontCacheRef fontCache, SFUInteger *outCount);
+
+/**
+ * Returns the bitset of the mark glyph set at specified index, or NULL if the set was not expanded
+ * or the index is out of bounds, in which case its coverage should be searched instead. The bit of
+ * a glyph is found in the word at its id divided by 32, less the first word. A glyph whose word
+ * lies outside the bitset is not in the set.
+ */
+SF_INTERNAL const SFUInt32 *SFFontCacheGetMarkGlyphSet(SFFontCacheRef fontCache, SFUInteger markSetIndex,
+    SFUInteger *outFirstWord, SFUInteger *outWordCount);
+
+/**
+ * Returns the compiled class definition table, or NULL if it was not compiled.
+ */
+SF_INTERNAL SFGlyphMapRef SFFontCacheGetClassDef(SFFontCacheRef fontCache, SFData classDefTable);
+
+/**
+ * Searches the class of the glyph, preferring the compiled class definition table if available.
+ */
+SF_INTERNAL SFUInt16 SFFontCacheSearchGlyphClass(SFFontCacheRef fontCache, SFData classDefTable, SFGlyphID glyphID);
+
+/**
+ * Returns the glyph map at specified index, as referred by a compiled context matcher.
+ */
+SF_INTERNAL SFGlyphMapRef SFFontCacheGetGlyphMap(SFFontCacheRef fontCache, SFUInteger index);
+
+/**
+ * Returns the compiled matcher of the contextual or chaining contextual subtable, or NULL if it
+ * was not compiled.
+ */
+SF_INTERNAL SFContextMatcherRef SFFontCacheGetContextMatcher(SFFontCacheRef fontCache, SFData contextSubtable);
+
+/**
+ * Returns the compiled trie of the ligature substitution subtable, or NULL if it was not compiled.
+ */
+SF_INTERNAL SFLigatureTrieRef SFFontCacheGetLigatureTrie(SFFontCacheRef fontCache, SFData ligatureSubst);
+
+/**
+ * Returns the native index of the pair adjustment subtable, or NULL if it was not compiled. Only
+ * the subtables of format 2 are indexed.
+ */
+SF_INTERNAL SFPairIndexRef SFFontCacheGetPairIndex(SFFontCacheRef fontCache, SFData pairPos);
+
+/**
+ * Searches the value records of a glyph pair in the native index of a pair adjustment subtable.
+ * The returned data starts with the value record of first glyph, immediately followed by the
+ * value record of second glyph. NULL is returned if the subtable does not apply to the pair.
+ */
+SF_INTERNAL SFData SFFontCacheSearchPairValues(SFFontCacheRef fontCache, SFPairIndexRef pairIndex,
+    SFGlyphID firstGlyph, SFGlyphID secondGlyph);
+
+#endif
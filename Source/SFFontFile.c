@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SFConfig.h>
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#define _SF_MAP_WIN32
+#include <windows.h>
+#elif defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#define _SF_MAP_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <stdio.h>
+#endif
+
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFData.h"
+#include "SFFontFile.h"
+
+#define SF_SFNT_VERSION_TRUETYPE    0x00010000
+
+static SFData _SFMapFile(const SFAllocator *allocator, const char *path, SFUInteger *outLength);
+static void _SFUnmapFile(const SFAllocator *allocator, void *mapping, SFUInteger length);
+static SFBoolean _SFFontFileLoadFace(SFFontFileRef fontFile, SFUInteger faceIndex);
+
+#if defined(_SF_MAP_WIN32)
+
+static SFData _SFMapFile(const SFAllocator *allocator, const char *path, SFUInteger *outLength)
+{
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    HANDLE mapping;
+    LARGE_INTEGER size;
+    SFData data = NULL;
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && (ULONGLONG)size.QuadPart <= (ULONGLONG)(SFUInteger)-1) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+        if (mapping) {
+            /* The view keeps the mapping alive after its handle is closed. */
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+
+    *outLength = (data ? (SFUInteger)size.QuadPart : 0);
+    return data;
+}
+
+static void _SFUnmapFile(const SFAllocator *allocator, void *mapping, SFUInteger length)
+{
+    UnmapViewOfFile(mapping);
+}
+
+#elif defined(_SF_MAP_POSIX)
+
+static SFData _SFMapFile(const SFAllocator *allocator, const char *path, SFUInteger *outLength)
+{
+    int descriptor = open(path, O_RDONLY);
+    struct stat status;
+    void *data = NULL;
+
+    if (descriptor < 0) {
+        return NULL;
+    }
+
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+        if (data == MAP_FAILED) {
+            data = NULL;
+        }
+    }
+
+    close(descriptor);
+
+    *outLength = (data ? (SFUInteger)status.st_size : 0);
+    return data;
+}
+
+static void _SFUnmapFile(const SFAllocator *allocator, void *mapping, SFUInteger length)
+{
+    munmap(mapping, (size_t)length);
+}
+
+#else
+
+static SFData _SFMapFile(const SFAllocator *allocator, const char *path, SFUInteger *outLength)
+{
+    FILE *file = fopen(path, "rb");
+    SFUInt8 *data = NULL;
+    long size;
+
+    if (!file) {
+        return NULL;
+    }
+
+    /* Without memory mapping, read the whole file into a buffer owned by the font file. */
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = SFAllocatorAllocate(allocator, (SFUInteger)size);
+
+        if (fread(data, 1, (size_t)size, file) != (size_t)size) {
+            SFAllocatorDeallocate(allocator, data);
+            data = NULL;
+        }
+    }
+
+    fclose(file);
+
+    *outLength = (data ? (SFUInteger)size : 0);
+    return data;
+}
+
+static void _SFUnmapFile(const SFAllocator *allocator, void *mapping, SFUInteger length)
+{
+    SFAllocatorDeallocate(allocator, mapping);
+}
+
+#endif
+
+SF_INTERNAL SFFontFileRef SFFontFileCreateWithMemory(const SFAllocator *allocator,
+    SFData data, SFUInteger length, SFUInteger faceIndex)
+{
+    SFFontFileRef fontFile;
+
+    if (!data) {
+        return NULL;
+    }
+
+    fontFile = SFAllocatorAllocate(allocator, sizeof(SFFontFile));
+    fontFile->_data = data;
+    fontFile->_length = length;
+    fontFile->_tableRecords = NULL;
+    fontFile->_tableCount = 0;
+    fontFile->_mapping = NULL;
+    fontFile->_mappingLength = 0;
+    fontFile->_allocator = *allocator;
+
+    if (!_SFFontFileLoadFace(fontFile, faceIndex)) {
+        SFAllocatorDeallocate(allocator, fontFile);
+        return NULL;
+    }
+
+    return fontFile;
+}
+
+SF_INTERNAL SFFontFileRef SFFontFileCreateWithPath(const SFAllocator *allocator,
+    const char *path, SFUInteger faceIndex)
+{
+    SFUInteger length = 0;
+    SFData data = _SFMapFile(allocator, path, &length);
+    SFFontFileRef fontFile;
+
+    if (!data) {
+        return NULL;
+    }
+
+    fontFile = SFFontFileCreateWithMemory(allocator, data, length, faceIndex);
+
+    if (!fontFile) {
+        _SFUnmapFile(allocator, (void *)data, length);
+        return NULL;
+    }
+
+    fontFile->_mapping = (void *)data;
+    fontFile->_mappingLength = length;
+
+    return fontFile;
+}
+
+SF_INTERNAL void SFFontFileRelease(SFFontFileRef fontFile)
+{
+    SFAllocator allocator = fontFile->_allocator;
+
+    if (fontFile->_mapping) {
+        _SFUnmapFile(&allocator, fontFile->_mapping, fontFile->_mappingLength);
+    }
+
+    SFAllocatorDeallocate(&allocator, fontFile);
+}
+
+static SFBoolean _SFFontFileLoadFace(SFFontFileRef fontFile, SFUInteger faceIndex)
+{
+    SFData data = fontFile->_data;
+    SFUInteger length = fontFile->_length;
+    SFUInteger offset = 0;
+    SFUInt32 version;
+    SFUInteger tableCount;
+
+    if (length < 12) {
+        return SFFalse;
+    }
+
+    /* Locate the offset table of the face if the data is a collection. */
+    if (SFData_UInt32(data, 0) == SFTagMake('t', 't', 'c', 'f')) {
+        SFUInteger faceCount = SFData_UInt32(data, 8);
+
+        if (faceIndex >= faceCount || faceIndex >= (length - 12) / 4) {
+            return SFFalse;
+        }
+
+        offset = SFData_UInt32(data, 12 + (faceIndex * 4));
+
+        if (offset > length - 12) {
+            return SFFalse;
+        }
+    } else if (faceIndex != 0) {
+        return SFFalse;
+    }
+
+    version = SFData_UInt32(data, offset);
+
+    if (version != SF_SFNT_VERSION_TRUETYPE
+        && version != SFTagMake('O', 'T', 'T', 'O')
+        && version != SFTagMake('t', 'r', 'u', 'e')) {
+        return SFFalse;
+    }
+
+    tableCount = SFData_UInt16(data, offset + 4);
+
+    if (tableCount > (length - offset - 12) / 16) {
+        return SFFalse;
+    }
+
+    fontFile->_tableRecords = SFData_Subdata(data, offset + 12);
+    fontFile->_tableCount = tableCount;
+
+    return SFTrue;
+}
+
+SF_INTERNAL SFData SFFontFileGetTable(SFFontFileRef fontFile, SFTag tableTag, SFUInteger *length)
+{
+    SFUInteger index;
+
+    for (index = 0; index < fontFile->_tableCount; index++) {
+        SFData record = SFData_Subdata(fontFile->_tableRecords, index * 16);
+
+        if (SFData_UInt32(record, 0) == tableTag) {
+            SFUInteger tableOffset = SFData_UInt32(record, 8);
+            SFUInteger tableLength = SFData_UInt32(record, 12);
+
+            /* Ignore the table if it does not lie within the data. */
+            if (tableOffset > fontFile->_length || tableLength > fontFile->_length - tableOffset) {
+                break;
+            }
+
+            *length = tableLength;
+            return SFData_Subdata(fontFile->_data, tableOffset);
+        }
+    }
+
+    *length = 0;
+    return NULL;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_FONT_FILE_H
+#define _SF_INTERNAL_FONT_FILE_H
+
+#include <SFConfig.h>
+#include <SFFont.h>
+
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFData.h"
+
+/**
+ * A face of an sfnt file or memory block, serving its tables in place.
+ */
+typedef struct _SFFontFile {
+    SFData _data;               /**< Data of the whole file or memory block. */
+    SFUInteger _length;         /**< Length of the data in bytes. */
+    SFData _tableRecords;       /**< Table records of the selected face. */
+    SFUInteger _tableCount;     /**< Number of table records. */
+    void *_mapping;             /**< Mapping or buffer owned by the file, NULL for a memory block. */
+    SFUInteger _mappingLength;  /**< Length of the owned mapping or buffer. */
+    SFAllocator _allocator;     /**< Allocator of the file object. */
+} SFFontFile, *SFFontFileRef;
+
+/**
+ * Opens a face of an sfnt memory block, which must outlive the returned object. Returns NULL if the
+ * data is not a valid TrueType, OpenType or collection font, or the face does not exist.
+ */
+SF_INTERNAL SFFontFileRef SFFontFileCreateWithMemory(const SFAllocator *allocator,
+    SFData data, SFUInteger length, SFUInteger faceIndex);
+
+/**
+ * Memory-maps an sfnt file and opens one of its faces. Returns NULL if the file cannot be mapped
+ * or does not hold the face. The allocator also holds the file if it has to be read into memory.
+ */
+SF_INTERNAL SFFontFileRef SFFontFileCreateWithPath(const SFAllocator *allocator,
+    const char *path, SFUInteger faceIndex);
+
+/**
+ * Releases the file object, unmapping the file if it was opened from a path.
+ */
+SF_INTERNAL void SFFontFileRelease(SFFontFileRef fontFile);
+
+/**
+ * Returns the table of given tag in place, or NULL if the face does not have it.
+ */
+SF_INTERNAL SFData SFFontFileGetTable(SFFontFileRef fontFile, SFTag tableTag, SFUInteger *length);
+
+#endif
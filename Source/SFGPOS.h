@@ -104,6 +104,8 @@ enum {
 /*******************************PAIR ADJUSTMENT POSITIONING SUBTABLE*******************************/
 
 #define SFPairPos_Format(data)                      SFData_UInt16(data, 0)
+#define SFPairPos_ValueFormat1(data)                SFData_UInt16(data, 4)
+#define SFPairPos_ValueFormat2(data)                SFData_UInt16(data, 6)
 
 #define SFPairPosF1_CoverageOffset(data)            SFData_UInt16(data, 2)
 #define SFPairPosF1_ValueFormat1(data)              SFData_UInt16(data, 4)
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <SFConfig.h>
+
+#include "SFBase.h"
+#include "SFGlyphDigest.h"
+
+#define SF_GLYPH_DIGEST_MASK_BITS   32
+#define SF_GLYPH_DIGEST_BIT_MASK    (SF_GLYPH_DIGEST_MASK_BITS - 1)
+
+/**
+ * Shifts applied to glyph ids for selecting the bits of each mask. The first mask distinguishes
+ * nearby glyphs, whereas the others distinguish blocks of them.
+ */
+#define SF_GLYPH_DIGEST_SHIFT_0     0
+#define SF_GLYPH_DIGEST_SHIFT_1     4
+#define SF_GLYPH_DIGEST_SHIFT_2     9
+
+static const SFUInteger _SFGlyphDigestShifts[SF_GLYPH_DIGEST_MASK_COUNT] = {
+    SF_GLYPH_DIGEST_SHIFT_0, SF_GLYPH_DIGEST_SHIFT_1, SF_GLYPH_DIGEST_SHIFT_2
+};
+
+SF_INTERNAL void SFGlyphDigestClear(SFGlyphDigestRef glyphDigest)
+{
+    SFUInteger index;
+
+    for (index = 0; index < SF_GLYPH_DIGEST_MASK_COUNT; index++) {
+        glyphDigest->_masks[index] = 0;
+    }
+}
+
+SF_INTERNAL void SFGlyphDigestFill(SFGlyphDigestRef glyphDigest)
+{
+    SFUInteger index;
+
+    for (index = 0; index < SF_GLYPH_DIGEST_MASK_COUNT; index++) {
+        glyphDigest->_masks[index] = SFUInt32Max;
+    }
+}
+
+SF_INTERNAL void SFGlyphDigestAddGlyph(SFGlyphDigestRef glyphDigest, SFGlyphID glyphID)
+{
+    SFUInteger index;
+
+    for (index = 0; index < SF_GLYPH_DIGEST_MASK_COUNT; index++) {
+        SFUInteger bit = ((SFUInteger)glyphID >> _SFGlyphDigestShifts[index]) & SF_GLYPH_DIGEST_BIT_MASK;
+        glyphDigest->_masks[index] |= (SFUInt32)1 << bit;
+    }
+}
+
+SF_INTERNAL void SFGlyphDigestAddRange(SFGlyphDigestRef glyphDigest, SFGlyphID startGlyph, SFGlyphID endGlyph)
+{
+    SFUInteger index;
+
+    for (index = 0; index < SF_GLYPH_DIGEST_MASK_COUNT; index++) {
+        SFUInteger shift = _SFGlyphDigestShifts[index];
+        SFUInteger first = (SFUInteger)startGlyph >> shift;
+        SFUInteger last = (SFUInteger)endGlyph >> shift;
+
+        if (last - first >= SF_GLYPH_DIGEST_BIT_MASK) {
+            /* The range touches every bit of the mask. */
+            glyphDigest->_masks[index] = SFUInt32Max;
+        } else {
+            SFUInt32 firstBit = (SFUInt32)1 << (first & SF_GLYPH_DIGEST_BIT_MASK);
+            SFUInt32 lastBit = (SFUInt32)1 << (last & SF_GLYPH_DIGEST_BIT_MASK);
+
+            if (firstBit <= lastBit) {
+                glyphDigest->_masks[index] |= (SFUInt32)(lastBit + lastBit - firstBit);
+            } else {
+                /* The bits wrap around the end of the mask. */
+                glyphDigest->_masks[index] |= (SFUInt32)(0 - firstBit) | (SFUInt32)(lastBit + lastBit - 1);
+            }
+        }
+    }
+}
+
+SF_INTERNAL SFBoolean SFGlyphDigestMayHave(SFGlyphDigestRef glyphDigest, SFGlyphID glyphID)
+{
+    SFUInt32 *masks = glyphDigest->_masks;
+
+    return ((masks[0] >> (((SFUInteger)glyphID >> SF_GLYPH_DIGEST_SHIFT_0) & SF_GLYPH_DIGEST_BIT_MASK))
+          & (masks[1] >> (((SFUInteger)glyphID >> SF_GLYPH_DIGEST_SHIFT_1) & SF_GLYPH_DIGEST_BIT_MASK))
+          & (masks[2] >> (((SFUInteger)glyphID >> SF_GLYPH_DIGEST_SHIFT_2) & SF_GLYPH_DIGEST_BIT_MASK))
+          & 1);
+}
+
+SF_INTERNAL SFBoolean SFGlyphDigestMayIntersect(SFGlyphDigestRef glyphDigest, SFGlyphDigestRef otherDigest)
+{
+    SFUInteger index;
+
+    for (index = 0; index < SF_GLYPH_DIGEST_MASK_COUNT; index++) {
+        if (!(glyphDigest->_masks[index] & otherDigest->_masks[index])) {
+            return SFFalse;
+        }
+    }
+
+    return SFTrue;
+}
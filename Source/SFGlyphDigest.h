@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _SF_INTERNAL_GLYPH_DIGEST_H
+#define _SF_INTERNAL_GLYPH_DIGEST_H
+
+#include <SFConfig.h>
+
+#include "SFBase.h"
+
+#define SF_GLYPH_DIGEST_MASK_COUNT  3
+
+/**
+ * A compact approximation of a set of glyphs. Each mask keeps a bit for every glyph of the set,
+ * selected by a different portion of its id. A glyph absent from any of the masks is guaranteed
+ * to be absent from the set, whereas a glyph present in all masks may or may not be in the set.
+ */
+typedef struct _SFGlyphDigest {
+    SFUInt32 _masks[SF_GLYPH_DIGEST_MASK_COUNT];
+} SFGlyphDigest, *SFGlyphDigestRef;
+
+/**
+ * Makes the digest empty so that it rejects every glyph.
+ */
+SF_INTERNAL void SFGlyphDigestClear(SFGlyphDigestRef glyphDigest);
+
+/**
+ * Makes the digest full so that it accepts every glyph.
+ */
+SF_INTERNAL void SFGlyphDigestFill(SFGlyphDigestRef glyphDigest);
+
+SF_INTERNAL void SFGlyphDigestAddGlyph(SFGlyphDigestRef glyphDigest, SFGlyphID glyphID);
+SF_INTERNAL void SFGlyphDigestAddRange(SFGlyphDigestRef glyphDigest, SFGlyphID startGlyph, SFGlyphID endGlyph);
+
+/**
+ * Returns SFFalse if the glyph is definitely not in the digest, SFTrue otherwise.
+ */
+SF_INTERNAL SFBoolean SFGlyphDigestMayHave(SFGlyphDigestRef glyphDigest, SFGlyphID glyphID);
+
+/**
+ * Returns SFFalse if the two digests definitely have no glyph in common, SFTrue otherwise.
+ */
+SF_INTERNAL SFBoolean SFGlyphDigestMayIntersect(SFGlyphDigestRef glyphDigest, SFGlyphDigestRef otherDigest);
+
+#endif
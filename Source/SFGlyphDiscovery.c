@@ -18,10 +18,10 @@
 
 #include "SFAlbum.h"
 #include "SFBase.h"
+#include "SFCmap.h"
 #include "SFCodepoints.h"
 #include "SFFont.h"
-#include "SFGDEF.h"
-#include "SFOpenType.h"
+#include "SFFontCache.h"
 #include "SFPattern.h"
 
 #include "SFGlyphDiscovery.h"
@@ -29,28 +29,25 @@
 
 SF_PRIVATE SFGlyphTraits _SFGetGlyphTraits(SFTextProcessorRef processor, SFGlyphID glyph)
 {
-    SFData glyphClassDef = processor->_glyphClassDef;
-
-    if (glyphClassDef) {
-        SFUInt16 glyphClass = SFOpenTypeSearchGlyphClass(glyphClassDef, glyph);
-
-        /* Convert glyph class to traits options. */
-        switch (glyphClass) {
-            case SFGlyphClassValueBase:
-                return SFGlyphTraitBase;
+    return SFFontCacheGetGlyphTraits(processor->_fontCache, glyph);
+}
 
-            case SFGlyphClassValueLigature:
-                return SFGlyphTraitLigature;
+/**
+ * Adds the glyphs of a run of code points, letting the font map all of them in a single call.
+ */
+static void _SFAddGlyphBatch(SFTextProcessorRef processor,
+    const SFCodepoint *codepoints, const SFUInteger *associations, SFUInteger count)
+{
+    SFAlbumRef album = processor->_album;
+    SFGlyphID glyphs[SF_FONT_BATCH_SIZE];
+    SFUInteger index;
 
-            case SFGlyphClassValueMark:
-                return SFGlyphTraitMark;
+    SFFontGetGlyphIDsForCodepoints(processor->_pattern->font, codepoints, glyphs, count);
 
-            case SFGlyphClassValueComponent:
-                return SFGlyphTraitComponent;
-        }
+    for (index = 0; index < count; index++) {
+        SFGlyphTraits traits = _SFGetGlyphTraits(processor, glyphs[index]);
+        SFAlbumAddGlyph(album, glyphs[index], traits, associations[index]);
     }
-    
-    return SFGlyphTraitNone;
 }
 
 SF_INTERNAL void _SFDiscoverGlyphs(SFTextProcessorRef processor)
@@ -60,18 +57,24 @@ SF_INTERNAL void _SFDiscoverGlyphs(SFTextProcessorRef processor)
     SFAlbumRef album = processor->_album;
     SFCodepointsRef codepoints = album->codepoints;
     SFBoolean isRTL = processor->_textDirection == SFTextDirectionRightToLeft;
+    SFCmapRef cmap = SFFontGetCmap(font);
+    SFCmapCache cmapCache;
+
+    if (cmap) {
+        SFCmapCacheInitialize(&cmapCache);
+    }
 
     SFCodepointsReset(album->codepoints);
 
     switch (processor->_textMode) {
         case SFTextModeForward:
         case SFTextModeBackward: {
+            SFCodepoint batchCodepoints[SF_FONT_BATCH_SIZE];
+            SFUInteger batchAssociations[SF_FONT_BATCH_SIZE];
+            SFUInteger batchCount = 0;
             SFCodepoint current;
 
             while ((current = SFCodepointsNext(codepoints)) != SFCodepointInvalid) {
-                SFGlyphID glyph;
-                SFGlyphTraits traits;
-
                 if (isRTL) {
                     SFCodepoint mirror = SFCodepointsGetMirror(current);
 
@@ -80,9 +83,25 @@ SF_INTERNAL void _SFDiscoverGlyphs(SFTextProcessorRef processor)
                     }
                 }
 
-                glyph = SFFontGetGlyphIDForCodepoint(font, current);
-                traits = _SFGetGlyphTraits(processor, glyph);
-                SFAlbumAddGlyph(album, glyph, traits, codepoints->index);
+                /* Map the code point natively unless the protocol of the font does it. */
+                if (cmap) {
+                    SFGlyphID glyph = SFCmapGetCachedGlyph(cmap, &cmapCache, current);
+                    SFGlyphTraits traits = _SFGetGlyphTraits(processor, glyph);
+
+                    SFAlbumAddGlyph(album, glyph, traits, codepoints->index);
+                } else {
+                    batchCodepoints[batchCount] = current;
+                    batchAssociations[batchCount] = codepoints->index;
+
+                    if (++batchCount == SF_FONT_BATCH_SIZE) {
+                        _SFAddGlyphBatch(processor, batchCodepoints, batchAssociations, batchCount);
+                        batchCount = 0;
+                    }
+                }
+            }
+
+            if (batchCount) {
+                _SFAddGlyphBatch(processor, batchCodepoints, batchAssociations, batchCount);
             }
             break;
         }
@@ -23,30 +23,42 @@
 #include "SFAlbum.h"
 #include "SFBase.h"
 #include "SFCommon.h"
+#include "SFContextMatcher.h"
 #include "SFData.h"
+#include "SFFontCache.h"
 #include "SFGDEF.h"
 #include "SFLocator.h"
-#include "SFOpenType.h"
 
 #include "SFGlyphManipulation.h"
 #include "SFGlyphPositioning.h"
 #include "SFGlyphSubstitution.h"
 #include "SFTextProcessor.h"
 
-enum {
-    _SFGlyphZoneInput = 0,
-    _SFGlyphZoneBacktrack = 1,
-    _SFGlyphZoneLookahead = 2
-};
-typedef SFUInt8 _SFGlyphZone;
+/**
+ * Maximum number of glyphs on either side of the first input glyph which a compiled rule can
+ * refer to. Subtables having longer rules are matched by interpreting the raw tables.
+ */
+#define _SFContextWindowLimit   32
 
 typedef struct {
+    SFFontCacheRef fontCache;
     void *helperPtr;
     SFUInt16 recordValue;
     SFGlyphID glyphID;
-    _SFGlyphZone glyphZone;
+    SFContextZone glyphZone;
 } _SFGlyphAgent;
 
+/**
+ * Indexes of the glyphs around the first input glyph, resolved lazily and shared by all rules
+ * of a rule set.
+ */
+typedef struct {
+    SFUInteger forward[_SFContextWindowLimit];
+    SFUInteger backward[_SFContextWindowLimit];
+    SFUInteger forwardCount;
+    SFUInteger backwardCount;
+} _SFContextWindow;
+
 typedef SFBoolean (*_SFGlyphAssessment)(_SFGlyphAgent *glyphAgent);
 
 static SFBoolean _SFApplyRuleSetTable(SFTextProcessorRef textProcessor,
@@ -62,6 +74,9 @@ static SFBoolean _SFApplyChainRuleTable(SFTextProcessorRef textProcessor,
 static SFBoolean _SFApplyContextLookups(SFTextProcessorRef textProcessor,
     SFData lookupArray, SFUInteger lookupCount, SFUInteger contextStart, SFUInteger contextEnd);
 
+static SFBoolean _SFApplyContextMatcher(SFTextProcessorRef textProcessor,
+    SFData contextSubtable, SFContextMatcherRef contextMatcher);
+
 static SFBoolean _SFAssessGlyphByEquality(_SFGlyphAgent *glyphAgent)
 {
     return (glyphAgent->glyphID == glyphAgent->recordValue);
@@ -73,20 +88,20 @@ static SFBoolean _SFAssessGlyphByClass(_SFGlyphAgent *glyphAgent)
     SFUInt16 glyphClass;
 
     switch (glyphAgent->glyphZone) {
-        case _SFGlyphZoneInput:
+        case SFContextZoneInput:
             classDefTable = ((SFData *)glyphAgent->helperPtr)[0];
             break;
 
-        case _SFGlyphZoneBacktrack:
+        case SFContextZoneBacktrack:
             classDefTable = ((SFData *)glyphAgent->helperPtr)[1];
             break;
 
-        case _SFGlyphZoneLookahead:
+        case SFContextZoneLookahead:
             classDefTable = ((SFData *)glyphAgent->helperPtr)[2];
             break;
     }
 
-    glyphClass = SFOpenTypeSearchGlyphClass(classDefTable, glyphAgent->glyphID);
+    glyphClass = SFFontCacheSearchGlyphClass(glyphAgent->fontCache, classDefTable, glyphAgent->glyphID);
 
     return (glyphClass == glyphAgent->recordValue);
 }
@@ -98,7 +113,7 @@ static SFBoolean _SFAssessGlyphByCoverage(_SFGlyphAgent *glyphAgent)
     SFUInteger coverageIndex;
 
     coverageTable = SFData_Subdata(subtable, glyphAgent->recordValue);
-    coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, glyphAgent->glyphID);
+    coverageIndex = SFFontCacheSearchCoverageIndex(glyphAgent->fontCache, coverageTable, glyphAgent->glyphID);
 
     return (coverageIndex != SFInvalidIndex);
 }
@@ -112,8 +127,9 @@ static SFBoolean _SFAssessBacktrackGlyphs(SFTextProcessorRef textProcessor,
     SFUInteger valueIndex;
     _SFGlyphAgent glyphAgent;
 
+    glyphAgent.fontCache = textProcessor->_fontCache;
     glyphAgent.helperPtr = helperPtr;
-    glyphAgent.glyphZone = _SFGlyphZoneBacktrack;
+    glyphAgent.glyphZone = SFContextZoneBacktrack;
 
     for (valueIndex = 0; valueIndex < valueCount; valueIndex++) {
         backtrackIndex = SFLocatorGetBefore(locator, backtrackIndex);
@@ -143,8 +159,9 @@ static SFBoolean _SFAssessInputGlyphs(SFTextProcessorRef textProcessor,
     SFUInteger valueIndex = 0;
     _SFGlyphAgent glyphAgent;
 
+    glyphAgent.fontCache = textProcessor->_fontCache;
     glyphAgent.helperPtr = helperPtr;
-    glyphAgent.glyphZone = _SFGlyphZoneInput;
+    glyphAgent.glyphZone = SFContextZoneInput;
 
     if (includeFirst) {
         glyphAgent.glyphID = SFAlbumGetGlyph(album, inputIndex);
@@ -188,8 +205,9 @@ static SFBoolean _SFAssessLookaheadGlyphs(SFTextProcessorRef textProcessor,
     SFUInteger valueIndex;
     _SFGlyphAgent glyphAgent;
 
+    glyphAgent.fontCache = textProcessor->_fontCache;
     glyphAgent.helperPtr = helperPtr;
-    glyphAgent.glyphZone = _SFGlyphZoneLookahead;
+    glyphAgent.glyphZone = SFContextZoneLookahead;
 
     for (valueIndex = 0; valueIndex < valueCount; valueIndex++) {
         lookaheadIndex = SFLocatorGetAfter(locator, lookaheadIndex);
@@ -209,13 +227,188 @@ static SFBoolean _SFAssessLookaheadGlyphs(SFTextProcessorRef textProcessor,
     return SFTrue;
 }
 
+static SFUInteger _SFResolveForwardIndex(SFLocatorRef locator, _SFContextWindow *contextWindow,
+    SFUInteger position)
+{
+    while (contextWindow->forwardCount <= position) {
+        SFUInteger lastIndex = contextWindow->forward[contextWindow->forwardCount - 1];
+
+        if (lastIndex != SFInvalidIndex) {
+            lastIndex = SFLocatorGetAfter(locator, lastIndex);
+        }
+
+        contextWindow->forward[contextWindow->forwardCount++] = lastIndex;
+    }
+
+    return contextWindow->forward[position];
+}
+
+static SFUInteger _SFResolveBackwardIndex(SFLocatorRef locator, _SFContextWindow *contextWindow,
+    SFUInteger position)
+{
+    while (contextWindow->backwardCount <= position) {
+        SFUInteger lastIndex = contextWindow->backward[contextWindow->backwardCount - 1];
+
+        if (lastIndex != SFInvalidIndex) {
+            lastIndex = SFLocatorGetBefore(locator, lastIndex);
+        }
+
+        contextWindow->backward[contextWindow->backwardCount++] = lastIndex;
+    }
+
+    return contextWindow->backward[position];
+}
+
+static SFBoolean _SFMatchContextGlyph(SFTextProcessorRef textProcessor, SFContextMatcherRef contextMatcher,
+    SFContextZone contextZone, SFUInteger glyphIndex, SFUInt32 value)
+{
+    SFGlyphID glyphID;
+
+    if (glyphIndex == SFInvalidIndex) {
+        return SFFalse;
+    }
+
+    glyphID = SFAlbumGetGlyph(textProcessor->_album, glyphIndex);
+
+    switch (contextMatcher->format) {
+        case 1:
+            return (glyphID == value);
+
+        case 2: {
+            SFUInteger classMap = contextMatcher->classMaps[contextZone];
+            return (SFGlyphMapGetValue(SFFontCacheGetGlyphMap(textProcessor->_fontCache, classMap), glyphID) == value);
+        }
+
+        case 3:
+            return (SFGlyphMapGetValue(SFFontCacheGetGlyphMap(textProcessor->_fontCache, value), glyphID) != SFUInt16Max);
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFMatchContextRule(SFTextProcessorRef textProcessor, SFContextMatcherRef contextMatcher,
+    SFContextRuleRef contextRule, _SFContextWindow *contextWindow, SFUInteger *contextEnd)
+{
+    SFLocatorRef locator = &textProcessor->_locator;
+    const SFUInt32 *values = SFContextMatcherGetValues(contextMatcher, contextRule);
+    SFUInteger inputCount = contextRule->inputCount;
+    SFUInteger forwardCount = inputCount + contextRule->lookaheadCount;
+    SFUInteger glyphIndex;
+    SFUInteger position;
+
+    /* The first input glyph has a value only in format 3. */
+    for (position = (contextMatcher->format == 3 ? 0 : 1); position < inputCount; position++) {
+        glyphIndex = _SFResolveForwardIndex(locator, contextWindow, position);
+
+        if (!_SFMatchContextGlyph(textProcessor, contextMatcher, SFContextZoneInput, glyphIndex, *(values++))) {
+            return SFFalse;
+        }
+    }
+
+    for (position = 1; position <= contextRule->backtrackCount; position++) {
+        glyphIndex = _SFResolveBackwardIndex(locator, contextWindow, position);
+
+        if (!_SFMatchContextGlyph(textProcessor, contextMatcher, SFContextZoneBacktrack, glyphIndex, *(values++))) {
+            return SFFalse;
+        }
+    }
+
+    for (position = inputCount; position < forwardCount; position++) {
+        glyphIndex = _SFResolveForwardIndex(locator, contextWindow, position);
+
+        if (!_SFMatchContextGlyph(textProcessor, contextMatcher, SFContextZoneLookahead, glyphIndex, *(values++))) {
+            return SFFalse;
+        }
+    }
+
+    *contextEnd = contextWindow->forward[inputCount - 1];
+    return SFTrue;
+}
+
+/**
+ * Matches the rules of a compiled subtable without reinterpreting the raw tables.
+ */
+static SFBoolean _SFApplyContextMatcher(SFTextProcessorRef textProcessor,
+    SFData contextSubtable, SFContextMatcherRef contextMatcher)
+{
+    SFFontCacheRef fontCache = textProcessor->_fontCache;
+    SFUInteger inputIndex = textProcessor->_locator.index;
+    SFGlyphID inputGlyph = SFAlbumGetGlyph(textProcessor->_album, inputIndex);
+    SFUInteger ruleSetIndex = 0;
+    SFContextRuleRef contextRules;
+    SFUInteger ruleCount;
+    SFUInteger ruleIndex;
+    _SFContextWindow contextWindow;
+
+    if (contextMatcher->format != 3) {
+        /* Coverage offset lies at the same place in both contextual and chaining contextual subtables. */
+        SFOffset coverageOffset = SFContextF1_CoverageOffset(contextSubtable);
+        SFData coverageTable = SFData_Subdata(contextSubtable, coverageOffset);
+        SFUInteger coverageIndex;
+
+        coverageIndex = SFFontCacheSearchCoverageIndex(fontCache, coverageTable, inputGlyph);
+
+        if (coverageIndex == SFInvalidIndex) {
+            return SFFalse;
+        }
+
+        if (contextMatcher->format == 1) {
+            ruleSetIndex = coverageIndex;
+        } else {
+            SFGlyphMapRef classMap = SFFontCacheGetGlyphMap(fontCache, contextMatcher->classMaps[SFContextZoneInput]);
+            ruleSetIndex = SFGlyphMapGetValue(classMap, inputGlyph);
+        }
+    }
+
+    contextRules = SFContextMatcherGetRules(contextMatcher, ruleSetIndex, &ruleCount);
+    contextWindow.forward[0] = inputIndex;
+    contextWindow.backward[0] = inputIndex;
+    contextWindow.forwardCount = 1;
+    contextWindow.backwardCount = 1;
+
+    /* Match each rule sequentially as they are ordered by preference. */
+    for (ruleIndex = 0; ruleIndex < ruleCount; ruleIndex++) {
+        SFContextRuleRef contextRule = &contextRules[ruleIndex];
+        SFUInteger contextEnd;
+
+        if (_SFMatchContextRule(textProcessor, contextMatcher, contextRule, &contextWindow, &contextEnd)) {
+            return _SFApplyContextLookups(textProcessor,
+                                          SFContextMatcherGetLookupArray(contextMatcher, contextRule),
+                                          contextRule->lookupCount, inputIndex, contextEnd);
+        }
+    }
+
+    return SFFalse;
+}
+
+/**
+ * Returns the compiled matcher of the subtable if its rules fit in a context window.
+ */
+static SFContextMatcherRef _SFGetContextMatcher(SFTextProcessorRef textProcessor, SFData contextSubtable)
+{
+    SFContextMatcherRef contextMatcher = SFFontCacheGetContextMatcher(textProcessor->_fontCache, contextSubtable);
+
+    if (contextMatcher
+        && contextMatcher->forwardLimit < _SFContextWindowLimit
+        && contextMatcher->backtrackLimit < _SFContextWindowLimit) {
+        return contextMatcher;
+    }
+
+    return NULL;
+}
+
 SF_PRIVATE SFBoolean _SFApplyContextSubtable(SFTextProcessorRef processor, SFData contextSubtable)
 {
     SFAlbumRef album = processor->_album;
     SFLocatorRef locator = &processor->_locator;
     SFGlyphID inputGlyph = SFAlbumGetGlyph(album, locator->index);
+    SFContextMatcherRef contextMatcher = _SFGetContextMatcher(processor, contextSubtable);
     SFUInt16 format;
 
+    if (contextMatcher) {
+        return _SFApplyContextMatcher(processor, contextSubtable, contextMatcher);
+    }
+
     format = SFContext_Format(contextSubtable);
 
     switch (format) {
@@ -224,7 +417,7 @@ SF_PRIVATE SFBoolean _SFApplyContextSubtable(SFTextProcessorRef processor, SFDat
             SFData coverageTable = SFData_Subdata(contextSubtable, coverageOffset);
             SFUInteger coverageIndex;
 
-            coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
+            coverageIndex = SFFontCacheSearchCoverageIndex(processor->_fontCache, coverageTable, inputGlyph);
 
             if (coverageIndex != SFInvalidIndex) {
                 SFUInt16 chainRuleSetCount = SFContextF1_RuleSetCount(contextSubtable);
@@ -244,7 +437,7 @@ SF_PRIVATE SFBoolean _SFApplyContextSubtable(SFTextProcessorRef processor, SFDat
             SFData coverageTable = SFData_Subdata(contextSubtable, coverageOffset);
             SFUInteger coverageIndex;
 
-            coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
+            coverageIndex = SFFontCacheSearchCoverageIndex(processor->_fontCache, coverageTable, inputGlyph);
 
             if (coverageIndex != SFInvalidIndex) {
                 SFOffset classDefOffset = SFContextF2_ClassDefOffset(contextSubtable);
@@ -252,7 +445,7 @@ SF_PRIVATE SFBoolean _SFApplyContextSubtable(SFTextProcessorRef processor, SFDat
                 SFUInt16 ruleSetCount = SFContextF2_RuleSetCount(contextSubtable);
                 SFUInt16 inputClass;
 
-                inputClass = SFOpenTypeSearchGlyphClass(classDefTable, inputGlyph);
+                inputClass = SFFontCacheSearchGlyphClass(processor->_fontCache, classDefTable, inputGlyph);
 
                 if (inputClass < ruleSetCount) {
                     SFOffset ruleSetOffset = SFContextF2_RuleSetOffset(contextSubtable, inputClass);
@@ -322,8 +515,13 @@ SF_PRIVATE SFBoolean _SFApplyChainContextSubtable(SFTextProcessorRef textProcess
     SFData chainContextSubtable)
 {
     SFGlyphID inputGlyph = SFAlbumGetGlyph(textProcessor->_album, textProcessor->_locator.index);
+    SFContextMatcherRef contextMatcher = _SFGetContextMatcher(textProcessor, chainContextSubtable);
     SFUInt16 format;
-    
+
+    if (contextMatcher) {
+        return _SFApplyContextMatcher(textProcessor, chainContextSubtable, contextMatcher);
+    }
+
     format = SFChainContext_Format(chainContextSubtable);
 
     switch (format) {
@@ -332,7 +530,7 @@ SF_PRIVATE SFBoolean _SFApplyChainContextSubtable(SFTextProcessorRef textProcess
             SFData coverageTable = SFData_Subdata(chainContextSubtable, coverageOffset);
             SFUInteger coverageIndex;
 
-            coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
+            coverageIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, coverageTable, inputGlyph);
 
             if (coverageIndex != SFInvalidIndex) {
                 SFUInt16 chainRuleSetCount = SFChainContextF1_ChainRuleSetCount(chainContextSubtable);
@@ -352,7 +550,7 @@ SF_PRIVATE SFBoolean _SFApplyChainContextSubtable(SFTextProcessorRef textProcess
             SFData coverageTable = SFData_Subdata(chainContextSubtable, coverageOffset);
             SFUInteger coverageIndex;
 
-            coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
+            coverageIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, coverageTable, inputGlyph);
 
             if (coverageIndex != SFInvalidIndex) {
                 SFOffset backtrackClassDefOffset = SFChainContextF2_BacktrackClassDefOffset(chainContextSubtable);
@@ -364,7 +562,7 @@ SF_PRIVATE SFBoolean _SFApplyChainContextSubtable(SFTextProcessorRef textProcess
                 SFUInt16 chainRuleSetCount = SFChainContextF2_ChainRuleSetCount(chainContextSubtable);
                 SFUInt16 inputClass;
 
-                inputClass = SFOpenTypeSearchGlyphClass(inputClassDefTable, inputGlyph);
+                inputClass = SFFontCacheSearchGlyphClass(textProcessor->_fontCache, inputClassDefTable, inputGlyph);
 
                 if (inputClass < chainRuleSetCount) {
                     SFOffset chainRuleSetOffset = SFChainContextF2_ChainRuleSetOffset(chainContextSubtable, inputClass);
@@ -0,0 +1,721 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <SFConfig.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#include "SFAllocator.h"
+#include "SFAssert.h"
+#include "SFBase.h"
+#include "SFCommon.h"
+#include "SFData.h"
+#include "SFGlyphMap.h"
+
+/**
+ * Glyphs spanning at most this limit are always directly indexed.
+ */
+#define SF_GLYPH_MAP_DIRECT_SPAN            64
+
+/**
+ * A lookup structure is preferred over ranges as long as it takes at most four times the memory.
+ */
+#define SF_GLYPH_MAP_MEMORY_FACTOR          4
+
+#define SF_GLYPH_MAP_WORD_BITS              32
+#define SF_GLYPH_MAP_WORD_SHIFT             5
+#define SF_GLYPH_MAP_WORD_MASK              (SF_GLYPH_MAP_WORD_BITS - 1)
+
+#define SF_GLYPH_MAP_PAGE_SIZE              64
+#define SF_GLYPH_MAP_PAGE_SHIFT             6
+#define SF_GLYPH_MAP_PAGE_MASK              (SF_GLYPH_MAP_PAGE_SIZE - 1)
+
+/**
+ * Number of 32-bit fields preceding the arrays in the image of a glyph map.
+ */
+#define SF_GLYPH_MAP_IMAGE_FIELDS           7
+#define SF_GLYPH_MAP_IMAGE_ALIGNMENT        4
+
+enum {
+    _SFGlyphMapFormRanges = 0,
+    _SFGlyphMapFormValues = 1,
+    _SFGlyphMapFormWords = 2,
+    _SFGlyphMapFormPages = 3
+};
+
+static SFBoolean _SFGlyphMapAppendRange(SFGlyphMapRange *ranges, SFUInteger *rangeCount,
+    SFGlyphID start, SFGlyphID end, SFUInt16 value, SFUInt16 increment);
+static SFBoolean _SFGlyphMapIsRanked(SFGlyphMapRange *ranges, SFUInteger rangeCount);
+static SFUInteger _SFGlyphMapCountPages(SFGlyphMapRef glyphMap, SFGlyphMapRange *ranges, SFUInteger rangeCount);
+static void _SFGlyphMapFillValues(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFGlyphMapRange *ranges, SFUInteger rangeCount);
+static void _SFGlyphMapFillWords(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFGlyphMapRange *ranges, SFUInteger rangeCount);
+static void _SFGlyphMapFillPages(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFGlyphMapRange *ranges, SFUInteger rangeCount, SFUInteger pageCount);
+static void _SFGlyphMapSetRanges(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFGlyphMapRange *ranges, SFUInteger rangeCount);
+static SFUInteger _SFGlyphMapCountBits(SFUInt32 word);
+static SFUInteger _SFGlyphMapAlignSize(SFUInteger size);
+
+static SFBoolean _SFGlyphMapAppendRange(SFGlyphMapRange *ranges, SFUInteger *rangeCount,
+    SFGlyphID start, SFGlyphID end, SFUInt16 value, SFUInt16 increment)
+{
+    SFUInteger count = *rangeCount;
+    SFGlyphMapRange *last = (count ? &ranges[count - 1] : NULL);
+
+    /* The ranges must be in increasing order without any overlap. */
+    if (start > end || (last && start <= last->end)) {
+        return SFFalse;
+    }
+    /* The sequential values must not reach the one reserved for unmapped glyphs. */
+    if (increment && (SFUInteger)value + (end - start) >= SFUInt16Max) {
+        return SFFalse;
+    }
+
+    /* Merge the range with the previous one if both are contiguous. */
+    if (last && start == last->end + 1
+        && value == (SFUInteger)last->value + (((SFUInteger)(last->end - last->start) + 1) * increment)) {
+        last->end = end;
+    } else {
+        SFGlyphMapRange *range = &ranges[count];
+        range->start = start;
+        range->end = end;
+        range->value = value;
+
+        *rangeCount = count + 1;
+    }
+
+    return SFTrue;
+}
+
+static SFBoolean _SFGlyphMapIsRanked(SFGlyphMapRange *ranges, SFUInteger rangeCount)
+{
+    SFUInteger rank = 0;
+    SFUInteger index;
+
+    for (index = 0; index < rangeCount; index++) {
+        SFGlyphMapRange *range = &ranges[index];
+
+        if (range->value != rank) {
+            return SFFalse;
+        }
+
+        rank += (SFUInteger)(range->end - range->start) + 1;
+    }
+
+    return SFTrue;
+}
+
+static SFUInteger _SFGlyphMapCountPages(SFGlyphMapRef glyphMap, SFGlyphMapRange *ranges, SFUInteger rangeCount)
+{
+    SFUInteger pageCount = 0;
+    SFUInteger nextPage = 0;
+    SFUInteger index;
+
+    for (index = 0; index < rangeCount; index++) {
+        SFGlyphMapRange *range = &ranges[index];
+        SFUInteger startPage = (range->start - glyphMap->_firstGlyph) >> SF_GLYPH_MAP_PAGE_SHIFT;
+        SFUInteger endPage = (range->end - glyphMap->_firstGlyph) >> SF_GLYPH_MAP_PAGE_SHIFT;
+
+        /* A page may be shared with the previous range. */
+        if (startPage < nextPage) {
+            startPage = nextPage;
+        }
+
+        if (startPage <= endPage) {
+            pageCount += endPage - startPage + 1;
+            nextPage = endPage + 1;
+        }
+    }
+
+    return pageCount;
+}
+
+static void _SFGlyphMapFillValues(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFGlyphMapRange *ranges, SFUInteger rangeCount)
+{
+    SFUInteger span = glyphMap->_span;
+    SFUInt16 *values = SFAllocatorAllocate(allocator, sizeof(SFUInt16) * span);
+    SFUInteger index;
+
+    for (index = 0; index < span; index++) {
+        values[index] = glyphMap->_defaultValue;
+    }
+
+    for (index = 0; index < rangeCount; index++) {
+        SFGlyphMapRange *range = &ranges[index];
+        SFUInteger offset = range->start - glyphMap->_firstGlyph;
+        SFUInteger limit = range->end - glyphMap->_firstGlyph;
+        SFUInt16 value = range->value;
+
+        for (; offset <= limit; offset++) {
+            values[offset] = value;
+            value += glyphMap->_increment;
+        }
+    }
+
+    glyphMap->_values = values;
+}
+
+static void _SFGlyphMapFillWords(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFGlyphMapRange *ranges, SFUInteger rangeCount)
+{
+    SFUInteger wordCount = (glyphMap->_span + SF_GLYPH_MAP_WORD_MASK) >> SF_GLYPH_MAP_WORD_SHIFT;
+    SFUInt32 *words = SFAllocatorAllocate(allocator, sizeof(SFUInt32) * wordCount);
+    SFUInt16 *ranks = SFAllocatorAllocate(allocator, sizeof(SFUInt16) * wordCount);
+    SFUInteger rank = 0;
+    SFUInteger index;
+
+    for (index = 0; index < wordCount; index++) {
+        words[index] = 0;
+    }
+
+    for (index = 0; index < rangeCount; index++) {
+        SFGlyphMapRange *range = &ranges[index];
+        SFUInteger offset = range->start - glyphMap->_firstGlyph;
+        SFUInteger limit = range->end - glyphMap->_firstGlyph;
+
+        for (; offset <= limit; offset++) {
+            words[offset >> SF_GLYPH_MAP_WORD_SHIFT] |= (SFUInt32)1 << (offset & SF_GLYPH_MAP_WORD_MASK);
+        }
+    }
+
+    for (index = 0; index < wordCount; index++) {
+        ranks[index] = (SFUInt16)rank;
+        rank += _SFGlyphMapCountBits(words[index]);
+    }
+
+    glyphMap->_words = words;
+    glyphMap->_ranks = ranks;
+}
+
+static void _SFGlyphMapFillPages(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFGlyphMapRange *ranges, SFUInteger rangeCount, SFUInteger pageCount)
+{
+    SFUInteger indexCount = (glyphMap->_span + SF_GLYPH_MAP_PAGE_MASK) >> SF_GLYPH_MAP_PAGE_SHIFT;
+    SFUInteger valueCount = (pageCount + 1) << SF_GLYPH_MAP_PAGE_SHIFT;
+    SFUInt16 *pageIndexes = SFAllocatorAllocate(allocator, sizeof(SFUInt16) * indexCount);
+    SFUInt16 *pageValues = SFAllocatorAllocate(allocator, sizeof(SFUInt16) * valueCount);
+    SFUInteger usedPages = 1;
+    SFUInteger index;
+
+    /* All blocks initially refer to the first page holding no mapped glyph. */
+    for (index = 0; index < indexCount; index++) {
+        pageIndexes[index] = 0;
+    }
+    for (index = 0; index < valueCount; index++) {
+        pageValues[index] = glyphMap->_defaultValue;
+    }
+
+    for (index = 0; index < rangeCount; index++) {
+        SFGlyphMapRange *range = &ranges[index];
+        SFUInteger offset = range->start - glyphMap->_firstGlyph;
+        SFUInteger limit = range->end - glyphMap->_firstGlyph;
+        SFUInt16 value = range->value;
+
+        for (; offset <= limit; offset++) {
+            SFUInteger block = offset >> SF_GLYPH_MAP_PAGE_SHIFT;
+
+            if (!pageIndexes[block]) {
+                pageIndexes[block] = (SFUInt16)usedPages++;
+            }
+
+            pageValues[((SFUInteger)pageIndexes[block] << SF_GLYPH_MAP_PAGE_SHIFT)
+                       | (offset & SF_GLYPH_MAP_PAGE_MASK)] = value;
+            value += glyphMap->_increment;
+        }
+    }
+
+    glyphMap->_pageIndexes = pageIndexes;
+    glyphMap->_pageValues = pageValues;
+}
+
+static void _SFGlyphMapSetRanges(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFGlyphMapRange *ranges, SFUInteger rangeCount)
+{
+    glyphMap->_values = NULL;
+    glyphMap->_words = NULL;
+    glyphMap->_ranks = NULL;
+    glyphMap->_pageIndexes = NULL;
+    glyphMap->_pageValues = NULL;
+    glyphMap->_ranges = NULL;
+    glyphMap->_rangeCount = 0;
+    glyphMap->_span = 0;
+    glyphMap->_firstGlyph = 0;
+
+    if (rangeCount) {
+        SFGlyphID firstGlyph = ranges[0].start;
+        SFGlyphID lastGlyph = ranges[rangeCount - 1].end;
+        SFUInteger span = (SFUInteger)(lastGlyph - firstGlyph) + 1;
+        SFUInteger rangesSize = sizeof(SFGlyphMapRange) * rangeCount * SF_GLYPH_MAP_MEMORY_FACTOR;
+        SFUInteger valuesSize = sizeof(SFUInt16) * span;
+        SFUInteger wordsSize = ((span + SF_GLYPH_MAP_WORD_MASK) >> SF_GLYPH_MAP_WORD_SHIFT)
+                             * (sizeof(SFUInt32) + sizeof(SFUInt16));
+        SFUInteger pageCount;
+        SFUInteger pagesSize;
+
+        glyphMap->_span = span;
+        glyphMap->_firstGlyph = firstGlyph;
+
+        pageCount = _SFGlyphMapCountPages(glyphMap, ranges, rangeCount);
+        pagesSize = (((span + SF_GLYPH_MAP_PAGE_MASK) >> SF_GLYPH_MAP_PAGE_SHIFT)
+                     + ((pageCount + 1) << SF_GLYPH_MAP_PAGE_SHIFT)) * sizeof(SFUInt16);
+
+        if (span <= SF_GLYPH_MAP_DIRECT_SPAN || valuesSize <= rangesSize) {
+            _SFGlyphMapFillValues(glyphMap, allocator, ranges, rangeCount);
+        } else if (glyphMap->_increment && wordsSize <= rangesSize && _SFGlyphMapIsRanked(ranges, rangeCount)) {
+            _SFGlyphMapFillWords(glyphMap, allocator, ranges, rangeCount);
+        } else if (pagesSize <= rangesSize) {
+            _SFGlyphMapFillPages(glyphMap, allocator, ranges, rangeCount, pageCount);
+        } else {
+            glyphMap->_ranges = SFAllocatorReallocate(allocator, ranges, sizeof(SFGlyphMapRange) * rangeCount);
+            glyphMap->_rangeCount = rangeCount;
+            return;
+        }
+    }
+
+    SFAllocatorDeallocate(allocator, ranges);
+}
+
+static SFUInteger _SFGlyphMapCountBits(SFUInt32 word)
+{
+    word = word - ((word >> 1) & 0x55555555UL);
+    word = (word & 0x33333333UL) + ((word >> 2) & 0x33333333UL);
+    word = (word + (word >> 4)) & 0x0F0F0F0FUL;
+
+    return (SFUInteger)((SFUInt32)(word * 0x01010101UL) >> 24);
+}
+
+SF_INTERNAL SFBoolean SFGlyphMapInitializeWithCoverage(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFData coverageTable, SFUInteger length)
+{
+    SFGlyphMapRange *ranges = NULL;
+    SFUInteger rangeCount = 0;
+    SFUInt16 format;
+
+    /* The coverage table must NOT be null. */
+    SFAssert(coverageTable != NULL);
+
+    if (length < 4) {
+        return SFFalse;
+    }
+
+    format = SFCoverage_Format(coverageTable);
+
+    switch (format) {
+        case 1: {
+            SFUInt16 glyphCount = SFCoverageF1_GlyphCount(coverageTable);
+            SFData glyphArray = SFCoverageF1_GlyphArray(coverageTable);
+            SFUInteger index;
+
+            if (length < 4 + ((SFUInteger)glyphCount * 2)) {
+                return SFFalse;
+            }
+
+            ranges = SFAllocatorAllocate(allocator, sizeof(SFGlyphMapRange) * (glyphCount + 1));
+
+            for (index = 0; index < glyphCount; index++) {
+                SFGlyphID glyph = SFGlyphArray_Value(glyphArray, index);
+
+                if (!_SFGlyphMapAppendRange(ranges, &rangeCount, glyph, glyph, (SFUInt16)index, 1)) {
+                    SFAllocatorDeallocate(allocator, ranges);
+                    return SFFalse;
+                }
+            }
+            break;
+        }
+
+        case 2: {
+            SFUInt16 rangeRecordCount = SFCoverageF2_RangeCount(coverageTable);
+            SFUInteger index;
+
+            if (length < 4 + ((SFUInteger)rangeRecordCount * SFGlyphRange_Size())) {
+                return SFFalse;
+            }
+
+            ranges = SFAllocatorAllocate(allocator, sizeof(SFGlyphMapRange) * (rangeRecordCount + 1));
+
+            for (index = 0; index < rangeRecordCount; index++) {
+                SFData rangeRecord = SFCoverageF2_RangeRecord(coverageTable, index);
+                SFGlyphID start = SFRangeRecord_StartGlyphID(rangeRecord);
+                SFGlyphID end = SFRangeRecord_EndGlyphID(rangeRecord);
+                SFUInt16 startCoverageIndex = SFRangeRecord_StartCoverageIndex(rangeRecord);
+
+                if (!_SFGlyphMapAppendRange(ranges, &rangeCount, start, end, startCoverageIndex, 1)) {
+                    SFAllocatorDeallocate(allocator, ranges);
+                    return SFFalse;
+                }
+            }
+            break;
+        }
+
+        default:
+            return SFFalse;
+    }
+
+    glyphMap->_increment = 1;
+    glyphMap->_defaultValue = SFUInt16Max;
+    _SFGlyphMapSetRanges(glyphMap, allocator, ranges, rangeCount);
+
+    return SFTrue;
+}
+
+SF_INTERNAL SFBoolean SFGlyphMapInitializeWithClassDef(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFData classDefTable, SFUInteger length)
+{
+    SFGlyphMapRange *ranges = NULL;
+    SFUInteger rangeCount = 0;
+    SFUInt16 format;
+
+    /* The class definition table must NOT be null. */
+    SFAssert(classDefTable != NULL);
+
+    if (length < 4) {
+        return SFFalse;
+    }
+
+    format = SFClassDef_Format(classDefTable);
+
+    switch (format) {
+        case 1: {
+            SFGlyphID startGlyphID;
+            SFUInt16 glyphCount;
+            SFData classArray;
+            SFUInteger index;
+
+            if (length < 6) {
+                return SFFalse;
+            }
+
+            startGlyphID = SFClassDefF1_StartGlyphID(classDefTable);
+            glyphCount = SFClassDefF1_GlyphCount(classDefTable);
+            classArray = SFClassDefF1_ClassValueArray(classDefTable);
+
+            if (length < 6 + ((SFUInteger)glyphCount * 2)
+                || (SFUInteger)startGlyphID + glyphCount > (SFUInteger)SFUInt16Max + 1) {
+                return SFFalse;
+            }
+
+            ranges = SFAllocatorAllocate(allocator, sizeof(SFGlyphMapRange) * (glyphCount + 1));
+
+            for (index = 0; index < glyphCount; index++) {
+                SFGlyphID glyph = (SFGlyphID)(startGlyphID + index);
+                SFUInt16 glyphClass = SFUInt16Array_Value(classArray, index);
+
+                /* Glyphs of class zero are left unmapped. */
+                if (glyphClass) {
+                    _SFGlyphMapAppendRange(ranges, &rangeCount, glyph, glyph, glyphClass, 0);
+                }
+            }
+            break;
+        }
+
+        case 2: {
+            SFUInt16 classRangeCount = SFClassDefF2_ClassRangeCount(classDefTable);
+            SFUInteger index;
+
+            if (length < 4 + ((SFUInteger)classRangeCount * SFGlyphRange_Size())) {
+                return SFFalse;
+            }
+
+            ranges = SFAllocatorAllocate(allocator, sizeof(SFGlyphMapRange) * (classRangeCount + 1));
+
+            for (index = 0; index < classRangeCount; index++) {
+                SFData rangeRecord = SFClassDefF2_ClassRangeRecord(classDefTable, index);
+                SFGlyphID start = SFClassRangeRecord_Start(rangeRecord);
+                SFGlyphID end = SFClassRangeRecord_End(rangeRecord);
+                SFUInt16 glyphClass = SFClassRangeRecord_Class(rangeRecord);
+
+                /* The binary search of raw table relies on sorted ranges, so reject others. */
+                if (start > end || (index && start <= SFClassRangeRecord_End(
+                        SFClassDefF2_ClassRangeRecord(classDefTable, index - 1)))) {
+                    SFAllocatorDeallocate(allocator, ranges);
+                    return SFFalse;
+                }
+
+                if (glyphClass) {
+                    _SFGlyphMapAppendRange(ranges, &rangeCount, start, end, glyphClass, 0);
+                }
+            }
+            break;
+        }
+
+        default:
+            return SFFalse;
+    }
+
+    glyphMap->_increment = 0;
+    glyphMap->_defaultValue = 0;
+    _SFGlyphMapSetRanges(glyphMap, allocator, ranges, rangeCount);
+
+    return SFTrue;
+}
+
+static SFUInteger _SFGlyphMapAlignSize(SFUInteger size)
+{
+    return (size + (SF_GLYPH_MAP_IMAGE_ALIGNMENT - 1)) & ~(SFUInteger)(SF_GLYPH_MAP_IMAGE_ALIGNMENT - 1);
+}
+
+SF_INTERNAL SFUInteger SFGlyphMapInitializeWithImage(SFGlyphMapRef glyphMap, const SFUInt8 *image, SFUInteger length)
+{
+    const SFUInt32 *fields = (const SFUInt32 *)image;
+    SFUInteger size = sizeof(SFUInt32) * SF_GLYPH_MAP_IMAGE_FIELDS;
+    SFUInteger arraySizes[2] = { 0, 0 };
+    SFUInteger span;
+    SFUInteger form;
+    SFUInteger count1;
+    SFUInteger count2;
+    SFUInteger index;
+
+    if (length < size) {
+        return 0;
+    }
+
+    span = fields[1];
+    form = fields[4];
+    count1 = fields[5];
+    count2 = fields[6];
+
+    if (fields[0] > SFUInt16Max || span > (SFUInt16Max + 1) - fields[0]
+        || fields[2] > SFUInt16Max || fields[3] > SFUInt16Max
+        || count1 > SFUInt16Max + 1 || count2 > SFUInt16Max + 1 + SF_GLYPH_MAP_PAGE_SIZE) {
+        return 0;
+    }
+
+    switch (form) {
+        case _SFGlyphMapFormRanges:
+            arraySizes[0] = sizeof(SFGlyphMapRange) * count1;
+            break;
+
+        case _SFGlyphMapFormValues:
+            if (count1 != span) {
+                return 0;
+            }
+            arraySizes[0] = sizeof(SFUInt16) * count1;
+            break;
+
+        case _SFGlyphMapFormWords:
+            if (count1 != (span + SF_GLYPH_MAP_WORD_MASK) >> SF_GLYPH_MAP_WORD_SHIFT) {
+                return 0;
+            }
+            arraySizes[0] = sizeof(SFUInt32) * count1;
+            arraySizes[1] = sizeof(SFUInt16) * count1;
+            break;
+
+        case _SFGlyphMapFormPages:
+            if (count1 != (span + SF_GLYPH_MAP_PAGE_MASK) >> SF_GLYPH_MAP_PAGE_SHIFT
+                || !count2 || (count2 & SF_GLYPH_MAP_PAGE_MASK)) {
+                return 0;
+            }
+            arraySizes[0] = sizeof(SFUInt16) * count1;
+            arraySizes[1] = sizeof(SFUInt16) * count2;
+            break;
+
+        default:
+            return 0;
+    }
+
+    if (length - size < _SFGlyphMapAlignSize(arraySizes[0])
+        || length - size - _SFGlyphMapAlignSize(arraySizes[0]) < _SFGlyphMapAlignSize(arraySizes[1])) {
+        return 0;
+    }
+
+    glyphMap->_values = NULL;
+    glyphMap->_words = NULL;
+    glyphMap->_ranks = NULL;
+    glyphMap->_pageIndexes = NULL;
+    glyphMap->_pageValues = NULL;
+    glyphMap->_ranges = NULL;
+    glyphMap->_rangeCount = 0;
+    glyphMap->_span = span;
+    glyphMap->_firstGlyph = (SFGlyphID)fields[0];
+    glyphMap->_increment = (SFUInt16)fields[2];
+    glyphMap->_defaultValue = (SFUInt16)fields[3];
+
+    switch (form) {
+        case _SFGlyphMapFormRanges:
+            glyphMap->_ranges = (SFGlyphMapRange *)(image + size);
+            glyphMap->_rangeCount = count1;
+            break;
+
+        case _SFGlyphMapFormValues:
+            glyphMap->_values = (SFUInt16 *)(image + size);
+            break;
+
+        case _SFGlyphMapFormWords:
+            glyphMap->_words = (SFUInt32 *)(image + size);
+            glyphMap->_ranks = (SFUInt16 *)(image + size + _SFGlyphMapAlignSize(arraySizes[0]));
+            break;
+
+        case _SFGlyphMapFormPages:
+            glyphMap->_pageIndexes = (SFUInt16 *)(image + size);
+            glyphMap->_pageValues = (SFUInt16 *)(image + size + _SFGlyphMapAlignSize(arraySizes[0]));
+
+            /* Make sure that all blocks refer to existing pages. */
+            for (index = 0; index < count1; index++) {
+                if (glyphMap->_pageIndexes[index] >= (count2 >> SF_GLYPH_MAP_PAGE_SHIFT)) {
+                    return 0;
+                }
+            }
+            break;
+    }
+
+    return size + _SFGlyphMapAlignSize(arraySizes[0]) + _SFGlyphMapAlignSize(arraySizes[1]);
+}
+
+SF_INTERNAL void SFGlyphMapFinalize(SFGlyphMapRef glyphMap, const SFAllocator *allocator)
+{
+    SFAllocatorDeallocate(allocator, glyphMap->_values);
+    SFAllocatorDeallocate(allocator, glyphMap->_words);
+    SFAllocatorDeallocate(allocator, glyphMap->_ranks);
+    SFAllocatorDeallocate(allocator, glyphMap->_pageIndexes);
+    SFAllocatorDeallocate(allocator, glyphMap->_pageValues);
+    SFAllocatorDeallocate(allocator, glyphMap->_ranges);
+}
+
+SF_INTERNAL SFUInteger SFGlyphMapWriteImage(SFGlyphMapRef glyphMap, SFUInt8 *buffer)
+{
+    SFUInt32 fields[SF_GLYPH_MAP_IMAGE_FIELDS];
+    const void *arrays[2] = { NULL, NULL };
+    SFUInteger arraySizes[2] = { 0, 0 };
+    SFUInteger size = sizeof(fields);
+    SFUInteger index;
+
+    fields[0] = glyphMap->_firstGlyph;
+    fields[1] = (SFUInt32)glyphMap->_span;
+    fields[2] = glyphMap->_increment;
+    fields[3] = glyphMap->_defaultValue;
+    fields[6] = 0;
+
+    if (glyphMap->_values) {
+        fields[4] = _SFGlyphMapFormValues;
+        fields[5] = (SFUInt32)glyphMap->_span;
+        arrays[0] = glyphMap->_values;
+        arraySizes[0] = sizeof(SFUInt16) * glyphMap->_span;
+    } else if (glyphMap->_words) {
+        SFUInteger wordCount = (glyphMap->_span + SF_GLYPH_MAP_WORD_MASK) >> SF_GLYPH_MAP_WORD_SHIFT;
+
+        fields[4] = _SFGlyphMapFormWords;
+        fields[5] = (SFUInt32)wordCount;
+        arrays[0] = glyphMap->_words;
+        arrays[1] = glyphMap->_ranks;
+        arraySizes[0] = sizeof(SFUInt32) * wordCount;
+        arraySizes[1] = sizeof(SFUInt16) * wordCount;
+    } else if (glyphMap->_pageIndexes) {
+        SFUInteger indexCount = (glyphMap->_span + SF_GLYPH_MAP_PAGE_MASK) >> SF_GLYPH_MAP_PAGE_SHIFT;
+        SFUInteger pageCount = 0;
+
+        for (index = 0; index < indexCount; index++) {
+            if (glyphMap->_pageIndexes[index] >= pageCount) {
+                pageCount = (SFUInteger)glyphMap->_pageIndexes[index] + 1;
+            }
+        }
+
+        fields[4] = _SFGlyphMapFormPages;
+        fields[5] = (SFUInt32)indexCount;
+        fields[6] = (SFUInt32)(pageCount << SF_GLYPH_MAP_PAGE_SHIFT);
+        arrays[0] = glyphMap->_pageIndexes;
+        arrays[1] = glyphMap->_pageValues;
+        arraySizes[0] = sizeof(SFUInt16) * indexCount;
+        arraySizes[1] = sizeof(SFUInt16) * fields[6];
+    } else {
+        fields[4] = _SFGlyphMapFormRanges;
+        fields[5] = (SFUInt32)glyphMap->_rangeCount;
+        arrays[0] = glyphMap->_ranges;
+        arraySizes[0] = sizeof(SFGlyphMapRange) * glyphMap->_rangeCount;
+    }
+
+    if (buffer) {
+        memcpy(buffer, fields, sizeof(fields));
+    }
+
+    for (index = 0; index < 2; index++) {
+        SFUInteger alignedSize = _SFGlyphMapAlignSize(arraySizes[index]);
+
+        if (buffer && alignedSize) {
+            memcpy(buffer + size, arrays[index], arraySizes[index]);
+            memset(buffer + size + arraySizes[index], 0, alignedSize - arraySizes[index]);
+        }
+
+        size += alignedSize;
+    }
+
+    return size;
+}
+
+SF_INTERNAL SFUInt16 SFGlyphMapGetValue(SFGlyphMapRef glyphMap, SFGlyphID glyphID)
+{
+    SFUInteger offset = (SFUInteger)glyphID - glyphMap->_firstGlyph;
+
+    /* The subtraction wraps around for glyphs before the first one. */
+    if (offset < glyphMap->_span) {
+        const SFGlyphMapRange *ranges;
+        SFUInteger low;
+        SFUInteger high;
+
+        if (glyphMap->_values) {
+            return glyphMap->_values[offset];
+        }
+
+        if (glyphMap->_words) {
+            SFUInteger wordIndex = offset >> SF_GLYPH_MAP_WORD_SHIFT;
+            SFUInt32 word = glyphMap->_words[wordIndex];
+            SFUInt32 bit = (SFUInt32)1 << (offset & SF_GLYPH_MAP_WORD_MASK);
+
+            if (word & bit) {
+                return (SFUInt16)(glyphMap->_ranks[wordIndex] + _SFGlyphMapCountBits(word & (bit - 1)));
+            }
+
+            return glyphMap->_defaultValue;
+        }
+
+        if (glyphMap->_pageIndexes) {
+            SFUInteger page = glyphMap->_pageIndexes[offset >> SF_GLYPH_MAP_PAGE_SHIFT];
+            return glyphMap->_pageValues[(page << SF_GLYPH_MAP_PAGE_SHIFT) | (offset & SF_GLYPH_MAP_PAGE_MASK)];
+        }
+
+        ranges = glyphMap->_ranges;
+        low = 0;
+        high = glyphMap->_rangeCount;
+
+        while (low < high) {
+            SFUInteger middle = low + ((high - low) >> 1);
+            const SFGlyphMapRange *range = &ranges[middle];
+
+            if (glyphID < range->start) {
+                high = middle;
+            } else if (glyphID > range->end) {
+                low = middle + 1;
+            } else {
+                return (SFUInt16)(range->value + ((glyphID - range->start) * glyphMap->_increment));
+            }
+        }
+    }
+
+    return glyphMap->_defaultValue;
+}
+
+SF_INTERNAL SFUInteger SFGlyphMapGetGlyphLimit(SFGlyphMapRef glyphMap)
+{
+    if (glyphMap->_span) {
+        return glyphMap->_firstGlyph + glyphMap->_span;
+    }
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _SF_INTERNAL_GLYPH_MAP_H
+#define _SF_INTERNAL_GLYPH_MAP_H
+
+#include <SFConfig.h>
+
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFData.h"
+
+/**
+ * A native range of glyphs whose values are either sequential or constant.
+ */
+typedef struct _SFGlyphMapRange {
+    SFGlyphID start;        /**< First glyph of the range. */
+    SFGlyphID end;          /**< Last glyph of the range. */
+    SFUInt16 value;         /**< Value of the first glyph of the range. */
+} SFGlyphMapRange;
+
+/**
+ * A native representation of an open type table that maps glyphs to 16-bit values. Glyphs lying
+ * in a small span are directly indexed. Sparse glyphs whose values are their ranks are kept in a
+ * bitmap, sparse glyphs clustered in a few places are kept in pages of a two-level table, whereas
+ * others are kept in sorted ranges.
+ */
+typedef struct _SFGlyphMap {
+    SFUInt16 *_values;          /**< Values of all glyphs in the span, if directly indexed. */
+    SFUInt32 *_words;           /**< Bitmap of mapped glyphs in the span, if ranked. */
+    SFUInt16 *_ranks;           /**< Number of mapped glyphs before each word of the bitmap. */
+    SFUInt16 *_pageIndexes;     /**< Index of the page holding each block of the span, if paged. */
+    SFUInt16 *_pageValues;      /**< Values of all pages, the first one being left unmapped. */
+    SFGlyphMapRange *_ranges;   /**< Sorted ranges of glyphs, if none of the above. */
+    SFUInteger _rangeCount;     /**< Number of ranges. */
+    SFUInteger _span;           /**< Number of glyphs from first to last mapped glyph. */
+    SFGlyphID _firstGlyph;      /**< First mapped glyph. */
+    SFUInt16 _increment;        /**< Difference between values of consecutive glyphs of a range. */
+    SFUInt16 _defaultValue;     /**< Value of the glyphs that are not mapped. */
+} SFGlyphMap, *SFGlyphMapRef;
+
+/**
+ * Compiles a coverage table into the glyph map so that it yields the coverage index of each glyph,
+ * or SFUInt16Max if the glyph is not covered. The arrays are allocated with the given allocator,
+ * which must be passed again when finalizing the glyph map.
+ *
+ * @return
+ *      SFTrue if the coverage table was valid and successfully compiled, SFFalse otherwise.
+ */
+SF_INTERNAL SFBoolean SFGlyphMapInitializeWithCoverage(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFData coverageTable, SFUInteger length);
+
+/**
+ * Compiles a class definition table into the glyph map so that it yields the class of each glyph,
+ * or zero if the glyph is not assigned any class.
+ *
+ * @return
+ *      SFTrue if the class definition table was valid and successfully compiled, SFFalse otherwise.
+ */
+SF_INTERNAL SFBoolean SFGlyphMapInitializeWithClassDef(SFGlyphMapRef glyphMap, const SFAllocator *allocator,
+    SFData classDefTable, SFUInteger length);
+
+/**
+ * Initializes the glyph map from an image written by SFGlyphMapWriteImage. The arrays of the glyph
+ * map refer to the image in place, so it must not be finalized and the image must outlive it.
+ *
+ * @return
+ *      The size of the image in bytes if it was valid, zero otherwise.
+ */
+SF_INTERNAL SFUInteger SFGlyphMapInitializeWithImage(SFGlyphMapRef glyphMap, const SFUInt8 *image, SFUInteger length);
+SF_INTERNAL void SFGlyphMapFinalize(SFGlyphMapRef glyphMap, const SFAllocator *allocator);
+
+/**
+ * Writes a self-contained image of the glyph map in native byte order, padded to four bytes.
+ *
+ * @param buffer
+ *      The target buffer that is large enough to hold the image. This parameter can be NULL if
+ *      only the size of the image is needed.
+ * @return
+ *      The size of the image in bytes.
+ */
+SF_INTERNAL SFUInteger SFGlyphMapWriteImage(SFGlyphMapRef glyphMap, SFUInt8 *buffer);
+
+SF_INTERNAL SFUInt16 SFGlyphMapGetValue(SFGlyphMapRef glyphMap, SFGlyphID glyphID);
+
+/**
+ * Returns the glyph following the last mapped glyph, or zero if no glyph is mapped.
+ */
+SF_INTERNAL SFUInteger SFGlyphMapGetGlyphLimit(SFGlyphMapRef glyphMap);
+
+#endif
@@ -23,10 +23,11 @@
 #include "SFBase.h"
 #include "SFCommon.h"
 #include "SFData.h"
+#include "SFFontCache.h"
 #include "SFGPOS.h"
 #include "SFLocator.h"
+#include "SFPairIndex.h"
 #include "SFPattern.h"
-#include "SFOpenType.h"
 
 #include "SFGlyphManipulation.h"
 #include "SFGlyphPositioning.h"
@@ -35,6 +36,8 @@
 static SFBoolean _SFApplySinglePos(SFTextProcessorRef textProcessor, SFData singlePos);
 
 static SFBoolean _SFApplyPairPos(SFTextProcessorRef textProcessor, SFData pairPos);
+static SFBoolean _SFApplyPairValues(SFTextProcessorRef textProcessor, SFData pairPos, SFData pairValues,
+    SFUInteger firstIndex, SFUInteger secondIndex, SFBoolean *outShouldSkip);
 static SFBoolean _SFApplyPairPosF1(SFTextProcessorRef textProcessor, SFData pairPos,
     SFUInteger firstIndex, SFUInteger secondIndex, SFBoolean *outShouldSkip);
 static SFBoolean _SFApplyPairPosF2(SFTextProcessorRef textProcessor, SFData pairPos,
@@ -101,6 +104,19 @@ SF_PRIVATE SFBoolean _SFApplyPositioningSubtable(SFTextProcessorRef textProcesso
     return SFFalse;
 }
 
+SF_PRIVATE void _SFSetPositioningHandlers(_SFSubtableHandler *subtableHandlers)
+{
+    subtableHandlers[SFLookupTypeSingleAdjustment] = _SFApplySinglePos;
+    subtableHandlers[SFLookupTypePairAdjustment] = _SFApplyPairPos;
+    subtableHandlers[SFLookupTypeCursiveAttachment] = _SFApplyCursivePos;
+    subtableHandlers[SFLookupTypeMarkToBaseAttachment] = _SFApplyMarkToBasePos;
+    subtableHandlers[SFLookupTypeMarkToLigatureAttachment] = _SFApplyMarkToLigPos;
+    subtableHandlers[SFLookupTypeMarkToMarkAttachment] = _SFApplyMarkToMarkPos;
+    subtableHandlers[SFLookupTypeContextPositioning] = _SFApplyContextSubtable;
+    subtableHandlers[SFLookupTypeChainedContextPositioning] = _SFApplyChainContextSubtable;
+    subtableHandlers[SFLookupTypeExtensionPositioning] = _SFApplyExtensionSubtable;
+}
+
 static void _SFApplyValueRecord(SFTextProcessorRef textProcessor,
     SFData valueRecord, SFUInt16 valueFormat, SFUInteger inputIndex)
 {
@@ -158,7 +174,7 @@ static SFBoolean _SFApplySinglePos(SFTextProcessorRef textProcessor, SFData sing
             SFData coverageTable = SFData_Subdata(singlePos, coverageOffset);
             SFUInteger coverageIndex;
 
-            coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
+            coverageIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, coverageTable, inputGlyph);
 
             if (coverageIndex != SFInvalidIndex) {
                 SFUInt16 valueFormat = SFSinglePosF1_ValueFormat(singlePos);
@@ -178,7 +194,7 @@ static SFBoolean _SFApplySinglePos(SFTextProcessorRef textProcessor, SFData sing
             SFUInt16 valueCount = SFSinglePosF2_ValueCount(singlePos);
             SFUInteger valueIndex;
 
-            valueIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
+            valueIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, coverageTable, inputGlyph);
 
             if (valueIndex < valueCount) {
                 SFUInteger valueSize = SFValueRecord_Size(valueFormat);
@@ -231,16 +247,35 @@ static SFBoolean _SFApplyPairPos(SFTextProcessorRef textProcessor, SFData pairPo
 
     /* Proceed only if pair glyph is available. */
     if (secondIndex != SFInvalidIndex) {
-        SFUInt16 format = SFPairPos_Format(pairPos);
+        SFFontCacheRef fontCache = textProcessor->_fontCache;
+        SFPairIndexRef pairIndex = SFFontCacheGetPairIndex(fontCache, pairPos);
 
-        switch (format) {
-            case 1:
-                didPosition = _SFApplyPairPosF1(textProcessor, pairPos, firstIndex, secondIndex, &shouldSkip);
-                break;
+        if (pairIndex) {
+            SFAlbumRef album = textProcessor->_album;
+            SFGlyphID firstGlyph = SFAlbumGetGlyph(album, firstIndex);
+            SFGlyphID secondGlyph = SFAlbumGetGlyph(album, secondIndex);
+            SFData pairValues = SFFontCacheSearchPairValues(fontCache, pairIndex, firstGlyph, secondGlyph);
 
-            case 2:
-                didPosition = _SFApplyPairPosF2(textProcessor, pairPos, firstIndex, secondIndex, &shouldSkip);
-                break;
+            if (pairValues) {
+                didPosition = _SFApplyPairValues(textProcessor, pairPos, pairValues,
+                                                 firstIndex, secondIndex, &shouldSkip);
+            }
+        } else {
+            /*
+             * Format 1 searches its pair set directly, selected by the compiled coverage. Format 2
+             * falls back to the raw subtable if it could not be compiled.
+             */
+            SFUInt16 format = SFPairPos_Format(pairPos);
+
+            switch (format) {
+                case 1:
+                    didPosition = _SFApplyPairPosF1(textProcessor, pairPos, firstIndex, secondIndex, &shouldSkip);
+                    break;
+
+                case 2:
+                    didPosition = _SFApplyPairPosF2(textProcessor, pairPos, firstIndex, secondIndex, &shouldSkip);
+                    break;
+            }
         }
     }
 
@@ -251,6 +286,34 @@ static SFBoolean _SFApplyPairPos(SFTextProcessorRef textProcessor, SFData pairPo
     return didPosition;
 }
 
+static SFBoolean _SFApplyPairValues(SFTextProcessorRef textProcessor, SFData pairPos, SFData pairValues,
+    SFUInteger firstIndex, SFUInteger secondIndex, SFBoolean *outShouldSkip)
+{
+    SFUInt16 valueFormat1 = SFPairPos_ValueFormat1(pairPos);
+    SFUInt16 valueFormat2 = SFPairPos_ValueFormat2(pairPos);
+    SFUInteger value1Size = SFValueRecord_Size(valueFormat1);
+    SFUInteger value2Size = SFValueRecord_Size(valueFormat2);
+
+    *outShouldSkip = SFFalse;
+
+    if (value1Size) {
+        _SFApplyValueRecord(textProcessor, pairValues, valueFormat1, firstIndex);
+    }
+
+    if (value2Size) {
+        SFData value2 = SFData_Subdata(pairValues, value1Size);
+        _SFApplyValueRecord(textProcessor, value2, valueFormat2, secondIndex);
+
+        /*
+         * Pair element should be skipped only if the value record for the second glyph is
+         * AVAILABLE.
+         */
+        *outShouldSkip = SFTrue;
+    }
+
+    return SFTrue;
+}
+
 static SFBoolean _SFApplyPairPosF1(SFTextProcessorRef textProcessor, SFData pairPos,
     SFUInteger firstIndex, SFUInteger secondIndex, SFBoolean *outShouldSkip)
 {
@@ -265,43 +328,24 @@ static SFBoolean _SFApplyPairPosF1(SFTextProcessorRef textProcessor, SFData pair
 
     coverageOffset = SFPairPosF1_CoverageOffset(pairPos);
     coverageTable = SFData_Subdata(pairPos, coverageOffset);
-    coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, firstGlyph);
+    coverageIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, coverageTable, firstGlyph);
 
-    if (coverageIndex != SFInvalidIndex) {
+    /* The pair set of first glyph is the one lying at its coverage index. */
+    if (coverageIndex < SFPairPosF1_PairSetCount(pairPos)) {
         SFUInt16 valueFormat1 = SFPairPosF1_ValueFormat1(pairPos);
         SFUInt16 valueFormat2 = SFPairPosF1_ValueFormat2(pairPos);
-        SFUInt16 pairSetCount = SFPairPosF1_PairSetCount(pairPos);
         SFUInteger value1Size = SFValueRecord_Size(valueFormat1);
         SFUInteger value2Size = SFValueRecord_Size(valueFormat2);
         SFUInteger recordSize = SFPairValueRecord_Size(value1Size, value2Size);
-        SFUInteger pairSetIndex;
-
-        for (pairSetIndex = 0; pairSetIndex < pairSetCount; pairSetIndex++) {
-            SFOffset pairSetOffset = SFPairPosF1_PairSetOffset(pairPos, pairSetIndex);
-            SFData pairSetTable = SFData_Subdata(pairPos, pairSetOffset);
-            SFData pairRecord;
+        SFOffset pairSetOffset = SFPairPosF1_PairSetOffset(pairPos, coverageIndex);
+        SFData pairSetTable = SFData_Subdata(pairPos, pairSetOffset);
+        SFData pairRecord;
 
-            pairRecord = _SFSearchPairRecord(pairSetTable, recordSize, secondGlyph);
-
-            if (pairRecord) {
-                if (value1Size) {
-                    SFData value1 = SFPairValueRecord_Value1(pairRecord);
-                    _SFApplyValueRecord(textProcessor, value1, valueFormat1, firstIndex);
-                }
+        pairRecord = _SFSearchPairRecord(pairSetTable, recordSize, secondGlyph);
 
-                if (value2Size) {
-                    SFData value2 = SFPairValueRecord_Value2(pairRecord, value1Size);
-                    _SFApplyValueRecord(textProcessor, value2, valueFormat2, secondIndex);
-
-                    /*
-                     * Pair element should be skipped only if the value record for the second glyph
-                     * is AVAILABLE.
-                     */
-                    *outShouldSkip = SFTrue;
-                }
-
-                return SFTrue;
-            }
+        if (pairRecord) {
+            SFData pairValues = SFPairValueRecord_Value1(pairRecord);
+            return _SFApplyPairValues(textProcessor, pairPos, pairValues, firstIndex, secondIndex, outShouldSkip);
         }
     }
 
@@ -322,7 +366,7 @@ static SFBoolean _SFApplyPairPosF2(SFTextProcessorRef textProcessor, SFData pair
 
     coverageOffset = SFPairPosF2_CoverageOffset(pairPos);
     coverageTable = SFData_Subdata(pairPos, coverageOffset);
-    coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, firstGlyph);
+    coverageIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, coverageTable, firstGlyph);
 
     if (coverageIndex != SFInvalidIndex) {
         SFUInt16 valueFormat1 = SFPairPosF2_ValueFormat1(pairPos);
@@ -336,8 +380,8 @@ static SFBoolean _SFApplyPairPosF2(SFTextProcessorRef textProcessor, SFData pair
         SFUInt16 class1Value;
         SFUInt16 class2Value;
 
-        class1Value = SFOpenTypeSearchGlyphClass(classDef1Table, firstGlyph);
-        class2Value = SFOpenTypeSearchGlyphClass(classDef2Table, secondGlyph);
+        class1Value = SFFontCacheSearchGlyphClass(textProcessor->_fontCache, classDef1Table, firstGlyph);
+        class2Value = SFFontCacheSearchGlyphClass(textProcessor->_fontCache, classDef2Table, secondGlyph);
 
         if (class1Value < class1Count && class2Value < class2Count) {
             SFUInteger value1Size = SFValueRecord_Size(valueFormat1);
@@ -346,24 +390,9 @@ static SFBoolean _SFApplyPairPosF2(SFTextProcessorRef textProcessor, SFData pair
             SFUInteger class1Size = SFClass1Record_Size(class2Count, class2Size);
             SFData class1Record = SFPairPosF2_Class1Record(pairPos, class1Value, class1Size);
             SFData class2Record = SFClass1Record_Class2Record(class1Record, class2Value, class2Size);
+            SFData pairValues = SFClass2Record_Value1(class2Record);
 
-            if (value1Size) {
-                SFData value1 = SFClass2Record_Value1(class2Record);
-                _SFApplyValueRecord(textProcessor, value1, valueFormat1, firstIndex);
-            }
-
-            if (value2Size) {
-                SFData value2 = SFClass2Record_Value2(class2Record, value1Size);
-                _SFApplyValueRecord(textProcessor, value2, valueFormat2, secondIndex);
-
-                /*
-                 * Pair element should be skipped only if the value record for the second glyph is
-                 * AVAILABLE.
-                 */
-                *outShouldSkip = SFTrue;
-            }
-
-            return SFTrue;
+            return _SFApplyPairValues(textProcessor, pairPos, pairValues, firstIndex, secondIndex, outShouldSkip);
         }
     }
 
@@ -394,7 +423,7 @@ static SFPoint _SFConvertAnchorToPoint(SFData anchorTable)
     return point;
 }
 
-static void _SFSearchCursiveAnchors(SFData cursivePos, SFGlyphID inputGlyph,
+static void _SFSearchCursiveAnchors(SFTextProcessorRef textProcessor, SFData cursivePos, SFGlyphID inputGlyph,
     SFData *refExitAnchorTable, SFData *refEntryAnchorTable)
 {
     SFOffset coverageOffset = SFCursivePos_CoverageOffset(cursivePos);
@@ -402,7 +431,7 @@ static void _SFSearchCursiveAnchors(SFData cursivePos, SFGlyphID inputGlyph,
     SFUInt16 entryExitCount = SFCursivePos_EntryExitCount(cursivePos);
     SFUInteger entryExitIndex;
 
-    entryExitIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
+    entryExitIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, coverageTable, inputGlyph);
 
     if (entryExitIndex < entryExitCount) {
         SFData entryExitRecord = SFCursivePos_EntryExitRecord(cursivePos, entryExitIndex);
@@ -439,7 +468,7 @@ static SFBoolean _SFApplyCursivePosF1(SFTextProcessorRef textProcessor, SFData c
     SFGlyphID firstGlyph = SFAlbumGetGlyph(album, firstIndex);
     SFData exitAnchorTable = NULL;
 
-    _SFSearchCursiveAnchors(cursivePos, firstGlyph, &exitAnchorTable, NULL);
+    _SFSearchCursiveAnchors(textProcessor, cursivePos, firstGlyph, &exitAnchorTable, NULL);
 
     /* Proceed only if exit anchor of first glyph exists. */
     if (exitAnchorTable) {
@@ -449,7 +478,7 @@ static SFBoolean _SFApplyCursivePosF1(SFTextProcessorRef textProcessor, SFData c
             SFGlyphID secondGlyph = SFAlbumGetGlyph(album, secondIndex);
             SFData entryAnchorTable = NULL;
 
-            _SFSearchCursiveAnchors(cursivePos, secondGlyph, NULL, &entryAnchorTable);
+            _SFSearchCursiveAnchors(textProcessor, cursivePos, secondGlyph, NULL, &entryAnchorTable);
 
             /* Proceed only if entry anchor of second glyph exists. */
             if (entryAnchorTable) {
@@ -587,7 +616,7 @@ static SFBoolean _SFApplyMarkToBasePos(SFTextProcessorRef textProcessor, SFData
             SFData markCoverageTable = SFData_Subdata(markBasePos, markCoverageOffset);
             SFUInteger markIndex;
 
-            markIndex = SFOpenTypeSearchCoverageIndex(markCoverageTable, inputGlyph);
+            markIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, markCoverageTable, inputGlyph);
 
             if (markIndex != SFInvalidIndex) {
                 SFUInteger prevIndex = _SFGetPreviousBaseGlyphIndex(textProcessor);
@@ -600,7 +629,7 @@ static SFBoolean _SFApplyMarkToBasePos(SFTextProcessorRef textProcessor, SFData
                     SFUInteger baseIndex;
 
                     prevGlyph = SFAlbumGetGlyph(album, prevIndex);
-                    baseIndex = SFOpenTypeSearchCoverageIndex(baseCoverageTable, prevGlyph);
+                    baseIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, baseCoverageTable, prevGlyph);
 
                     if (baseIndex != SFInvalidIndex) {
                         return _SFApplyMarkToBaseArrays(textProcessor, markBasePos, markIndex, baseIndex, prevIndex);
@@ -701,12 +730,18 @@ static SFUInteger _SFGetPreviousLigatureGlyphIndex(SFTextProcessorRef textProces
          *      1) Start loop from ligature index to input index.
          *      2) If a placeholder glyph is found, it is a component of the ligature.
          *      3) Increase component counter for each placeholder.
+         *      4) Also count the placeholders that were removed before each glyph up to the input
+         *         glyph while compacting the album.
          */
         for (nextIndex = ligatureIndex + 1; nextIndex < inputIndex; nextIndex++) {
             if (SFAlbumGetTraits(album, nextIndex) & SFGlyphTraitPlaceholder) {
                 (*outComponent)++;
             }
+
+            (*outComponent) += SFAlbumGetRemovedCount(album, nextIndex);
         }
+
+        (*outComponent) += SFAlbumGetRemovedCount(album, inputIndex);
     }
 
     /* Restore the old lookup flag. */
@@ -730,7 +765,7 @@ static SFBoolean _SFApplyMarkToLigPos(SFTextProcessorRef textProcessor, SFData m
             SFData markCoverageTable = SFData_Subdata(markLigPos, markCoverageOffset);
             SFUInteger markIndex;
 
-            markIndex = SFOpenTypeSearchCoverageIndex(markCoverageTable, inputGlyph);
+            markIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, markCoverageTable, inputGlyph);
 
             if (markIndex != SFInvalidIndex) {
                 SFUInteger prevIndex;
@@ -746,7 +781,7 @@ static SFBoolean _SFApplyMarkToLigPos(SFTextProcessorRef textProcessor, SFData m
                     SFUInteger ligIndex;
 
                     prevGlyph = SFAlbumGetGlyph(album, prevIndex);
-                    ligIndex = SFOpenTypeSearchCoverageIndex(ligCoverageTable, prevGlyph);
+                    ligIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, ligCoverageTable, prevGlyph);
 
                     if (ligIndex != SFInvalidIndex) {
                         return _SFApplyMarkToLigArrays(textProcessor, markLigPos, markIndex, ligIndex, ligComponent, prevIndex);
@@ -864,7 +899,7 @@ static SFBoolean _SFApplyMarkToMarkPos(SFTextProcessorRef textProcessor, SFData
             SFData mark1CoverageTable = SFData_Subdata(markMarkPos, mark1CoverageOffset);
             SFUInteger mark1Index;
 
-            mark1Index = SFOpenTypeSearchCoverageIndex(mark1CoverageTable, inputGlyph);
+            mark1Index = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, mark1CoverageTable, inputGlyph);
 
             if (mark1Index != SFInvalidIndex) {
                 SFUInteger prevIndex = _SFGetPreviousMarkGlyphIndex(textProcessor);
@@ -877,7 +912,7 @@ static SFBoolean _SFApplyMarkToMarkPos(SFTextProcessorRef textProcessor, SFData
                     SFUInteger mark2Index;
 
                     prevGlyph = SFAlbumGetGlyph(album, prevIndex);
-                    mark2Index = SFOpenTypeSearchCoverageIndex(mark2Coverage, prevGlyph);
+                    mark2Index = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, mark2Coverage, prevGlyph);
 
                     if (mark2Index != SFInvalidIndex) {
                         return _SFApplyMarkToMarkArrays(textProcessor, markMarkPos, mark1Index, mark2Index, prevIndex);
@@ -968,25 +1003,36 @@ static void _SFResolveLeftCursiveSegment(SFTextProcessorRef textProcessor, SFUIn
      * REMARKS:
      *      For left-to-right cursively attached segment, first glyph is positioned on BASELINE
      *      pushing next glyphs DOWNWARD.
+     *
+     * PROCESS:
+     *      1) Walk the chain forward from the first glyph.
+     *      2) Add the resolved position of each glyph to the next one.
      */
 
     SFAlbumRef album = textProcessor->_album;
     SFUInteger offset;
 
-    /* The glyph MUST be cursive and right-to-left. */
-    SFAssert(SFAlbumGetTraits(album, inputIndex) & SFGlyphTraitCursive);
-    /* The glyph must NOT be right-to-left. */
-    SFAssert(!(SFAlbumGetTraits(album, inputIndex) & SFGlyphTraitRightToLeft));
-    /* The glyph must NOT be resolved yet. */
-    SFAssert(!(SFAlbumGetTraits(album, inputIndex) & SFGlyphTraitResolved));
-
-    offset = SFAlbumGetCursiveOffset(album, inputIndex);
-
-    if (offset) {
-        SFUInteger nextIndex = inputIndex + offset;
+    for (;;) {
+        SFUInteger nextIndex;
         SFInt32 inputY;
         SFInt32 nextY;
 
+        /* The glyph MUST be cursive and right-to-left. */
+        SFAssert(SFAlbumGetTraits(album, inputIndex) & SFGlyphTraitCursive);
+        /* The glyph must NOT be right-to-left. */
+        SFAssert(!(SFAlbumGetTraits(album, inputIndex) & SFGlyphTraitRightToLeft));
+        /* The glyph must NOT be resolved yet. */
+        SFAssert(!(SFAlbumGetTraits(album, inputIndex) & SFGlyphTraitResolved));
+
+        offset = SFAlbumGetCursiveOffset(album, inputIndex);
+
+        /* Stop at the last glyph of the segment. */
+        if (!offset) {
+            break;
+        }
+
+        nextIndex = inputIndex + offset;
+
         switch (textProcessor->_textDirection) {
             case SFTextDirectionLeftToRight:
             case SFTextDirectionRightToLeft: {
@@ -998,10 +1044,10 @@ static void _SFResolveLeftCursiveSegment(SFTextProcessorRef textProcessor, SFUIn
             }
         }
 
-        _SFResolveLeftCursiveSegment(textProcessor, nextIndex);
-
         /* Mark this glyph as resolved. */
         SFAlbumInsertTraits(album, inputIndex, SFGlyphTraitResolved);
+
+        inputIndex = nextIndex;
     }
 }
 
@@ -1011,38 +1057,53 @@ static void _SFResolveRightCursiveSegment(SFTextProcessorRef textProcessor, SFUI
      * REMARKS:
      *      For right-to-left cursively attached segment, last glyph is positioned on BASELINE,
      *      pushing previous glyphs UPWARD.
+     *
+     * PROCESS:
+     *      1) Walk the chain forward once to sum up the positions of all its glyphs.
+     *      2) Walk it again, giving each glyph the sum of its own position and the positions of
+     *         all following glyphs, which is what resolving from the last glyph backward yields.
      */
 
     SFAlbumRef album = textProcessor->_album;
+    SFUInteger firstIndex = inputIndex;
     SFUInteger offset;
+    SFInt32 chainY = 0;
 
-    /* The glyph MUST be cursive and right-to-left. */
-    SFAssert(SFAlbumGetTraits(album, inputIndex) & (SFGlyphTraitCursive | SFGlyphTraitRightToLeft));
-    /* The glyph must NOT be resolved yet. */
-    SFAssert(!(SFAlbumGetTraits(album, inputIndex) & SFGlyphTraitResolved));
+    do {
+        /* The glyph MUST be cursive and right-to-left. */
+        SFAssert(SFAlbumGetTraits(album, inputIndex) & (SFGlyphTraitCursive | SFGlyphTraitRightToLeft));
+        /* The glyph must NOT be resolved yet. */
+        SFAssert(!(SFAlbumGetTraits(album, inputIndex) & SFGlyphTraitResolved));
 
-    offset = SFAlbumGetCursiveOffset(album, inputIndex);
+        switch (textProcessor->_textDirection) {
+            case SFTextDirectionLeftToRight:
+            case SFTextDirectionRightToLeft:
+                chainY += SFAlbumGetY(album, inputIndex);
+                break;
+        }
 
-    if (offset) {
-        SFUInteger nextIndex = inputIndex + offset;
-        SFInt32 inputY;
-        SFInt32 nextY;
+        offset = SFAlbumGetCursiveOffset(album, inputIndex);
+        inputIndex += offset;
+    } while (offset);
 
-        _SFResolveRightCursiveSegment(textProcessor, nextIndex);
+    inputIndex = firstIndex;
 
+    while ((offset = SFAlbumGetCursiveOffset(album, inputIndex))) {
         switch (textProcessor->_textDirection) {
             case SFTextDirectionLeftToRight:
             case SFTextDirectionRightToLeft: {
-                inputY = SFAlbumGetY(album, inputIndex);
-                nextY = SFAlbumGetY(album, nextIndex);
+                SFInt32 inputY = SFAlbumGetY(album, inputIndex);
 
-                SFAlbumSetY(album, inputIndex, inputY + nextY);
+                SFAlbumSetY(album, inputIndex, chainY);
+                chainY -= inputY;
                 break;
             }
         }
 
         /* Mark this glyph as resolved. */
         SFAlbumInsertTraits(album, inputIndex, SFGlyphTraitResolved);
+
+        inputIndex += offset;
     }
 }
 
@@ -1068,7 +1129,24 @@ static void _SFResolveCursivePositions(SFTextProcessorRef textProcessor, SFLocat
 static void _SFResolveMarkPositions(SFTextProcessorRef textProcessor, SFLocatorRef locator)
 {
     SFAlbumRef album = textProcessor->_album;
-    SFLocatorReset(locator, 0, album->glyphCount);
+    SFUInteger glyphCount = album->glyphCount;
+    SFInteger *penPositions;
+    SFInteger penPosition = 0;
+    SFUInteger index;
+
+    /*
+     * Keep the pen position before each glyph, so that the advances between a mark and its
+     * attached glyph can be obtained with a single subtraction.
+     */
+    penPositions = (SFInteger *)SFAlbumGetTemporaryIndexArray(album, glyphCount + 1);
+
+    for (index = 0; index < glyphCount; index++) {
+        penPositions[index] = penPosition;
+        penPosition += SFAlbumGetAdvance(album, index);
+    }
+    penPositions[glyphCount] = penPosition;
+
+    SFLocatorReset(locator, 0, glyphCount);
 
     while (SFLocatorMoveNext(locator)) {
         SFUInteger inputIndex = locator->index;
@@ -1079,7 +1157,6 @@ static void _SFResolveMarkPositions(SFTextProcessorRef textProcessor, SFLocatorR
             SFUInteger attachmentIndex = inputIndex - attachmentOffset;
             SFInt32 markX = SFAlbumGetX(album, inputIndex);
             SFInt32 markY = SFAlbumGetY(album, inputIndex);
-            SFUInteger index;
 
             /* Put the mark glyph OVER attached glyph. */
             markX += SFAlbumGetX(album, attachmentIndex);;
@@ -1088,15 +1165,11 @@ static void _SFResolveMarkPositions(SFTextProcessorRef textProcessor, SFLocatorR
             /* Close the gap between the mark glyph and previous glyph. */
             switch (textProcessor->_textDirection) {
                 case SFTextDirectionLeftToRight:
-                    for (index = attachmentIndex; index < inputIndex; index++) {
-                        markX -= SFAlbumGetAdvance(album, index);
-                    }
+                    markX -= (SFInt32)(penPositions[inputIndex] - penPositions[attachmentIndex]);
                     break;
 
                 case SFTextDirectionRightToLeft:
-                    for (index = attachmentIndex + 1; index <= inputIndex; index++) {
-                        markX += SFAlbumGetAdvance(album, index);
-                    }
+                    markX += (SFInt32)(penPositions[inputIndex + 1] - penPositions[attachmentIndex + 1]);
                     break;
             }
 
@@ -1112,7 +1185,7 @@ SF_PRIVATE void _SFResolveAttachments(SFTextProcessorRef textProcessor)
     SFAlbumRef album = textProcessor->_album;
     SFLocator locator;
 
-    SFLocatorInitialize(&locator, album, NULL);
+    SFLocatorInitialize(&locator, album, textProcessor->_fontCache, NULL);
 
     _SFResolveCursivePositions(textProcessor, &locator);
     _SFResolveMarkPositions(textProcessor, &locator);
@@ -25,6 +25,7 @@
 #include "SFTextProcessor.h"
 
 SF_PRIVATE SFBoolean _SFApplyPositioningSubtable(SFTextProcessorRef textProcessor, SFLookupType lookupType, SFData subtable);
+SF_PRIVATE void _SFSetPositioningHandlers(_SFSubtableHandler *subtableHandlers);
 SF_PRIVATE void _SFResolveAttachments(SFTextProcessorRef textProcessor);
 
 #endif
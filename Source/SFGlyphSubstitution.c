@@ -20,9 +20,10 @@
 #include "SFCommon.h"
 #include "SFData.h"
 #include "SFGSUB.h"
+#include "SFLigatureTrie.h"
 #include "SFLocator.h"
 #include "SFPattern.h"
-#include "SFOpenType.h"
+#include "SFFontCache.h"
 
 #include "SFGlyphDiscovery.h"
 #include "SFGlyphManipulation.h"
@@ -39,6 +40,11 @@ static SFBoolean _SFApplyAlternateSetTable(SFTextProcessorRef textProcessor, SFD
 
 static SFBoolean _SFApplyLigatureSubst(SFTextProcessorRef textProcessor, SFData subtable);
 static SFBoolean _SFApplyLigatureSetTable(SFTextProcessorRef textProcessor, SFData ligatureSetTable);
+static SFBoolean _SFApplyLigatureTable(SFTextProcessorRef textProcessor, SFData ligatureTable);
+static SFBoolean _SFApplyLigatureTrie(SFTextProcessorRef textProcessor, SFLigatureTrieRef ligatureTrie,
+    SFLigatureNodeRef rootNode);
+static void _SFApplyLigature(SFTextProcessorRef textProcessor, SFGlyphID ligGlyph,
+    SFUInteger *partIndexes, SFUInteger compCount);
 
 SF_PRIVATE SFBoolean _SFApplySubstitutionSubtable(SFTextProcessorRef textProcessor, SFLookupType lookupType, SFData subtable)
 {
@@ -71,69 +77,84 @@ SF_PRIVATE SFBoolean _SFApplySubstitutionSubtable(SFTextProcessorRef textProcess
     return SFFalse;
 }
 
+SF_PRIVATE void _SFSetSubstitutionHandlers(_SFSubtableHandler *subtableHandlers)
+{
+    subtableHandlers[SFLookupTypeSingle] = _SFApplySingleSubst;
+    subtableHandlers[SFLookupTypeMultiple] = _SFApplyMultipleSubst;
+    subtableHandlers[SFLookupTypeAlternate] = _SFApplyAlternateSubst;
+    subtableHandlers[SFLookupTypeLigature] = _SFApplyLigatureSubst;
+    subtableHandlers[SFLookupTypeContext] = _SFApplyContextSubtable;
+    subtableHandlers[SFLookupTypeChainingContext] = _SFApplyChainContextSubtable;
+    subtableHandlers[SFLookupTypeExtension] = _SFApplyExtensionSubtable;
+}
+
 static SFBoolean _SFApplySingleSubst(SFTextProcessorRef textProcessor, SFData singleSubst)
 {
     SFAlbumRef album = textProcessor->_album;
     SFLocatorRef locator = &textProcessor->_locator;
     SFUInteger inputIndex = locator->index;
     SFGlyphID inputGlyph = SFAlbumGetGlyph(album, inputIndex);
-    SFUInt16 format;
-
-    format = SFSingleSubst_Format(singleSubst);
+    SFUInteger substitute;
 
-    switch (format) {
-        case 1: {
-            SFOffset coverageOffset = SFSingleSubstF1_CoverageOffset(singleSubst);
-            SFData coverageTable = SFData_Subdata(singleSubst, coverageOffset);
-            SFUInteger coverageIndex;
+    substitute = SFFontCacheSearchSingleSubstitute(textProcessor->_fontCache, singleSubst, inputGlyph);
 
-            coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
+    if (substitute != SFInvalidIndex) {
+        SFGlyphID substituteGlyph = (SFGlyphID)substitute;
+        SFGlyphTraits substituteTraits = _SFGetGlyphTraits(textProcessor, substituteGlyph);
 
-            if (coverageIndex != SFInvalidIndex) {
-                SFInt16 deltaGlyphID = SFSingleSubstF1_DeltaGlyphID(singleSubst);
-                SFGlyphID substituteGlyph;
-                SFGlyphTraits substituteTraits;
+        /* Substitute the glyph and set its traits. */
+        SFAlbumSetGlyph(album, inputIndex, substituteGlyph);
+        SFAlbumSetTraits(album, inputIndex, substituteTraits);
 
-                substituteGlyph = (SFGlyphID)(inputGlyph + deltaGlyphID);
-                substituteTraits = _SFGetGlyphTraits(textProcessor, substituteGlyph);
+        return SFTrue;
+    }
 
-                /* Substitute the glyph and set its traits. */
-                SFAlbumSetGlyph(album, inputIndex, substituteGlyph);
-                SFAlbumSetTraits(album, inputIndex, substituteTraits);
+    return SFFalse;
+}
 
-                return SFTrue;
-            }
-            break;
+SF_PRIVATE SFBoolean _SFApplySingleRemap(SFTextProcessorRef textProcessor, SFSingleRemapRef singleRemap)
+{
+    SFAlbumRef album = textProcessor->_album;
+    SFUInteger glyphCount = album->glyphCount;
+    const SFGlyphMask *glyphMasks = _SFAlbumGetGlyphMasksPtr(album);
+    const SFGlyphID *glyphs = album->_glyphs.items;
+    SFSingleRemapStepRef steps = singleRemap->steps.items;
+    SFUInteger stepCount = singleRemap->steps.count;
+    SFBoolean isApplied = SFFalse;
+    SFUInteger index;
+
+    for (index = 0; index < glyphCount; index++) {
+        SFUInteger storageIndex = _SFAlbumStorageIndex(album, index);
+        SFGlyphMask glyphMask = glyphMasks[storageIndex];
+        SFGlyphID inputGlyph = glyphs[storageIndex];
+        SFGlyphID substituteGlyph = inputGlyph;
+        SFUInteger stepIndex;
+
+        /* Placeholders are ignored by every lookup. */
+        if (glyphMask.section.glyphTraits & SFGlyphTraitPlaceholder) {
+            continue;
         }
 
-        case 2: {
-            SFOffset coverageOffset = SFSingleSubstF2_CoverageOffset(singleSubst);
-            SFData coverageTable = SFData_Subdata(singleSubst, coverageOffset);
-            SFUInteger coverageIndex;
-
-            coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
-
-            if (coverageIndex != SFInvalidIndex) {
-                SFUInt16 glyphCount = SFSingleSubstF2_GlyphCount(singleSubst);
+        for (stepIndex = 0; stepIndex < stepCount; stepIndex++) {
+            SFSingleRemapStepRef step = &steps[stepIndex];
 
-                if (coverageIndex < glyphCount) {
-                    SFGlyphID substituteGlyph = SFSingleSubstF2_Substitute(singleSubst, coverageIndex);
-                    SFGlyphTraits substituteTraits;
+            if (!(glyphMask.section.featureMask & step->antiFeatureMask) && substituteGlyph < step->glyphLimit) {
+                substituteGlyph = step->glyphs[substituteGlyph];
+            }
+        }
 
-                    substituteTraits = _SFGetGlyphTraits(textProcessor, substituteGlyph);
+        if (substituteGlyph != inputGlyph) {
+            SFGlyphTraits substituteTraits = _SFGetGlyphTraits(textProcessor, substituteGlyph);
 
-                    /* Substitute the glyph and set its traits. */
-                    SFAlbumSetGlyph(album, inputIndex, substituteGlyph);
-                    SFAlbumSetTraits(album, inputIndex, substituteTraits);
+            /* Substitute the glyph and set its traits. */
+            SFAlbumSetGlyph(album, index, substituteGlyph);
+            SFAlbumSetTraits(album, index, substituteTraits);
 
-                    return SFTrue;
-                }
-            }
-            break;
+            isApplied = SFTrue;
         }
     }
 
-    return SFFalse;
+    return isApplied;
 }
 
 static SFBoolean _SFApplyMultipleSubst(SFTextProcessorRef textProcessor, SFData multipleSubst)
@@ -152,7 +173,7 @@ static SFBoolean _SFApplyMultipleSubst(SFTextProcessorRef textProcessor, SFData
             SFData coverageTable = SFData_Subdata(multipleSubst, coverageOffset);
             SFUInteger coverageIndex;
 
-            coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
+            coverageIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, coverageTable, inputGlyph);
 
             if (coverageIndex != SFInvalidIndex) {
                 SFUInt16 sequenceCount = SFMultipleSubstF1_SequenceCount(multipleSubst);
@@ -244,7 +265,7 @@ static SFBoolean _SFApplyAlternateSubst(SFTextProcessorRef textProcessor, SFData
             SFData coverageTable = SFData_Subdata(alternateSubst, coverageOffset);
             SFUInteger coverageIndex;
 
-            coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
+            coverageIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, coverageTable, inputGlyph);
 
             if (coverageIndex != SFInvalidIndex) {
                 SFUInt16 alternateSetCount = SFAlternateSubstF1_AlternateSetCount(alternateSubst);
@@ -299,15 +320,35 @@ static SFBoolean _SFApplyLigatureSubst(SFTextProcessorRef textProcessor, SFData
             SFData coverageTable = SFData_Subdata(ligatureSubst, coverageOffset);
             SFUInteger coverageIndex;
 
-            coverageIndex = SFOpenTypeSearchCoverageIndex(coverageTable, inputGlyph);
-
-            if (coverageIndex != SFInvalidIndex) {
-                SFUInt16 ligSetCount = SFLigatureSubstF1_LigSetCount(ligatureSubst);
-
-                if (coverageIndex < ligSetCount) {
-                    SFOffset ligatureSetOffset = SFLigatureSubstF1_LigatureSetOffset(ligatureSubst, coverageIndex);
-                    SFData ligatureSetTable = SFData_Subdata(ligatureSubst, ligatureSetOffset);
-
+            coverageIndex = SFFontCacheSearchCoverageIndex(textProcessor->_fontCache, coverageTable, inputGlyph);
+
+            if (coverageIndex < SFLigatureSubstF1_LigSetCount(ligatureSubst)) {
+                SFLigatureTrieRef ligatureTrie = SFFontCacheGetLigatureTrie(textProcessor->_fontCache, ligatureSubst);
+                SFOffset ligatureSetOffset = SFLigatureSubstF1_LigatureSetOffset(ligatureSubst, coverageIndex);
+                SFData ligatureSetTable = SFData_Subdata(ligatureSubst, ligatureSetOffset);
+
+                if (ligatureTrie) {
+                    SFLigatureNodeRef rootNode = SFLigatureTrieGetRoot(ligatureTrie, coverageIndex);
+
+                    if (rootNode) {
+                        /*
+                         * The most preferred ligature matches more often than not, and a direct
+                         * comparison of its components is cheaper than searching the edges of
+                         * the trie, so try it first.
+                         */
+                        if (SFLigatureSet_LigatureCount(ligatureSetTable) > 0) {
+                            SFOffset ligatureOffset = SFLigatureSet_LigatureOffset(ligatureSetTable, 0);
+                            SFData ligatureTable = SFData_Subdata(ligatureSetTable, ligatureOffset);
+
+                            if (_SFApplyLigatureTable(textProcessor, ligatureTable)) {
+                                return SFTrue;
+                            }
+                        }
+
+                        return _SFApplyLigatureTrie(textProcessor, ligatureTrie, rootNode);
+                    }
+                } else {
+                    /* Fall back to matching the raw ligature set if the subtable could not be compiled. */
                     return _SFApplyLigatureSetTable(textProcessor, ligatureSetTable);
                 }
             }
@@ -320,9 +361,6 @@ static SFBoolean _SFApplyLigatureSubst(SFTextProcessorRef textProcessor, SFData
 
 static SFBoolean _SFApplyLigatureSetTable(SFTextProcessorRef textProcessor, SFData ligatureSetTable)
 {
-    SFAlbumRef album = textProcessor->_album;
-    SFLocatorRef locator = &textProcessor->_locator;
-    SFUInteger inputIndex = locator->index;
     SFUInt16 ligCount;
     SFUInteger ligIndex;
 
@@ -332,71 +370,150 @@ static SFBoolean _SFApplyLigatureSetTable(SFTextProcessorRef textProcessor, SFDa
     for (ligIndex = 0; ligIndex < ligCount; ligIndex++) {
         SFOffset ligatureOffset = SFLigatureSet_LigatureOffset(ligatureSetTable, ligIndex);
         SFData ligatureTable = SFData_Subdata(ligatureSetTable, ligatureOffset);
-        SFUInt16 compCount = SFLigature_CompCount(ligatureTable);
-        SFUInteger *partIndexes;
-        SFUInteger prevIndex;
-        SFUInteger nextIndex;
-        SFUInteger compIndex;
-
-        partIndexes = SFAlbumGetTemporaryIndexArray(album, compCount);
-        prevIndex = inputIndex;
-
-        /*
-         * Match all compononets starting from second one with input glyphs.
-         *
-         * NOTE:
-         *      The loop is started from 1..CompCount, rather than 0..(CompCount - 1) so that
-         *      it does not accidently overflow if the component count is zero.
-         */
-        for (compIndex = 1; compIndex < compCount; compIndex++) {
-            nextIndex = SFLocatorGetAfter(locator, prevIndex);
-
-            if (nextIndex != SFInvalidIndex) {
-                SFGlyphID component = SFLigature_Component(ligatureTable, compIndex - 1);
-                SFGlyphID glyph = SFAlbumGetGlyph(album, nextIndex);
-
-                if (component != glyph) {
-                    break;
-                }
-            } else {
-                break;
-            }
 
-            partIndexes[compIndex] = nextIndex;
-            prevIndex = nextIndex;
+        if (_SFApplyLigatureTable(textProcessor, ligatureTable)) {
+            return SFTrue;
         }
+    }
 
-        /* Do the substitution, if all components are matched. */
-        if (compIndex == compCount) {
-            SFGlyphID ligGlyph = SFLigature_LigGlyph(ligatureTable);
-            SFGlyphTraits ligTraits = _SFGetGlyphTraits(textProcessor, ligGlyph);
-            SFUInteger ligAssociation;
+    return SFFalse;
+}
 
-            /* Substitute the ligature glyph and set its traits. */
-            SFAlbumSetGlyph(album, inputIndex, ligGlyph);
-            SFAlbumSetTraits(album, inputIndex, ligTraits);
+static SFBoolean _SFApplyLigatureTable(SFTextProcessorRef textProcessor, SFData ligatureTable)
+{
+    SFAlbumRef album = textProcessor->_album;
+    SFLocatorRef locator = &textProcessor->_locator;
+    SFUInt16 compCount = SFLigature_CompCount(ligatureTable);
+    SFUInteger *partIndexes;
+    SFUInteger prevIndex;
+    SFUInteger nextIndex;
+    SFUInteger compIndex;
 
-            ligAssociation = SFAlbumGetAssociation(album, inputIndex);
-            prevIndex = inputIndex;
+    partIndexes = SFAlbumGetTemporaryIndexArray(album, compCount);
+    prevIndex = locator->index;
 
-            /* Initialize component glyphs. */
-            for (compIndex = 1; compIndex < compCount; compIndex++) {
-                /* Get the next component. */
-                nextIndex = partIndexes[compIndex];
+    /*
+     * Match all compononets starting from second one with input glyphs.
+     *
+     * NOTE:
+     *      The loop is started from 1..CompCount, rather than 0..(CompCount - 1) so that
+     *      it does not accidently overflow if the component count is zero.
+     */
+    for (compIndex = 1; compIndex < compCount; compIndex++) {
+        nextIndex = SFLocatorGetAfter(locator, prevIndex);
 
-                /* Make the glyph placeholder. */
-                SFAlbumSetGlyph(album, nextIndex, 0);
-                SFAlbumSetTraits(album, nextIndex, SFGlyphTraitPlaceholder);
+        if (nextIndex != SFInvalidIndex) {
+            SFGlyphID component = SFLigature_Component(ligatureTable, compIndex - 1);
+            SFGlyphID glyph = SFAlbumGetGlyph(album, nextIndex);
 
-                /* Form a cluster by setting the association of in-between glyphs. */
-                for (; prevIndex <= nextIndex; prevIndex++) {
-                    SFAlbumSetAssociation(album, nextIndex, ligAssociation);
-                }
+            if (component != glyph) {
+                break;
             }
+        } else {
+            break;
+        }
 
-            return SFTrue;
+        partIndexes[compIndex] = nextIndex;
+        prevIndex = nextIndex;
+    }
+
+    /* Do the substitution, if all components are matched. */
+    if (compIndex == compCount) {
+        SFGlyphID ligGlyph = SFLigature_LigGlyph(ligatureTable);
+
+        _SFApplyLigature(textProcessor, ligGlyph, partIndexes, compCount);
+        return SFTrue;
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFApplyLigatureTrie(SFTextProcessorRef textProcessor, SFLigatureTrieRef ligatureTrie,
+    SFLigatureNodeRef rootNode)
+{
+    SFAlbumRef album = textProcessor->_album;
+    SFLocatorRef locator = &textProcessor->_locator;
+    SFUInteger *partIndexes = SFAlbumGetTemporaryIndexArray(album, ligatureTrie->componentLimit);
+    SFLigatureNodeRef currentNode = rootNode;
+    SFLigatureNodeRef matchedNode = NULL;
+    SFUInteger matchedCount = 0;
+    SFUInteger prevIndex = locator->index;
+    SFUInteger depth = 0;
+
+    /*
+     * Walk the trie along the following glyphs, remembering the most preferred ligature ending on
+     * the way, so that each glyph is visited only once.
+     */
+    while (currentNode) {
+        SFUInteger nextIndex;
+
+        if (currentNode->priority < (matchedNode ? matchedNode->priority : SFUInt16Max)) {
+            matchedNode = currentNode;
+            matchedCount = depth + 1;
+        }
+
+        /* Stop if no ligature down the trie is preferred over the matched one. */
+        if (matchedNode && currentNode->bestPriority >= matchedNode->priority) {
+            break;
+        }
+
+        /* A trie loaded from an image is trusted only as deep as its component limit. */
+        if (depth + 1 >= ligatureTrie->componentLimit) {
+            break;
+        }
+
+        nextIndex = SFLocatorGetAfter(locator, prevIndex);
+        if (nextIndex == SFInvalidIndex) {
+            break;
+        }
+
+        currentNode = SFLigatureTrieGetChild(ligatureTrie, currentNode, SFAlbumGetGlyph(album, nextIndex));
+
+        if (currentNode) {
+            depth += 1;
+            partIndexes[depth] = nextIndex;
+            prevIndex = nextIndex;
         }
     }
 
+    if (matchedNode) {
+        _SFApplyLigature(textProcessor, matchedNode->ligGlyph, partIndexes, matchedCount);
+        return SFTrue;
+    }
+
     return SFFalse;
 }
+
+static void _SFApplyLigature(SFTextProcessorRef textProcessor, SFGlyphID ligGlyph,
+    SFUInteger *partIndexes, SFUInteger compCount)
+{
+    SFAlbumRef album = textProcessor->_album;
+    SFUInteger inputIndex = textProcessor->_locator.index;
+    SFGlyphTraits ligTraits = _SFGetGlyphTraits(textProcessor, ligGlyph);
+    SFUInteger ligAssociation;
+    SFUInteger prevIndex;
+    SFUInteger nextIndex;
+    SFUInteger compIndex;
+
+    /* Substitute the ligature glyph and set its traits. */
+    SFAlbumSetGlyph(album, inputIndex, ligGlyph);
+    SFAlbumSetTraits(album, inputIndex, ligTraits);
+
+    ligAssociation = SFAlbumGetAssociation(album, inputIndex);
+    prevIndex = inputIndex;
+
+    /* Initialize component glyphs. */
+    for (compIndex = 1; compIndex < compCount; compIndex++) {
+        /* Get the next component. */
+        nextIndex = partIndexes[compIndex];
+
+        /* Make the glyph placeholder. */
+        SFAlbumSetGlyph(album, nextIndex, 0);
+        SFAlbumSetTraits(album, nextIndex, SFGlyphTraitPlaceholder);
+
+        /* Form a cluster by setting the association of in-between glyphs. */
+        for (; prevIndex <= nextIndex; prevIndex++) {
+            SFAlbumSetAssociation(album, nextIndex, ligAssociation);
+        }
+    }
+}
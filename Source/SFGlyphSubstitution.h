@@ -22,8 +22,18 @@
 #include "SFBase.h"
 #include "SFCommon.h"
 #include "SFData.h"
+#include "SFSingleRemap.h"
 #include "SFTextProcessor.h"
 
 SF_PRIVATE SFBoolean _SFApplySubstitutionSubtable(SFTextProcessorRef textProcessor, SFLookupType lookupType, SFData subtable);
+SF_PRIVATE void _SFSetSubstitutionHandlers(_SFSubtableHandler *subtableHandlers);
+
+/**
+ * Applies a composed run of single substitutions on all glyphs of the album in a single pass.
+ *
+ * @return
+ *      SFTrue if any glyph was substituted, SFFalse otherwise.
+ */
+SF_PRIVATE SFBoolean _SFApplySingleRemap(SFTextProcessorRef textProcessor, SFSingleRemapRef singleRemap);
 
 #endif
@@ -0,0 +1,459 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <SFConfig.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#include "SFAllocator.h"
+#include "SFAssert.h"
+#include "SFBase.h"
+#include "SFData.h"
+#include "SFGSUB.h"
+#include "SFList.h"
+#include "SFLigatureTrie.h"
+
+#define SF_LIGATURE_TRIE_IMAGE_FIELDS   4
+
+/**
+ * A ligature of a set along with the sequence of its components following the first one.
+ */
+typedef struct _SFLigatureEntry {
+    SFData components;
+    SFUInteger length;
+    SFUInt16 priority;
+    SFGlyphID ligGlyph;
+} _SFLigatureEntry;
+
+/**
+ * A node whose edges are yet to be built from a sorted range of ligature entries.
+ */
+typedef struct _SFLigatureTask {
+    SFUInt32 node;
+    SFUInteger depth;
+    SFUInteger start;
+    SFUInteger end;
+} _SFLigatureTask;
+
+typedef SF_LIST(_SFLigatureEntry) _SFLigatureEntryList;
+typedef SF_LIST(_SFLigatureTask) _SFLigatureTaskList;
+
+static SFBoolean _SFLigatureTrieCollectEntries(_SFLigatureEntryList *entries, SFUInteger *componentLimit,
+    SFData ligatureSubst, SFUInteger length, SFUInteger ligatureSetOffset);
+static int _SFLigatureEntryComparison(const void *item1, const void *item2);
+static SFUInt32 _SFLigatureTrieAddNode(SFLigatureTrieRef ligatureTrie);
+static void _SFLigatureTrieBuildSet(SFLigatureTrieRef ligatureTrie, _SFLigatureEntryList *entries,
+    _SFLigatureTaskList *tasks, SFUInt32 root);
+static void _SFLigatureTrieResolvePriorities(SFLigatureTrieRef ligatureTrie);
+
+static SFBoolean _SFLigatureTrieCollectEntries(_SFLigatureEntryList *entries, SFUInteger *componentLimit,
+    SFData ligatureSubst, SFUInteger length, SFUInteger ligatureSetOffset)
+{
+    SFData ligatureSet = SFData_Subdata(ligatureSubst, ligatureSetOffset);
+    SFUInteger ligCount;
+    SFUInteger ligIndex;
+
+    if (ligatureSetOffset + 2 > length) {
+        return SFFalse;
+    }
+
+    ligCount = SFLigatureSet_LigatureCount(ligatureSet);
+
+    if (ligatureSetOffset + 2 + (ligCount * 2) > length) {
+        return SFFalse;
+    }
+
+    for (ligIndex = 0; ligIndex < ligCount; ligIndex++) {
+        SFUInteger ligatureOffset = ligatureSetOffset + SFLigatureSet_LigatureOffset(ligatureSet, ligIndex);
+        SFData ligature = SFData_Subdata(ligatureSubst, ligatureOffset);
+        SFUInteger compCount;
+        _SFLigatureEntry entry;
+
+        if (ligatureOffset + 4 > length) {
+            return SFFalse;
+        }
+
+        compCount = SFLigature_CompCount(ligature);
+
+        /* A ligature without any component can never be matched. */
+        if (compCount == 0) {
+            continue;
+        }
+
+        if (ligatureOffset + 4 + ((compCount - 1) * 2) > length) {
+            return SFFalse;
+        }
+
+        if (compCount > *componentLimit) {
+            *componentLimit = compCount;
+        }
+
+        entry.components = SFData_Subdata(ligature, 4);
+        entry.length = compCount - 1;
+        entry.priority = (SFUInt16)ligIndex;
+        entry.ligGlyph = SFLigature_LigGlyph(ligature);
+
+        SFListAdd(entries, entry);
+    }
+
+    return SFTrue;
+}
+
+/**
+ * Orders the entries by their component sequences, placing a sequence before all of its
+ * extensions, and the identical sequences by their preference.
+ */
+static int _SFLigatureEntryComparison(const void *item1, const void *item2)
+{
+    const _SFLigatureEntry *entry1 = item1;
+    const _SFLigatureEntry *entry2 = item2;
+    SFUInteger length = (entry1->length < entry2->length ? entry1->length : entry2->length);
+    SFUInteger index;
+
+    for (index = 0; index < length; index++) {
+        SFGlyphID glyph1 = SFData_UInt16(entry1->components, index * 2);
+        SFGlyphID glyph2 = SFData_UInt16(entry2->components, index * 2);
+
+        if (glyph1 != glyph2) {
+            return (glyph1 < glyph2 ? -1 : 1);
+        }
+    }
+
+    if (entry1->length != entry2->length) {
+        return (entry1->length < entry2->length ? -1 : 1);
+    }
+
+    return (int)entry1->priority - (int)entry2->priority;
+}
+
+static SFUInt32 _SFLigatureTrieAddNode(SFLigatureTrieRef ligatureTrie)
+{
+    SFUInt32 index = (SFUInt32)ligatureTrie->_nodes.count;
+    SFLigatureNode node;
+
+    node.firstEdge = 0;
+    node.edgeCount = 0;
+    node.priority = SFUInt16Max;
+    node.bestPriority = SFUInt16Max;
+    node.ligGlyph = 0;
+
+    SFListAdd(&ligatureTrie->_nodes, node);
+
+    return index;
+}
+
+static void _SFLigatureTrieBuildSet(SFLigatureTrieRef ligatureTrie, _SFLigatureEntryList *entries,
+    _SFLigatureTaskList *tasks, SFUInt32 root)
+{
+    _SFLigatureTask rootTask;
+    SFUInteger taskIndex;
+
+    SFListSort(entries, 0, entries->count, _SFLigatureEntryComparison);
+    SFListClear(tasks);
+
+    rootTask.node = root;
+    rootTask.depth = 0;
+    rootTask.start = 0;
+    rootTask.end = entries->count;
+    SFListAdd(tasks, rootTask);
+
+    /*
+     * Build the nodes in breadth first order so that the edges of each node are added together
+     * and remain contiguous.
+     */
+    for (taskIndex = 0; taskIndex < tasks->count; taskIndex++) {
+        _SFLigatureTask task = SFListGetVal(tasks, taskIndex);
+        SFUInteger start = task.start;
+        SFLigatureNodeRef node;
+
+        /* The most preferred ligature ending at this node is placed first in the range. */
+        if (start < task.end) {
+            _SFLigatureEntry *entry = SFListGetRef(entries, start);
+
+            if (entry->length == task.depth) {
+                node = SFListGetRef(&ligatureTrie->_nodes, task.node);
+                node->priority = entry->priority;
+                node->ligGlyph = entry->ligGlyph;
+
+                /* Skip the less preferred ligatures having identical components. */
+                while (start < task.end && SFListGetRef(entries, start)->length == task.depth) {
+                    start += 1;
+                }
+            }
+        }
+
+        node = SFListGetRef(&ligatureTrie->_nodes, task.node);
+        node->firstEdge = (SFUInt32)ligatureTrie->_edges.count;
+
+        /* Add an edge for each group of entries sharing the component at current depth. */
+        while (start < task.end) {
+            SFGlyphID glyph = SFData_UInt16(SFListGetRef(entries, start)->components, task.depth * 2);
+            SFUInteger end = start + 1;
+            _SFLigatureTask childTask;
+            SFLigatureEdge edge;
+
+            while (end < task.end
+                   && SFData_UInt16(SFListGetRef(entries, end)->components, task.depth * 2) == glyph) {
+                end += 1;
+            }
+
+            /* Clear the padding so that the images of the trie are deterministic. */
+            memset(&edge, 0, sizeof(edge));
+            edge.glyph = glyph;
+            edge.node = _SFLigatureTrieAddNode(ligatureTrie);
+            SFListAdd(&ligatureTrie->_edges, edge);
+
+            node = SFListGetRef(&ligatureTrie->_nodes, task.node);
+            node->edgeCount += 1;
+
+            childTask.node = edge.node;
+            childTask.depth = task.depth + 1;
+            childTask.start = start;
+            childTask.end = end;
+            SFListAdd(tasks, childTask);
+
+            start = end;
+        }
+    }
+}
+
+static void _SFLigatureTrieResolvePriorities(SFLigatureTrieRef ligatureTrie)
+{
+    SFUInteger nodeIndex = ligatureTrie->_nodes.count;
+
+    /* Children are always added after their parents, so visit the nodes in reverse order. */
+    while (nodeIndex--) {
+        SFLigatureNodeRef node = SFListGetRef(&ligatureTrie->_nodes, nodeIndex);
+        SFUInt16 bestPriority = node->priority;
+        SFUInteger edgeIndex;
+
+        for (edgeIndex = 0; edgeIndex < node->edgeCount; edgeIndex++) {
+            SFLigatureEdge *edge = SFListGetRef(&ligatureTrie->_edges, node->firstEdge + edgeIndex);
+            SFLigatureNodeRef child = SFListGetRef(&ligatureTrie->_nodes, edge->node);
+
+            if (child->bestPriority < bestPriority) {
+                bestPriority = child->bestPriority;
+            }
+        }
+
+        node->bestPriority = bestPriority;
+    }
+}
+
+SF_INTERNAL SFBoolean SFLigatureTrieInitialize(SFLigatureTrieRef ligatureTrie, const SFAllocator *allocator,
+    SFData ligatureSubst, SFUInteger length)
+{
+    _SFLigatureEntryList entries;
+    _SFLigatureTaskList tasks;
+    SFUInteger ligSetCount;
+    SFUInteger ligSetIndex;
+    SFBoolean isValid = SFTrue;
+
+    if (length < 6 || SFLigatureSubst_Format(ligatureSubst) != 1) {
+        return SFFalse;
+    }
+
+    ligSetCount = SFLigatureSubstF1_LigSetCount(ligatureSubst);
+
+    if (6 + (ligSetCount * 2) > length) {
+        return SFFalse;
+    }
+
+    ligatureTrie->_subtable = ligatureSubst;
+    ligatureTrie->_roots = SFAllocatorAllocate(allocator, sizeof(SFUInt32) * (ligSetCount ? ligSetCount : 1));
+    ligatureTrie->_rootCount = ligSetCount;
+    ligatureTrie->componentLimit = 1;
+    SFListInitialize(&ligatureTrie->_nodes, sizeof(SFLigatureNode), allocator);
+    SFListInitialize(&ligatureTrie->_edges, sizeof(SFLigatureEdge), allocator);
+
+    SFListInitialize(&entries, sizeof(_SFLigatureEntry), allocator);
+    SFListInitialize(&tasks, sizeof(_SFLigatureTask), allocator);
+
+    for (ligSetIndex = 0; ligSetIndex < ligSetCount; ligSetIndex++) {
+        SFUInteger ligatureSetOffset = SFLigatureSubstF1_LigatureSetOffset(ligatureSubst, ligSetIndex);
+        SFUInt32 root;
+
+        SFListClear(&entries);
+
+        if (!_SFLigatureTrieCollectEntries(&entries, &ligatureTrie->componentLimit,
+                                           ligatureSubst, length, ligatureSetOffset)) {
+            isValid = SFFalse;
+            break;
+        }
+
+        root = _SFLigatureTrieAddNode(ligatureTrie);
+        ligatureTrie->_roots[ligSetIndex] = root;
+
+        _SFLigatureTrieBuildSet(ligatureTrie, &entries, &tasks, root);
+    }
+
+    SFListFinalize(&entries);
+    SFListFinalize(&tasks);
+
+    if (!isValid) {
+        SFLigatureTrieFinalize(ligatureTrie);
+        return SFFalse;
+    }
+
+    _SFLigatureTrieResolvePriorities(ligatureTrie);
+    SFListTrimExcess(&ligatureTrie->_nodes);
+    SFListTrimExcess(&ligatureTrie->_edges);
+
+    return SFTrue;
+}
+
+SF_INTERNAL SFUInteger SFLigatureTrieInitializeWithImage(SFLigatureTrieRef ligatureTrie,
+    SFData ligatureSubst, const SFUInt8 *image, SFUInteger length)
+{
+    const SFUInt32 *fields = (const SFUInt32 *)image;
+    SFUInteger size = sizeof(SFUInt32) * SF_LIGATURE_TRIE_IMAGE_FIELDS;
+    SFUInteger rootCount;
+    SFUInteger nodeCount;
+    SFUInteger edgeCount;
+    const SFUInt32 *roots;
+    const SFLigatureNode *nodes;
+    const SFLigatureEdge *edges;
+    SFUInteger index;
+
+    if (length < size) {
+        return 0;
+    }
+
+    rootCount = fields[0];
+    nodeCount = fields[1];
+    edgeCount = fields[2];
+
+    if (rootCount > SFUInt16Max || fields[3] == 0 || fields[3] > SFUInt16Max
+        || (length - size) / sizeof(SFUInt32) < rootCount) {
+        return 0;
+    }
+    roots = (const SFUInt32 *)(image + size);
+    size += sizeof(SFUInt32) * rootCount;
+
+    if ((length - size) / sizeof(SFLigatureNode) < nodeCount) {
+        return 0;
+    }
+    nodes = (const SFLigatureNode *)(image + size);
+    size += sizeof(SFLigatureNode) * nodeCount;
+
+    if ((length - size) / sizeof(SFLigatureEdge) < edgeCount) {
+        return 0;
+    }
+    edges = (const SFLigatureEdge *)(image + size);
+    size += sizeof(SFLigatureEdge) * edgeCount;
+
+    /* Make sure that all roots, edges and nodes refer to existing items. */
+    for (index = 0; index < rootCount; index++) {
+        if (roots[index] >= nodeCount) {
+            return 0;
+        }
+    }
+    for (index = 0; index < nodeCount; index++) {
+        if (nodes[index].firstEdge > edgeCount || nodes[index].edgeCount > edgeCount - nodes[index].firstEdge) {
+            return 0;
+        }
+    }
+    for (index = 0; index < edgeCount; index++) {
+        if (edges[index].node >= nodeCount) {
+            return 0;
+        }
+    }
+
+    ligatureTrie->_subtable = ligatureSubst;
+    ligatureTrie->_roots = (SFUInt32 *)roots;
+    ligatureTrie->_rootCount = rootCount;
+    ligatureTrie->componentLimit = fields[3];
+    SFListInitialize(&ligatureTrie->_nodes, sizeof(SFLigatureNode), NULL);
+    SFListInitialize(&ligatureTrie->_edges, sizeof(SFLigatureEdge), NULL);
+    ligatureTrie->_nodes.items = (SFLigatureNode *)nodes;
+    ligatureTrie->_nodes.count = nodeCount;
+    ligatureTrie->_nodes.capacity = nodeCount;
+    ligatureTrie->_edges.items = (SFLigatureEdge *)edges;
+    ligatureTrie->_edges.count = edgeCount;
+    ligatureTrie->_edges.capacity = edgeCount;
+
+    return size;
+}
+
+SF_INTERNAL SFUInteger SFLigatureTrieWriteImage(SFLigatureTrieRef ligatureTrie, SFUInt8 *buffer)
+{
+    SFUInteger rootSize = sizeof(SFUInt32) * ligatureTrie->_rootCount;
+    SFUInteger nodeSize = sizeof(SFLigatureNode) * ligatureTrie->_nodes.count;
+    SFUInteger edgeSize = sizeof(SFLigatureEdge) * ligatureTrie->_edges.count;
+    SFUInt32 fields[SF_LIGATURE_TRIE_IMAGE_FIELDS];
+    SFUInteger size = sizeof(fields);
+
+    if (buffer) {
+        fields[0] = (SFUInt32)ligatureTrie->_rootCount;
+        fields[1] = (SFUInt32)ligatureTrie->_nodes.count;
+        fields[2] = (SFUInt32)ligatureTrie->_edges.count;
+        fields[3] = (SFUInt32)ligatureTrie->componentLimit;
+
+        memcpy(buffer, fields, sizeof(fields));
+        if (rootSize) {
+            memcpy(buffer + size, ligatureTrie->_roots, rootSize);
+        }
+        if (nodeSize) {
+            memcpy(buffer + size + rootSize, ligatureTrie->_nodes.items, nodeSize);
+        }
+        if (edgeSize) {
+            memcpy(buffer + size + rootSize + nodeSize, ligatureTrie->_edges.items, edgeSize);
+        }
+    }
+
+    return size + rootSize + nodeSize + edgeSize;
+}
+
+SF_INTERNAL void SFLigatureTrieFinalize(SFLigatureTrieRef ligatureTrie)
+{
+    SFAllocatorDeallocate(&ligatureTrie->_nodes._allocator, ligatureTrie->_roots);
+    SFListFinalize(&ligatureTrie->_nodes);
+    SFListFinalize(&ligatureTrie->_edges);
+}
+
+SF_INTERNAL SFLigatureNodeRef SFLigatureTrieGetRoot(SFLigatureTrieRef ligatureTrie, SFUInteger coverageIndex)
+{
+    if (coverageIndex < ligatureTrie->_rootCount) {
+        return SFListGetRef(&ligatureTrie->_nodes, ligatureTrie->_roots[coverageIndex]);
+    }
+
+    return NULL;
+}
+
+SF_INTERNAL SFLigatureNodeRef SFLigatureTrieGetChild(SFLigatureTrieRef ligatureTrie, SFLigatureNodeRef node, SFGlyphID glyph)
+{
+    SFUInteger low = node->firstEdge;
+    SFUInteger high = low + node->edgeCount;
+
+    /* Binary search the edge as they are sorted by glyph. */
+    while (low < high) {
+        SFUInteger mid = low + ((high - low) / 2);
+        SFLigatureEdge *edge = &ligatureTrie->_edges.items[mid];
+        SFGlyphID midGlyph = edge->glyph;
+
+        if (glyph < midGlyph) {
+            high = mid;
+        } else if (glyph > midGlyph) {
+            low = mid + 1;
+        } else {
+            return SFListGetRef(&ligatureTrie->_nodes, edge->node);
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_LIGATURE_TRIE_H
+#define _SF_INTERNAL_LIGATURE_TRIE_H
+
+#include <SFConfig.h>
+
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFData.h"
+#include "SFList.h"
+
+typedef struct _SFLigatureNode {
+    SFUInt32 firstEdge;         /**< Index of the first edge leaving the node. */
+    SFUInt16 edgeCount;         /**< Number of edges leaving the node, sorted by glyph. */
+    SFUInt16 priority;          /**< Preference of the ligature ending at the node, SFUInt16Max if none. */
+    SFUInt16 bestPriority;      /**< Most preferred priority of any ligature within the subtree. */
+    SFGlyphID ligGlyph;         /**< Glyph of the ligature ending at the node. */
+} SFLigatureNode, *SFLigatureNodeRef;
+
+typedef struct _SFLigatureEdge {
+    SFGlyphID glyph;            /**< Component glyph leading to the node. */
+    SFUInt32 node;              /**< Index of the node reached by the edge. */
+} SFLigatureEdge;
+
+/**
+ * A prefix tree of the component sequences of a ligature substitution subtable. Each ligature set
+ * has a root node at its coverage index, so the most preferred ligature can be matched in a single
+ * forward scan of the following glyphs.
+ */
+typedef struct _SFLigatureTrie {
+    SFData _subtable;               /**< The compiled ligature substitution subtable. */
+    SFUInt32 *_roots;               /**< Root node of each ligature set. */
+    SFUInteger _rootCount;          /**< Number of ligature sets. */
+    SF_LIST(SFLigatureNode) _nodes; /**< All nodes of the trie. */
+    SF_LIST(SFLigatureEdge) _edges; /**< All edges of the trie, grouped by their source nodes. */
+    SFUInteger componentLimit;      /**< Maximum number of components in any ligature. */
+} SFLigatureTrie, *SFLigatureTrieRef;
+
+/**
+ * Compiles the ligature substitution subtable into the trie, allocating it with the given
+ * allocator. Returns SFFalse, leaving the trie uninitialized, if the subtable is malformed or of an
+ * unknown format.
+ */
+SF_INTERNAL SFBoolean SFLigatureTrieInitialize(SFLigatureTrieRef ligatureTrie, const SFAllocator *allocator,
+    SFData ligatureSubst, SFUInteger length);
+
+/**
+ * Initializes the trie of the subtable from an image written by SFLigatureTrieWriteImage. The
+ * arrays of the trie refer to the image in place, so it must not be finalized and the image must
+ * outlive it.
+ *
+ * @return
+ *      The size of the image in bytes if it was valid, zero otherwise.
+ */
+SF_INTERNAL SFUInteger SFLigatureTrieInitializeWithImage(SFLigatureTrieRef ligatureTrie,
+    SFData ligatureSubst, const SFUInt8 *image, SFUInteger length);
+SF_INTERNAL void SFLigatureTrieFinalize(SFLigatureTrieRef ligatureTrie);
+
+/**
+ * Writes a self-contained image of the trie in native byte order.
+ *
+ * @param buffer
+ *      The target buffer that is large enough to hold the image. This parameter can be NULL if
+ *      only the size of the image is needed.
+ * @return
+ *      The size of the image in bytes.
+ */
+SF_INTERNAL SFUInteger SFLigatureTrieWriteImage(SFLigatureTrieRef ligatureTrie, SFUInt8 *buffer);
+
+/**
+ * Returns the root node of the ligature set at specified coverage index, or NULL if it does not
+ * exist.
+ */
+SF_INTERNAL SFLigatureNodeRef SFLigatureTrieGetRoot(SFLigatureTrieRef ligatureTrie, SFUInteger coverageIndex);
+
+/**
+ * Returns the node reached from the given node by the component glyph, or NULL if there is no
+ * such node.
+ */
+SF_INTERNAL SFLigatureNodeRef SFLigatureTrieGetChild(SFLigatureTrieRef ligatureTrie, SFLigatureNodeRef node, SFGlyphID glyph);
+
+#endif
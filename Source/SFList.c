@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "SFAllocator.h"
 #include "SFAssert.h"
 #include "SFBase.h"
 #include "SFList.h"
@@ -30,7 +31,7 @@ static void _SFListEnsureCapacity(_SFListRef list, SFUInteger capacity);
 static void *_SFListGetItemPtr(_SFListRef list, SFUInteger index);
 static void _SFListMoveItems(_SFListRef list, SFUInteger srcIndex, SFUInteger dstIndex, SFUInteger itemCount);
 
-SF_PRIVATE void _SFListInitialize(_SFListRef list, SFUInteger itemSize)
+SF_PRIVATE void _SFListInitialize(_SFListRef list, SFUInteger itemSize, const SFAllocator *allocator)
 {
     /* Item size MUST be greater than 0. */
     SFAssert(itemSize > 0);
@@ -39,11 +40,13 @@ SF_PRIVATE void _SFListInitialize(_SFListRef list, SFUInteger itemSize)
     list->count = 0;
     list->capacity = 0;
     list->_itemSize = itemSize;
+
+    SFAllocatorInitialize(&list->_allocator, allocator);
 }
 
 SF_PRIVATE void _SFListFinalize(_SFListRef list)
 {
-    free(list->_data);
+    SFAllocatorDeallocate(&list->_allocator, list->_data);
 }
 
 SF_PRIVATE void _SFListFinalizeKeepingArray(_SFListRef list, void **outArray, SFUInteger *outCount)
@@ -67,7 +70,7 @@ SF_PRIVATE void _SFListSetCapacity(_SFListRef list, SFUInteger capacity)
     SFAssert(capacity >= list->count);
 
     if (capacity != list->capacity) {
-        list->_data = realloc(list->_data, list->_itemSize * capacity);
+        list->_data = SFAllocatorReallocate(&list->_allocator, list->_data, list->_itemSize * capacity);
         list->capacity = capacity;
     }
 }
@@ -123,6 +126,15 @@ SF_PRIVATE void _SFListRemoveRange(_SFListRef list, SFUInteger index, SFUInteger
     list->count -= count;
 }
 
+SF_PRIVATE void _SFListMoveRange(_SFListRef list, SFUInteger srcIndex, SFUInteger dstIndex, SFUInteger count)
+{
+    /* The source and destination items must be valid and there should be no integer overflow. */
+    SFAssert(srcIndex <= (srcIndex + count) && (srcIndex + count) <= list->count);
+    SFAssert(dstIndex <= (dstIndex + count) && (dstIndex + count) <= list->count);
+
+    _SFListMoveItems(list, srcIndex, dstIndex, count);
+}
+
 SF_PRIVATE void _SFListClear(_SFListRef list)
 {
     list->count = 0;
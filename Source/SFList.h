@@ -19,6 +19,7 @@
 
 #include <SFConfig.h>
 
+#include "SFAllocator.h"
 #include "SFAssert.h"
 #include "SFBase.h"
 
@@ -27,6 +28,7 @@ typedef struct _SFList {
     SFUInteger count;
     SFUInteger capacity;
     SFUInteger _itemSize;
+    SFAllocator _allocator;
 } _SFList, *_SFListRef;
 
 #define SF_LIST(type)       \
@@ -35,17 +37,19 @@ struct {                    \
     SFUInteger count;       \
     SFUInteger capacity;    \
     SFUInteger _itemSize;   \
+    SFAllocator _allocator; \
 }
 
 typedef int (*SFComparison)(const void *item1, const void *item2);
 
-SF_PRIVATE void _SFListInitialize(_SFListRef list, SFUInteger itemSize);
+SF_PRIVATE void _SFListInitialize(_SFListRef list, SFUInteger itemSize, const SFAllocator *allocator);
 SF_PRIVATE void _SFListFinalize(_SFListRef list);
 SF_PRIVATE void _SFListFinalizeKeepingArray(_SFListRef list, void **outArray, SFUInteger *outCount);
 
 SF_PRIVATE void _SFListSetCapacity(_SFListRef list, SFUInteger capacity);
 SF_PRIVATE void _SFListReserveRange(_SFListRef list, SFUInteger index, SFUInteger count);
 SF_PRIVATE void _SFListRemoveRange(_SFListRef list, SFUInteger index, SFUInteger count);
+SF_PRIVATE void _SFListMoveRange(_SFListRef list, SFUInteger srcIndex, SFUInteger dstIndex, SFUInteger count);
 
 SF_PRIVATE void _SFListClear(_SFListRef list);
 SF_PRIVATE void _SFListTrimExcess(_SFListRef list);
@@ -87,7 +91,7 @@ do {                                                    \
         _SFListInsert(list_, (list_)->count, item_)
 
 
-#define SFListInitialize(list, itemSize)            _SFListInitialize((_SFListRef)(list), itemSize)
+#define SFListInitialize(list, itemSize, allocator) _SFListInitialize((_SFListRef)(list), itemSize, allocator)
 #define SFListFinalize(list)                        _SFListFinalize((_SFListRef)(list))
 #define SFListFinalizeKeepingArray(list, outArray, outCount) \
                                     _SFListFinalizeKeepingArray((_SFListRef)(list), (void **)outArray, outCount)
@@ -95,6 +99,8 @@ do {                                                    \
 #define SFListSetCapacity(list, capacity)           _SFListSetCapacity((_SFListRef)(list), capacity)
 #define SFListReserveRange(list, index, count)      _SFListReserveRange((_SFListRef)(list), index, count)
 #define SFListRemoveRange(list, index, count)       _SFListRemoveRange((_SFListRef)(list), index, count)
+#define SFListMoveRange(list, srcIndex, dstIndex, count) \
+                                    _SFListMoveRange((_SFListRef)(list), srcIndex, dstIndex, count)
 
 #define SFListClear(list)                           _SFListClear((_SFListRef)(list))
 #define SFListTrimExcess(list)                      _SFListTrimExcess((_SFListRef)(list))
@@ -20,22 +20,77 @@
 
 #include "SFAssert.h"
 #include "SFAlbum.h"
+#include "SFAllocator.h"
 #include "SFBase.h"
+#include "SFFontCache.h"
 #include "SFGDEF.h"
-#include "SFOpenType.h"
 #include "SFLocator.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _SF_SCAN_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define _SF_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+static SFUInteger _SFScanGlyphMasks(const SFGlyphMask *glyphMasks, SFUInteger index, SFUInteger limit, SFUInt32 ignoreMask);
+static SFUInteger _SFScanAlbum(SFLocatorRef locator, SFUInteger index, SFUInteger limit);
 static SFBoolean _SFIsIgnoredGlyph(SFLocatorRef locator, SFUInteger index);
+static SFBoolean _SFSkipVectorMatches(SFSkipVectorRef skipVector, SFLocatorRef locator);
+static void _SFRecordSkipVector(SFSkipVectorRef skipVector, SFLocatorRef locator);
+static void _SFBuildSkipVector(SFSkipVectorRef skipVector, SFLocatorRef locator);
+static SFSkipVectorRef _SFGetSkipVector(SFLocatorRef locator);
 
-SF_INTERNAL void SFLocatorInitialize(SFLocatorRef locator, SFAlbumRef album, SFData gdef)
+SF_INTERNAL void SFSkipVectorsInitialize(SFSkipVectorsRef skipVectors, const SFAllocator *allocator)
+{
+    SFUInteger index;
+
+    for (index = 0; index < SF_SKIP_VECTOR_COUNT; index++) {
+        SFSkipVectorRef skipVector = &skipVectors->_items[index];
+
+        skipVector->_nextIndexes = NULL;
+        skipVector->_previousIndexes = NULL;
+        skipVector->_capacity = 0;
+        skipVector->_version = SFInvalidIndex;
+        skipVector->_markFilteringCoverage = NULL;
+        skipVector->_ignoreMask = 0;
+        skipVector->_lookupFlag = 0;
+        skipVector->_isBuilt = SFFalse;
+    }
+
+    skipVectors->_nextSlot = 0;
+    SFAllocatorInitialize(&skipVectors->_allocator, allocator);
+}
+
+SF_INTERNAL void SFSkipVectorsFinalize(SFSkipVectorsRef skipVectors)
+{
+    SFUInteger index;
+
+    for (index = 0; index < SF_SKIP_VECTOR_COUNT; index++) {
+        SFAllocatorDeallocate(&skipVectors->_allocator, skipVectors->_items[index]._nextIndexes);
+    }
+}
+
+SF_INTERNAL void SFLocatorInitialize(SFLocatorRef locator, SFAlbumRef album, SFFontCacheRef fontCache, SFData gdef)
 {
     /* Album must NOT be null. */
     SFAssert(album != NULL);
+    /* Font cache must NOT be null. */
+    SFAssert(fontCache != NULL);
 
     locator->_album = album;
+    locator->_fontCache = fontCache;
     locator->_markAttachClassDef = NULL;
     locator->_markGlyphSetsDef = NULL;
     locator->_markFilteringCoverage = NULL;
+    locator->_markAttachClasses = SFFontCacheGetMarkAttachClasses(fontCache, &locator->_markAttachClassCount);
+    locator->_markFilteringSet = NULL;
+    locator->_markFilteringFirstWord = 0;
+    locator->_markFilteringWords = 0;
+    locator->_skipVectors = NULL;
+    locator->_skipVector = NULL;
+    locator->_scansMasks = SFFalse;
     locator->_version = SFInvalidIndex;
     locator->_startIndex = 0;
     locator->_limitIndex = 0;
@@ -55,6 +110,13 @@ SF_INTERNAL void SFLocatorInitialize(SFLocatorRef locator, SFAlbumRef album, SFD
     }
 }
 
+SF_INTERNAL void SFLocatorSetSkipVectors(SFLocatorRef locator, SFSkipVectorsRef skipVectors)
+{
+    locator->_skipVectors = skipVectors;
+    locator->_skipVector = NULL;
+    locator->_scansMasks = SFFalse;
+}
+
 SF_INTERNAL void SFLocatorReserveGlyphs(SFLocatorRef locator, SFUInteger glyphCount)
 {
     /* The album version MUST be same. */
@@ -69,9 +131,11 @@ SF_INTERNAL void SFLocatorReserveGlyphs(SFLocatorRef locator, SFUInteger glyphCo
 SF_INTERNAL void SFLocatorSetFeatureMask(SFLocatorRef locator, SFUInt16 featureMask)
 {
     locator->_ignoreMask.section.featureMask = _SFAlbumGetAntiFeatureMask(featureMask);
+    locator->_skipVector = NULL;
+    locator->_scansMasks = SFFalse;
 }
 
-SF_INTERNAL void SFLocatorSetLookupFlag(SFLocatorRef locator, SFLookupFlag lookupFlag)
+SF_PRIVATE SFGlyphTraits _SFLocatorGetIgnoreTraits(SFLookupFlag lookupFlag)
 {
     SFGlyphTraits ignoreTraits = SFGlyphTraitNone;
 
@@ -87,10 +151,17 @@ SF_INTERNAL void SFLocatorSetLookupFlag(SFLocatorRef locator, SFLookupFlag looku
         ignoreTraits |= SFGlyphTraitMark;
     }
 
-    ignoreTraits |= SFGlyphTraitPlaceholder;
+    return ignoreTraits;
+}
+
+SF_INTERNAL void SFLocatorSetLookupFlag(SFLocatorRef locator, SFLookupFlag lookupFlag)
+{
+    SFGlyphTraits ignoreTraits = _SFLocatorGetIgnoreTraits(lookupFlag) | SFGlyphTraitPlaceholder;
 
     locator->lookupFlag = lookupFlag;
     locator->_ignoreMask.section.glyphTraits = ignoreTraits;
+    locator->_skipVector = NULL;
+    locator->_scansMasks = SFFalse;
 }
 
 SF_INTERNAL void SFLocatorSetMarkFilteringSet(SFLocatorRef locator, SFUInt16 markFilteringSet)
@@ -98,6 +169,9 @@ SF_INTERNAL void SFLocatorSetMarkFilteringSet(SFLocatorRef locator, SFUInt16 mar
     SFData markGlyphSetsDef = locator->_markGlyphSetsDef;
 
     locator->_markFilteringCoverage = NULL;
+    locator->_markFilteringSet = NULL;
+    locator->_skipVector = NULL;
+    locator->_scansMasks = SFFalse;
 
     if (markGlyphSetsDef) {
         SFUInt16 format = SFMarkGlyphSets_Format(markGlyphSetsDef);
@@ -110,6 +184,9 @@ SF_INTERNAL void SFLocatorSetMarkFilteringSet(SFLocatorRef locator, SFUInt16 mar
                     SFData coverage = SFData_Subdata(markGlyphSetsDef, offset);
 
                     locator->_markFilteringCoverage = coverage;
+                    locator->_markFilteringSet = SFFontCacheGetMarkGlyphSet(locator->_fontCache, markFilteringSet,
+                                                                            &locator->_markFilteringFirstWord,
+                                                                            &locator->_markFilteringWords);
                 }
                 break;
             }
@@ -129,6 +206,86 @@ SF_INTERNAL void SFLocatorReset(SFLocatorRef locator, SFUInteger index, SFUInteg
     locator->index = SFInvalidIndex;
 }
 
+/**
+ * Returns the index of first glyph in the given range whose mask does not intersect with the ignore
+ * mask, or the limit if there is no such glyph. Eight masks are tested at a time where vector
+ * instructions are available.
+ */
+static SFUInteger _SFScanGlyphMasks(const SFGlyphMask *glyphMasks, SFUInteger index, SFUInteger limit, SFUInt32 ignoreMask)
+{
+#if defined(_SF_SCAN_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ignore = _mm_set1_epi32((int)ignoreMask);
+
+    while (limit - index >= 8) {
+        __m128i first = _mm_loadu_si128((const __m128i *)(glyphMasks + index));
+        __m128i second = _mm_loadu_si128((const __m128i *)(glyphMasks + index + 4));
+
+        /* Lanes of a glyph which is not ignored become all ones. */
+        first = _mm_cmpeq_epi32(_mm_and_si128(first, ignore), zero);
+        second = _mm_cmpeq_epi32(_mm_and_si128(second, ignore), zero);
+
+        if (_mm_movemask_epi8(_mm_or_si128(first, second))) {
+            break;
+        }
+
+        index += 8;
+    }
+#elif defined(_SF_SCAN_NEON)
+    const uint32x4_t ignore = vdupq_n_u32(ignoreMask);
+
+    while (limit - index >= 8) {
+        uint32x4_t first = vld1q_u32((const SFUInt32 *)(glyphMasks + index));
+        uint32x4_t second = vld1q_u32((const SFUInt32 *)(glyphMasks + index + 4));
+
+        /* Lanes of an ignored glyph become all ones. */
+        first = vtstq_u32(first, ignore);
+        second = vtstq_u32(second, ignore);
+
+        if (vminvq_u32(vandq_u32(first, second)) == 0) {
+            break;
+        }
+
+        index += 8;
+    }
+#endif
+
+    /* Locate the exact glyph, or test the remaining ones. */
+    for (; index < limit; index++) {
+        if (!(glyphMasks[index].full & ignoreMask)) {
+            break;
+        }
+    }
+
+    return index;
+}
+
+/**
+ * Returns the index of first glyph in the given range passing the ignore mask of the locator, or
+ * the limit if there is no such glyph. The glyphs on either side of the gap in album are scanned
+ * separately.
+ */
+static SFUInteger _SFScanAlbum(SFLocatorRef locator, SFUInteger index, SFUInteger limit)
+{
+    SFAlbumRef album = locator->_album;
+    const SFGlyphMask *glyphMasks = _SFAlbumGetGlyphMasksPtr(album);
+    SFUInt32 ignoreMask = locator->_ignoreMask.full;
+    SFUInteger gapIndex = album->_gapIndex;
+    SFUInteger gapLength = album->_gapLength;
+
+    if (index < gapIndex) {
+        SFUInteger segmentLimit = (limit < gapIndex ? limit : gapIndex);
+
+        index = _SFScanGlyphMasks(glyphMasks, index, segmentLimit, ignoreMask);
+
+        if (index != gapIndex) {
+            return index;
+        }
+    }
+
+    return _SFScanGlyphMasks(glyphMasks, index + gapLength, limit + gapLength, ignoreMask) - gapLength;
+}
+
 static SFBoolean _SFIsIgnoredGlyph(SFLocatorRef locator, SFUInteger index) {
     SFAlbumRef album = locator->_album;
     SFLookupFlag lookupFlag = locator->lookupFlag;
@@ -139,12 +296,21 @@ static SFBoolean _SFIsIgnoredGlyph(SFLocatorRef locator, SFUInteger index) {
     }
 
     if (glyphMask.section.glyphTraits & SFGlyphTraitMark) {
+        SFGlyphID glyph = SFAlbumGetGlyph(album, index);
+
         if (lookupFlag & SFLookupFlagUseMarkFilteringSet) {
-            SFData markFilteringCoverage = locator->_markFilteringCoverage;
+            const SFUInt32 *markFilteringSet = locator->_markFilteringSet;
+
+            if (markFilteringSet) {
+                /* A glyph lying before the bitset wraps around to a word beyond it. */
+                SFUInteger word = (SFUInteger)(glyph >> 5) - locator->_markFilteringFirstWord;
 
-            if (markFilteringCoverage) {
-                SFGlyphID glyph = SFAlbumGetGlyph(album, index);
-                SFUInteger coverageIndex = SFOpenTypeSearchCoverageIndex(markFilteringCoverage, glyph);
+                if (word >= locator->_markFilteringWords || !(markFilteringSet[word] & ((SFUInt32)1 << (glyph & 31)))) {
+                    return SFTrue;
+                }
+            } else if (locator->_markFilteringCoverage) {
+                SFUInteger coverageIndex = SFFontCacheSearchCoverageIndex(locator->_fontCache,
+                                                                          locator->_markFilteringCoverage, glyph);
 
                 if (coverageIndex == SFInvalidIndex) {
                     return SFTrue;
@@ -153,15 +319,18 @@ static SFBoolean _SFIsIgnoredGlyph(SFLocatorRef locator, SFUInteger index) {
         }
 
         if (lookupFlag & SFLookupFlagMarkAttachmentType) {
-            SFData markAttachClassDef = locator->_markAttachClassDef;
-
-            if (markAttachClassDef) {
-                SFGlyphID glyph = SFAlbumGetGlyph(album, index);
-                SFUInt16 glyphClass = SFOpenTypeSearchGlyphClass(markAttachClassDef, glyph);
+            SFUInt16 glyphClass;
+
+            if (locator->_markAttachClasses) {
+                glyphClass = (glyph < locator->_markAttachClassCount ? locator->_markAttachClasses[glyph] : 0);
+            } else if (locator->_markAttachClassDef) {
+                glyphClass = SFFontCacheSearchGlyphClass(locator->_fontCache, locator->_markAttachClassDef, glyph);
+            } else {
+                return SFFalse;
+            }
 
-                if (glyphClass != (lookupFlag >> 8)) {
-                    return SFTrue;
-                }
+            if (glyphClass != (lookupFlag >> 8)) {
+                return SFTrue;
             }
         }
     }
@@ -169,16 +338,150 @@ static SFBoolean _SFIsIgnoredGlyph(SFLocatorRef locator, SFUInteger index) {
     return SFFalse;
 }
 
+static SFBoolean _SFSkipVectorMatches(SFSkipVectorRef skipVector, SFLocatorRef locator)
+{
+    return (skipVector->_version == locator->_album->_version
+            && skipVector->_ignoreMask == locator->_ignoreMask.full
+            && skipVector->_lookupFlag == locator->lookupFlag
+            && skipVector->_markFilteringCoverage == locator->_markFilteringCoverage);
+}
+
+static void _SFRecordSkipVector(SFSkipVectorRef skipVector, SFLocatorRef locator)
+{
+    skipVector->_version = locator->_album->_version;
+    skipVector->_ignoreMask = locator->_ignoreMask.full;
+    skipVector->_lookupFlag = locator->lookupFlag;
+    skipVector->_markFilteringCoverage = locator->_markFilteringCoverage;
+    skipVector->_isBuilt = SFFalse;
+}
+
+static void _SFBuildSkipVector(SFSkipVectorRef skipVector, SFLocatorRef locator)
+{
+    SFAlbumRef album = locator->_album;
+    SFAllocator *allocator = &locator->_skipVectors->_allocator;
+    SFUInteger glyphCount = album->glyphCount;
+    SFUInteger nextIndex = glyphCount;
+    SFUInteger previousIndex = SFInvalidIndex;
+    SFUInteger index;
+
+    if (skipVector->_capacity < glyphCount) {
+        SFAllocatorDeallocate(allocator, skipVector->_nextIndexes);
+
+        skipVector->_nextIndexes = SFAllocatorAllocate(allocator, sizeof(SFUInteger) * glyphCount * 2);
+        skipVector->_previousIndexes = skipVector->_nextIndexes + glyphCount;
+        skipVector->_capacity = glyphCount;
+    }
+
+    /* Test each glyph once, so a legitimate glyph is the one being its own previous glyph. */
+    for (index = 0; index < glyphCount; index++) {
+        if (!_SFIsIgnoredGlyph(locator, index)) {
+            previousIndex = index;
+        }
+
+        skipVector->_previousIndexes[index] = previousIndex;
+    }
+
+    for (index = glyphCount; index-- > 0;) {
+        if (skipVector->_previousIndexes[index] == index) {
+            nextIndex = index;
+        }
+
+        skipVector->_nextIndexes[index] = nextIndex;
+    }
+
+    _SFRecordSkipVector(skipVector, locator);
+    skipVector->_isBuilt = SFTrue;
+}
+
+/**
+ * Returns the skip vector matching the current criterion of the locator, building it if the
+ * criterion was already requested for the same version of the album. NULL is returned if the glyph
+ * masks should be scanned instead.
+ */
+static SFSkipVectorRef _SFGetSkipVector(SFLocatorRef locator)
+{
+    SFSkipVectorsRef skipVectors = locator->_skipVectors;
+    SFSkipVectorRef skipVector = locator->_skipVector;
+    SFUInteger index;
+
+    /* Keep scanning until the criterion is requested again. */
+    if (locator->_scansMasks) {
+        return NULL;
+    }
+
+    /* The vector may have been rebuilt for another criterion by a copy of the locator. */
+    if (skipVector && _SFSkipVectorMatches(skipVector, locator)) {
+        return skipVector;
+    }
+
+    /* The glyphs can change while filling, so the vectors are only used while arranging. */
+    if (!skipVectors || locator->_album->_state != _SFAlbumStateArranging) {
+        return NULL;
+    }
+
+    for (index = 0; index < SF_SKIP_VECTOR_COUNT; index++) {
+        skipVector = &skipVectors->_items[index];
+
+        if (_SFSkipVectorMatches(skipVector, locator)) {
+            /* The criterion is requested again, so the vector pays for itself now. */
+            if (!skipVector->_isBuilt) {
+                _SFBuildSkipVector(skipVector, locator);
+            }
+
+            locator->_skipVector = skipVector;
+            return skipVector;
+        }
+    }
+
+    /* Only keep the request for the first time, and scan the glyph masks meanwhile. */
+    skipVector = &skipVectors->_items[skipVectors->_nextSlot];
+    skipVectors->_nextSlot = (skipVectors->_nextSlot + 1) % SF_SKIP_VECTOR_COUNT;
+
+    _SFRecordSkipVector(skipVector, locator);
+    locator->_skipVector = NULL;
+    locator->_scansMasks = SFTrue;
+
+    return NULL;
+}
+
 SF_INTERNAL SFBoolean SFLocatorMoveNext(SFLocatorRef locator)
 {
+    SFSkipVectorRef skipVector;
+
     /* The state of locator must be valid. */
     SFAssert(locator->_stateIndex <= locator->_limitIndex);
     /* The album version MUST be same. */
     SFAssert(locator->_version == locator->_album->_version);
 
+    skipVector = _SFGetSkipVector(locator);
+
+    if (skipVector) {
+        if (locator->_stateIndex < locator->_limitIndex) {
+            SFUInteger index = skipVector->_nextIndexes[locator->_stateIndex];
+
+            if (index < locator->_limitIndex) {
+                locator->_stateIndex = index + 1;
+                locator->index = index;
+                return SFTrue;
+            }
+
+            locator->_stateIndex = locator->_limitIndex;
+        }
+
+        locator->index = SFInvalidIndex;
+        return SFFalse;
+    }
+
     while (locator->_stateIndex < locator->_limitIndex) {
-        SFUInteger index = locator->_stateIndex++;
+        SFUInteger index = _SFScanAlbum(locator, locator->_stateIndex, locator->_limitIndex);
+        if (index == locator->_limitIndex) {
+            locator->_stateIndex = index;
+            break;
+        }
+
+        locator->_stateIndex = index + 1;
 
+        /* The mask has passed, so only the mark filtering criterion can still ignore the glyph. */
         if (!_SFIsIgnoredGlyph(locator, index)) {
             locator->index = index;
             return SFTrue;
@@ -221,12 +524,33 @@ SF_INTERNAL void SFLocatorJumpTo(SFLocatorRef locator, SFUInteger index)
 
 SF_INTERNAL SFUInteger SFLocatorGetAfter(SFLocatorRef locator, SFUInteger index)
 {
+    SFSkipVectorRef skipVector;
+
     /* The index must be valid. */
     SFAssert(index < locator->_limitIndex);
     /* The album version MUST be same. */
     SFAssert(locator->_version == locator->_album->_version);
 
+    skipVector = _SFGetSkipVector(locator);
+
+    if (skipVector) {
+        if (++index < locator->_limitIndex) {
+            index = skipVector->_nextIndexes[index];
+
+            if (index < locator->_limitIndex) {
+                return index;
+            }
+        }
+
+        return SFInvalidIndex;
+    }
+
     for (index += 1; index < locator->_limitIndex; index++) {
+        index = _SFScanAlbum(locator, index, locator->_limitIndex);
+        if (index == locator->_limitIndex) {
+            break;
+        }
+
         if (!_SFIsIgnoredGlyph(locator, index)) {
             return index;
         }
@@ -237,11 +561,27 @@ SF_INTERNAL SFUInteger SFLocatorGetAfter(SFLocatorRef locator, SFUInteger index)
 
 SF_INTERNAL SFUInteger SFLocatorGetBefore(SFLocatorRef locator, SFUInteger index)
 {
+    SFSkipVectorRef skipVector;
+
     /* The index must be valid. */
     SFAssert(index < locator->_limitIndex);
     /* The album version MUST be same. */
     SFAssert(locator->_version == locator->_album->_version);
 
+    skipVector = _SFGetSkipVector(locator);
+
+    if (skipVector) {
+        if (index > locator->_startIndex) {
+            index = skipVector->_previousIndexes[index - 1];
+
+            if (index != SFInvalidIndex && index >= locator->_startIndex) {
+                return index;
+            }
+        }
+
+        return SFInvalidIndex;
+    }
+
     while (index-- > locator->_startIndex) {
         if (!_SFIsIgnoredGlyph(locator, index)) {
             return index;
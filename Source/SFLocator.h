@@ -20,14 +20,56 @@
 #include <SFConfig.h>
 
 #include "SFAlbum.h"
+#include "SFAllocator.h"
 #include "SFCommon.h"
 #include "SFData.h"
+#include "SFFontCache.h"
+
+/**
+ * Number of skip vectors kept at a time for different criteria of ignoring glyphs.
+ */
+#define SF_SKIP_VECTOR_COUNT    4
+
+/**
+ * Keeps the indexes of nearest legitimate glyphs of an album for a specific criterion of ignoring
+ * glyphs, so that the locator can jump over the ignored ones. The indexes are built only when the
+ * criterion is requested again for the same version of the album, since a single sweep is faster
+ * by scanning the glyph masks.
+ */
+typedef struct _SFSkipVector {
+    SFUInteger *_nextIndexes;       /**< Index of first legitimate glyph at or after each glyph. */
+    SFUInteger *_previousIndexes;   /**< Index of last legitimate glyph at or before each glyph. */
+    SFUInteger _capacity;           /**< Number of glyphs for which the arrays are allocated. */
+    SFUInteger _version;            /**< Version of the album when the vector was built. */
+    SFData _markFilteringCoverage;  /**< Mark filtering set for which the vector was built. */
+    SFUInt32 _ignoreMask;           /**< Ignore mask for which the vector was built. */
+    SFLookupFlag _lookupFlag;       /**< Lookup flag for which the vector was built. */
+    SFBoolean _isBuilt;             /**< Whether the indexes are built or only the request is kept. */
+} SFSkipVector, *SFSkipVectorRef;
+
+/**
+ * Keeps the skip vectors shared by all locators of a text processor.
+ */
+typedef struct _SFSkipVectors {
+    SFSkipVector _items[SF_SKIP_VECTOR_COUNT];
+    SFUInteger _nextSlot;           /**< Slot to be reused for the next vector. */
+    SFAllocator _allocator;         /**< Allocator of the index arrays. */
+} SFSkipVectors, *SFSkipVectorsRef;
 
 typedef struct _SFLocator {
     SFAlbumRef _album;
+    SFFontCacheRef _fontCache;
     SFData _markAttachClassDef;
     SFData _markGlyphSetsDef;
     SFData _markFilteringCoverage;
+    const SFUInt8 *_markAttachClasses;
+    const SFUInt32 *_markFilteringSet;
+    SFUInteger _markAttachClassCount;
+    SFUInteger _markFilteringFirstWord;
+    SFUInteger _markFilteringWords;
+    SFSkipVectorsRef _skipVectors;
+    SFSkipVectorRef _skipVector;
+    SFBoolean _scansMasks;
     SFUInteger _version;
     SFUInteger _startIndex;
     SFUInteger _limitIndex;
@@ -37,10 +79,26 @@ typedef struct _SFLocator {
     SFLookupFlag lookupFlag;
 } SFLocator, *SFLocatorRef;
 
-SF_INTERNAL void SFLocatorInitialize(SFLocatorRef locator, SFAlbumRef album, SFData gdef);
+SF_INTERNAL void SFSkipVectorsInitialize(SFSkipVectorsRef skipVectors, const SFAllocator *allocator);
+SF_INTERNAL void SFSkipVectorsFinalize(SFSkipVectorsRef skipVectors);
+
+SF_INTERNAL void SFLocatorInitialize(SFLocatorRef locator, SFAlbumRef album, SFFontCacheRef fontCache, SFData gdef);
+
+/**
+ * Lets the locator build and reuse skip vectors while the album is being arranged, so that
+ * ignored glyphs are jumped over instead of being examined one by one. The glyphs and their
+ * traits deciding whether they are ignored must not change while the vectors are in use.
+ */
+SF_INTERNAL void SFLocatorSetSkipVectors(SFLocatorRef locator, SFSkipVectorsRef skipVectors);
 
 SF_INTERNAL void SFLocatorSetFeatureMask(SFLocatorRef locator, SFUInt16 featureMask);
 
+/**
+ * Returns the traits of the glyphs that are ignored by the lookup flag, excluding the mark
+ * filtering set and the mark attachment type.
+ */
+SF_PRIVATE SFGlyphTraits _SFLocatorGetIgnoreTraits(SFLookupFlag lookupFlag);
+
 /**
  * Sets the lookup flag describing the criterion for ignoring glyphs.
  */
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SFConfig.h>
+#include <SFFont.h>
+
+#include <stddef.h>
+
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFData.h"
+#include "SFMetrics.h"
+
+#define _SFMetricsLayoutIndex(fontLayout)   ((fontLayout) == SFFontLayoutVertical ? 1 : 0)
+
+SF_INTERNAL void SFMetricsInitialize(SFMetricsRef metrics, SFData headTable, SFUInteger headLength)
+{
+    metrics->_advances[0] = NULL;
+    metrics->_advances[1] = NULL;
+    metrics->_counts[0] = 0;
+    metrics->_counts[1] = 0;
+    metrics->_defaultAdvances[0] = 0;
+    metrics->_defaultAdvances[1] = 0;
+
+    if (headTable && headLength >= 20) {
+        metrics->_defaultAdvances[1] = SFData_UInt16(headTable, 18);
+    }
+}
+
+SF_INTERNAL void SFMetricsLoad(SFMetricsRef metrics, const SFAllocator *allocator, SFFontLayout fontLayout,
+    SFData headerTable, SFUInteger headerLength, SFData metricsTable, SFUInteger metricsLength)
+{
+    SFUInteger layoutIndex = _SFMetricsLayoutIndex(fontLayout);
+    SFUInteger metricCount;
+    SFUInt16 *advances;
+    SFUInteger index;
+
+    if (!headerTable || headerLength < 36 || !metricsTable) {
+        return;
+    }
+
+    metricCount = SFData_UInt16(headerTable, 34);
+
+    if (metricCount > metricsLength / 4) {
+        metricCount = metricsLength / 4;
+    }
+    if (!metricCount) {
+        return;
+    }
+
+    advances = SFAllocatorAllocate(allocator, sizeof(SFUInt16) * metricCount);
+
+    /* Keep only the advances, leaving out the side bearings. */
+    for (index = 0; index < metricCount; index++) {
+        advances[index] = SFData_UInt16(metricsTable, index * 4);
+    }
+
+    SFAllocatorDeallocate(allocator, metrics->_advances[layoutIndex]);
+    metrics->_advances[layoutIndex] = advances;
+    metrics->_counts[layoutIndex] = metricCount;
+}
+
+SF_INTERNAL void SFMetricsFinalize(SFMetricsRef metrics, const SFAllocator *allocator)
+{
+    SFAllocatorDeallocate(allocator, metrics->_advances[0]);
+    SFAllocatorDeallocate(allocator, metrics->_advances[1]);
+}
+
+SF_INTERNAL SFAdvance SFMetricsGetAdvance(SFMetricsRef metrics, SFFontLayout fontLayout, SFGlyphID glyphID)
+{
+    SFAdvance advance;
+
+    SFMetricsGetAdvances(metrics, fontLayout, &glyphID, &advance, 1);
+
+    return advance;
+}
+
+SF_INTERNAL void SFMetricsGetAdvances(SFMetricsRef metrics, SFFontLayout fontLayout,
+    const SFGlyphID *glyphIDs, SFAdvance *advances, SFUInteger count)
+{
+    SFUInteger layoutIndex = _SFMetricsLayoutIndex(fontLayout);
+    const SFUInt16 *table = metrics->_advances[layoutIndex];
+    SFUInteger lastGlyph = metrics->_counts[layoutIndex] - 1;
+    SFUInteger index;
+
+    if (!table) {
+        SFAdvance defaultAdvance = metrics->_defaultAdvances[layoutIndex];
+
+        for (index = 0; index < count; index++) {
+            advances[index] = defaultAdvance;
+        }
+        return;
+    }
+
+    /* Glyphs after the long metrics share the advance of the last one. */
+    for (index = 0; index < count; index++) {
+        SFUInteger glyphID = glyphIDs[index];
+        advances[index] = table[glyphID < lastGlyph ? glyphID : lastGlyph];
+    }
+}
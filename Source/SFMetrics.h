@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_METRICS_H
+#define _SF_INTERNAL_METRICS_H
+
+#include <SFConfig.h>
+#include <SFFont.h>
+
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFData.h"
+
+/**
+ * Native advances of glyphs parsed from the hmtx and vmtx tables into flat arrays indexed by
+ * glyph ID. Glyphs following the long metrics share the advance of the last one.
+ */
+typedef struct _SFMetrics {
+    SFUInt16 *_advances[2];         /**< Advances of each layout, NULL if its table is missing. */
+    SFUInteger _counts[2];          /**< Number of long metrics of each layout. */
+    SFAdvance _defaultAdvances[2];  /**< Advances of each layout in absence of its table. */
+} SFMetrics, *SFMetricsRef;
+
+/**
+ * Initializes the metrics without any advances, taking the units per em of the head table as the
+ * default vertical advance.
+ */
+SF_INTERNAL void SFMetricsInitialize(SFMetricsRef metrics, SFData headTable, SFUInteger headLength);
+
+/**
+ * Parses the advances of a layout from its header table, either hhea or vhea, and its metrics
+ * table, either hmtx or vmtx. The array is allocated with the given allocator, which must be passed
+ * again when finalizing the metrics.
+ */
+SF_INTERNAL void SFMetricsLoad(SFMetricsRef metrics, const SFAllocator *allocator, SFFontLayout fontLayout,
+    SFData headerTable, SFUInteger headerLength, SFData metricsTable, SFUInteger metricsLength);
+SF_INTERNAL void SFMetricsFinalize(SFMetricsRef metrics, const SFAllocator *allocator);
+
+SF_INTERNAL SFAdvance SFMetricsGetAdvance(SFMetricsRef metrics, SFFontLayout fontLayout, SFGlyphID glyphID);
+
+/**
+ * Gathers the advances of a run of glyphs.
+ */
+SF_INTERNAL void SFMetricsGetAdvances(SFMetricsRef metrics, SFFontLayout fontLayout,
+    const SFGlyphID *glyphIDs, SFAdvance *advances, SFUInteger count);
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SFConfig.h>
+
+#include <stddef.h>
+
+#include "SFBase.h"
+#include "SFData.h"
+#include "SFPairIndex.h"
+
+SF_INTERNAL void SFPairIndexInitialize(SFPairIndexRef pairIndex,
+    SFUInteger coverageMap, SFUInteger class1Map, SFUInteger class2Map,
+    SFData class1Records, SFUInt16 class1Count, SFUInt16 class2Count, SFUInteger class2Size)
+{
+    pairIndex->_coverageMap = coverageMap;
+    pairIndex->_class1Map = class1Map;
+    pairIndex->_class2Map = class2Map;
+    pairIndex->_class1Records = class1Records;
+    pairIndex->_class1Size = class2Count * class2Size;
+    pairIndex->_class2Size = class2Size;
+    pairIndex->_class1Count = class1Count;
+    pairIndex->_class2Count = class2Count;
+}
+
+SF_INTERNAL SFData SFPairIndexGetClassValues(SFPairIndexRef pairIndex, SFUInt16 class1, SFUInt16 class2)
+{
+    if (class1 < pairIndex->_class1Count && class2 < pairIndex->_class2Count) {
+        return SFData_Subdata(pairIndex->_class1Records,
+                              (class1 * pairIndex->_class1Size) + (class2 * pairIndex->_class2Size));
+    }
+
+    return NULL;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_PAIR_INDEX_H
+#define _SF_INTERNAL_PAIR_INDEX_H
+
+#include <SFConfig.h>
+
+#include "SFBase.h"
+#include "SFData.h"
+
+/**
+ * A native index of a format 2 pair adjustment subtable. It keeps the glyph maps of the coverage
+ * and class definitions along with the layout of the class records so that a pair is resolved with
+ * plain arithmetic. Format 1 subtables are not indexed, as their compiled coverage already selects
+ * the pair set to be searched.
+ */
+typedef struct _SFPairIndex {
+    SFUInteger _coverageMap;    /**< Index of the glyph map of the coverage. */
+    SFUInteger _class1Map;      /**< Index of the glyph map of the first class definition. */
+    SFUInteger _class2Map;      /**< Index of the glyph map of the second class definition. */
+    SFData _class1Records;      /**< First class record. */
+    SFUInteger _class1Size;     /**< Size of each first class record. */
+    SFUInteger _class2Size;     /**< Size of each second class record. */
+    SFUInt16 _class1Count;      /**< Number of first class records. */
+    SFUInt16 _class2Count;      /**< Number of second class records in each first class record. */
+} SFPairIndex, *SFPairIndexRef;
+
+/**
+ * Initializes the index with the glyph maps and the class records of a format 2 subtable.
+ */
+SF_INTERNAL void SFPairIndexInitialize(SFPairIndexRef pairIndex,
+    SFUInteger coverageMap, SFUInteger class1Map, SFUInteger class2Map,
+    SFData class1Records, SFUInt16 class1Count, SFUInt16 class2Count, SFUInteger class2Size);
+
+/**
+ * Returns the value records of the given classes, or NULL if either class is out of bounds.
+ */
+SF_INTERNAL SFData SFPairIndexGetClassValues(SFPairIndexRef pairIndex, SFUInt16 class1, SFUInt16 class2);
+
+#endif
@@ -17,24 +17,32 @@
 #include <SFConfig.h>
 
 #include <stddef.h>
-#include <stdlib.h>
 #include <string.h>
 
+#include "SFAllocator.h"
 #include "SFBase.h"
 #include "SFPattern.h"
 
-static void _SFFinalizeFeatureUnit(SFFeatureUnitRef featureUnit);
+static void _SFFinalizeFeatureUnit(SFPatternRef pattern, SFFeatureUnitRef featureUnit);
 static void _SFPatternFinalize(SFPatternRef pattern);
 
-SF_INTERNAL SFPatternRef SFPatternCreate(void)
+SF_INTERNAL SFPatternRef SFPatternCreate(const SFAllocator *allocator)
 {
-    SFPatternRef pattern = malloc(sizeof(SFPattern));
+    SFAllocator patternAllocator;
+    SFPatternRef pattern;
+
+    SFAllocatorInitialize(&patternAllocator, allocator);
+
+    pattern = SFAllocatorAllocate(&patternAllocator, sizeof(SFPattern));
+    pattern->_allocator = patternAllocator;
     pattern->font = NULL;
     pattern->featureTags.items = NULL;
     pattern->featureTags.count = 0;
     pattern->featureUnits.items = NULL;
     pattern->featureUnits.gsub = 0;
     pattern->featureUnits.gpos = 0;
+    pattern->singleRemaps.items = NULL;
+    pattern->singleRemaps.count = 0;
     pattern->scriptTag = 0;
     pattern->languageTag = 0;
     pattern->defaultDirection = SFTextDirectionLeftToRight;
@@ -43,9 +51,9 @@ SF_INTERNAL SFPatternRef SFPatternCreate(void)
     return pattern;
 }
 
-static void _SFFinalizeFeatureUnit(SFFeatureUnitRef featureUnit)
+static void _SFFinalizeFeatureUnit(SFPatternRef pattern, SFFeatureUnitRef featureUnit)
 {
-    free(featureUnit->lookupIndexes.items);
+    SFAllocatorDeallocate(&pattern->_allocator, featureUnit->lookupIndexes.items);
 }
 
 static void _SFPatternFinalize(SFPatternRef pattern)
@@ -55,10 +63,18 @@ static void _SFPatternFinalize(SFPatternRef pattern)
 
     /* Finalize all feature units. */
     for (index = 0; index < featureCount; index++) {
-        _SFFinalizeFeatureUnit((SFFeatureUnitRef)&pattern->featureUnits.items[index]);
+        _SFFinalizeFeatureUnit(pattern, (SFFeatureUnitRef)&pattern->featureUnits.items[index]);
+    }
+
+    SFAllocatorDeallocate(&pattern->_allocator, pattern->featureTags.items);
+    SFAllocatorDeallocate(&pattern->_allocator, pattern->featureUnits.items);
+
+    /* Finalize all composed runs of single substitutions. */
+    for (index = 0; index < pattern->singleRemaps.count; index++) {
+        SFSingleRemapFinalize(&pattern->singleRemaps.items[index]);
     }
 
-    free(pattern->featureUnits.items);
+    SFAllocatorDeallocate(&pattern->_allocator, pattern->singleRemaps.items);
 }
 
 SFFontRef SFPatternGetFont(SFPatternRef pattern)
@@ -98,6 +114,9 @@ SFPatternRef SFPatternRetain(SFPatternRef pattern)
 void SFPatternRelease(SFPatternRef pattern)
 {
     if (pattern && --pattern->_retainCount == 0) {
+        SFAllocator allocator = pattern->_allocator;
+
         _SFPatternFinalize(pattern);
+        SFAllocatorDeallocate(&allocator, pattern);
     }
 }
@@ -20,9 +20,11 @@
 #include <SFConfig.h>
 #include <SFPattern.h>
 
+#include "SFAllocator.h"
 #include "SFArtist.h"
 #include "SFBase.h"
 #include "SFFont.h"
+#include "SFSingleRemap.h"
 
 enum {
     SFFeatureKindSubstitution = 0x01, /**< A value indicating that the feature belongs to 'GSUB' table. */
@@ -59,12 +61,21 @@ typedef struct _SFPattern {
         SFUInteger gsub;                /**< Total number of gsub feature units. */
         SFUInteger gpos;                /**< Total number of gpos feature units. */
     } featureUnits;
+    struct {
+        SFSingleRemap *items;           /**< Composed runs of single substitutions in order of gsub feature units. */
+        SFUInteger count;               /**< Total number of composed runs. */
+    } singleRemaps;
     SFTag scriptTag;                    /**< Tag of the script. */
     SFTag languageTag;                  /**< Tag of the language. */
     SFTextDirection defaultDirection;   /**< Default direction of the script. */
+    SFAllocator _allocator;             /**< Allocator of the pattern and its arrays. */
     SFUInteger _retainCount;
 } SFPattern;
 
-SF_INTERNAL SFPatternRef SFPatternCreate(void);
+/**
+ * Creates a pattern whose arrays are allocated by the given allocator, or the default allocator if
+ * it is NULL.
+ */
+SF_INTERNAL SFPatternRef SFPatternCreate(const SFAllocator *allocator);
 
 #endif
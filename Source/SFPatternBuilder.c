@@ -22,11 +22,15 @@
 #include "SFArtist.h"
 #include "SFAssert.h"
 #include "SFBase.h"
+#include "SFFont.h"
+#include "SFFontCache.h"
 #include "SFList.h"
 #include "SFPattern.h"
 #include "SFPatternBuilder.h"
+#include "SFSingleRemap.h"
 
 static int _SFLookupIndexComparison(const void *item1, const void *item2);
+static void _SFComposeSingleRemaps(SFPatternRef pattern);
 
 static int _SFLookupIndexComparison(const void *item1, const void *item2)
 {
@@ -36,6 +40,66 @@ static int _SFLookupIndexComparison(const void *item1, const void *item2)
     return (int)(*ref1 - *ref2);
 }
 
+/**
+ * Composes each run of at least two consecutive single substitution lookups among the gsub
+ * feature units, so that the run is applied in one pass rather than one pass per lookup.
+ */
+static void _SFComposeSingleRemaps(SFPatternRef pattern)
+{
+    SFFontCacheRef fontCache = &pattern->font->cache;
+    SFLookupInfosRef lookupInfos = &fontCache->gsubLookups;
+    SFUInteger unitCount = pattern->featureUnits.gsub;
+    SF_LIST(SFSingleRemap) singleRemaps;
+    SFSingleRemap singleRemap;
+    SFBoolean hasRun = SFFalse;
+    SFUInteger unitIndex;
+    SFUInteger lookupIndex;
+
+    SFListInitialize(&singleRemaps, sizeof(SFSingleRemap), &pattern->_allocator);
+
+    /* Go one lookup past the last unit so that the pending run is closed as well. */
+    for (unitIndex = 0; unitIndex <= unitCount; unitIndex++) {
+        SFFeatureUnitRef featureUnit = NULL;
+        SFUInteger lookupCount = 1;
+
+        if (unitIndex < unitCount) {
+            featureUnit = &pattern->featureUnits.items[unitIndex];
+            lookupCount = featureUnit->lookupIndexes.count;
+        }
+
+        for (lookupIndex = 0; lookupIndex < lookupCount; lookupIndex++) {
+            SFLookupInfoRef lookupInfo = NULL;
+
+            if (featureUnit) {
+                SFUInt16 listIndex = featureUnit->lookupIndexes.items[lookupIndex];
+                lookupInfo = SFFontCacheGetLookupInfo(lookupInfos, listIndex);
+            }
+
+            if (featureUnit && SFSingleRemapCanCompose(fontCache, lookupInfo)) {
+                if (!hasRun) {
+                    SFSingleRemapInitialize(&singleRemap, &pattern->_allocator, unitIndex, lookupIndex);
+                    hasRun = SFTrue;
+                }
+
+                SFSingleRemapAddLookup(&singleRemap, fontCache, lookupInfo, featureUnit->featureMask);
+            } else if (hasRun) {
+                /* A single lookup gains nothing from being composed. */
+                if (singleRemap.lookupCount > 1) {
+                    singleRemap.unitLimit = unitIndex;
+                    singleRemap.lookupLimit = lookupIndex;
+                    SFListAdd(&singleRemaps, singleRemap);
+                } else {
+                    SFSingleRemapFinalize(&singleRemap);
+                }
+
+                hasRun = SFFalse;
+            }
+        }
+    }
+
+    SFListFinalizeKeepingArray(&singleRemaps, &pattern->singleRemaps.items, &pattern->singleRemaps.count);
+}
+
 SF_INTERNAL void SFPatternBuilderInitialize(SFPatternBuilderRef builder, SFPatternRef pattern)
 {
     /* Pattern must NOT be null. */
@@ -54,13 +118,13 @@ SF_INTERNAL void SFPatternBuilderInitialize(SFPatternBuilderRef builder, SFPatte
     builder->_featureKind = 0;
     builder->_canBuild = SFTrue;
 
-    SFListInitialize(&builder->_featureTags, sizeof(SFTag));
+    SFListInitialize(&builder->_featureTags, sizeof(SFTag), &pattern->_allocator);
     SFListSetCapacity(&builder->_featureTags, 24);
 
-    SFListInitialize(&builder->_featureUnits, sizeof(SFFeatureUnit));
+    SFListInitialize(&builder->_featureUnits, sizeof(SFFeatureUnit), &pattern->_allocator);
     SFListSetCapacity(&builder->_featureUnits, 24);
 
-    SFListInitialize(&builder->_lookupIndexes, sizeof(SFUInt16));
+    SFListInitialize(&builder->_lookupIndexes, sizeof(SFUInt16), &pattern->_allocator);
     SFListSetCapacity(&builder->_lookupIndexes, 32);
 }
 
@@ -167,7 +231,7 @@ SF_INTERNAL void SFPatternBuilderMakeFeatureUnit(SFPatternBuilderRef builder)
     builder->_featureIndex += featureUnit.coveredRange.count;
 
     /* Initialize lookup indexes array. */
-    SFListInitialize(&builder->_lookupIndexes, sizeof(SFUInt16));
+    SFListInitialize(&builder->_lookupIndexes, sizeof(SFUInt16), &builder->_pattern->_allocator);
     SFListSetCapacity(&builder->_lookupIndexes, 32);
     /* Reset feature mask. */
     builder->_featureMask = 0;
@@ -204,5 +268,9 @@ SF_INTERNAL void SFPatternBuilderBuild(SFPatternBuilderRef builder)
     SFListFinalizeKeepingArray(&builder->_featureTags, &pattern->featureTags.items, &pattern->featureTags.count);
     SFListFinalizeKeepingArray(&builder->_featureUnits, &pattern->featureUnits.items, &unitCount);
 
+    if (pattern->font) {
+        _SFComposeSingleRemaps(pattern);
+    }
+
     builder->_canBuild = SFFalse;
 }
@@ -16,7 +16,6 @@
 
 #include <SFConfig.h>
 #include <stddef.h>
-#include <stdlib.h>
 
 #include "SFBase.h"
 #include "SFCommon.h"
@@ -196,7 +195,18 @@ static void _SFAddHeaderTable(SFSchemeRef scheme,
 
 SFSchemeRef SFSchemeCreate(void)
 {
-    SFSchemeRef scheme = malloc(sizeof(SFScheme));
+    return SFSchemeCreateWithAllocator(NULL);
+}
+
+SFSchemeRef SFSchemeCreateWithAllocator(const SFAllocator *allocator)
+{
+    SFAllocator schemeAllocator;
+    SFSchemeRef scheme;
+
+    SFAllocatorInitialize(&schemeAllocator, allocator);
+
+    scheme = SFAllocatorAllocate(&schemeAllocator, sizeof(SFScheme));
+    scheme->_allocator = schemeAllocator;
     scheme->_font = NULL;
     scheme->_scriptTag = 0;
     scheme->_languageTag = 0;
@@ -226,7 +236,7 @@ SFPatternRef SFSchemeBuildPattern(SFSchemeRef scheme)
 
     if (font) {
         SFScriptKnowledgeRef scriptKnowledge = SFShapingKnowledgeSeekScript(&SFUnifiedKnowledgeInstance, scheme->_scriptTag);
-        SFPatternRef pattern = SFPatternCreate();
+        SFPatternRef pattern = SFPatternCreate(&scheme->_allocator);
         SFPatternBuilder builder;
 
         SFPatternBuilderInitialize(&builder, pattern);
@@ -267,6 +277,7 @@ SFSchemeRef SFSchemeRetain(SFSchemeRef scheme)
 void SFSchemeRelease(SFSchemeRef scheme)
 {
     if (scheme && --scheme->_retainCount == 0) {
-        free(scheme);
+        SFAllocator allocator = scheme->_allocator;
+        SFAllocatorDeallocate(&allocator, scheme);
     }
 }
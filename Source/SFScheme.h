@@ -19,6 +19,7 @@
 
 #include <SFScheme.h>
 
+#include "SFAllocator.h"
 #include "SFBase.h"
 #include "SFFont.h"
 #include "SFShapingKnowledge.h"
@@ -27,6 +28,7 @@ typedef struct _SFScheme {
     SFFontRef _font;                /**< Font, whose scheme is being built. */
     SFTag _scriptTag;               /**< Tag of the script. */
     SFTag _languageTag;             /**< Tag of the language. */
+    SFAllocator _allocator;         /**< Allocator of the scheme and the patterns it builds. */
 
     SFInteger _retainCount;
 } SFScheme;
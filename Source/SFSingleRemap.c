@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SFConfig.h>
+
+#include <stddef.h>
+
+#include "SFAlbum.h"
+#include "SFAllocator.h"
+#include "SFAssert.h"
+#include "SFBase.h"
+#include "SFCommon.h"
+#include "SFData.h"
+#include "SFFontCache.h"
+#include "SFGlyphMap.h"
+#include "SFGSUB.h"
+#include "SFList.h"
+#include "SFLocator.h"
+#include "SFSingleRemap.h"
+
+static SFGlyphID _SFSingleRemapApplyLookup(SFFontCacheRef fontCache, SFLookupInfoRef lookupInfo,
+    SFGlyphTraits ignoreTraits, SFGlyphID glyph);
+
+SF_INTERNAL SFBoolean SFSingleRemapCanCompose(SFFontCacheRef fontCache, SFLookupInfoRef lookupInfo)
+{
+    SFUInteger subtableIndex;
+
+    /* The filtering criteria depend on more than the traits of a glyph. */
+    if (!lookupInfo || lookupInfo->lookupFlag & (SFLookupFlagUseMarkFilteringSet | SFLookupFlagMarkAttachmentType)) {
+        return SFFalse;
+    }
+
+    for (subtableIndex = 0; subtableIndex < lookupInfo->subtableCount; subtableIndex++) {
+        SFSubtableInfoRef subtable = &lookupInfo->subtables[subtableIndex];
+        SFUInt16 format;
+        SFData coverageTable;
+
+        if (subtable->subtableType != SFLookupTypeSingle) {
+            return SFFalse;
+        }
+
+        format = SFSingleSubst_Format(subtable->table);
+
+        if (format != 1 && format != 2) {
+            return SFFalse;
+        }
+
+        /* The coverage must be compiled so that the covered glyphs are known. */
+        coverageTable = SFData_Subdata(subtable->table, SFSingleSubstF1_CoverageOffset(subtable->table));
+
+        if (!SFFontCacheGetCoverage(fontCache, coverageTable)) {
+            return SFFalse;
+        }
+    }
+
+    return SFTrue;
+}
+
+SF_INTERNAL void SFSingleRemapInitialize(SFSingleRemapRef singleRemap, const SFAllocator *allocator,
+    SFUInteger unitIndex, SFUInteger lookupIndex)
+{
+    SFListInitialize(&singleRemap->steps, sizeof(SFSingleRemapStep), allocator);
+
+    singleRemap->unitIndex = unitIndex;
+    singleRemap->lookupIndex = lookupIndex;
+    singleRemap->unitLimit = unitIndex;
+    singleRemap->lookupLimit = lookupIndex;
+    singleRemap->lookupCount = 0;
+}
+
+SF_INTERNAL void SFSingleRemapFinalize(SFSingleRemapRef singleRemap)
+{
+    SFUInteger index;
+
+    for (index = 0; index < singleRemap->steps.count; index++) {
+        SFAllocatorDeallocate(&singleRemap->steps._allocator, SFListGetRef(&singleRemap->steps, index)->glyphs);
+    }
+
+    SFListFinalize(&singleRemap->steps);
+}
+
+static SFGlyphID _SFSingleRemapApplyLookup(SFFontCacheRef fontCache, SFLookupInfoRef lookupInfo,
+    SFGlyphTraits ignoreTraits, SFGlyphID glyph)
+{
+    SFUInteger subtableIndex;
+
+    if (SFFontCacheGetGlyphTraits(fontCache, glyph) & ignoreTraits) {
+        return glyph;
+    }
+
+    /* The first subtable applying to the glyph wins. */
+    for (subtableIndex = 0; subtableIndex < lookupInfo->subtableCount; subtableIndex++) {
+        SFData singleSubst = lookupInfo->subtables[subtableIndex].table;
+        SFUInteger substitute = SFFontCacheSearchSingleSubstitute(fontCache, singleSubst, glyph);
+
+        if (substitute != SFInvalidIndex) {
+            return (SFGlyphID)substitute;
+        }
+    }
+
+    return glyph;
+}
+
+SF_INTERNAL void SFSingleRemapAddLookup(SFSingleRemapRef singleRemap, SFFontCacheRef fontCache,
+    SFLookupInfoRef lookupInfo, SFUInt16 featureMask)
+{
+    SFUInt16 antiFeatureMask = _SFAlbumGetAntiFeatureMask(featureMask);
+    SFGlyphTraits ignoreTraits = _SFLocatorGetIgnoreTraits(lookupInfo->lookupFlag);
+    SFSingleRemapStepRef step = NULL;
+    SFUInteger glyphLimit;
+    SFUInteger subtableIndex;
+    SFUInteger glyph;
+
+    /* The lookup must be composable. */
+    SFAssert(SFSingleRemapCanCompose(fontCache, lookupInfo));
+
+    if (singleRemap->steps.count) {
+        step = SFListGetRef(&singleRemap->steps, singleRemap->steps.count - 1);
+
+        if (step->antiFeatureMask != antiFeatureMask) {
+            step = NULL;
+        }
+    }
+
+    if (!step) {
+        SFSingleRemapStep newStep;
+        newStep.glyphs = NULL;
+        newStep.glyphLimit = 0;
+        newStep.antiFeatureMask = antiFeatureMask;
+
+        SFListAdd(&singleRemap->steps, newStep);
+        step = SFListGetRef(&singleRemap->steps, singleRemap->steps.count - 1);
+    }
+
+    /* Extend the step up to the last glyph covered by the lookup. */
+    glyphLimit = step->glyphLimit;
+
+    for (subtableIndex = 0; subtableIndex < lookupInfo->subtableCount; subtableIndex++) {
+        SFData singleSubst = lookupInfo->subtables[subtableIndex].table;
+        SFData coverageTable = SFData_Subdata(singleSubst, SFSingleSubstF1_CoverageOffset(singleSubst));
+        SFUInteger coverageLimit = SFGlyphMapGetGlyphLimit(SFFontCacheGetCoverage(fontCache, coverageTable));
+
+        if (coverageLimit > glyphLimit) {
+            glyphLimit = coverageLimit;
+        }
+    }
+
+    if (glyphLimit > step->glyphLimit) {
+        step->glyphs = SFAllocatorReallocate(&singleRemap->steps._allocator, step->glyphs, sizeof(SFGlyphID) * glyphLimit);
+
+        for (glyph = step->glyphLimit; glyph < glyphLimit; glyph++) {
+            step->glyphs[glyph] = (SFGlyphID)glyph;
+        }
+
+        step->glyphLimit = glyphLimit;
+    }
+
+    /* Apply the lookup on the final glyphs of previous lookups. */
+    for (glyph = 0; glyph < glyphLimit; glyph++) {
+        step->glyphs[glyph] = _SFSingleRemapApplyLookup(fontCache, lookupInfo, ignoreTraits, step->glyphs[glyph]);
+    }
+
+    singleRemap->lookupCount++;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_SINGLE_REMAP_H
+#define _SF_INTERNAL_SINGLE_REMAP_H
+
+#include <SFConfig.h>
+
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFFontCache.h"
+#include "SFList.h"
+
+/**
+ * Final glyphs of consecutive single substitution lookups belonging to feature units of the same
+ * mask.
+ */
+typedef struct _SFSingleRemapStep {
+    SFGlyphID *glyphs;          /**< Final glyph of each glyph below the limit. */
+    SFUInteger glyphLimit;      /**< Number of glyphs that may be substituted in the step. */
+    SFUInt16 antiFeatureMask;   /**< Feature mask of the glyphs that the step does not apply to. */
+} SFSingleRemapStep, *SFSingleRemapStepRef;
+
+/**
+ * A run of consecutive single substitution lookups, possibly spanning multiple feature units,
+ * composed into glyph tables so that the whole run is applied in a single pass over the album.
+ */
+typedef struct _SFSingleRemap {
+    SF_LIST(SFSingleRemapStep) steps;   /**< Steps of the run in order of their feature units. */
+    SFUInteger unitIndex;               /**< Index of the feature unit holding the first lookup. */
+    SFUInteger lookupIndex;             /**< Position of the first lookup in its feature unit. */
+    SFUInteger unitLimit;               /**< Index of the feature unit holding the lookup after the run. */
+    SFUInteger lookupLimit;             /**< Position of the lookup after the run in its feature unit. */
+    SFUInteger lookupCount;             /**< Number of lookups composed into the run. */
+} SFSingleRemap, *SFSingleRemapRef;
+
+/**
+ * Returns SFTrue if the lookup can be composed into a remap, i.e. it is a compiled lookup of
+ * single substitutions only, ignoring the glyphs merely on the basis of their traits.
+ */
+SF_INTERNAL SFBoolean SFSingleRemapCanCompose(SFFontCacheRef fontCache, SFLookupInfoRef lookupInfo);
+
+SF_INTERNAL void SFSingleRemapInitialize(SFSingleRemapRef singleRemap, const SFAllocator *allocator,
+    SFUInteger unitIndex, SFUInteger lookupIndex);
+SF_INTERNAL void SFSingleRemapFinalize(SFSingleRemapRef singleRemap);
+
+/**
+ * Composes a lookup of the feature unit having given mask at the end of the run. The lookup must
+ * be composable.
+ */
+SF_INTERNAL void SFSingleRemapAddLookup(SFSingleRemapRef singleRemap, SFFontCacheRef fontCache,
+    SFLookupInfoRef lookupInfo, SFUInt16 featureMask);
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <SFConfig.h>
+
+#include <stddef.h>
+
+#include "SFAllocator.h"
+#include "SFAssert.h"
+#include "SFBase.h"
+#include "SFData.h"
+#include "SFTableMap.h"
+
+#define SF_DEFAULT_TABLE_MAP_CAPACITY 16
+
+static SFUInteger _SFTableMapHash(SFData table);
+static SFTableMapEntry *_SFTableMapFindEntry(SFTableMapEntry *entries, SFUInteger capacity, SFData table);
+static void _SFTableMapResize(SFTableMapRef tableMap, SFUInteger capacity);
+
+SF_INTERNAL void SFTableMapInitialize(SFTableMapRef tableMap, const SFAllocator *allocator)
+{
+    tableMap->_entries = NULL;
+    tableMap->_capacity = 0;
+    tableMap->count = 0;
+    SFAllocatorInitialize(&tableMap->_allocator, allocator);
+}
+
+SF_INTERNAL void SFTableMapFinalize(SFTableMapRef tableMap)
+{
+    SFAllocatorDeallocate(&tableMap->_allocator, tableMap->_entries);
+}
+
+static SFUInteger _SFTableMapHash(SFData table)
+{
+    SFUInteger hash = (SFUInteger)table;
+
+    /* Mix the bits so that nearby tables do not end up in adjacent slots. */
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6DUL;
+    hash ^= hash >> 12;
+
+    return hash;
+}
+
+static SFTableMapEntry *_SFTableMapFindEntry(SFTableMapEntry *entries, SFUInteger capacity, SFData table)
+{
+    SFUInteger mask = capacity - 1;
+    SFUInteger index = _SFTableMapHash(table) & mask;
+
+    /* Probe linearly until either the table or an empty slot is found. */
+    while (entries[index].table && entries[index].table != table) {
+        index = (index + 1) & mask;
+    }
+
+    return &entries[index];
+}
+
+static void _SFTableMapResize(SFTableMapRef tableMap, SFUInteger capacity)
+{
+    SFTableMapEntry *oldEntries = tableMap->_entries;
+    SFUInteger oldCapacity = tableMap->_capacity;
+    SFTableMapEntry *newEntries;
+    SFUInteger index;
+
+    newEntries = SFAllocatorAllocate(&tableMap->_allocator, sizeof(SFTableMapEntry) * capacity);
+
+    for (index = 0; index < capacity; index++) {
+        newEntries[index].table = NULL;
+    }
+
+    for (index = 0; index < oldCapacity; index++) {
+        SFTableMapEntry *oldEntry = &oldEntries[index];
+
+        if (oldEntry->table) {
+            *_SFTableMapFindEntry(newEntries, capacity, oldEntry->table) = *oldEntry;
+        }
+    }
+
+    SFAllocatorDeallocate(&tableMap->_allocator, oldEntries);
+
+    tableMap->_entries = newEntries;
+    tableMap->_capacity = capacity;
+}
+
+SF_INTERNAL SFUInteger SFTableMapGetValue(SFTableMapRef tableMap, SFData table)
+{
+    if (tableMap->count) {
+        SFTableMapEntry *entry = _SFTableMapFindEntry(tableMap->_entries, tableMap->_capacity, table);
+
+        if (entry->table) {
+            return entry->value;
+        }
+    }
+
+    return SFInvalidIndex;
+}
+
+SF_INTERNAL void SFTableMapSetValue(SFTableMapRef tableMap, SFData table, SFUInteger value)
+{
+    SFTableMapEntry *entry;
+
+    /* The table must NOT be null. */
+    SFAssert(table != NULL);
+
+    /* Keep the load factor at most one half so that probe sequences remain short. */
+    if ((tableMap->count + 1) * 2 > tableMap->_capacity) {
+        SFUInteger capacity = tableMap->_capacity ? tableMap->_capacity * 2 : SF_DEFAULT_TABLE_MAP_CAPACITY;
+        _SFTableMapResize(tableMap, capacity);
+    }
+
+    entry = _SFTableMapFindEntry(tableMap->_entries, tableMap->_capacity, table);
+
+    if (!entry->table) {
+        entry->table = table;
+        tableMap->count += 1;
+    }
+
+    entry->value = value;
+}
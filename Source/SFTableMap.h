@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _SF_INTERNAL_TABLE_MAP_H
+#define _SF_INTERNAL_TABLE_MAP_H
+
+#include <SFConfig.h>
+
+#include "SFAllocator.h"
+#include "SFBase.h"
+#include "SFData.h"
+
+typedef struct _SFTableMapEntry {
+    SFData table;           /**< The table acting as key of the entry. */
+    SFUInteger value;       /**< The value associated with the table. */
+} SFTableMapEntry;
+
+/**
+ * Associates the addresses of open type tables with arbitrary values, so that the data compiled
+ * from a table can be reached in constant time while processing it.
+ */
+typedef struct _SFTableMap {
+    SFTableMapEntry *_entries;  /**< Open addressed entries of the map. */
+    SFUInteger _capacity;       /**< Total number of entries, always a power of two. */
+    SFUInteger count;           /**< Number of occupied entries. */
+    SFAllocator _allocator;     /**< Allocator of the entries. */
+} SFTableMap, *SFTableMapRef;
+
+SF_INTERNAL void SFTableMapInitialize(SFTableMapRef tableMap, const SFAllocator *allocator);
+SF_INTERNAL void SFTableMapFinalize(SFTableMapRef tableMap);
+
+/**
+ * Returns the value associated with the table, or SFInvalidIndex if it does not exist in the map.
+ */
+SF_INTERNAL SFUInteger SFTableMapGetValue(SFTableMapRef tableMap, SFData table);
+
+/**
+ * Associates the value with the table, replacing the previous value if any.
+ */
+SF_INTERNAL void SFTableMapSetValue(SFTableMapRef tableMap, SFData table, SFUInteger value);
+
+#endif
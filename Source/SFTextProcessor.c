@@ -23,7 +23,8 @@
 #include "SFCommon.h"
 #include "SFData.h"
 #include "SFFont.h"
-#include "SFGDEF.h"
+#include "SFFontCache.h"
+#include "SFGlyphDigest.h"
 #include "SFPattern.h"
 
 #include "SFGlyphDiscovery.h"
@@ -32,16 +33,19 @@
 #include "SFGlyphSubstitution.h"
 #include "SFTextProcessor.h"
 
+static SFBoolean _SFIgnoreSubtable(SFTextProcessorRef processor, SFData subtable);
+static void _SFResetSubtableHandlers(SFTextProcessorRef processor);
+static void _SFCollectAlbumDigest(SFTextProcessorRef processor);
+static void _SFCompactAlbum(SFTextProcessorRef processor);
 static void _SFApplyFeatureRange(SFTextProcessorRef processor, SFUInteger index, SFUInteger count);
+static SFBoolean _SFApplyFeatureLookup(SFTextProcessorRef processor, SFFeatureUnitRef featureUnit, SFUInt16 lookupIndex);
 
-static void _SFPrepareLookup(SFTextProcessorRef processor, SFUInt16 lookupIndex, SFData *outLookupTable);
-static void _SFApplySubtables(SFTextProcessorRef processor, SFData lookupTable);
+static SFLookupInfoRef _SFPrepareLookup(SFTextProcessorRef processor, SFUInt16 lookupIndex, SFData *outLookupTable);
+static SFBoolean _SFApplySubtables(SFTextProcessorRef processor, SFLookupInfoRef lookupInfo, SFData lookupTable);
 
 SF_INTERNAL void SFTextProcessorInitialize(SFTextProcessorRef textProcessor, SFPatternRef pattern,
     SFAlbumRef album, SFTextDirection textDirection, SFTextMode textMode)
 {
-    SFData gdef;
-
     /* Pattern must NOT be null. */
     SFAssert(pattern != NULL);
     /* Album must NOT be null. */
@@ -49,17 +53,14 @@ SF_INTERNAL void SFTextProcessorInitialize(SFTextProcessorRef textProcessor, SFP
 
     textProcessor->_pattern = pattern;
     textProcessor->_album = album;
-    textProcessor->_glyphClassDef = NULL;
+    textProcessor->_fontCache = &pattern->font->cache;
+    textProcessor->_lookupDigests = NULL;
+    textProcessor->_lookupInfos = NULL;
     textProcessor->_textDirection = textDirection;
     textProcessor->_textMode = textMode;
 
-    gdef = pattern->font->tables.gdef;
-    if (gdef) {
-        SFOffset offset = SFGDEF_GlyphClassDefOffset(gdef);
-        textProcessor->_glyphClassDef = SFData_Subdata(gdef, offset);
-    }
-
-    SFLocatorInitialize(&textProcessor->_locator, album, gdef);
+    SFLocatorInitialize(&textProcessor->_locator, album, textProcessor->_fontCache, pattern->font->tables.gdef);
+    SFSkipVectorsInitialize(&textProcessor->_skipVectors, &album->_allocator);
 }
 
 SF_INTERNAL void SFTextProcessorDiscoverGlyphs(SFTextProcessorRef textProcessor)
@@ -79,7 +80,11 @@ SF_INTERNAL void SFTextProcessorSubstituteGlyphs(SFTextProcessorRef textProcesso
         SFData lookupListTable = SFData_Subdata(gsubTable, lookupListOffset);
 
         textProcessor->_lookupList = lookupListTable;
+        textProcessor->_lookupDigests = &textProcessor->_fontCache->gsubDigests;
+        textProcessor->_lookupInfos = &textProcessor->_fontCache->gsubLookups;
         textProcessor->_lookupOperation = _SFApplySubstitutionSubtable;
+        _SFResetSubtableHandlers(textProcessor);
+        _SFSetSubstitutionHandlers(textProcessor->_subtableHandlers);
 
         _SFApplyFeatureRange(textProcessor, 0, pattern->featureUnits.gsub);
     }
@@ -94,24 +99,43 @@ SF_INTERNAL void SFTextProcessorPositionGlyphs(SFTextProcessorRef textProcessor)
     SFFontRef font = pattern->font;
     SFData gposTable = font->tables.gpos;
     SFUInteger glyphCount = album->glyphCount;
-    SFUInteger index;
+    SFUInteger start;
 
     SFAlbumBeginArranging(album);
 
-    /* Set positions and advances of all glyphs. */
-    for (index = 0; index < glyphCount; index++) {
-        SFGlyphID glyphID = SFAlbumGetGlyph(album, index);
-        SFGlyphTraits traits = SFAlbumGetTraits(album, index);
-        SFAdvance advance = 0;
+    /* Set positions and advances of all glyphs, getting the advances in batches. */
+    for (start = 0; start < glyphCount; start += SF_FONT_BATCH_SIZE) {
+        SFUInteger limit = start + SF_FONT_BATCH_SIZE;
+        SFGlyphID glyphIDs[SF_FONT_BATCH_SIZE];
+        SFAdvance advances[SF_FONT_BATCH_SIZE];
+        SFUInteger batchCount = 0;
+        SFUInteger index;
+
+        if (limit > glyphCount) {
+            limit = glyphCount;
+        }
 
         /* Ignore placeholder glyphs. */
-        if (traits != SFGlyphTraitPlaceholder) {
-            advance = SFFontGetAdvanceForGlyph(font, SFFontLayoutHorizontal, glyphID);
+        for (index = start; index < limit; index++) {
+            if (SFAlbumGetTraits(album, index) != SFGlyphTraitPlaceholder) {
+                glyphIDs[batchCount++] = SFAlbumGetGlyph(album, index);
+            }
         }
 
-        SFAlbumSetX(album, index, 0);
-        SFAlbumSetY(album, index, 0);
-        SFAlbumSetAdvance(album, index, advance);
+        SFFontGetAdvancesForGlyphs(font, SFFontLayoutHorizontal, glyphIDs, advances, batchCount);
+        batchCount = 0;
+
+        for (index = start; index < limit; index++) {
+            SFAdvance advance = 0;
+
+            if (SFAlbumGetTraits(album, index) != SFGlyphTraitPlaceholder) {
+                advance = advances[batchCount++];
+            }
+
+            SFAlbumSetX(album, index, 0);
+            SFAlbumSetY(album, index, 0);
+            SFAlbumSetAdvance(album, index, advance);
+        }
     }
 
     if (gposTable) {
@@ -119,7 +143,12 @@ SF_INTERNAL void SFTextProcessorPositionGlyphs(SFTextProcessorRef textProcessor)
         SFData lookupListTable = SFData_Subdata(gposTable, lookupListOffset);
 
         textProcessor->_lookupList = lookupListTable;
+        textProcessor->_lookupDigests = &textProcessor->_fontCache->gposDigests;
+        textProcessor->_lookupInfos = &textProcessor->_fontCache->gposLookups;
         textProcessor->_lookupOperation = _SFApplyPositioningSubtable;
+        SFLocatorSetSkipVectors(&textProcessor->_locator, &textProcessor->_skipVectors);
+        _SFResetSubtableHandlers(textProcessor);
+        _SFSetPositioningHandlers(textProcessor->_subtableHandlers);
 
         _SFApplyFeatureRange(textProcessor, pattern->featureUnits.gsub, pattern->featureUnits.gpos);
         _SFResolveAttachments(textProcessor);
@@ -131,52 +160,170 @@ SF_INTERNAL void SFTextProcessorPositionGlyphs(SFTextProcessorRef textProcessor)
 SF_INTERNAL void SFTextProcessorWrapUp(SFTextProcessorRef textProcessor)
 {
     SFAlbumWrapUp(textProcessor->_album);
+    SFSkipVectorsFinalize(&textProcessor->_skipVectors);
+}
+
+static SFBoolean _SFIgnoreSubtable(SFTextProcessorRef processor, SFData subtable)
+{
+    return SFFalse;
+}
+
+static void _SFResetSubtableHandlers(SFTextProcessorRef processor)
+{
+    SFUInteger index;
+
+    for (index = 0; index < SF_SUBTABLE_TYPE_COUNT; index++) {
+        processor->_subtableHandlers[index] = _SFIgnoreSubtable;
+    }
+}
+
+static void _SFCollectAlbumDigest(SFTextProcessorRef processor)
+{
+    SFAlbumRef album = processor->_album;
+    SFUInteger glyphCount = album->glyphCount;
+    SFUInteger index;
+
+    SFGlyphDigestClear(&processor->_albumDigest);
+
+    for (index = 0; index < glyphCount; index++) {
+        SFGlyphDigestAddGlyph(&processor->_albumDigest, SFAlbumGetGlyph(album, index));
+    }
+}
+
+/**
+ * Removes the placeholders left behind by ligatures once they make up a quarter of the album, so
+ * that the lookups of later feature units do not have to walk over them.
+ */
+static void _SFCompactAlbum(SFTextProcessorRef processor)
+{
+    SFAlbumRef album = processor->_album;
+    SFUInteger glyphCount = album->glyphCount;
+    SFUInteger placeholderCount = 0;
+    SFUInteger index;
+
+    for (index = 0; index < glyphCount; index++) {
+        if (SFAlbumGetTraits(album, index) & SFGlyphTraitPlaceholder) {
+            placeholderCount++;
+        }
+    }
+
+    if (placeholderCount && placeholderCount >= glyphCount / 4) {
+        SFAlbumCompact(album);
+    }
 }
 
 static void _SFApplyFeatureRange(SFTextProcessorRef processor, SFUInteger index, SFUInteger count)
 {
     SFPatternRef pattern = processor->_pattern;
+    SFSingleRemapRef singleRemap = pattern->singleRemaps.items;
+    SFSingleRemapRef remapLimit = singleRemap + pattern->singleRemaps.count;
     SFUInteger limit = index + count;
+    SFUInteger lookupIndex = 0;
+
+    _SFCollectAlbumDigest(processor);
 
-    for (; index < limit; index++) {
+    /* Composed runs are kept only for gsub units, so positioning never meets one. */
+    while (singleRemap != remapLimit && singleRemap->unitIndex < index) {
+        singleRemap++;
+    }
+
+    while (index < limit) {
         SFFeatureUnitRef featureUnit = &pattern->featureUnits.items[index];
-        SFUInt16 *lookupArray = featureUnit->lookupIndexes.items;
-        SFUInteger lookupCount = featureUnit->lookupIndexes.count;
-        SFUInteger lookupIndex;
+        SFBoolean isApplied;
 
-        /* Apply all lookups of the feature unit. */
-        for (lookupIndex = 0; lookupIndex < lookupCount; lookupIndex++) {
-            SFLocatorRef locator = &processor->_locator;
-            SFData lookupTable;
+        if (lookupIndex == featureUnit->lookupIndexes.count) {
+            /* Glyphs can only be removed while the album is being filled. */
+            if (processor->_lookupOperation == _SFApplySubstitutionSubtable) {
+                _SFCompactAlbum(processor);
+            }
 
-            SFLocatorReset(locator, 0, processor->_album->glyphCount);
-            SFLocatorSetFeatureMask(locator, featureUnit->featureMask);
+            index++;
+            lookupIndex = 0;
+            continue;
+        }
 
-            _SFPrepareLookup(processor, lookupArray[lookupIndex], &lookupTable);
+        if (singleRemap != remapLimit
+            && singleRemap->unitIndex == index && singleRemap->lookupIndex == lookupIndex) {
+            /* Apply the whole run of single substitutions at once and continue after it. */
+            isApplied = _SFApplySingleRemap(processor, singleRemap);
+            index = singleRemap->unitLimit;
+            lookupIndex = singleRemap->lookupLimit;
+            singleRemap++;
+        } else {
+            isApplied = _SFApplyFeatureLookup(processor, featureUnit, featureUnit->lookupIndexes.items[lookupIndex]);
+            lookupIndex++;
+        }
 
-            /* Apply current lookup on all glyphs. */
-            while (SFLocatorMoveNext(locator)) {
-                _SFApplySubtables(processor, lookupTable);
-            }
+        /* Substitutions may have brought new glyphs into the album. */
+        if (isApplied && processor->_lookupOperation == _SFApplySubstitutionSubtable) {
+            _SFCollectAlbumDigest(processor);
+        }
+    }
+}
+
+static SFBoolean _SFApplyFeatureLookup(SFTextProcessorRef processor, SFFeatureUnitRef featureUnit, SFUInt16 lookupIndex)
+{
+    SFAlbumRef album = processor->_album;
+    SFLocatorRef locator = &processor->_locator;
+    SFGlyphDigestRef lookupDigest;
+    SFLookupInfoRef lookupInfo;
+    SFData lookupTable;
+    SFBoolean isApplied = SFFalse;
+
+    lookupDigest = SFFontCacheGetLookupDigest(processor->_lookupDigests, lookupIndex);
+
+    /* Skip the lookup if it does not apply to any glyph of the album. */
+    if (lookupDigest && !SFGlyphDigestMayIntersect(lookupDigest, &processor->_albumDigest)) {
+        return SFFalse;
+    }
+
+    SFLocatorReset(locator, 0, album->glyphCount);
+    SFLocatorSetFeatureMask(locator, featureUnit->featureMask);
+
+    lookupInfo = _SFPrepareLookup(processor, lookupIndex, &lookupTable);
+
+    /* Apply current lookup on all glyphs, rejecting the ones outside its digest. */
+    while (SFLocatorMoveNext(locator)) {
+        if (!lookupDigest || SFGlyphDigestMayHave(lookupDigest, SFAlbumGetGlyph(album, locator->index))) {
+            isApplied |= _SFApplySubtables(processor, lookupInfo, lookupTable);
         }
     }
+
+    return isApplied;
 }
 
 SF_PRIVATE void _SFApplyLookup(SFTextProcessorRef processor, SFUInt16 lookupIndex)
 {
+    SFLookupInfoRef lookupInfo;
     SFData lookupTable;
 
-    _SFPrepareLookup(processor, lookupIndex, &lookupTable);
-    _SFApplySubtables(processor, lookupTable);
+    lookupInfo = _SFPrepareLookup(processor, lookupIndex, &lookupTable);
+    _SFApplySubtables(processor, lookupInfo, lookupTable);
 }
 
-static void _SFPrepareLookup(SFTextProcessorRef processor, SFUInt16 lookupIndex, SFData *outLookupTable)
+/**
+ * Sets up the locator for the lookup, returning its native form if available. Otherwise, the raw
+ * lookup table is returned in the output parameter.
+ */
+static SFLookupInfoRef _SFPrepareLookup(SFTextProcessorRef processor, SFUInt16 lookupIndex, SFData *outLookupTable)
 {
+    SFLookupInfoRef lookupInfo = SFFontCacheGetLookupInfo(processor->_lookupInfos, lookupIndex);
     SFData lookupListTable = processor->_lookupList;
     SFOffset lookupOffset;
     SFData lookupTable;
     SFLookupFlag lookupFlag;
 
+    if (lookupInfo) {
+        SFLocatorSetLookupFlag(&processor->_locator, lookupInfo->lookupFlag);
+
+        if (lookupInfo->lookupFlag & SFLookupFlagUseMarkFilteringSet) {
+            SFLocatorSetMarkFilteringSet(&processor->_locator, lookupInfo->markFilteringSet);
+        }
+
+        *outLookupTable = NULL;
+        return lookupInfo;
+    }
+
     lookupOffset = SFLookupList_LookupOffset(lookupListTable, lookupIndex);
     lookupTable = SFData_Subdata(lookupListTable, lookupOffset);
     lookupFlag = SFLookup_LookupFlag(lookupTable);
@@ -191,14 +338,31 @@ static void _SFPrepareLookup(SFTextProcessorRef processor, SFUInt16 lookupIndex,
     }
 
     *outLookupTable = lookupTable;
+    return NULL;
 }
 
-static void _SFApplySubtables(SFTextProcessorRef processor, SFData lookupTable)
+static SFBoolean _SFApplySubtables(SFTextProcessorRef processor, SFLookupInfoRef lookupInfo, SFData lookupTable)
 {
     SFLookupType lookupType;
-    SFUInt16 subtableCount;
+    SFUInteger subtableCount;
     SFUInteger subtableIndex;
 
+    if (lookupInfo) {
+        SFSubtableInfoRef subtables = lookupInfo->subtables;
+        subtableCount = lookupInfo->subtableCount;
+
+        /* Dispatch each subtable directly to the handler of its resolved type. */
+        for (subtableIndex = 0; subtableIndex < subtableCount; subtableIndex++) {
+            SFSubtableInfoRef subtable = &subtables[subtableIndex];
+
+            if (processor->_subtableHandlers[subtable->subtableType](processor, subtable->table)) {
+                return SFTrue;
+            }
+        }
+
+        return SFFalse;
+    }
+
     lookupType = SFLookup_LookupType(lookupTable);
     subtableCount = SFLookup_SubtableCount(lookupTable);
 
@@ -209,7 +373,9 @@ static void _SFApplySubtables(SFTextProcessorRef processor, SFData lookupTable)
 
         if (processor->_lookupOperation(processor, lookupType, subtable)) {
             /* A subtable has performed substitution/positioning, so break the loop. */
-            break;
+            return SFTrue;
         }
     }
+
+    return SFFalse;
 }
@@ -23,18 +23,32 @@
 #include "SFArtist.h"
 #include "SFBase.h"
 #include "SFFont.h"
+#include "SFFontCache.h"
+#include "SFGlyphDigest.h"
 #include "SFLocator.h"
 #include "SFPattern.h"
 
+struct _SFTextProcessor;
+
+/**
+ * A function that applies a subtable of specific type at the current glyph of the locator.
+ */
+typedef SFBoolean (*_SFSubtableHandler)(struct _SFTextProcessor *, SFData);
+
 typedef struct _SFTextProcessor {
     SFPatternRef _pattern;
     SFAlbumRef _album;
-    SFData _glyphClassDef;
+    SFFontCacheRef _fontCache;
     SFData _lookupList;
+    SFLookupDigestsRef _lookupDigests;
+    SFLookupInfosRef _lookupInfos;
     SFBoolean (*_lookupOperation)(struct _SFTextProcessor *, SFLookupType, SFData);
+    _SFSubtableHandler _subtableHandlers[SF_SUBTABLE_TYPE_COUNT];
     SFTextDirection _textDirection;
     SFTextMode _textMode;
+    SFGlyphDigest _albumDigest;
     SFLocator _locator;
+    SFSkipVectors _skipVectors;
 } SFTextProcessor, *SFTextProcessorRef;
 
 SF_INTERNAL void SFTextProcessorInitialize(SFTextProcessorRef textProcessor, SFPatternRef pattern, SFAlbumRef album, SFTextDirection textDirection, SFTextMode textMode);
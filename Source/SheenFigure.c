@@ -20,27 +20,39 @@
 #ifdef SF_CONFIG_UNITY
 
 #include "SFAlbum.c"
+#include "SFAllocator.c"
 #include "SFArabicEngine.c"
 #include "SFArtist.c"
 #include "SFBase.c"
+#include "SFCmap.c"
 #include "SFCodepoints.c"
+#include "SFContextMatcher.c"
 #include "SFFont.c"
+#include "SFFontCache.c"
+#include "SFFontFile.c"
 #include "SFGeneralCategoryLookup.c"
+#include "SFGlyphDigest.c"
 #include "SFGlyphDiscovery.c"
 #include "SFGlyphManipulation.c"
+#include "SFGlyphMap.c"
 #include "SFGlyphPositioning.c"
 #include "SFGlyphSubstitution.c"
 #include "SFJoiningTypeLookup.c"
+#include "SFLigatureTrie.c"
 #include "SFList.c"
 #include "SFLocator.c"
+#include "SFMetrics.c"
 #include "SFOpenType.c"
+#include "SFPairIndex.c"
 #include "SFPattern.c"
 #include "SFPatternBuilder.c"
 #include "SFScheme.c"
 #include "SFShapingEngine.c"
 #include "SFShapingKnowledge.c"
 #include "SFSimpleEngine.c"
+#include "SFSingleRemap.c"
 #include "SFStandardEngine.c"
+#include "SFTableMap.c"
 #include "SFTextProcessor.c"
 #include "SFUnifiedEngine.c"
 
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFFont.h>
+}
+
+#include "FontBuilder.h"
+#include "Measure.h"
+#include "Shaper.h"
+#include "CallbackBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+
+static const size_t TextLength = 2000;
+static const size_t Iterations = 1000;
+static const size_t GlyphCount = 3000;
+
+/* Stands for a host face that must be locked before every access. */
+struct LockedFace {
+    mutex lock;
+};
+
+static void loadTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length)
+{
+    if (length) {
+        *length = 0;
+    }
+}
+
+static SFGlyphID getGlyphID(void *object, SFCodepoint codepoint)
+{
+    lock_guard<mutex> guard(reinterpret_cast<LockedFace *>(object)->lock);
+    return (SFGlyphID)codepoint;
+}
+
+static SFAdvance getAdvance(void *object, SFFontLayout fontLayout, SFGlyphID glyphID)
+{
+    lock_guard<mutex> guard(reinterpret_cast<LockedFace *>(object)->lock);
+    return 100;
+}
+
+static void getGlyphIDs(void *object, const SFCodepoint *codepoints, SFGlyphID *glyphIDs, SFUInteger count)
+{
+    lock_guard<mutex> guard(reinterpret_cast<LockedFace *>(object)->lock);
+
+    for (SFUInteger i = 0; i < count; i++) {
+        glyphIDs[i] = (SFGlyphID)codepoints[i];
+    }
+}
+
+static void getAdvances(void *object, SFFontLayout fontLayout,
+    const SFGlyphID *glyphIDs, SFAdvance *advances, SFUInteger count)
+{
+    lock_guard<mutex> guard(reinterpret_cast<LockedFace *>(object)->lock);
+
+    for (SFUInteger i = 0; i < count; i++) {
+        advances[i] = 100;
+    }
+}
+
+/* Holds the metrics tables of a face, whose advances a host would read on every call. */
+struct MetricsFace {
+    vector<uint8_t> hhea;
+    vector<uint8_t> hmtx;
+};
+
+static void loadMetricsTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length)
+{
+    MetricsFace *face = reinterpret_cast<MetricsFace *>(object);
+    const vector<uint8_t> *table = NULL;
+
+    switch (tag) {
+    case SFTagMake('h', 'h', 'e', 'a'):
+        table = &face->hhea;
+        break;
+
+    case SFTagMake('h', 'm', 't', 'x'):
+        table = &face->hmtx;
+        break;
+    }
+
+    if (table && buffer) {
+        memcpy(buffer, table->data(), table->size());
+    }
+    if (length) {
+        *length = (table ? (SFUInteger)table->size() : 0);
+    }
+}
+
+static SFGlyphID getMetricsGlyphID(void *object, SFCodepoint codepoint)
+{
+    return (SFGlyphID)codepoint;
+}
+
+static SFAdvance getMetricsAdvance(void *object, SFFontLayout fontLayout, SFGlyphID glyphID)
+{
+    const vector<uint8_t> &hmtx = reinterpret_cast<MetricsFace *>(object)->hmtx;
+    size_t offset = (size_t)(glyphID < GlyphCount ? glyphID : GlyphCount - 1) * 4;
+
+    return (SFAdvance)((hmtx[offset] << 8) | hmtx[offset + 1]);
+}
+
+CallbackBenchmark::CallbackBenchmark()
+{
+}
+
+void CallbackBenchmark::benchmarkLockedFace()
+{
+    LockedFace face;
+    FontBuilder fontBuilder;
+    SFFontExtendedProtocol protocol;
+    vector<SFCodepoint> text(TextLength);
+
+    for (size_t i = 0; i < TextLength; i++) {
+        text[i] = (SFCodepoint)('a' + (i % 26));
+    }
+
+    protocol.size = sizeof(SFFontExtendedProtocol);
+    protocol.base.finalize = NULL;
+    protocol.base.loadTable = &loadTable;
+    protocol.base.getGlyphIDForCodepoint = &getGlyphID;
+    protocol.base.getAdvanceForGlyph = &getAdvance;
+    protocol.getTable = NULL;
+    protocol.getGlyphIDsForCodepoints = NULL;
+    protocol.getAdvancesForGlyphs = NULL;
+    protocol.options = SFFontOptionNone;
+
+    SFFontRef singleFont = SFFontCreateWithExtendedProtocol(&protocol, &face, NULL, NULL, 0);
+
+    protocol.getGlyphIDsForCodepoints = &getGlyphIDs;
+    protocol.getAdvancesForGlyphs = &getAdvances;
+    SFFontRef batchFont = SFFontCreateWithExtendedProtocol(&protocol, &face, NULL, NULL, 0);
+
+    Shaper singleShaper(fontBuilder, singleFont);
+    Shaper batchShaper(fontBuilder, batchFont);
+
+    double baseline = measure(Iterations, [&]() {
+        singleShaper.shape(text);
+    });
+    double current = measure(Iterations, [&]() {
+        batchShaper.shape(text);
+    });
+
+    report("2000 code points on a locked face", baseline, current);
+
+    SFFontRelease(singleFont);
+    SFFontRelease(batchFont);
+}
+
+void CallbackBenchmark::benchmarkParsedMetrics()
+{
+    MetricsFace face;
+    FontBuilder fontBuilder;
+    SFFontExtendedProtocol protocol;
+    vector<SFCodepoint> text(TextLength);
+    uint32_t seed = 0x12345678;
+
+    face.hhea.resize(36);
+    face.hhea[34] = (uint8_t)(GlyphCount >> 8);
+    face.hhea[35] = (uint8_t)GlyphCount;
+
+    for (size_t i = 0; i < GlyphCount; i++) {
+        face.hmtx.push_back((uint8_t)((500 + i) >> 8));
+        face.hmtx.push_back((uint8_t)(500 + i));
+        face.hmtx.push_back(0);
+        face.hmtx.push_back(0);
+    }
+
+    for (size_t i = 0; i < TextLength; i++) {
+        seed = seed * 1664525 + 1013904223;
+        text[i] = (SFCodepoint)((seed >> 8) % GlyphCount);
+    }
+
+    protocol.size = sizeof(SFFontExtendedProtocol);
+    protocol.base.finalize = NULL;
+    protocol.base.loadTable = &loadMetricsTable;
+    protocol.base.getGlyphIDForCodepoint = &getMetricsGlyphID;
+    protocol.base.getAdvanceForGlyph = &getMetricsAdvance;
+    protocol.getTable = NULL;
+    protocol.getGlyphIDsForCodepoints = NULL;
+    protocol.getAdvancesForGlyphs = NULL;
+    protocol.options = SFFontOptionParsedMetrics;
+
+    SFFontRef callbackFont = SFFontCreateWithExtendedProtocol(&protocol, &face, NULL, NULL, 0);
+
+    protocol.base.getAdvanceForGlyph = NULL;
+    SFFontRef parsedFont = SFFontCreateWithExtendedProtocol(&protocol, &face, NULL, NULL, 0);
+
+    Shaper callbackShaper(fontBuilder, callbackFont);
+    Shaper parsedShaper(fontBuilder, parsedFont);
+
+    double baseline = measure(Iterations, [&]() {
+        callbackShaper.shape(text);
+    });
+    double current = measure(Iterations, [&]() {
+        parsedShaper.shape(text);
+    });
+
+    report("2000 glyphs with parsed hmtx", baseline, current);
+
+    SFFontRelease(callbackFont);
+    SFFontRelease(parsedFont);
+}
+
+void CallbackBenchmark::run()
+{
+    header("Font callbacks (per text)");
+    benchmarkLockedFace();
+    benchmarkParsedMetrics();
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFFont.h>
+#include <Source/SFFontCache.h>
+}
+
+#include <Tester/OpenType/Builder.h>
+
+#include "FontBuilder.h"
+#include "Measure.h"
+#include "Shaper.h"
+#include "ChainContextBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+using namespace SheenFigure::Tester::OpenType;
+
+static const Glyph BacktrackGlyph = 100;
+static const Glyph FirstGlyph = 200;
+static const Glyph SecondGlyph = 300;
+static const Glyph LookaheadGlyph = 400;
+static const Glyph ReferredGlyph = 500;
+static const size_t RuleCount = 40;
+static const size_t TextLength = 2000;
+static const size_t Iterations = 200;
+
+/**
+ * Makes a text of repeating contexts which are matched by the last rule of the rule set.
+ */
+static vector<SFCodepoint> makeText()
+{
+    vector<SFCodepoint> text(TextLength);
+
+    for (size_t i = 0; i + 3 < TextLength; i += 4) {
+        text[i] = BacktrackGlyph;
+        text[i + 1] = FirstGlyph;
+        text[i + 2] = SecondGlyph + RuleCount - 1;
+        text[i + 3] = LookaheadGlyph;
+    }
+
+    return text;
+}
+
+static void compare(const char *name, LookupSubtable &chainContext)
+{
+    Builder builder;
+    FontBuilder fontBuilder;
+    vector<SFCodepoint> text = makeText();
+
+    /* Refer to a lookup which leaves the glyphs unchanged. */
+    fontBuilder.addSubstitution(chainContext);
+    fontBuilder.addSubstitution(builder.createSingleSubst({ ReferredGlyph }, 0));
+
+    SFFontRef font = fontBuilder.build();
+    Shaper shaper(fontBuilder, font);
+    SFUInteger matcherCount = font->cache._contextMatcherMap.count;
+
+    /* Run without compiled matchers for the baseline. */
+    font->cache._contextMatcherMap.count = 0;
+    double baseline = measure(Iterations, [&]() {
+        shaper.shape(text);
+    });
+
+    font->cache._contextMatcherMap.count = matcherCount;
+    double current = measure(Iterations, [&]() {
+        shaper.shape(text);
+    });
+
+    report(name, baseline, current);
+
+    SFFontRelease(font);
+}
+
+ChainContextBenchmark::ChainContextBenchmark()
+{
+}
+
+void ChainContextBenchmark::benchmarkGlyphRules()
+{
+    Builder builder;
+    vector<rule_chain_context> rules;
+
+    for (size_t i = 0; i < RuleCount; i++) {
+        rules.push_back(rule_chain_context {
+            { BacktrackGlyph }, { FirstGlyph, (Glyph)(SecondGlyph + i) }, { LookaheadGlyph }, { {0, 1} }
+        });
+    }
+
+    compare("format 1, 40 rules, last matching", builder.createChainContext(rules));
+}
+
+void ChainContextBenchmark::benchmarkClassRules()
+{
+    Builder builder;
+    vector<UInt16> inputClasses(SecondGlyph + RuleCount - FirstGlyph, 0);
+    vector<rule_chain_context> rules;
+
+    /* Give the first glyph a class of its own, and each second glyph a distinct class. */
+    inputClasses[0] = 1;
+    for (size_t i = 0; i < RuleCount; i++) {
+        inputClasses[SecondGlyph - FirstGlyph + i] = (UInt16)(i + 2);
+    }
+
+    reference_wrapper<ClassDefTable> classDefs[] = {
+        builder.createClassDef(BacktrackGlyph, 1, { 1 }),
+        builder.createClassDef(FirstGlyph, (UInt16)inputClasses.size(), inputClasses),
+        builder.createClassDef(LookaheadGlyph, 1, { 1 }),
+    };
+
+    for (size_t i = 0; i < RuleCount; i++) {
+        rules.push_back(rule_chain_context {
+            { 1 }, { 1, (Glyph)(i + 2) }, { 1 }, { {0, 1} }
+        });
+    }
+
+    compare("format 2, 40 rules, last matching", builder.createChainContext({ FirstGlyph }, classDefs, rules));
+}
+
+void ChainContextBenchmark::benchmarkCoverageRule()
+{
+    Builder builder;
+
+    compare("format 3, single rule",
+            builder.createChainContext({ { BacktrackGlyph } },
+                                       { { FirstGlyph }, { (Glyph)(SecondGlyph + RuleCount - 1) } },
+                                       { { LookaheadGlyph } }, { {0, 1} }));
+}
+
+void ChainContextBenchmark::run()
+{
+    header("Chain context matchers (per text)");
+    benchmarkGlyphRules();
+    benchmarkClassRules();
+    benchmarkCoverageRule();
+}
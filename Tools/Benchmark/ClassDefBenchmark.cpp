@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include <Source/SFAllocator.h>
+#include <Source/SFBase.h>
+#include <Source/SFGlyphMap.h>
+#include <Source/SFOpenType.h>
+}
+
+#include <Tester/OpenType/Builder.h>
+#include <Tester/OpenType/Writer.h>
+
+#include "Measure.h"
+#include "ClassDefBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+using namespace SheenFigure::Tester::OpenType;
+
+static const size_t QueryCount = 4096;
+static const size_t Iterations = 2000;
+
+static vector<SFGlyphID> makeQueries(SFGlyphID limit)
+{
+    vector<SFGlyphID> queries(QueryCount);
+    uint32_t seed = 0x9E3779B9;
+
+    for (size_t i = 0; i < QueryCount; i++) {
+        seed = seed * 1664525 + 1013904223;
+        queries[i] = (SFGlyphID)((seed >> 8) % limit);
+    }
+
+    return queries;
+}
+
+static void compare(const char *name, ClassDefTable &classDef, SFGlyphID limit)
+{
+    Writer writer;
+    writer.write(&classDef);
+
+    SFData table = writer.data();
+    SFAllocator allocator;
+    SFGlyphMap glyphMap;
+    SFAllocatorInitialize(&allocator, NULL);
+    SFGlyphMapInitializeWithClassDef(&glyphMap, &allocator, table, writer.size());
+
+    vector<SFGlyphID> queries = makeQueries(limit);
+    volatile SFUInteger sink = 0;
+
+    double baseline = measure(Iterations, [&]() {
+        SFUInteger sum = 0;
+        for (SFGlyphID glyph : queries) {
+            sum += SFOpenTypeSearchGlyphClass(table, glyph);
+        }
+        sink = sink + sum;
+    });
+    double current = measure(Iterations, [&]() {
+        SFUInteger sum = 0;
+        for (SFGlyphID glyph : queries) {
+            sum += SFGlyphMapGetValue(&glyphMap, glyph);
+        }
+        sink = sink + sum;
+    });
+
+    report(name, baseline / QueryCount, current / QueryCount);
+
+    SFGlyphMapFinalize(&glyphMap, &allocator);
+}
+
+ClassDefBenchmark::ClassDefBenchmark()
+{
+}
+
+void ClassDefBenchmark::benchmarkDenseClasses()
+{
+    Builder builder;
+    vector<class_range> ranges;
+
+    /* Kerning classes usually assign short runs of related glyphs to the same class. */
+    for (uint32_t glyph = 100; glyph < 1100; glyph += 4) {
+        ranges.push_back(class_range((Glyph)glyph, (Glyph)(glyph + 2), (UInt16)((glyph / 4) % 40 + 1)));
+    }
+
+    compare("dense classes (250 ranges in 1000 glyphs)", builder.createClassDef(ranges), 1200);
+}
+
+void ClassDefBenchmark::benchmarkSparseClasses()
+{
+    Builder builder;
+    vector<class_range> ranges;
+
+    for (uint32_t glyph = 100; glyph < 400; glyph++) {
+        ranges.push_back(class_range((Glyph)glyph, (Glyph)glyph, (UInt16)(glyph % 7 + 1)));
+    }
+    for (uint32_t glyph = 40000; glyph < 40400; glyph += 2) {
+        ranges.push_back(class_range((Glyph)glyph, (Glyph)glyph, (UInt16)(glyph % 3 + 1)));
+    }
+
+    compare("sparse classes (500 glyphs in 40400 glyphs)", builder.createClassDef(ranges), 40400);
+}
+
+void ClassDefBenchmark::run()
+{
+    header("Glyph class search (per glyph)");
+    benchmarkDenseClasses();
+    benchmarkSparseClasses();
+}
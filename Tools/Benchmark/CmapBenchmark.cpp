@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFFont.h>
+}
+
+#include "FontBuilder.h"
+#include "Measure.h"
+#include "Shaper.h"
+#include "CmapBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+
+typedef vector<uint8_t> Bytes;
+
+static const size_t GroupCount = 4000;
+static const size_t TextLength = 2000;
+static const size_t Iterations = 1000;
+
+static void appendUInt16(Bytes &bytes, uint32_t value)
+{
+    bytes.push_back((uint8_t)(value >> 8));
+    bytes.push_back((uint8_t)value);
+}
+
+static void appendUInt32(Bytes &bytes, uint32_t value)
+{
+    appendUInt16(bytes, value >> 16);
+    appendUInt16(bytes, value & 0xFFFF);
+}
+
+static uint32_t readUInt32(const uint8_t *data)
+{
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+/* Maps every other code point from U+4E00 and from U+20000 like a large CJK font. */
+static Bytes makeCmap()
+{
+    Bytes cmap;
+
+    appendUInt16(cmap, 0);
+    appendUInt16(cmap, 1);
+    appendUInt16(cmap, 3);
+    appendUInt16(cmap, 10);
+    appendUInt32(cmap, 12);
+
+    appendUInt16(cmap, 12);
+    appendUInt16(cmap, 0);
+    appendUInt32(cmap, (uint32_t)(16 + (GroupCount * 2 * 12)));
+    appendUInt32(cmap, 0);
+    appendUInt32(cmap, (uint32_t)(GroupCount * 2));
+
+    for (uint32_t base : { 0x4E00, 0x20000 }) {
+        for (size_t i = 0; i < GroupCount; i++) {
+            uint32_t codepoint = base + (uint32_t)(i * 2);
+
+            appendUInt32(cmap, codepoint);
+            appendUInt32(cmap, codepoint);
+            appendUInt32(cmap, (base == 0x4E00 ? 1 : 1 + GroupCount) + (uint32_t)i);
+        }
+    }
+
+    return cmap;
+}
+
+/* Searches the format 12 subtable in place, as a typical protocol implementation would. */
+static SFGlyphID getGlyphID(void *object, SFCodepoint codepoint)
+{
+    const uint8_t *subtable = reinterpret_cast<const Bytes *>(object)->data() + 12;
+    const uint8_t *groups = subtable + 16;
+    size_t low = 0;
+    size_t high = readUInt32(subtable + 12);
+
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        const uint8_t *group = groups + (mid * 12);
+
+        if (readUInt32(group + 4) < codepoint) {
+            low = mid + 1;
+        } else if (readUInt32(group) > codepoint) {
+            high = mid;
+        } else {
+            return (SFGlyphID)(readUInt32(group + 8) + (codepoint - readUInt32(group)));
+        }
+    }
+
+    return 0;
+}
+
+static const SFUInt8 *getTable(void *object, SFTag tag, SFUInteger *length)
+{
+    const Bytes *cmap = reinterpret_cast<const Bytes *>(object);
+
+    if (tag == SFTagMake('c', 'm', 'a', 'p')) {
+        *length = (SFUInteger)cmap->size();
+        return cmap->data();
+    }
+
+    return NULL;
+}
+
+static void compare(const char *name, const vector<SFCodepoint> &text)
+{
+    Bytes cmap = makeCmap();
+    FontBuilder fontBuilder;
+    SFFontExtendedProtocol protocol;
+
+    protocol.size = sizeof(SFFontExtendedProtocol);
+    protocol.base.finalize = NULL;
+    protocol.base.loadTable = NULL;
+    protocol.base.getGlyphIDForCodepoint = &getGlyphID;
+    protocol.base.getAdvanceForGlyph = NULL;
+    protocol.getTable = &getTable;
+    protocol.getGlyphIDsForCodepoints = NULL;
+    protocol.getAdvancesForGlyphs = NULL;
+    protocol.options = SFFontOptionNone;
+
+    SFFontRef callbackFont = SFFontCreateWithExtendedProtocol(&protocol, &cmap, NULL, NULL, 0);
+
+    protocol.base.getGlyphIDForCodepoint = NULL;
+    SFFontRef nativeFont = SFFontCreateWithExtendedProtocol(&protocol, &cmap, NULL, NULL, 0);
+
+    Shaper callbackShaper(fontBuilder, callbackFont);
+    Shaper nativeShaper(fontBuilder, nativeFont);
+
+    double baseline = measure(Iterations, [&]() {
+        callbackShaper.shape(text);
+    });
+    double current = measure(Iterations, [&]() {
+        nativeShaper.shape(text);
+    });
+
+    report(name, baseline, current);
+
+    SFFontRelease(callbackFont);
+    SFFontRelease(nativeFont);
+}
+
+CmapBenchmark::CmapBenchmark()
+{
+}
+
+void CmapBenchmark::benchmarkPlaneText()
+{
+    vector<SFCodepoint> text(TextLength);
+    uint32_t seed = 0x12345678;
+
+    for (size_t i = 0; i < TextLength; i++) {
+        seed = seed * 1664525 + 1013904223;
+        text[i] = 0x4E00 + ((seed >> 8) % (GroupCount * 2));
+    }
+
+    compare("2000 scattered CJK code points", text);
+}
+
+void CmapBenchmark::benchmarkSupplementaryText()
+{
+    vector<SFCodepoint> text(TextLength);
+
+    /* Repeat a handful of supplementary ideographs as running text does. */
+    for (size_t i = 0; i < TextLength; i++) {
+        text[i] = 0x20000 + (SFCodepoint)((i % 12) * 2);
+    }
+
+    compare("2000 repeated supplementary code points", text);
+}
+
+void CmapBenchmark::run()
+{
+    header("Glyph discovery (per text)");
+    benchmarkPlaneText();
+    benchmarkSupplementaryText();
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <set>
+#include <vector>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFCommon.h>
+#include <Source/SFFont.h>
+#include <Source/SFFontCache.h>
+#include <Source/SFGSUB.h>
+#include <Source/SFOpenType.h>
+}
+
+#include <Tester/OpenType/Builder.h>
+
+#include "FontBuilder.h"
+#include "Measure.h"
+#include "CoverageBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+using namespace SheenFigure::Tester::OpenType;
+
+static const size_t QueryCount = 4096;
+static const size_t Iterations = 2000;
+
+static SFData getFirstCoverage(SFFontRef font)
+{
+    SFData gsub = font->tables.gsub;
+    SFData lookupList = SFData_Subdata(gsub, SFGSUB_LookupListOffset(gsub));
+    SFData lookup = SFData_Subdata(lookupList, SFLookupList_LookupOffset(lookupList, 0));
+    SFData subtable = SFData_Subdata(lookup, SFLookup_SubtableOffset(lookup, 0));
+
+    return SFData_Subdata(subtable, SFSingleSubstF1_CoverageOffset(subtable));
+}
+
+static vector<SFGlyphID> makeQueries(SFGlyphID limit)
+{
+    vector<SFGlyphID> queries(QueryCount);
+    uint32_t seed = 0x12345678;
+
+    for (size_t i = 0; i < QueryCount; i++) {
+        seed = seed * 1664525 + 1013904223;
+        queries[i] = (SFGlyphID)((seed >> 8) % limit);
+    }
+
+    return queries;
+}
+
+static void compare(const char *name, const set<Glyph> &glyphs, SFGlyphID limit)
+{
+    Builder builder;
+    FontBuilder fontBuilder;
+    fontBuilder.addSubstitution(builder.createSingleSubst(glyphs, 1));
+
+    SFFontRef font = fontBuilder.build();
+    SFFontCacheRef fontCache = &font->cache;
+    SFData coverage = getFirstCoverage(font);
+    vector<SFGlyphID> queries = makeQueries(limit);
+    volatile SFUInteger sink = 0;
+
+    double baseline = measure(Iterations, [&]() {
+        SFUInteger sum = 0;
+        for (SFGlyphID glyph : queries) {
+            sum += SFOpenTypeSearchCoverageIndex(coverage, glyph);
+        }
+        sink = sink + sum;
+    });
+    double current = measure(Iterations, [&]() {
+        SFUInteger sum = 0;
+        for (SFGlyphID glyph : queries) {
+            sum += SFFontCacheSearchCoverageIndex(fontCache, coverage, glyph);
+        }
+        sink = sink + sum;
+    });
+
+    report(name, baseline / QueryCount, current / QueryCount);
+
+    SFFontRelease(font);
+}
+
+CoverageBenchmark::CoverageBenchmark()
+{
+}
+
+void CoverageBenchmark::benchmarkDenseCoverage()
+{
+    set<Glyph> glyphs;
+    for (Glyph glyph = 100; glyph < 1100; glyph += 2) {
+        glyphs.insert(glyph);
+    }
+
+    compare("dense coverage (500 of 1000 glyphs)", glyphs, 1200);
+}
+
+void CoverageBenchmark::benchmarkSparseCoverage()
+{
+    set<Glyph> glyphs;
+    for (uint32_t glyph = 7; glyph < 60000; glyph += 29) {
+        glyphs.insert((Glyph)glyph);
+    }
+
+    compare("sparse coverage (2069 of 60000 glyphs)", glyphs, 60000);
+}
+
+void CoverageBenchmark::run()
+{
+    header("Coverage search (per glyph)");
+    benchmarkDenseCoverage();
+    benchmarkSparseCoverage();
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFFont.h>
+}
+
+#include <Tester/OpenType/Builder.h>
+
+#include "FontBuilder.h"
+#include "Measure.h"
+#include "Shaper.h"
+#include "CursiveBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+using namespace SheenFigure::Tester::OpenType;
+
+static const Glyph FirstGlyph = 100;
+static const size_t GlyphCount = 20;
+static const size_t ShortLength = 100000;
+static const size_t LongLength = 1000000;
+static const size_t Iterations = 5;
+
+/**
+ * Makes a text of the given length whose glyphs are all cursively connected in a single chain.
+ */
+static vector<SFCodepoint> makeText(size_t length)
+{
+    vector<SFCodepoint> text(length);
+
+    for (size_t i = 0; i < length; i++) {
+        text[i] = (SFCodepoint)(FirstGlyph + (i % GlyphCount));
+    }
+
+    return text;
+}
+
+/**
+ * Compares a chain of a million glyphs against ten chains of a hundred thousand glyphs, so that a
+ * speedup near one means the chains are resolved in linear time without growing the stack.
+ */
+static void compare(const char *name, LookupFlag lookupFlag, SFTextDirection direction)
+{
+    Builder builder;
+    FontBuilder fontBuilder;
+    map<Glyph, pair<AnchorTable *, AnchorTable *>> rules;
+
+    for (size_t i = 0; i < GlyphCount; i++) {
+        rules[(Glyph)(FirstGlyph + i)] = {
+            &builder.createAnchor(0, (Int16)(10 * i)), &builder.createAnchor(500, (Int16)(20 * i))
+        };
+    }
+
+    fontBuilder.addPositioning(builder.createCursivePos(rules), lookupFlag);
+
+    SFFontRef font = fontBuilder.build();
+    Shaper shaper(fontBuilder, font, direction);
+    vector<SFCodepoint> shortText = makeText(ShortLength);
+    vector<SFCodepoint> longText = makeText(LongLength);
+
+    double baseline = measure(Iterations, [&]() {
+        shaper.shape(shortText);
+    }) * (double)(LongLength / ShortLength);
+
+    double current = measure(Iterations, [&]() {
+        shaper.shape(longText);
+    });
+
+    report(name, baseline, current);
+
+    SFFontRelease(font);
+}
+
+CursiveBenchmark::CursiveBenchmark()
+{
+}
+
+void CursiveBenchmark::benchmarkLeftToRightChain()
+{
+    compare("1M glyph chain, left-to-right", (LookupFlag)0, SFTextDirectionLeftToRight);
+}
+
+void CursiveBenchmark::benchmarkRightToLeftChain()
+{
+    compare("1M glyph chain, right-to-left", LookupFlag::RightToLeft, SFTextDirectionRightToLeft);
+}
+
+void CursiveBenchmark::run()
+{
+    header("Cursive chains (10 x 100k glyphs vs 1M glyphs)");
+    benchmarkLeftToRightChain();
+    benchmarkRightToLeftChain();
+}
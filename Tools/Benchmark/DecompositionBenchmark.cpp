@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFFont.h>
+}
+
+#include <Tester/OpenType/Builder.h>
+
+#include "FontBuilder.h"
+#include "Measure.h"
+#include "Shaper.h"
+#include "DecompositionBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+using namespace SheenFigure::Tester::OpenType;
+
+static const Glyph FirstGlyph = 100;
+static const size_t GlyphCount = 20;
+static const size_t ShortLength = 10000;
+static const size_t LongLength = 100000;
+static const size_t Iterations = 20;
+
+/**
+ * Makes a text whose every character decomposes into the given number of glyphs, so that the
+ * shaped album holds the given number of glyphs.
+ */
+static vector<SFCodepoint> makeText(size_t glyphLength, size_t components)
+{
+    vector<SFCodepoint> text(glyphLength / components);
+
+    for (size_t i = 0; i < text.size(); i++) {
+        text[i] = (SFCodepoint)(FirstGlyph + (i % GlyphCount));
+    }
+
+    return text;
+}
+
+/**
+ * Compares a long run against ten short runs of the same total length, so that a speedup near
+ * one means the album grows linearly with the number of decomposed glyphs.
+ */
+static void compare(const char *name, size_t components)
+{
+    Builder builder;
+    FontBuilder fontBuilder;
+    map<Glyph, vector<Glyph>> sequences;
+
+    for (size_t i = 0; i < GlyphCount; i++) {
+        vector<Glyph> sequence;
+
+        for (size_t j = 0; j < components; j++) {
+            sequence.push_back((Glyph)(1000 + (i * components) + j));
+        }
+
+        sequences[(Glyph)(FirstGlyph + i)] = sequence;
+    }
+
+    fontBuilder.addSubstitution(builder.createMultipleSubst(sequences));
+
+    SFFontRef font = fontBuilder.build();
+    Shaper shaper(fontBuilder, font);
+    vector<SFCodepoint> shortText = makeText(ShortLength, components);
+    vector<SFCodepoint> longText = makeText(LongLength, components);
+
+    double baseline = measure(Iterations, [&]() {
+        shaper.shape(shortText);
+    }) * (double)(LongLength / ShortLength);
+
+    double current = measure(Iterations, [&]() {
+        shaper.shape(longText);
+    });
+
+    report(name, baseline, current);
+
+    SFFontRelease(font);
+}
+
+DecompositionBenchmark::DecompositionBenchmark()
+{
+}
+
+void DecompositionBenchmark::benchmarkPairDecomposition()
+{
+    compare("100k glyphs, two per character", 2);
+}
+
+void DecompositionBenchmark::benchmarkTripleDecomposition()
+{
+    compare("100k glyphs, three per character", 3);
+}
+
+void DecompositionBenchmark::run()
+{
+    header("Multiple substitutions (10 x 10k glyphs vs 100k glyphs)");
+    benchmarkPairDecomposition();
+    benchmarkTripleDecomposition();
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFFont.h>
+#include <Source/SFFontCache.h>
+}
+
+#include <Tester/OpenType/Builder.h>
+
+#include "FontBuilder.h"
+#include "Measure.h"
+#include "Shaper.h"
+#include "DigestBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+using namespace SheenFigure::Tester::OpenType;
+
+static const size_t LookupCount = 60;
+static const size_t TextLength = 2000;
+static const size_t Iterations = 200;
+
+static vector<SFCodepoint> makeText(SFCodepoint extra, size_t interval)
+{
+    vector<SFCodepoint> text(TextLength);
+
+    for (size_t i = 0; i < TextLength; i++) {
+        text[i] = (interval && (i % interval) == 0 ? extra : (SFCodepoint)('a' + (i % 26)));
+    }
+
+    return text;
+}
+
+static void compare(const char *name, const vector<SFCodepoint> &text)
+{
+    Builder builder;
+    FontBuilder fontBuilder;
+
+    /* Each lookup substitutes its own block of glyphs lying far from the latin letters. */
+    for (size_t i = 0; i < LookupCount; i++) {
+        set<Glyph> glyphs;
+        for (size_t j = 0; j < 20; j++) {
+            glyphs.insert((Glyph)(1000 + (i * 20) + j));
+        }
+
+        fontBuilder.addSubstitution(builder.createSingleSubst(glyphs, 1));
+    }
+
+    SFFontRef font = fontBuilder.build();
+    Shaper shaper(fontBuilder, font);
+    SFLookupDigests digests = font->cache.gsubDigests;
+
+    /* Run without digests for the baseline. */
+    font->cache.gsubDigests.count = 0;
+    double baseline = measure(Iterations, [&]() {
+        shaper.shape(text);
+    });
+
+    font->cache.gsubDigests = digests;
+    double current = measure(Iterations, [&]() {
+        shaper.shape(text);
+    });
+
+    report(name, baseline, current);
+
+    SFFontRelease(font);
+}
+
+DigestBenchmark::DigestBenchmark()
+{
+}
+
+void DigestBenchmark::benchmarkMissingLookups()
+{
+    compare("60 lookups missing all 2000 glyphs", makeText(0, 0));
+}
+
+void DigestBenchmark::benchmarkSparseLookups()
+{
+    compare("60 lookups hitting 1 of 50 glyphs", makeText(1010, 50));
+}
+
+void DigestBenchmark::run()
+{
+    header("Lookup digests (per text)");
+    benchmarkMissingLookups();
+    benchmarkSparseLookups();
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <Headers/SFFont.h>
+}
+
+#include <Tester/OpenType/Base.h>
+#include <Tester/OpenType/Common.h>
+#include <Tester/OpenType/GPOS.h>
+#include <Tester/OpenType/GSUB.h>
+#include <Tester/OpenType/Writer.h>
+
+#include "FontBuilder.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+using namespace SheenFigure::Tester::OpenType;
+
+FontBuilder::FontBuilder()
+    : m_gsub(make_shared<Writer>())
+    , m_gpos(make_shared<Writer>())
+{
+}
+
+void FontBuilder::addSubstitution(LookupSubtable &subtable, LookupFlag lookupFlag)
+{
+    m_substitutions.push_back({ &subtable, lookupFlag });
+}
+
+void FontBuilder::addPositioning(LookupSubtable &subtable, LookupFlag lookupFlag)
+{
+    m_positionings.push_back({ &subtable, lookupFlag });
+}
+
+void FontBuilder::write(Writer &writer, const vector<Lookup> &lookups, bool positioning)
+{
+    UInt16 lookupCount = (UInt16)lookups.size();
+    vector<LookupTable> lookupTables(lookupCount);
+    vector<UInt16> lookupIndexes(lookupCount);
+
+    for (UInt16 i = 0; i < lookupCount; i++) {
+        lookupTables[i].lookupType = lookups[i].subtable->lookupType();
+        lookupTables[i].lookupFlag = lookups[i].lookupFlag;
+        lookupTables[i].subTableCount = 1;
+        lookupTables[i].subtables = lookups[i].subtable;
+        lookupTables[i].markFilteringSet = 0;
+        lookupIndexes[i] = i;
+    }
+
+    LookupListTable lookupList;
+    lookupList.lookupCount = lookupCount;
+    lookupList.lookupTables = lookupTables.data();
+
+    FeatureTable feature;
+    feature.featureParams = 0;
+    feature.lookupCount = lookupCount;
+    feature.lookupListIndex = lookupIndexes.data();
+
+    FeatureRecord featureRecord;
+    memcpy(&featureRecord.featureTag, "test", 4);
+    featureRecord.feature = &feature;
+
+    FeatureListTable featureList;
+    featureList.featureCount = 1;
+    featureList.featureRecord = &featureRecord;
+
+    UInt16 featureIndex[] = { 0 };
+
+    LangSysTable langSys;
+    langSys.lookupOrder = 0;
+    langSys.reqFeatureIndex = 0xFFFF;
+    langSys.featureCount = 1;
+    langSys.featureIndex = featureIndex;
+
+    ScriptTable script;
+    script.defaultLangSys = &langSys;
+    script.langSysCount = 0;
+    script.langSysRecord = NULL;
+
+    ScriptRecord scriptRecord;
+    memcpy(&scriptRecord.scriptTag, "dflt", 4);
+    scriptRecord.script = &script;
+
+    ScriptListTable scriptList;
+    scriptList.scriptCount = 1;
+    scriptList.scriptRecord = &scriptRecord;
+
+    if (positioning) {
+        GPOS gpos;
+        gpos.version = 0x00010000;
+        gpos.scriptList = &scriptList;
+        gpos.featureList = &featureList;
+        gpos.lookupList = &lookupList;
+
+        writer.write(&gpos);
+    } else {
+        GSUB gsub;
+        gsub.version = 0x00010000;
+        gsub.scriptList = &scriptList;
+        gsub.featureList = &featureList;
+        gsub.lookupList = &lookupList;
+
+        writer.write(&gsub);
+    }
+}
+
+Writer *FontBuilder::writerForTable(SFTag tag) const
+{
+    if (tag == SFTagMake('G', 'S', 'U', 'B') && !m_substitutions.empty()) {
+        return m_gsub.get();
+    }
+    if (tag == SFTagMake('G', 'P', 'O', 'S') && !m_positionings.empty()) {
+        return m_gpos.get();
+    }
+
+    return nullptr;
+}
+
+void FontBuilder::loadTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length)
+{
+    FontBuilder *builder = reinterpret_cast<FontBuilder *>(object);
+    Writer *writer = builder->writerForTable(tag);
+
+    if (writer) {
+        if (buffer) {
+            memcpy(buffer, writer->data(), writer->size());
+        }
+        if (length) {
+            *length = (SFUInteger)writer->size();
+        }
+    }
+}
+
+const SFUInt8 *FontBuilder::getTable(void *object, SFTag tag, SFUInteger *length)
+{
+    FontBuilder *builder = reinterpret_cast<FontBuilder *>(object);
+    Writer *writer = builder->writerForTable(tag);
+
+    if (writer) {
+        *length = (SFUInteger)writer->size();
+        return writer->data();
+    }
+
+    return NULL;
+}
+
+SFGlyphID FontBuilder::getGlyphID(void *object, SFCodepoint codepoint)
+{
+    return (SFGlyphID)codepoint;
+}
+
+SFAdvance FontBuilder::getAdvance(void *object, SFFontLayout fontLayout, SFGlyphID glyphID)
+{
+    return 100;
+}
+
+SFFontRef FontBuilder::build()
+{
+    m_gsub = make_shared<Writer>();
+    m_gpos = make_shared<Writer>();
+
+    if (!m_substitutions.empty()) {
+        write(*m_gsub, m_substitutions, false);
+    }
+    if (!m_positionings.empty()) {
+        write(*m_gpos, m_positionings, true);
+    }
+
+    return create();
+}
+
+SFFontRef FontBuilder::create(const SFUInt8 *cacheData, SFUInteger cacheLength, bool borrowTables,
+                              SFFontOptions options)
+{
+    SFFontExtendedProtocol protocol;
+    protocol.size = sizeof(SFFontExtendedProtocol);
+    protocol.base.finalize = NULL;
+    protocol.base.loadTable = &loadTable;
+    protocol.base.getGlyphIDForCodepoint = &getGlyphID;
+    protocol.base.getAdvanceForGlyph = &getAdvance;
+    protocol.getTable = (borrowTables ? &getTable : NULL);
+    protocol.getGlyphIDsForCodepoints = NULL;
+    protocol.getAdvancesForGlyphs = NULL;
+    protocol.options = options;
+
+    return SFFontCreateWithExtendedProtocol(&protocol, this, NULL, cacheData, cacheLength);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __SHEENFIGURE_BENCHMARK__FONT_BUILDER_H
+#define __SHEENFIGURE_BENCHMARK__FONT_BUILDER_H
+
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <Headers/SFFont.h>
+}
+
+#include <Tester/OpenType/Base.h>
+#include <Tester/OpenType/Common.h>
+#include <Tester/OpenType/Writer.h>
+
+namespace SheenFigure {
+namespace Benchmark {
+
+/**
+ * Writes synthetic open type tables having all lookups in a single feature and creates a font
+ * from them.
+ */
+class FontBuilder {
+public:
+    FontBuilder();
+
+    void addSubstitution(Tester::OpenType::LookupSubtable &subtable,
+                         Tester::OpenType::LookupFlag lookupFlag = (Tester::OpenType::LookupFlag)0);
+    void addPositioning(Tester::OpenType::LookupSubtable &subtable,
+                        Tester::OpenType::LookupFlag lookupFlag = (Tester::OpenType::LookupFlag)0);
+
+    size_t substitutionCount() const { return m_substitutions.size(); }
+    size_t positioningCount() const { return m_positionings.size(); }
+
+    /**
+     * Writes the tables and creates a font from them. The builder must outlive the font.
+     */
+    SFFontRef build();
+
+    /**
+     * Creates another font from the tables written by the last build, optionally reusing the
+     * cache data of a previously created font. The font copies the tables unless it is asked to
+     * borrow them in place, and compiles them unless given other options.
+     */
+    SFFontRef create(const SFUInt8 *cacheData = NULL, SFUInteger cacheLength = 0, bool borrowTables = false,
+                     SFFontOptions options = SFFontOptionCompiledTables);
+
+private:
+    struct Lookup {
+        Tester::OpenType::LookupSubtable *subtable;
+        Tester::OpenType::LookupFlag lookupFlag;
+    };
+
+    std::vector<Lookup> m_substitutions;
+    std::vector<Lookup> m_positionings;
+    std::shared_ptr<Tester::OpenType::Writer> m_gsub;
+    std::shared_ptr<Tester::OpenType::Writer> m_gpos;
+
+    Tester::OpenType::Writer *writerForTable(SFTag tag) const;
+
+    static void loadTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length);
+    static const SFUInt8 *getTable(void *object, SFTag tag, SFUInteger *length);
+    static SFGlyphID getGlyphID(void *object, SFCodepoint codepoint);
+    static SFAdvance getAdvance(void *object, SFFontLayout fontLayout, SFGlyphID glyphID);
+
+    static void write(Tester::OpenType::Writer &writer, const std::vector<Lookup> &lookups, bool positioning);
+};
+
+}
+}
+
+#endif
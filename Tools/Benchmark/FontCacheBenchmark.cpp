@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFFont.h>
+#include <Source/SFFontCache.h>
+}
+
+#include <Tester/OpenType/Builder.h>
+
+#include "FontBuilder.h"
+#include "Measure.h"
+#include "FontCacheBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+using namespace SheenFigure::Tester::OpenType;
+
+static const size_t LookupCount = 60;
+static const size_t Iterations = 2000;
+
+FontCacheBenchmark::FontCacheBenchmark()
+{
+}
+
+void FontCacheBenchmark::benchmarkFontCreation()
+{
+    Builder builder;
+    FontBuilder fontBuilder;
+    uint32_t seed = 0x12345678;
+
+    /* Add lookups having sparse coverages of different glyphs, keeping the offsets in 16 bits. */
+    for (size_t i = 0; i < LookupCount; i++) {
+        set<Glyph> glyphs;
+
+        for (size_t j = 0; j < 300; j++) {
+            seed = seed * 1664525 + 1013904223;
+            glyphs.insert((Glyph)((seed >> 8) % 60000));
+        }
+
+        fontBuilder.addSubstitution(builder.createSingleSubst(glyphs, 0));
+    }
+
+    SFFontRef font = fontBuilder.build();
+    SFUInteger length = 0;
+    SFFontWriteCache(font, NULL, &length);
+
+    /* Keep the cache data aligned as a memory mapped file would be. */
+    vector<SFUInt32> cacheData((length + 3) / 4);
+    SFFontWriteCache(font, (SFUInt8 *)cacheData.data(), NULL);
+    SFFontRelease(font);
+
+    double baseline = measure(Iterations, [&]() {
+        SFFontRelease(fontBuilder.create());
+    });
+    double current = measure(Iterations, [&]() {
+        SFFontRelease(fontBuilder.create((SFUInt8 *)cacheData.data(), length));
+    });
+
+    report("font creation (60 sparse coverages)", baseline, current);
+
+    /* Isolate the cost of copying the tables by reusing the cache data in both cases. */
+    baseline = measure(Iterations, [&]() {
+        SFFontRelease(fontBuilder.create((SFUInt8 *)cacheData.data(), length));
+    });
+    current = measure(Iterations, [&]() {
+        SFFontRelease(fontBuilder.create((SFUInt8 *)cacheData.data(), length, true));
+    });
+
+    report("cached font creation, borrowed tables", baseline, current);
+
+    /* Show what compiling the tables costs over using them raw. */
+    baseline = measure(Iterations, [&]() {
+        SFFontRelease(fontBuilder.create(NULL, 0, true, SFFontOptionNone));
+    });
+    current = measure(Iterations, [&]() {
+        SFFontRelease(fontBuilder.create(NULL, 0, true));
+    });
+
+    report("font creation, compiled over raw tables", baseline, current);
+}
+
+void FontCacheBenchmark::benchmarkImageRebuild()
+{
+    Builder builder;
+    FontBuilder fontBuilder;
+    ValueRecord &kern = builder.createValueRecord({ 0, 0, -50, 0 });
+    map<vector<Glyph>, Glyph> ligatures;
+    vector<rule_chain_context> rules;
+    vector<pair_rule> pairs;
+
+    /* Add the kinds of lookups having native subtables, which are the costliest ones to build. */
+    for (Glyph i = 0; i < 20; i++) {
+        for (Glyph j = 0; j < 10; j++) {
+            for (Glyph k = 0; k < 10; k++) {
+                ligatures[{ (Glyph)(100 + i), (Glyph)(200 + j), (Glyph)(300 + k) }] = (Glyph)(1000 + (i * 100) + (j * 10) + k);
+            }
+        }
+    }
+    for (Glyph i = 0; i < 40; i++) {
+        rules.push_back(rule_chain_context { { 50 }, { 100, (Glyph)(200 + i) }, { 60 }, { {0, 1} } });
+    }
+    for (Glyph i = 0; i < 300; i++) {
+        for (Glyph j = 0; j < 300; j += 5) {
+            pairs.push_back(pair_rule { (Glyph)(100 + i), (Glyph)(100 + j), kern, kern });
+        }
+    }
+
+    fontBuilder.addSubstitution(builder.createLigatureSubst(ligatures));
+    fontBuilder.addSubstitution(builder.createChainContext(rules));
+    fontBuilder.addPositioning(builder.createPairPos(pairs));
+
+    SFFontRef font = fontBuilder.build();
+    SFUInteger length = 0;
+    SFFontWriteCache(font, NULL, &length);
+
+    vector<SFUInt32> cacheData((length + 3) / 4);
+    SFFontWriteCache(font, (SFUInt8 *)cacheData.data(), NULL);
+
+    SFData tables[] = { font->tables.gdef, font->tables.gsub, font->tables.gpos };
+    SFUInteger lengths[] = { font->tables.gdefLength, font->tables.gsubLength, font->tables.gposLength };
+
+    /* Compare loading the image alone with loading the tables over it, which rebuilds only the lookups. */
+    double baseline = measure(Iterations, [&]() {
+        SFFontCache fontCache;
+        SFFontCacheInitialize(&fontCache, NULL);
+        SFFontCacheLoadImage(&fontCache, tables, lengths, 3, (SFUInt8 *)cacheData.data(), length);
+        SFFontCacheFinalize(&fontCache);
+    });
+    double current = measure(Iterations, [&]() {
+        SFFontCache fontCache;
+        SFFontCacheInitialize(&fontCache, NULL);
+        SFFontCacheLoadImage(&fontCache, tables, lengths, 3, (SFUInt8 *)cacheData.data(), length);
+        SFFontCacheLoadGDEF(&fontCache, tables[0], lengths[0]);
+        SFFontCacheLoadGSUB(&fontCache, tables[1], lengths[1]);
+        SFFontCacheLoadGPOS(&fontCache, tables[2], lengths[2]);
+        SFFontCacheFinalize(&fontCache);
+    });
+
+    report("image load, rebuilding the rest", baseline, current);
+
+    SFFontRelease(font);
+}
+
+void FontCacheBenchmark::run()
+{
+    header("Font creation");
+    benchmarkFontCreation();
+    benchmarkImageRebuild();
+}
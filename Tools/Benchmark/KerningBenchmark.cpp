@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFFont.h>
+#include <Source/SFFontCache.h>
+}
+
+#include <Tester/OpenType/Builder.h>
+
+#include "FontBuilder.h"
+#include "Measure.h"
+#include "Shaper.h"
+#include "KerningBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+using namespace SheenFigure::Tester::OpenType;
+
+static const Glyph FirstGlyph = 100;
+static const size_t GlyphCount = 300;
+static const size_t TextLength = 2000;
+static const size_t Iterations = 200;
+
+static vector<SFCodepoint> makeText()
+{
+    vector<SFCodepoint> text(TextLength);
+
+    for (size_t i = 0; i < TextLength; i++) {
+        text[i] = (SFCodepoint)(FirstGlyph + ((i * 7) % GlyphCount));
+    }
+
+    return text;
+}
+
+static void compare(const char *name, LookupSubtable &pairPos)
+{
+    FontBuilder fontBuilder;
+    fontBuilder.addPositioning(pairPos);
+
+    SFFontRef font = fontBuilder.build();
+    /* Search the raw subtables for the baseline. */
+    SFFontRef rawFont = fontBuilder.create(NULL, 0, false, SFFontOptionNone);
+    Shaper shaper(fontBuilder, font);
+    Shaper rawShaper(fontBuilder, rawFont);
+    vector<SFCodepoint> text = makeText();
+
+    double baseline = measure(Iterations, [&]() {
+        rawShaper.shape(text);
+    });
+    double current = measure(Iterations, [&]() {
+        shaper.shape(text);
+    });
+
+    report(name, baseline, current);
+
+    SFFontRelease(rawFont);
+    SFFontRelease(font);
+}
+
+KerningBenchmark::KerningBenchmark()
+{
+}
+
+void KerningBenchmark::benchmarkGlyphPairs()
+{
+    Builder builder;
+    ValueRecord &kern = builder.createValueRecord({ 0, 0, -50, 0 });
+    vector<pair_rule> rules;
+
+    /* Kern every glyph against every fifth glyph. */
+    for (size_t i = 0; i < GlyphCount; i++) {
+        for (size_t j = 0; j < GlyphCount; j += 5) {
+            rules.push_back(pair_rule { (Glyph)(FirstGlyph + i), (Glyph)(FirstGlyph + j), kern, kern });
+        }
+    }
+
+    compare("format 1, 300 x 60 glyph pairs", builder.createPairPos(rules));
+}
+
+void KerningBenchmark::benchmarkClassPairs()
+{
+    Builder builder;
+    ValueRecord &kern = builder.createValueRecord({ 0, 0, -50, 0 });
+    vector<Glyph> glyphs;
+    vector<class_range> ranges;
+    vector<pair_rule> rules;
+
+    /* Divide the glyphs into 30 classes of 10 consecutive glyphs each. */
+    for (size_t i = 0; i < GlyphCount; i++) {
+        glyphs.push_back((Glyph)(FirstGlyph + i));
+    }
+    for (size_t i = 0; i < GlyphCount / 10; i++) {
+        Glyph start = (Glyph)(FirstGlyph + (i * 10));
+        ranges.push_back(class_range(start, (Glyph)(start + 9), (UInt16)(i + 1)));
+    }
+    for (UInt16 class1 = 1; class1 <= GlyphCount / 10; class1++) {
+        for (UInt16 class2 = 1; class2 <= GlyphCount / 10; class2++) {
+            rules.push_back(pair_rule { class1, class2, kern, kern });
+        }
+    }
+
+    ClassDefTable &classDef = builder.createClassDef(ranges);
+    reference_wrapper<ClassDefTable> classDefs[2] = { classDef, classDef };
+
+    compare("format 2, 30 x 30 class pairs", builder.createPairPos(glyphs, classDefs, rules));
+}
+
+void KerningBenchmark::run()
+{
+    header("Pair indexes (per text)");
+    benchmarkGlyphPairs();
+    benchmarkClassPairs();
+}
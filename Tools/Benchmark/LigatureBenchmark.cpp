@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFFont.h>
+#include <Source/SFFontCache.h>
+}
+
+#include <Tester/OpenType/Builder.h>
+
+#include "FontBuilder.h"
+#include "Measure.h"
+#include "Shaper.h"
+#include "LigatureBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+using namespace SheenFigure::Tester::OpenType;
+
+static const Glyph FirstGlyph = 100;
+static const Glyph SecondGlyph = 200;
+static const Glyph ThirdGlyph = 300;
+static const size_t FirstCount = 20;
+static const size_t SecondCount = 10;
+static const size_t ThirdCount = 10;
+static const size_t TextLength = 2001;
+static const size_t Iterations = 200;
+
+/**
+ * Makes a text of three glyph sequences, each starting with a different first glyph and followed
+ * by the given components.
+ */
+static vector<SFCodepoint> makeText(Glyph second, Glyph third)
+{
+    vector<SFCodepoint> text(TextLength);
+
+    for (size_t i = 0; i < TextLength; i += 3) {
+        text[i] = (SFCodepoint)(FirstGlyph + ((i / 3) % FirstCount));
+        text[i + 1] = second;
+        text[i + 2] = third;
+    }
+
+    return text;
+}
+
+static void compare(const char *name, const vector<SFCodepoint> &text)
+{
+    Builder builder;
+    FontBuilder fontBuilder;
+    map<vector<Glyph>, Glyph> ligatures;
+
+    /* Give each first glyph 100 ligatures of three components. */
+    for (size_t i = 0; i < FirstCount; i++) {
+        for (size_t j = 0; j < SecondCount; j++) {
+            for (size_t k = 0; k < ThirdCount; k++) {
+                vector<Glyph> components = {
+                    (Glyph)(FirstGlyph + i), (Glyph)(SecondGlyph + j), (Glyph)(ThirdGlyph + k)
+                };
+                ligatures[components] = (Glyph)(1000 + (j * ThirdCount) + k);
+            }
+        }
+    }
+
+    fontBuilder.addSubstitution(builder.createLigatureSubst(ligatures));
+
+    SFFontRef font = fontBuilder.build();
+    Shaper shaper(fontBuilder, font);
+    SFUInteger trieCount = font->cache._ligatureTrieMap.count;
+
+    /* Run without ligature tries for the baseline. */
+    font->cache._ligatureTrieMap.count = 0;
+    double baseline = measure(Iterations, [&]() {
+        shaper.shape(text);
+    });
+
+    font->cache._ligatureTrieMap.count = trieCount;
+    double current = measure(Iterations, [&]() {
+        shaper.shape(text);
+    });
+
+    report(name, baseline, current);
+
+    SFFontRelease(font);
+}
+
+LigatureBenchmark::LigatureBenchmark()
+{
+}
+
+void LigatureBenchmark::benchmarkPreferredLigatures()
+{
+    compare("100 ligatures per set, first matching", makeText(SecondGlyph, ThirdGlyph));
+}
+
+void LigatureBenchmark::benchmarkLastLigatures()
+{
+    compare("100 ligatures per set, last matching",
+            makeText(SecondGlyph + SecondCount - 1, ThirdGlyph + ThirdCount - 1));
+}
+
+void LigatureBenchmark::run()
+{
+    header("Ligature tries (per text)");
+    benchmarkPreferredLigatures();
+    benchmarkLastLigatures();
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <vector>
+
+extern "C" {
+#include <Source/SFAlbum.h>
+#include <Source/SFBase.h>
+#include <Source/SFCodepoints.h>
+#include <Source/SFFontCache.h>
+#include <Source/SFLocator.h>
+}
+
+#include "Measure.h"
+#include "LocatorBenchmark.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+
+static const size_t TextLength = 2000;
+static const size_t Iterations = 500;
+
+static const SFCodepoint CodepointArray[] = { 'A' };
+static const SBCodepointSequence CodepointSequence = { SBStringEncodingUTF32, (void *)CodepointArray, 1 };
+
+/**
+ * Creates an arranging album of a text in which each base glyph carries two marks.
+ */
+static SFAlbumRef createAlbum(SFCodepoints *codepoints)
+{
+    SFAlbumRef album = SFAlbumCreate();
+
+    SFCodepointsInitialize(codepoints, &CodepointSequence, SFFalse);
+    SFAlbumReset(album, codepoints, 1);
+    SFAlbumBeginFilling(album);
+    SFAlbumReserveGlyphs(album, 0, TextLength);
+
+    for (SFUInteger i = 0; i < TextLength; i++) {
+        SFAlbumSetGlyph(album, i, (SFGlyphID)(i % 3));
+        SFAlbumSetFeatureMask(album, i, 0);
+        SFAlbumSetTraits(album, i, (i % 3) ? SFGlyphTraitMark : SFGlyphTraitBase);
+        SFAlbumSetAssociation(album, i, i);
+    }
+
+    SFAlbumEndFilling(album);
+    SFAlbumBeginArranging(album);
+
+    return album;
+}
+
+/**
+ * Runs a lookup over the whole album, reaching the glyph following each located one in the way of
+ * pair adjustment if asked.
+ */
+static SFUInteger runLookup(SFLocatorRef locator, SFLookupFlag lookupFlag, bool isPaired)
+{
+    SFUInteger checksum = 0;
+
+    SFLocatorReset(locator, 0, TextLength);
+    SFLocatorSetLookupFlag(locator, lookupFlag);
+
+    while (SFLocatorMoveNext(locator)) {
+        if (isPaired && locator->index + 1 < TextLength) {
+            checksum += SFLocatorGetAfter(locator, locator->index);
+        }
+    }
+
+    return checksum;
+}
+
+/**
+ * Compares a positioning pass of the given lookups without and with skip vectors. The vectors are
+ * created afresh for each pass so that their building cost and the first scanning request of each
+ * criterion are included.
+ */
+static void compare(const char *name, const vector<SFLookupFlag> &lookupFlags, bool isPaired)
+{
+    SFCodepoints codepoints;
+    SFAlbumRef album = createAlbum(&codepoints);
+    SFFontCache fontCache;
+    SFFontCacheInitialize(&fontCache, NULL);
+    volatile SFUInteger checksum = 0;
+
+    double baseline = measure(Iterations, [&]() {
+        SFLocator locator;
+        SFLocatorInitialize(&locator, album, &fontCache, NULL);
+
+        for (SFLookupFlag lookupFlag : lookupFlags) {
+            checksum += runLookup(&locator, lookupFlag, isPaired);
+        }
+    });
+    double current = measure(Iterations, [&]() {
+        SFSkipVectors skipVectors;
+        SFSkipVectorsInitialize(&skipVectors, NULL);
+
+        SFLocator locator;
+        SFLocatorInitialize(&locator, album, &fontCache, NULL);
+        SFLocatorSetSkipVectors(&locator, &skipVectors);
+
+        for (SFLookupFlag lookupFlag : lookupFlags) {
+            checksum += runLookup(&locator, lookupFlag, isPaired);
+        }
+
+        SFSkipVectorsFinalize(&skipVectors);
+    });
+
+    report(name, baseline, current);
+
+    SFFontCacheFinalize(&fontCache);
+    SFAlbumEndArranging(album);
+    SFAlbumRelease(album);
+}
+
+LocatorBenchmark::LocatorBenchmark()
+{
+}
+
+void LocatorBenchmark::benchmarkSharedCriterion()
+{
+    vector<SFLookupFlag> lookupFlags(8, SFLookupFlagIgnoreMarks);
+
+    compare("8 pair lookups ignoring marks", lookupFlags, true);
+    compare("8 single lookups ignoring marks", lookupFlags, false);
+}
+
+void LocatorBenchmark::benchmarkDistinctCriteria()
+{
+    vector<SFLookupFlag> lookupFlags = {
+        SFLookupFlagIgnoreMarks,
+        SFLookupFlagIgnoreBaseGlyphs,
+        SFLookupFlagIgnoreLigatures,
+        SFLookupFlagIgnoreMarks | SFLookupFlagIgnoreLigatures
+    };
+
+    /* Each criterion is requested by a single lookup here, so the vectors must not be built. */
+    compare("4 pair lookups, distinct criteria", lookupFlags, true);
+    compare("4 single lookups, distinct criteria", lookupFlags, false);
+}
+
+void LocatorBenchmark::run()
+{
+    header("Skip vectors (per positioning pass)");
+    benchmarkSharedCriterion();
+    benchmarkDistinctCriteria();
+}
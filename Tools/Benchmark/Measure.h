@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __SHEENFIGURE_BENCHMARK__MEASURE_H
+#define __SHEENFIGURE_BENCHMARK__MEASURE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+namespace SheenFigure {
+namespace Benchmark {
+
+/**
+ * Runs the operation for specified number of times and returns the average time in nanoseconds.
+ */
+template<class Operation>
+double measure(size_t iterations, Operation operation)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < iterations; i++) {
+        operation();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> elapsed = end - start;
+
+    return elapsed.count() / (double)iterations;
+}
+
+inline void report(const char *name, double baseline, double current)
+{
+    std::printf("  %-40s %10.2f ns %10.2f ns %8.2fx\n", name, baseline, current, baseline / current);
+}
+
+inline void header(const char *title)
+{
+    std::printf("%s\n  %-40s %13s %13s %9s\n", title, "case", "baseline", "current", "speedup");
+}
+
+}
+}
+
+#endif
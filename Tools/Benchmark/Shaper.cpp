@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+extern "C" {
+#include <Source/SFAlbum.h>
+#include <Source/SFBase.h>
+#include <Source/SFCodepoints.h>
+#include <Source/SFPattern.h>
+#include <Source/SFPatternBuilder.h>
+#include <Source/SFTextProcessor.h>
+}
+
+#include "FontBuilder.h"
+#include "Shaper.h"
+
+using namespace std;
+using namespace SheenFigure::Benchmark;
+
+static void addFeature(SFPatternBuilderRef builder, SFFeatureKind featureKind, size_t lookupCount)
+{
+    if (lookupCount) {
+        SFPatternBuilderBeginFeatures(builder, featureKind);
+        SFPatternBuilderAddFeature(builder, SFTagMake('t', 'e', 's', 't'), 0);
+
+        for (size_t i = 0; i < lookupCount; i++) {
+            SFPatternBuilderAddLookup(builder, (SFUInt16)i);
+        }
+
+        SFPatternBuilderMakeFeatureUnit(builder);
+        SFPatternBuilderEndFeatures(builder);
+    }
+}
+
+Shaper::Shaper(const FontBuilder &builder, SFFontRef font, SFTextDirection direction)
+    : m_pattern(SFPatternCreate(NULL))
+    , m_direction(direction)
+{
+    SFPatternBuilder patternBuilder;
+    SFPatternBuilderInitialize(&patternBuilder, m_pattern);
+    SFPatternBuilderSetFont(&patternBuilder, font);
+    SFPatternBuilderSetScript(&patternBuilder, SFTagMake('d', 'f', 'l', 't'), direction);
+    SFPatternBuilderSetLanguage(&patternBuilder, SFTagMake('d', 'f', 'l', 't'));
+    addFeature(&patternBuilder, SFFeatureKindSubstitution, builder.substitutionCount());
+    addFeature(&patternBuilder, SFFeatureKindPositioning, builder.positioningCount());
+    SFPatternBuilderBuild(&patternBuilder);
+    SFPatternBuilderFinalize(&patternBuilder);
+
+    SFAlbumInitialize(&m_album, NULL);
+}
+
+Shaper::~Shaper()
+{
+    SFAlbumFinalize(&m_album);
+    SFPatternRelease(m_pattern);
+}
+
+void Shaper::shape(const vector<SFCodepoint> &text)
+{
+    SBCodepointSequence sequence;
+    sequence.stringEncoding = SBStringEncodingUTF32;
+    sequence.stringBuffer = (void *)text.data();
+    sequence.stringLength = text.size();
+
+    SFCodepoints codepoints;
+    SFCodepointsInitialize(&codepoints, &sequence, SFFalse);
+    SFAlbumReset(&m_album, &codepoints, text.size());
+
+    SFTextProcessor processor;
+    SFTextProcessorInitialize(&processor, m_pattern, &m_album, m_direction, SFTextModeForward);
+    SFTextProcessorDiscoverGlyphs(&processor);
+    SFTextProcessorSubstituteGlyphs(&processor);
+    SFTextProcessorPositionGlyphs(&processor);
+    SFTextProcessorWrapUp(&processor);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SHEENFIGURE_BENCHMARK__SHAPER_H
+#define __SHEENFIGURE_BENCHMARK__SHAPER_H
+
+#include <vector>
+
+extern "C" {
+#include <Source/SFAlbum.h>
+#include <Source/SFBase.h>
+#include <Source/SFPattern.h>
+}
+
+#include "FontBuilder.h"
+
+namespace SheenFigure {
+namespace Benchmark {
+
+/**
+ * Shapes text with a pattern applying all lookups written by a font builder.
+ */
+class Shaper {
+public:
+    Shaper(const FontBuilder &builder, SFFontRef font, SFTextDirection direction = SFTextDirectionLeftToRight);
+    ~Shaper();
+
+    SFPatternRef pattern() { return m_pattern; }
+    SFAlbumRef album() { return &m_album; }
+
+    void shape(const std::vector<SFCodepoint> &text);
+
+private:
+    SFPatternRef m_pattern;
+    SFAlbum m_album;
+    SFTextDirection m_direction;
+};
+
+}
+}
+
+#endif
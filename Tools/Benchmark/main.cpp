@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "CallbackBenchmark.h"
+#include "ChainContextBenchmark.h"
+#include "ClassDefBenchmark.h"
+#include "CmapBenchmark.h"
+#include "CoverageBenchmark.h"
+#include "CursiveBenchmark.h"
+#include "DecompositionBenchmark.h"
+#include "DigestBenchmark.h"
+#include "FontCacheBenchmark.h"
+#include "KerningBenchmark.h"
+#include "LigatureBenchmark.h"
+#include "LocatorBenchmark.h"
+
+using namespace SheenFigure::Benchmark;
+
+int main(int argc, const char *argv[])
+{
+    CoverageBenchmark coverageBenchmark;
+    ClassDefBenchmark classDefBenchmark;
+    DigestBenchmark digestBenchmark;
+    KerningBenchmark kerningBenchmark;
+    LigatureBenchmark ligatureBenchmark;
+    LocatorBenchmark locatorBenchmark;
+    DecompositionBenchmark decompositionBenchmark;
+    CursiveBenchmark cursiveBenchmark;
+    ChainContextBenchmark chainContextBenchmark;
+    FontCacheBenchmark fontCacheBenchmark;
+    CmapBenchmark cmapBenchmark;
+    CallbackBenchmark callbackBenchmark;
+
+    coverageBenchmark.run();
+    classDefBenchmark.run();
+    digestBenchmark.run();
+    kerningBenchmark.run();
+    ligatureBenchmark.run();
+    locatorBenchmark.run();
+    decompositionBenchmark.run();
+    cursiveBenchmark.run();
+    chainContextBenchmark.run();
+    fontCacheBenchmark.run();
+    cmapBenchmark.run();
+    callbackBenchmark.run();
+
+    return 0;
+}
@@ -24,9 +24,12 @@ extern "C" {
 #include <Source/SFAlbum.h>
 }
 
+#include "Utilities/CountingAllocator.h"
+
 #include "AlbumTester.h"
 
 using namespace SheenFigure::Tester;
+using namespace SheenFigure::Tester::Utilities;
 
 static void SFAlbumReserveGlyphsInitialized(SFAlbumRef album, SFUInteger index, SFUInteger count)
 {
@@ -50,7 +53,7 @@ AlbumTester::AlbumTester()
 void AlbumTester::testInitialize()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
 
     assert(album.codepoints == NULL);
     assert(album.codeunitCount == 0);
@@ -62,7 +65,7 @@ void AlbumTester::testInitialize()
 void AlbumTester::testReset()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
 
     /* Test reset just after initialization. */
     {
@@ -94,7 +97,7 @@ void AlbumTester::testReset()
 void AlbumTester::testAddGlyph()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
 
     /* Test with forward associations. */
     {
@@ -195,7 +198,7 @@ void AlbumTester::testAddGlyph()
 void AlbumTester::testReserveGlyphs()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
     SFAlbumReset(&album, NULL, 5);
     SFAlbumBeginFilling(&album);
 
@@ -216,6 +219,13 @@ void AlbumTester::testReserveGlyphs()
     /* Reserve some glyphs at the start. */
     SFAlbumReserveGlyphs(&album, 0, 5);
 
+    /* Test the locations of glyphs while filling is in progress. */
+    assert(SFAlbumGetGlyph(&album, 5) == 100);
+    assert(SFAlbumGetGlyph(&album, 9) == 300);
+    assert(SFAlbumGetGlyph(&album, 15) == 400);
+    assert(SFAlbumGetGlyph(&album, 19) == 200);
+    assert(SFAlbumGetGlyph(&album, 24) == 500);
+
     /* Wrap up the album. */
     for (SFUInteger i = 0; i < 25; i++) {
         SFAlbumSetTraits(&album, i, SFGlyphTraitNone);
@@ -241,7 +251,7 @@ void AlbumTester::testReserveGlyphs()
 void AlbumTester::testSetGlyph()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
     SFAlbumReset(&album, NULL, 5);
     SFAlbumBeginFilling(&album);
 
@@ -271,7 +281,7 @@ void AlbumTester::testSetGlyph()
 void AlbumTester::testGetGlyph()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
     SFAlbumReset(&album, NULL, 5);
     SFAlbumBeginFilling(&album);
 
@@ -304,7 +314,7 @@ void AlbumTester::testGetGlyph()
 void AlbumTester::testSetAssociation()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
 
     /* Test with forward associations. */
     {
@@ -381,7 +391,7 @@ void AlbumTester::testSetAssociation()
 void AlbumTester::testGetAssociation()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
     SFAlbumReset(&album, NULL, 5);
     SFAlbumBeginFilling(&album);
 
@@ -416,7 +426,7 @@ void AlbumTester::testGetAssociation()
 void AlbumTester::testFeatureMask()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
     SFAlbumReset(&album, NULL, 5);
 
     SFAlbumBeginFilling(&album);
@@ -448,7 +458,7 @@ void AlbumTester::testFeatureMask()
 void AlbumTester::testTraits()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
     SFAlbumReset(&album, NULL, 5);
 
     SFAlbumBeginFilling(&album);
@@ -503,10 +513,62 @@ void AlbumTester::testTraits()
     SFAlbumFinalize(&album);
 }
 
+void AlbumTester::testCompact()
+{
+    SFAlbum album;
+    SFAlbumInitialize(&album, NULL);
+    SFAlbumReset(&album, NULL, 8);
+
+    SFAlbumBeginFilling(&album);
+    SFAlbumReserveGlyphsInitialized(&album, 0, 8);
+
+    for (SFUInteger i = 0; i < 8; i++) {
+        SFAlbumSetGlyph(&album, i, (SFGlyphID)(100 * (i + 1)));
+        SFAlbumSetAssociation(&album, i, i);
+    }
+
+    /* Turn the glyphs at 0, 2, 3 and 7 into placeholders and compact the album. */
+    SFAlbumSetTraits(&album, 0, SFGlyphTraitPlaceholder);
+    SFAlbumSetTraits(&album, 2, SFGlyphTraitPlaceholder);
+    SFAlbumSetTraits(&album, 3, SFGlyphTraitPlaceholder);
+    SFAlbumSetTraits(&album, 7, SFGlyphTraitPlaceholder);
+    SFAlbumCompact(&album);
+
+    /* Test the remaining glyphs along with the placeholders removed before them. */
+    assert(album.glyphCount == 4);
+    assert(SFAlbumGetGlyph(&album, 0) == 200 && SFAlbumGetRemovedCount(&album, 0) == 1);
+    assert(SFAlbumGetGlyph(&album, 1) == 500 && SFAlbumGetRemovedCount(&album, 1) == 2);
+    assert(SFAlbumGetGlyph(&album, 2) == 600 && SFAlbumGetRemovedCount(&album, 2) == 0);
+    assert(SFAlbumGetGlyph(&album, 3) == 700 && SFAlbumGetRemovedCount(&album, 3) == 0);
+
+    /* Reserve a glyph after compaction and make a placeholder carry the removed count. */
+    SFAlbumReserveGlyphsInitialized(&album, 2, 1);
+    SFAlbumSetGlyph(&album, 2, 550);
+    SFAlbumSetAssociation(&album, 2, 4);
+    SFAlbumSetTraits(&album, 1, SFGlyphTraitPlaceholder);
+    assert(SFAlbumGetRemovedCount(&album, 2) == 0);
+
+    SFAlbumCompact(&album);
+    assert(album.glyphCount == 4);
+    assert(SFAlbumGetGlyph(&album, 1) == 550 && SFAlbumGetRemovedCount(&album, 1) == 3);
+
+    /* Leave a placeholder for the wrap up. */
+    SFAlbumSetTraits(&album, 3, SFGlyphTraitPlaceholder);
+    SFAlbumEndFilling(&album);
+    SFAlbumWrapUp(&album);
+
+    /* Test the overall output. */
+    const SFGlyphID expected[] = { 200, 550, 600 };
+    assert(SFAlbumGetGlyphCount(&album) == 3);
+    assert(memcmp(SFAlbumGetGlyphIDsPtr(&album), expected, sizeof(expected)) == 0);
+
+    SFAlbumFinalize(&album);
+}
+
 void AlbumTester::testOffset()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
     SFAlbumReset(&album, NULL, 5);
 
     SFAlbumBeginFilling(&album);
@@ -543,7 +605,7 @@ void AlbumTester::testOffset()
 void AlbumTester::testAdvance()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
     SFAlbumReset(&album, NULL, 5);
 
     SFAlbumBeginFilling(&album);
@@ -578,7 +640,7 @@ void AlbumTester::testAdvance()
 void AlbumTester::testCursiveOffset()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
     SFAlbumReset(&album, NULL, 5);
 
     SFAlbumBeginFilling(&album);
@@ -607,7 +669,7 @@ void AlbumTester::testCursiveOffset()
 void AlbumTester::testAttachmentOffset()
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
+    SFAlbumInitialize(&album, NULL);
     SFAlbumReset(&album, NULL, 5);
 
     SFAlbumBeginFilling(&album);
@@ -633,6 +695,31 @@ void AlbumTester::testAttachmentOffset()
     SFAlbumFinalize(&album);
 }
 
+void AlbumTester::testAllocator()
+{
+    AllocationCounts counts = { 0, 0 };
+    SFAllocator allocator = { &CountingAllocator::Protocol, &counts };
+
+    SFAlbumRef album = SFAlbumCreateWithAllocator(&allocator);
+    SFAlbumReset(album, NULL, 5);
+
+    SFAlbumBeginFilling(album);
+    SFAlbumReserveGlyphsInitialized(album, 0, 5);
+    SFAlbumEndFilling(album);
+
+    SFAlbumBeginArranging(album);
+    SFAlbumEndArranging(album);
+    SFAlbumWrapUp(album);
+
+    /* Test that the album and its arrays were allocated with the given allocator. */
+    assert(counts.allocations > 1);
+
+    SFAlbumRelease(album);
+
+    /* Test that everything was given back to the same allocator. */
+    assert(counts.deallocations == counts.allocations);
+}
+
 void AlbumTester::test()
 {
     testInitialize();
@@ -645,8 +732,10 @@ void AlbumTester::test()
     testGetAssociation();
     testFeatureMask();
     testTraits();
+    testCompact();
     testOffset();
     testAdvance();
     testCursiveOffset();
     testAttachmentOffset();
+    testAllocator();
 }
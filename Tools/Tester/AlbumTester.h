@@ -34,10 +34,12 @@ public:
     void testGetAssociation();
     void testFeatureMask();
     void testTraits();
+    void testCompact();
     void testOffset();
     void testAdvance();
     void testCursiveOffset();
     void testAttachmentOffset();
+    void testAllocator();
 
     void test();
 };
@@ -0,0 +1,587 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <vector>
+
+extern "C" {
+#include <Source/SFAlbum.h>
+#include <Source/SFBase.h>
+#include <Source/SFContextMatcher.h>
+#include <Source/SFFontCache.h>
+#include <Source/SFLigatureTrie.h>
+#include <Source/SFPairIndex.h>
+}
+
+#include "OpenType/Base.h"
+#include "OpenType/Builder.h"
+#include "OpenType/Common.h"
+#include "OpenType/GDEF.h"
+#include "OpenType/GPOS.h"
+#include "OpenType/GSUB.h"
+#include "OpenType/Writer.h"
+#include "FontCacheTester.h"
+
+using namespace SheenFigure::Tester;
+using namespace SheenFigure::Tester::OpenType;
+
+static void testTraits(ClassDefTable *glyphClassDef, const SFGlyphTraits *expected, SFUInteger count)
+{
+    GDEF gdef;
+    gdef.version = 0x00010000;
+    gdef.glyphClassDef = glyphClassDef;
+    gdef.attachList = NULL;
+    gdef.ligCaretList = NULL;
+    gdef.markAttachClassDef = NULL;
+    gdef.markGlyphSetsDef = NULL;
+
+    Writer writer;
+    writer.write(&gdef);
+
+    /* Test with the raw table first, and then with the compiled one. */
+    for (int compiled = 0; compiled <= 1; compiled++) {
+        SFFontCache fontCache;
+        SFFontCacheInitialize(&fontCache, NULL);
+        SFFontCacheAttachGDEF(&fontCache, writer.data(), (SFUInteger)writer.size());
+
+        if (compiled) {
+            SFFontCacheLoadGDEF(&fontCache, writer.data(), (SFUInteger)writer.size());
+        }
+
+        for (SFUInteger glyph = 0; glyph <= 0xFFFF; glyph++) {
+            SFGlyphTraits traits = SFFontCacheGetGlyphTraits(&fontCache, (SFGlyphID)glyph);
+
+            if (glyph < count) {
+                assert(traits == expected[glyph]);
+            } else {
+                assert(traits == SFGlyphTraitNone);
+            }
+        }
+
+        SFFontCacheFinalize(&fontCache);
+    }
+}
+
+/* Writes a GSUB or GPOS table having only a lookup for each of the given subtables. */
+template<class Table>
+static void writeLookups(Writer &writer, const std::vector<LookupSubtable *> &subtables)
+{
+    std::vector<LookupTable> lookups(subtables.size());
+
+    for (size_t i = 0; i < subtables.size(); i++) {
+        lookups[i].lookupType = subtables[i]->lookupType();
+        lookups[i].lookupFlag = (LookupFlag)0;
+        lookups[i].subTableCount = 1;
+        lookups[i].subtables = subtables[i];
+        lookups[i].markFilteringSet = 0;
+    }
+
+    LookupListTable lookupList;
+    lookupList.lookupCount = (UInt16)lookups.size();
+    lookupList.lookupTables = lookups.data();
+
+    Table table;
+    table.version = 0x00010000;
+    table.scriptList = NULL;
+    table.featureList = NULL;
+    table.lookupList = &lookupList;
+
+    writer.write(&table);
+}
+
+/* Writes a GDEF table whose mark glyph sets cover the given glyphs, returning its data. */
+static std::vector<SFUInt8> writeMarkGlyphSets(std::vector<std::vector<Glyph>> &sets,
+    ClassDefTable *glyphClassDef = NULL, ClassDefTable *markAttachClassDef = NULL)
+{
+    std::vector<CoverageTable> coverages(sets.size());
+
+    for (size_t i = 0; i < sets.size(); i++) {
+        coverages[i].coverageFormat = 1;
+        coverages[i].format1.glyphCount = (UInt16)sets[i].size();
+        coverages[i].format1.glyphArray = sets[i].data();
+    }
+
+    MarkGlyphSetsDefTable markGlyphSets;
+    markGlyphSets.markSetTableFormat = 1;
+    markGlyphSets.markSetCount = (UInt16)sets.size();
+    markGlyphSets.coverage = coverages.data();
+
+    GDEF gdef;
+    gdef.version = 0x00010002;
+    gdef.glyphClassDef = glyphClassDef;
+    gdef.attachList = NULL;
+    gdef.ligCaretList = NULL;
+    gdef.markAttachClassDef = markAttachClassDef;
+    gdef.markGlyphSetsDef = &markGlyphSets;
+
+    Writer writer;
+    writer.write(&gdef);
+
+    return std::vector<SFUInt8>(writer.data(), writer.data() + writer.size());
+}
+
+static bool isInMarkGlyphSet(SFFontCacheRef fontCache, SFUInteger markSetIndex, SFGlyphID glyph)
+{
+    SFUInteger firstWord;
+    SFUInteger wordCount;
+    const SFUInt32 *words = SFFontCacheGetMarkGlyphSet(fontCache, markSetIndex, &firstWord, &wordCount);
+    SFUInteger word = (SFUInteger)(glyph >> 5) - firstWord;
+
+    assert(words != NULL);
+
+    return word < wordCount && (words[word] & ((SFUInt32)1 << (glyph & 31)));
+}
+
+FontCacheTester::FontCacheTester()
+{
+}
+
+void FontCacheTester::testGlyphTraits()
+{
+    const SFGlyphTraits traits[] = {
+        SFGlyphTraitNone, SFGlyphTraitBase, SFGlyphTraitLigature,
+        SFGlyphTraitMark, SFGlyphTraitComponent, SFGlyphTraitNone
+    };
+    const SFUInteger count = sizeof(traits) / sizeof(SFGlyphTraits);
+
+    /* Test with a class definition of format 1 having an unknown class at the end. */
+    {
+        Builder builder;
+        ClassDefTable &classDef = builder.createClassDef(1, 5, { 1, 2, 3, 4, 5 });
+
+        testTraits(&classDef, traits, count);
+    }
+
+    /* Test with a class definition of format 2. */
+    {
+        Builder builder;
+        ClassDefTable &classDef = builder.createClassDef({
+            class_range(1, 1, 1), class_range(2, 2, 2), class_range(3, 3, 3), class_range(4, 4, 4)
+        });
+
+        testTraits(&classDef, traits, count);
+    }
+
+    /* Test with overlapping ranges that must be looked up in the raw table. */
+    {
+        Builder builder;
+        ClassDefTable &classDef = builder.createClassDef({
+            class_range(1, 2, 1), class_range(2, 4, 3)
+        });
+        const SFGlyphTraits overlapping[] = {
+            SFGlyphTraitNone, SFGlyphTraitBase, SFGlyphTraitMark, SFGlyphTraitMark, SFGlyphTraitMark
+        };
+
+        testTraits(&classDef, overlapping, sizeof(overlapping) / sizeof(SFGlyphTraits));
+    }
+
+    /* Test without any class definition. */
+    {
+        testTraits(NULL, NULL, 0);
+    }
+}
+
+void FontCacheTester::testImage()
+{
+    Builder builder;
+    ClassDefTable &glyphClassDef = builder.createClassDef({
+        class_range(1, 20, 1), class_range(300, 310, 3), class_range(30000, 30100, 2)
+    });
+    ClassDefTable &markAttachClassDef = builder.createClassDef(300, 5, { 1, 2, 3, 4, 5 });
+
+    GDEF gdef;
+    gdef.version = 0x00010000;
+    gdef.glyphClassDef = &glyphClassDef;
+    gdef.attachList = NULL;
+    gdef.ligCaretList = NULL;
+    gdef.markAttachClassDef = &markAttachClassDef;
+    gdef.markGlyphSetsDef = NULL;
+
+    Writer writer;
+    writer.write(&gdef);
+
+    SFData gdefTable = writer.data();
+    SFUInteger gdefLength = (SFUInteger)writer.size();
+    SFData tables[] = { gdefTable, NULL, NULL };
+    SFUInteger lengths[] = { gdefLength, 0, 0 };
+
+    SFFontCache fontCache;
+    SFFontCacheInitialize(&fontCache, NULL);
+    SFFontCacheLoadGDEF(&fontCache, gdefTable, gdefLength);
+
+    /* Keep the image aligned to four bytes. */
+    SFUInteger imageLength = SFFontCacheWriteImage(&fontCache, tables, lengths, 3, NULL);
+    std::vector<SFUInt32> image((imageLength + 3) / 4);
+    assert(SFFontCacheWriteImage(&fontCache, tables, lengths, 3, (SFUInt8 *)image.data()) == imageLength);
+
+    /* Test that the loaded glyph maps are same as compiled ones. */
+    {
+        SFFontCache imageCache;
+        SFFontCacheInitialize(&imageCache, NULL);
+        assert(SFFontCacheLoadImage(&imageCache, tables, lengths, 3, (SFUInt8 *)image.data(), imageLength));
+        SFFontCacheLoadGDEF(&imageCache, gdefTable, gdefLength);
+
+        SFData classDefs[] = {
+            SFData_Subdata(gdefTable, SFData_UInt16(gdefTable, 4)),
+            SFData_Subdata(gdefTable, SFData_UInt16(gdefTable, 10))
+        };
+
+        for (SFData classDef : classDefs) {
+            SFGlyphMapRef expected = SFFontCacheGetClassDef(&fontCache, classDef);
+            SFGlyphMapRef actual = SFFontCacheGetClassDef(&imageCache, classDef);
+            assert(expected != NULL && actual != NULL);
+
+            for (SFUInteger glyph = 0; glyph <= 0xFFFF; glyph++) {
+                assert(SFGlyphMapGetValue(actual, (SFGlyphID)glyph) == SFGlyphMapGetValue(expected, (SFGlyphID)glyph));
+                assert(SFFontCacheGetGlyphTraits(&imageCache, (SFGlyphID)glyph) == SFFontCacheGetGlyphTraits(&fontCache, (SFGlyphID)glyph));
+            }
+        }
+
+        SFFontCacheFinalize(&imageCache);
+    }
+
+    /* Test that the image is rejected for a modified table. */
+    {
+        std::vector<SFUInt8> modified(gdefTable, gdefTable + gdefLength);
+        modified[gdefLength - 1] ^= 1;
+
+        SFData modifiedTables[] = { modified.data(), NULL, NULL };
+        SFFontCache imageCache;
+        SFFontCacheInitialize(&imageCache, NULL);
+        assert(!SFFontCacheLoadImage(&imageCache, modifiedTables, lengths, 3, (SFUInt8 *)image.data(), imageLength));
+        SFFontCacheFinalize(&imageCache);
+    }
+
+    /* Test that a truncated image is rejected. */
+    {
+        SFFontCache imageCache;
+        SFFontCacheInitialize(&imageCache, NULL);
+        assert(!SFFontCacheLoadImage(&imageCache, tables, lengths, 3, (SFUInt8 *)image.data(), imageLength - 4));
+        SFFontCacheFinalize(&imageCache);
+    }
+
+    SFFontCacheFinalize(&fontCache);
+}
+
+void FontCacheTester::testMarkGlyphSets()
+{
+    /* Test that each bitset only spans its own glyphs and that equal coverages share one. */
+    {
+        std::vector<std::vector<Glyph>> sets = { { 100, 101, 140 }, { 5000, 5040 }, { 7 } };
+        std::vector<SFUInt8> gdef = writeMarkGlyphSets(sets);
+        SFUInteger setsOffset = SFData_UInt16(gdef.data(), 12);
+        SFUInteger firstWord;
+        SFUInteger wordCount;
+
+        /* Point the last set to the coverage of the first one. */
+        for (SFUInteger i = 0; i < 4; i++) {
+            gdef[setsOffset + 12 + i] = gdef[setsOffset + 4 + i];
+        }
+
+        SFFontCache fontCache;
+        SFFontCacheInitialize(&fontCache, NULL);
+        SFFontCacheLoadGDEF(&fontCache, gdef.data(), (SFUInteger)gdef.size());
+
+        const SFUInt32 *first = SFFontCacheGetMarkGlyphSet(&fontCache, 0, &firstWord, &wordCount);
+        assert(firstWord == 100 / 32);
+        assert(wordCount == 2);
+
+        SFFontCacheGetMarkGlyphSet(&fontCache, 1, &firstWord, &wordCount);
+        assert(firstWord == 5000 / 32);
+        assert(wordCount == 2);
+
+        assert(SFFontCacheGetMarkGlyphSet(&fontCache, 2, &firstWord, &wordCount) == first);
+        assert(SFFontCacheGetMarkGlyphSet(&fontCache, 3, &firstWord, &wordCount) == NULL);
+
+        for (SFUInteger glyph = 0; glyph <= 0xFFFF; glyph++) {
+            bool inFirst = (glyph == 100 || glyph == 101 || glyph == 140);
+            bool inSecond = (glyph == 5000 || glyph == 5040);
+
+            assert(isInMarkGlyphSet(&fontCache, 0, (SFGlyphID)glyph) == inFirst);
+            assert(isInMarkGlyphSet(&fontCache, 1, (SFGlyphID)glyph) == inSecond);
+            assert(isInMarkGlyphSet(&fontCache, 2, (SFGlyphID)glyph) == inFirst);
+        }
+
+        SFFontCacheFinalize(&fontCache);
+    }
+
+    /* Test that the sets exceeding the limit of words are left to their coverages. */
+    {
+        std::vector<std::vector<Glyph>> sets(12, std::vector<Glyph>({ 0, 65000 }));
+        std::vector<SFUInt8> gdef = writeMarkGlyphSets(sets);
+        SFUInteger setsOffset = SFData_UInt16(gdef.data(), 12);
+        SFUInteger firstWord;
+        SFUInteger wordCount;
+
+        SFFontCache fontCache;
+        SFFontCacheInitialize(&fontCache, NULL);
+        SFFontCacheLoadGDEF(&fontCache, gdef.data(), (SFUInteger)gdef.size());
+
+        for (SFUInteger index = 0; index < sets.size(); index++) {
+            const SFUInt32 *words = SFFontCacheGetMarkGlyphSet(&fontCache, index, &firstWord, &wordCount);
+            SFData coverage = SFData_Subdata(gdef.data(), setsOffset + SFData_UInt32(gdef.data(), setsOffset + 4 + (index * 4)));
+
+            if (index < 8) {
+                assert(words != NULL);
+                assert(isInMarkGlyphSet(&fontCache, index, 65000));
+            } else {
+                assert(words == NULL);
+                assert(wordCount == 0);
+            }
+
+            assert(SFFontCacheSearchCoverageIndex(&fontCache, coverage, 65000) == 1);
+            assert(SFFontCacheSearchCoverageIndex(&fontCache, coverage, 64999) == SFInvalidIndex);
+        }
+
+        SFFontCacheFinalize(&fontCache);
+    }
+}
+
+void FontCacheTester::testImageArrays()
+{
+    Builder builder;
+    ClassDefTable &glyphClassDef = builder.createClassDef({ class_range(1, 20, 1), class_range(300, 310, 3) });
+    ClassDefTable &markAttachClassDef = builder.createClassDef(300, 5, { 1, 2, 3, 4, 5 });
+    std::vector<std::vector<Glyph>> sets = { { 100, 101, 140 }, { 5000, 5040 } };
+    std::vector<SFUInt8> gdef = writeMarkGlyphSets(sets, &glyphClassDef, &markAttachClassDef);
+
+    Writer writer;
+    writeLookups<GSUB>(writer, {
+        &builder.createSingleSubst({ 1, 2, 3 }, 1),
+        &builder.createSingleSubst({ 400, 900 }, 1)
+    });
+
+    SFData tables[] = { gdef.data(), writer.data(), NULL };
+    SFUInteger lengths[] = { (SFUInteger)gdef.size(), (SFUInteger)writer.size(), 0 };
+
+    SFFontCache fontCache;
+    SFFontCacheInitialize(&fontCache, NULL);
+    SFFontCacheLoadGDEF(&fontCache, tables[0], lengths[0]);
+    SFFontCacheLoadGSUB(&fontCache, tables[1], lengths[1]);
+
+    SFUInteger imageLength = SFFontCacheWriteImage(&fontCache, tables, lengths, 3, NULL);
+    std::vector<SFUInt32> image((imageLength + 3) / 4);
+    SFFontCacheWriteImage(&fontCache, tables, lengths, 3, (SFUInt8 *)image.data());
+
+    const SFUInt8 *imageStart = (const SFUInt8 *)image.data();
+    const SFUInt8 *imageEnd = imageStart + imageLength;
+    auto isInImage = [&](const void *array) {
+        return (const SFUInt8 *)array >= imageStart && (const SFUInt8 *)array < imageEnd;
+    };
+
+    /* Test that the digests and the GDEF arrays are borrowed from the image as they were. */
+    {
+        SFFontCache imageCache;
+        SFFontCacheInitialize(&imageCache, NULL);
+        assert(SFFontCacheLoadImage(&imageCache, tables, lengths, 3, imageStart, imageLength));
+        SFFontCacheLoadGDEF(&imageCache, tables[0], lengths[0]);
+        SFFontCacheLoadGSUB(&imageCache, tables[1], lengths[1]);
+
+        assert(isInImage(imageCache.gsubDigests.items));
+        assert(imageCache.gsubDigests.count == 2);
+        assert(memcmp(imageCache.gsubDigests.items, fontCache.gsubDigests.items, sizeof(SFGlyphDigest) * 2) == 0);
+        assert(imageCache.gsubLookups.count == 2);
+
+        SFUInteger expectedCount;
+        SFUInteger actualCount;
+        const SFUInt8 *expectedClasses = SFFontCacheGetMarkAttachClasses(&fontCache, &expectedCount);
+        const SFUInt8 *actualClasses = SFFontCacheGetMarkAttachClasses(&imageCache, &actualCount);
+        assert(isInImage(actualClasses));
+        assert(actualCount == expectedCount);
+        assert(memcmp(actualClasses, expectedClasses, actualCount) == 0);
+
+        const SFUInt32 *words = SFFontCacheGetMarkGlyphSet(&imageCache, 1, &expectedCount, &actualCount);
+        assert(isInImage(words));
+
+        for (SFUInteger glyph = 0; glyph <= 0xFFFF; glyph++) {
+            assert(SFFontCacheGetGlyphTraits(&imageCache, (SFGlyphID)glyph) == SFFontCacheGetGlyphTraits(&fontCache, (SFGlyphID)glyph));
+            assert(isInMarkGlyphSet(&imageCache, 0, (SFGlyphID)glyph) == isInMarkGlyphSet(&fontCache, 0, (SFGlyphID)glyph));
+            assert(isInMarkGlyphSet(&imageCache, 1, (SFGlyphID)glyph) == isInMarkGlyphSet(&fontCache, 1, (SFGlyphID)glyph));
+        }
+
+        SFFontCacheFinalize(&imageCache);
+    }
+
+    /* Test that a bitset lying outside the words is rejected. */
+    {
+        /* The words are followed by the counts of two empty sections of native subtables. */
+        SFUInteger setsOffset = imageLength - sizeof(SFUInt32) * (2 + 6 + (SFUInteger)fontCache._markGlyphSetWordCount + 2);
+        std::vector<SFUInt32> corrupted(image);
+        SFUInt32 *markGlyphSet = (SFUInt32 *)((SFUInt8 *)corrupted.data() + setsOffset + sizeof(SFUInt32));
+        markGlyphSet[0] = (SFUInt32)fontCache._markGlyphSetWordCount;
+
+        SFFontCache imageCache;
+        SFFontCacheInitialize(&imageCache, NULL);
+        assert(!SFFontCacheLoadImage(&imageCache, tables, lengths, 3, (SFUInt8 *)corrupted.data(), imageLength));
+        SFFontCacheFinalize(&imageCache);
+    }
+
+    SFFontCacheFinalize(&fontCache);
+}
+
+void FontCacheTester::testImageSubtables()
+{
+    Builder builder;
+    ValueRecord &kern = builder.createValueRecord({ 0, 0, -50, 0 });
+    std::map<std::vector<Glyph>, Glyph> ligatures;
+    std::reference_wrapper<ClassDefTable> classDefs[] = {
+        builder.createClassDef(100, 5, { 1, 2, 3, 4, 5 }),
+        builder.createClassDef(110, 3, { 1, 2, 3 }),
+    };
+
+    for (Glyph i = 0; i < 5; i++) {
+        ligatures[{ (Glyph)(100 + i), 200 }] = (Glyph)(1000 + i);
+        ligatures[{ (Glyph)(100 + i), 200, (Glyph)(300 + i) }] = (Glyph)(2000 + i);
+    }
+
+    Writer gsubWriter;
+    writeLookups<GSUB>(gsubWriter, {
+        &builder.createLigatureSubst(ligatures),
+        &builder.createChainContext({ rule_chain_context { { 50 }, { 100, 200 }, { 60 }, { {0, 0} } } }),
+        &builder.createChainContext({ { 50, 51 } }, { { 100 }, { 200 } }, { { 60 } }, { {1, 0} })
+    });
+
+    Writer gposWriter;
+    writeLookups<GPOS>(gposWriter, {
+        &builder.createPairPos({ 100, 101, 102, 103, 104 }, classDefs, {
+            pair_rule { 1, 2, kern, kern }
+        })
+    });
+
+    SFData tables[] = { NULL, gsubWriter.data(), gposWriter.data() };
+    SFUInteger lengths[] = { 0, (SFUInteger)gsubWriter.size(), (SFUInteger)gposWriter.size() };
+
+    SFFontCache fontCache;
+    SFFontCacheInitialize(&fontCache, NULL);
+    SFFontCacheLoadGSUB(&fontCache, tables[1], lengths[1]);
+    SFFontCacheLoadGPOS(&fontCache, tables[2], lengths[2]);
+
+    assert(fontCache._ligatureTries.count == 1);
+    assert(fontCache._contextMatchers.count == 2);
+    assert(fontCache._pairIndexes.count == 1);
+
+    SFUInteger imageLength = SFFontCacheWriteImage(&fontCache, tables, lengths, 3, NULL);
+    std::vector<SFUInt32> image((imageLength + 3) / 4);
+    SFFontCacheWriteImage(&fontCache, tables, lengths, 3, (SFUInt8 *)image.data());
+
+    const SFUInt8 *imageStart = (const SFUInt8 *)image.data();
+    const SFUInt8 *imageEnd = imageStart + imageLength;
+    auto isInImage = [&](const void *array) {
+        return (const SFUInt8 *)array >= imageStart && (const SFUInt8 *)array < imageEnd;
+    };
+
+    /* Test that the native subtables are borrowed from the image and are not compiled again. */
+    {
+        SFFontCache imageCache;
+        SFFontCacheInitialize(&imageCache, NULL);
+        assert(SFFontCacheLoadImage(&imageCache, tables, lengths, 3, imageStart, imageLength));
+        SFFontCacheLoadGSUB(&imageCache, tables[1], lengths[1]);
+        SFFontCacheLoadGPOS(&imageCache, tables[2], lengths[2]);
+
+        assert(imageCache._ligatureTries.count == 1);
+        assert(imageCache._contextMatchers.count == 2);
+        assert(imageCache._pairIndexes.count == 1);
+
+        SFLigatureTrieRef expectedTrie = SFListGetRef(&fontCache._ligatureTries, 0);
+        SFLigatureTrieRef actualTrie = SFFontCacheGetLigatureTrie(&imageCache, expectedTrie->_subtable);
+        assert(actualTrie != NULL && isInImage(actualTrie->_nodes.items) && isInImage(actualTrie->_edges.items));
+        assert(actualTrie->_rootCount == expectedTrie->_rootCount);
+        assert(actualTrie->componentLimit == expectedTrie->componentLimit);
+        assert(memcmp(actualTrie->_roots, expectedTrie->_roots, sizeof(SFUInt32) * actualTrie->_rootCount) == 0);
+        assert(actualTrie->_nodes.count == expectedTrie->_nodes.count);
+        assert(memcmp(actualTrie->_nodes.items, expectedTrie->_nodes.items, sizeof(SFLigatureNode) * actualTrie->_nodes.count) == 0);
+        assert(actualTrie->_edges.count == expectedTrie->_edges.count);
+        assert(memcmp(actualTrie->_edges.items, expectedTrie->_edges.items, sizeof(SFLigatureEdge) * actualTrie->_edges.count) == 0);
+
+        for (SFUInteger index = 0; index < 2; index++) {
+            SFContextMatcherRef expectedMatcher = SFListGetRef(&fontCache._contextMatchers, index);
+            SFContextMatcherRef actualMatcher = SFFontCacheGetContextMatcher(&imageCache, expectedMatcher->_subtable);
+            assert(actualMatcher != NULL && isInImage(actualMatcher->_rules.items));
+            assert(actualMatcher->format == expectedMatcher->format);
+            assert(actualMatcher->backtrackLimit == expectedMatcher->backtrackLimit);
+            assert(actualMatcher->forwardLimit == expectedMatcher->forwardLimit);
+            assert(memcmp(actualMatcher->classMaps, expectedMatcher->classMaps, sizeof(actualMatcher->classMaps)) == 0);
+
+            for (SFUInteger setIndex = 0; setIndex < expectedMatcher->_ruleSetCount; setIndex++) {
+                SFUInteger expectedCount;
+                SFUInteger actualCount;
+                SFContextRuleRef expectedRules = SFContextMatcherGetRules(expectedMatcher, setIndex, &expectedCount);
+                SFContextRuleRef actualRules = SFContextMatcherGetRules(actualMatcher, setIndex, &actualCount);
+                assert(actualCount == expectedCount);
+
+                for (SFUInteger ruleIndex = 0; ruleIndex < actualCount; ruleIndex++) {
+                    SFContextRuleRef expectedRule = &expectedRules[ruleIndex];
+                    SFContextRuleRef actualRule = &actualRules[ruleIndex];
+                    SFUInteger valueCount = (actualRule->inputCount - (actualMatcher->format != 3))
+                                          + actualRule->backtrackCount + actualRule->lookaheadCount;
+
+                    assert(memcmp(actualRule, expectedRule, sizeof(SFContextRule)) == 0);
+                    assert(SFContextMatcherGetLookupArray(actualMatcher, actualRule) == SFContextMatcherGetLookupArray(expectedMatcher, expectedRule));
+                    assert(memcmp(SFContextMatcherGetValues(actualMatcher, actualRule),
+                                  SFContextMatcherGetValues(expectedMatcher, expectedRule), sizeof(SFUInt32) * valueCount) == 0);
+                }
+            }
+        }
+
+        /* The pair index is not part of the image, but is rebuilt from the borrowed glyph maps. */
+        SFPairIndexRef expectedIndex = SFListGetRef(&fontCache._pairIndexes, 0);
+        SFPairIndexRef actualIndex = SFListGetRef(&imageCache._pairIndexes, 0);
+        assert(memcmp(actualIndex, expectedIndex, sizeof(SFPairIndex)) == 0);
+
+        for (SFUInteger first = 90; first < 130; first++) {
+            for (SFUInteger second = 90; second < 130; second++) {
+                SFData values = SFFontCacheSearchPairValues(&imageCache, actualIndex, (SFGlyphID)first, (SFGlyphID)second);
+                assert(values == SFFontCacheSearchPairValues(&fontCache, expectedIndex, (SFGlyphID)first, (SFGlyphID)second));
+                assert((values != NULL) == (first >= 100 && first < 105));
+            }
+        }
+
+        SFFontCacheFinalize(&imageCache);
+    }
+
+    /* Test that a rule whose lookup records lie outside the subtable is rejected. */
+    {
+        SFContextMatcherRef contextMatcher = SFListGetRef(&fontCache._contextMatchers, 0);
+        std::vector<SFUInt32> matcherImage(SFContextMatcherWriteImage(contextMatcher, NULL) / 4);
+        SFContextMatcherWriteImage(contextMatcher, (SFUInt8 *)matcherImage.data());
+
+        SFUInteger length = lengths[1] - (contextMatcher->_subtable - tables[1]);
+        SFUInteger mapCount = fontCache._glyphMaps.count;
+        SFContextMatcher loaded;
+        assert(SFContextMatcherInitializeWithImage(&loaded, contextMatcher->_subtable, length, mapCount,
+                                                   (SFUInt8 *)matcherImage.data(), matcherImage.size() * 4));
+
+        /* The first rule follows the header and the starts of the rule sets. */
+        SFUInteger ruleOffset = 9 + contextMatcher->_ruleSetCount + 1;
+        matcherImage[ruleOffset] = (SFUInt32)length;
+        assert(!SFContextMatcherInitializeWithImage(&loaded, contextMatcher->_subtable, length, mapCount,
+                                                    (SFUInt8 *)matcherImage.data(), matcherImage.size() * 4));
+    }
+
+    SFFontCacheFinalize(&fontCache);
+}
+
+void FontCacheTester::test()
+{
+    testGlyphTraits();
+    testImage();
+    testImageArrays();
+    testImageSubtables();
+    testMarkGlyphSets();
+}
@@ -16,15 +16,30 @@
 
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <vector>
 
 extern "C" {
+#include <Source/SFCmap.h>
 #include <Source/SFFont.h>
 }
 
+#include "Utilities/CountingAllocator.h"
+
 #include "FontTester.h"
 
+using namespace std;
 using namespace SheenFigure::Tester;
+using namespace SheenFigure::Tester::Utilities;
+
+typedef vector<uint8_t> Bytes;
+
+struct Table {
+    SFTag tag;
+    Bytes data;
+};
 
 static void *OBJECT_FONT = &OBJECT_FONT;
 static int FINALIZE_COUNT = 0;
@@ -79,6 +94,25 @@ static void loadTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *leng
     }
 }
 
+static const SFUInt8 *getTable(void *object, SFTag tag, SFUInteger *length)
+{
+    assert(object == OBJECT_FONT);
+
+    switch (tag) {
+    case SFTagMake('G', 'D', 'E', 'F'):
+        *length = 4;
+        return (const SFUInt8 *)TABLE_GDEF;
+
+    case SFTagMake('G', 'S', 'U', 'B'):
+        *length = 4;
+        return (const SFUInt8 *)TABLE_GSUB;
+
+    /* Leave GPOS to be loaded by copying. */
+    default:
+        return NULL;
+    }
+}
+
 static SFGlyphID getGlyphIDForCodepoint(void *object, SFCodepoint codepoint)
 {
     assert(object == OBJECT_FONT);
@@ -102,6 +136,303 @@ static SFAdvance getAdvanceForGlyph(void *object, SFFontLayout fontLayout, SFGly
     }
 }
 
+static void appendUInt16(Bytes &bytes, uint32_t value)
+{
+    bytes.push_back((uint8_t)(value >> 8));
+    bytes.push_back((uint8_t)value);
+}
+
+static void appendUInt32(Bytes &bytes, uint32_t value)
+{
+    appendUInt16(bytes, value >> 16);
+    appendUInt16(bytes, value & 0xFFFF);
+}
+
+static void setUInt32(Bytes &bytes, size_t offset, uint32_t value)
+{
+    bytes[offset + 0] = (uint8_t)(value >> 24);
+    bytes[offset + 1] = (uint8_t)(value >> 16);
+    bytes[offset + 2] = (uint8_t)(value >> 8);
+    bytes[offset + 3] = (uint8_t)value;
+}
+
+/* Writes the offset table of a face followed by its tables, whose offsets are from the start. */
+static void writeFace(Bytes &bytes, const vector<Table> &tables)
+{
+    size_t directory = bytes.size();
+
+    appendUInt32(bytes, 0x00010000);
+    appendUInt16(bytes, (uint32_t)tables.size());
+    appendUInt16(bytes, 0);
+    appendUInt16(bytes, 0);
+    appendUInt16(bytes, 0);
+
+    for (const Table &table : tables) {
+        appendUInt32(bytes, table.tag);
+        appendUInt32(bytes, 0);
+        appendUInt32(bytes, 0);
+        appendUInt32(bytes, (uint32_t)table.data.size());
+    }
+
+    for (size_t i = 0; i < tables.size(); i++) {
+        setUInt32(bytes, directory + 12 + (i * 16) + 8, (uint32_t)bytes.size());
+        bytes.insert(bytes.end(), tables[i].data.begin(), tables[i].data.end());
+
+        while (bytes.size() % 4) {
+            bytes.push_back(0);
+        }
+    }
+}
+
+static Bytes makeCmapFormat4()
+{
+    Bytes subtable;
+
+    /* Map A-C to glyphs 1-3 with a delta, and U+0100 to glyph 7 with the glyph array. */
+    appendUInt16(subtable, 4);
+    appendUInt16(subtable, 16 + (3 * 8) + 4);
+    appendUInt16(subtable, 0);
+    appendUInt16(subtable, 3 * 2);
+    appendUInt16(subtable, 4);
+    appendUInt16(subtable, 1);
+    appendUInt16(subtable, 2);
+    appendUInt16(subtable, 0x43);
+    appendUInt16(subtable, 0x101);
+    appendUInt16(subtable, 0xFFFF);
+    appendUInt16(subtable, 0);
+    appendUInt16(subtable, 0x41);
+    appendUInt16(subtable, 0x100);
+    appendUInt16(subtable, 0xFFFF);
+    appendUInt16(subtable, (1 - 0x41) & 0xFFFF);
+    appendUInt16(subtable, 0);
+    appendUInt16(subtable, 1);
+    appendUInt16(subtable, 0);
+    appendUInt16(subtable, 4);
+    appendUInt16(subtable, 0);
+    appendUInt16(subtable, 7);
+    appendUInt16(subtable, 0);
+
+    return subtable;
+}
+
+static Bytes makeCmapFormat12()
+{
+    Bytes subtable;
+
+    appendUInt16(subtable, 12);
+    appendUInt16(subtable, 0);
+    appendUInt32(subtable, 16 + (2 * 12));
+    appendUInt32(subtable, 0);
+    appendUInt32(subtable, 2);
+    appendUInt32(subtable, 0x41);
+    appendUInt32(subtable, 0x43);
+    appendUInt32(subtable, 4);
+    appendUInt32(subtable, 0x1F600);
+    appendUInt32(subtable, 0x1F602);
+    appendUInt32(subtable, 10);
+
+    return subtable;
+}
+
+struct Segment {
+    uint32_t start;
+    uint32_t end;
+    uint32_t delta;
+};
+
+/* Makes a format 4 subtable of delta segments, closing it with the mandatory last segment. */
+static Bytes makeDeltaFormat4(vector<Segment> segments)
+{
+    Bytes subtable;
+    uint32_t segCount;
+
+    segments.push_back({ 0xFFFF, 0xFFFF, 1 });
+    segCount = (uint32_t)segments.size();
+
+    appendUInt16(subtable, 4);
+    appendUInt16(subtable, 16 + (segCount * 8));
+    appendUInt16(subtable, 0);
+    appendUInt16(subtable, segCount * 2);
+    appendUInt16(subtable, 0);
+    appendUInt16(subtable, 0);
+    appendUInt16(subtable, 0);
+
+    for (const Segment &segment : segments) {
+        appendUInt16(subtable, segment.end);
+    }
+    appendUInt16(subtable, 0);
+    for (const Segment &segment : segments) {
+        appendUInt16(subtable, segment.start);
+    }
+    for (const Segment &segment : segments) {
+        appendUInt16(subtable, segment.delta & 0xFFFF);
+    }
+    for (size_t i = 0; i < segments.size(); i++) {
+        appendUInt16(subtable, 0);
+    }
+
+    return subtable;
+}
+
+/* Makes a cmap table holding a single subtable of given encoding. */
+static Bytes makeSingleCmap(uint32_t platformID, uint32_t encodingID, const Bytes &subtable)
+{
+    Bytes cmap;
+
+    appendUInt16(cmap, 0);
+    appendUInt16(cmap, 1);
+    appendUInt16(cmap, platformID);
+    appendUInt16(cmap, encodingID);
+    appendUInt32(cmap, 12);
+    cmap.insert(cmap.end(), subtable.begin(), subtable.end());
+
+    return cmap;
+}
+
+static Bytes makeCmap(bool withFormat12)
+{
+    Bytes cmap;
+    Bytes format4 = makeCmapFormat4();
+    Bytes format12 = makeCmapFormat12();
+    uint32_t recordCount = (withFormat12 ? 2 : 1);
+
+    appendUInt16(cmap, 0);
+    appendUInt16(cmap, recordCount);
+    appendUInt16(cmap, 3);
+    appendUInt16(cmap, 1);
+    appendUInt32(cmap, 4 + (recordCount * 8));
+
+    if (withFormat12) {
+        appendUInt16(cmap, 3);
+        appendUInt16(cmap, 10);
+        appendUInt32(cmap, (uint32_t)(4 + (recordCount * 8) + format4.size()));
+    }
+
+    cmap.insert(cmap.end(), format4.begin(), format4.end());
+
+    if (withFormat12) {
+        cmap.insert(cmap.end(), format12.begin(), format12.end());
+    }
+
+    return cmap;
+}
+
+static vector<Table> makeTables(bool withFormat12)
+{
+    Bytes head(54, 0);
+    Bytes hhea(36, 0);
+    Bytes hmtx;
+
+    head[18] = 1000 >> 8;
+    head[19] = 1000 & 0xFF;
+    hhea[35] = 2;
+
+    /* Two long metrics followed by the side bearing of a third glyph. */
+    appendUInt16(hmtx, 500);
+    appendUInt16(hmtx, 0);
+    appendUInt16(hmtx, 600);
+    appendUInt16(hmtx, 0);
+    appendUInt16(hmtx, 0);
+
+    return {
+        { SFTagMake('G', 'D', 'E', 'F'), Bytes(TABLE_GDEF, TABLE_GDEF + 4) },
+        { SFTagMake('c', 'm', 'a', 'p'), makeCmap(withFormat12) },
+        { SFTagMake('h', 'e', 'a', 'd'), head },
+        { SFTagMake('h', 'h', 'e', 'a'), hhea },
+        { SFTagMake('h', 'm', 't', 'x'), hmtx },
+    };
+}
+
+static void testFontFace(SFFontRef font, bool withFormat12)
+{
+    assert(font != NULL);
+
+    /* Test that the tables are used in place. */
+    assert(memcmp(font->tables.gdef, TABLE_GDEF, 4) == 0);
+    assert(font->tables.gdefLength == 4);
+    assert(font->tables.gsub == NULL);
+    assert(font->tables.gpos == NULL);
+
+    /* Test the glyph IDs of the preferred cmap subtable. */
+    assert(SFFontGetGlyphIDForCodepoint(font, 0x40) == 0);
+    assert(SFFontGetGlyphIDForCodepoint(font, 0xFFFF) == 0);
+
+    if (withFormat12) {
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x41) == 4);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x43) == 6);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x100) == 0);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x1F601) == 11);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x1F603) == 0);
+    } else {
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x41) == 1);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x43) == 3);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x44) == 0);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x100) == 7);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x101) == 0);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x1F601) == 0);
+    }
+
+    /* Test the advances, including the glyphs after the long metrics. */
+    assert(SFFontGetAdvanceForGlyph(font, SFFontLayoutHorizontal, 0) == 500);
+    assert(SFFontGetAdvanceForGlyph(font, SFFontLayoutHorizontal, 1) == 600);
+    assert(SFFontGetAdvanceForGlyph(font, SFFontLayoutHorizontal, 9) == 600);
+    assert(SFFontGetAdvanceForGlyph(font, SFFontLayoutVertical, 1) == 1000);
+}
+
+static const SFUInt8 *getCmapTable(void *object, SFTag tag, SFUInteger *length)
+{
+    const Bytes *cmap = reinterpret_cast<const Bytes *>(object);
+
+    if (tag == SFTagMake('c', 'm', 'a', 'p')) {
+        *length = (SFUInteger)cmap->size();
+        return cmap->data();
+    }
+
+    return NULL;
+}
+
+static void loadCmapTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length)
+{
+    const Bytes *cmap = reinterpret_cast<const Bytes *>(object);
+
+    if (tag == SFTagMake('c', 'm', 'a', 'p')) {
+        if (buffer) {
+            memcpy(buffer, cmap->data(), cmap->size());
+        }
+        if (length) {
+            *length = (SFUInteger)cmap->size();
+        }
+    } else if (length) {
+        *length = 0;
+    }
+}
+
+static void loadFaceTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length)
+{
+    const vector<Table> *tables = reinterpret_cast<const vector<Table> *>(object);
+
+    for (const Table &table : *tables) {
+        if (table.tag == tag) {
+            if (buffer) {
+                memcpy(buffer, table.data.data(), table.data.size());
+            }
+            if (length) {
+                *length = (SFUInteger)table.data.size();
+            }
+            return;
+        }
+    }
+
+    if (length) {
+        *length = 0;
+    }
+}
+
+static SFGlyphID getFaceGlyphID(void *object, SFCodepoint codepoint)
+{
+    return (SFGlyphID)codepoint;
+}
+
 static SFFontRef SFFontCreateWithCompleteFunctionality(void)
 {
     const SFFontProtocol protocol = {
@@ -148,6 +479,35 @@ void FontTester::testBadProtocol()
 
         assert(font == NULL);
     }
+
+    /* Test that the original protocol still requires the glyph function. */
+    {
+        const SFFontProtocol protocol = {
+            .finalize = NULL,
+            .loadTable = &loadTable,
+            .getGlyphIDForCodepoint = NULL,
+            .getAdvanceForGlyph = NULL,
+        };
+        SFFontRef font = SFFontCreateWithProtocol(&protocol, (void *)OBJECT_FONT);
+
+        assert(font == NULL);
+    }
+
+    /* Test with an extended protocol whose size is not set. */
+    {
+        const SFFontExtendedProtocol protocol = {
+            .size = 0,
+            .base = {
+                .finalize = NULL,
+                .loadTable = &loadTable,
+                .getGlyphIDForCodepoint = &getGlyphIDForCodepoint,
+                .getAdvanceForGlyph = NULL,
+            },
+        };
+        SFFontRef font = SFFontCreateWithExtendedProtocol(&protocol, (void *)OBJECT_FONT, NULL, NULL, 0);
+
+        assert(font == NULL);
+    }
 }
 
 void FontTester::testFinalizeCallback()
@@ -172,6 +532,509 @@ void FontTester::testLoadedTables()
     SFFontRelease(font);
 }
 
+void FontTester::testBorrowedTables()
+{
+    /* Test with both table functions. */
+    {
+        const SFFontExtendedProtocol protocol = {
+            .size = sizeof(SFFontExtendedProtocol),
+            .base = {
+                .finalize = NULL,
+                .loadTable = &loadTable,
+                .getGlyphIDForCodepoint = &getGlyphIDForCodepoint,
+                .getAdvanceForGlyph = NULL,
+            },
+            .getTable = &getTable,
+        };
+        SFFontRef font = SFFontCreateWithExtendedProtocol(&protocol, (void *)OBJECT_FONT, NULL, NULL, 0);
+
+        assert(font->tables.gdef == (const SFUInt8 *)TABLE_GDEF);
+        assert(font->tables.gsub == (const SFUInt8 *)TABLE_GSUB);
+        assert(font->tables.gpos != (const SFUInt8 *)TABLE_GPOS);
+        assert(memcmp(font->tables.gpos, TABLE_GPOS, 4) == 0);
+        assert(font->tables.gdefLength == 4);
+        assert(font->tables.gsubLength == 4);
+        assert(font->tables.gposLength == 4);
+
+        SFFontRelease(font);
+    }
+
+    /* Test without the load function. */
+    {
+        const SFFontExtendedProtocol protocol = {
+            .size = sizeof(SFFontExtendedProtocol),
+            .base = {
+                .finalize = NULL,
+                .loadTable = NULL,
+                .getGlyphIDForCodepoint = &getGlyphIDForCodepoint,
+                .getAdvanceForGlyph = NULL,
+            },
+            .getTable = &getTable,
+        };
+        SFFontRef font = SFFontCreateWithExtendedProtocol(&protocol, (void *)OBJECT_FONT, NULL, NULL, 0);
+
+        assert(font->tables.gdef == (const SFUInt8 *)TABLE_GDEF);
+        assert(font->tables.gsub == (const SFUInt8 *)TABLE_GSUB);
+        assert(font->tables.gpos == NULL);
+        assert(font->tables.gposLength == 0);
+
+        SFFontRelease(font);
+    }
+}
+
+void FontTester::testCompiledTables()
+{
+    const SFFontProtocol protocol = {
+        .finalize = NULL,
+        .loadTable = &loadTable,
+        .getGlyphIDForCodepoint = &getGlyphIDForCodepoint,
+        .getAdvanceForGlyph = NULL,
+    };
+    SFFontExtendedProtocol extended = {
+        .size = sizeof(SFFontExtendedProtocol),
+        .base = protocol,
+    };
+    SFUInteger length;
+
+    /* Test that the extended protocol leaves the tables raw without the option. */
+    {
+        SFFontRef font = SFFontCreateWithExtendedProtocol(&extended, (void *)OBJECT_FONT, NULL, NULL, 0);
+        SFFontWriteCache(font, NULL, &length);
+        assert(length == 0);
+        SFFontRelease(font);
+    }
+
+    /* Test that the tables are compiled on request and with the original protocol. */
+    {
+        extended.options = SFFontOptionCompiledTables;
+
+        SFFontRef font = SFFontCreateWithExtendedProtocol(&extended, (void *)OBJECT_FONT, NULL, NULL, 0);
+        SFFontWriteCache(font, NULL, &length);
+        assert(length != 0);
+        SFFontRelease(font);
+
+        font = SFFontCreateWithProtocol(&protocol, (void *)OBJECT_FONT);
+        SFFontWriteCache(font, NULL, &length);
+        assert(length != 0);
+        SFFontRelease(font);
+
+        font = SFFontCreateWithAllocator(&protocol, (void *)OBJECT_FONT, NULL);
+        SFFontWriteCache(font, NULL, &length);
+        assert(length != 0);
+        SFFontRelease(font);
+
+        font = SFFontCreateWithCache(&protocol, (void *)OBJECT_FONT, NULL, NULL, 0);
+        SFFontWriteCache(font, NULL, &length);
+        assert(length != 0);
+        SFFontRelease(font);
+    }
+}
+
+void FontTester::testNativeCmap()
+{
+    Bytes cmap = makeCmap(true);
+
+    /* Test with a borrowed cmap table. */
+    {
+        const SFFontExtendedProtocol protocol = {
+            .size = sizeof(SFFontExtendedProtocol),
+            .base = {
+                .finalize = NULL,
+                .loadTable = NULL,
+                .getGlyphIDForCodepoint = NULL,
+                .getAdvanceForGlyph = NULL,
+            },
+            .getTable = &getCmapTable,
+        };
+        SFFontRef font = SFFontCreateWithExtendedProtocol(&protocol, &cmap, NULL, NULL, 0);
+
+        assert(font != NULL);
+        assert(SFFontGetCmap(font) == &font->_cmap);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x41) == 4);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x1F602) == 12);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x10FFFF) == 0);
+
+        SFFontRelease(font);
+    }
+
+    /* Test with a copied cmap table. */
+    {
+        const SFFontExtendedProtocol protocol = {
+            .size = sizeof(SFFontExtendedProtocol),
+            .base = {
+                .finalize = NULL,
+                .loadTable = &loadCmapTable,
+                .getGlyphIDForCodepoint = NULL,
+                .getAdvanceForGlyph = NULL,
+            },
+        };
+        SFFontRef font = SFFontCreateWithExtendedProtocol(&protocol, &cmap, NULL, NULL, 0);
+
+        assert(font != NULL);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x43) == 6);
+        assert(SFFontGetGlyphIDForCodepoint(font, 0x1F600) == 10);
+
+        SFFontRelease(font);
+    }
+
+    /* Test that a protocol mapping the code points is not bypassed. */
+    {
+        SFFontRef font = SFFontCreateWithCompleteFunctionality();
+        assert(SFFontGetCmap(font) == NULL);
+        SFFontRelease(font);
+    }
+
+    /* Test the cached lookups, including the supplementary code points sharing a slot. */
+    {
+        SFAllocator allocator;
+        SFCmap compiled;
+        SFCmapCache cache;
+
+        SFAllocatorInitialize(&allocator, NULL);
+        SFCmapInitialize(&compiled, &allocator, cmap.data(), cmap.size());
+        SFCmapCacheInitialize(&cache);
+
+        for (int pass = 0; pass < 2; pass++) {
+            assert(SFCmapGetCachedGlyph(&compiled, &cache, 0x42) == 5);
+            assert(SFCmapGetCachedGlyph(&compiled, &cache, 0x1F601) == 11);
+            assert(SFCmapGetCachedGlyph(&compiled, &cache, 0x1F601 + (SF_CMAP_CACHE_SIZE * SF_CMAP_CACHE_SIZE)) == 0);
+            assert(SFCmapGetCachedGlyph(&compiled, &cache, 0x1F601) == 11);
+            assert(SFCmapGetCachedGlyph(&compiled, &cache, 0x10000) == 0);
+        }
+
+        SFCmapFinalize(&compiled, &allocator);
+    }
+
+    /* Test that overlapping segments cannot expand more code points than the plane holds. */
+    {
+        vector<Segment> segments(2000, { 0x0000, 0xFFFE, 2 });
+        segments[0].delta = 1;
+
+        Bytes table = makeSingleCmap(3, 1, makeDeltaFormat4(segments));
+        SFAllocator allocator;
+        SFCmap compiled;
+
+        SFAllocatorInitialize(&allocator, NULL);
+        SFCmapInitialize(&compiled, &allocator, table.data(), table.size());
+
+        /* The first segment is the one that a binary search of the subtable would find. */
+        assert(SFCmapGetGlyph(&compiled, 0x41) == 0x42);
+        assert(SFCmapGetGlyph(&compiled, 0xFFFE) == 0xFFFF);
+
+        SFCmapFinalize(&compiled, &allocator);
+    }
+
+    /* Test the same with overlapping groups. */
+    {
+        Bytes format12;
+
+        appendUInt16(format12, 12);
+        appendUInt16(format12, 0);
+        appendUInt32(format12, 16 + (2000 * 12));
+        appendUInt32(format12, 0);
+        appendUInt32(format12, 2000);
+
+        for (uint32_t i = 0; i < 2000; i++) {
+            appendUInt32(format12, 0x0000);
+            appendUInt32(format12, 0x1FFFF);
+            appendUInt32(format12, (i == 0 ? 1 : 2));
+        }
+
+        Bytes table = makeSingleCmap(3, 10, format12);
+        SFAllocator allocator;
+        SFCmap compiled;
+
+        SFAllocatorInitialize(&allocator, NULL);
+        SFCmapInitialize(&compiled, &allocator, table.data(), table.size());
+
+        assert(SFCmapGetGlyph(&compiled, 0x41) == 0x42);
+
+        SFCmapFinalize(&compiled, &allocator);
+    }
+
+    /* Test a symbol subtable, which is only used as a last resort. */
+    {
+        Bytes symbol = makeDeltaFormat4({ { 0xF020, 0xF07F, (uint32_t)(3 - 0xF020) } });
+        Bytes table = makeSingleCmap(3, 0, symbol);
+        SFAllocator allocator;
+        SFCmap compiled;
+
+        SFAllocatorInitialize(&allocator, NULL);
+        SFCmapInitialize(&compiled, &allocator, table.data(), table.size());
+
+        assert(SFCmapGetGlyph(&compiled, 0xF020) == 3);
+        assert(SFCmapGetGlyph(&compiled, 0xF041) == 36);
+        assert(SFCmapGetGlyph(&compiled, 0x20) == 3);
+        assert(SFCmapGetGlyph(&compiled, 0x41) == 36);
+        assert(SFCmapGetGlyph(&compiled, 0x7F) == 98);
+        assert(SFCmapGetGlyph(&compiled, 0x80) == 0);
+        assert(SFCmapGetGlyph(&compiled, 0x1F) == 0);
+
+        SFCmapFinalize(&compiled, &allocator);
+
+        /* Test that a unicode subtable wins over the symbol one. */
+        Bytes unicode = makeCmapFormat4();
+        Bytes both;
+
+        appendUInt16(both, 0);
+        appendUInt16(both, 2);
+        appendUInt16(both, 3);
+        appendUInt16(both, 0);
+        appendUInt32(both, 20);
+        appendUInt16(both, 3);
+        appendUInt16(both, 1);
+        appendUInt32(both, (uint32_t)(20 + symbol.size()));
+        both.insert(both.end(), symbol.begin(), symbol.end());
+        both.insert(both.end(), unicode.begin(), unicode.end());
+
+        SFCmapInitialize(&compiled, &allocator, both.data(), both.size());
+
+        assert(SFCmapGetGlyph(&compiled, 0x41) == 1);
+        assert(SFCmapGetGlyph(&compiled, 0x20) == 0);
+        assert(SFCmapGetGlyph(&compiled, 0xF020) == 0);
+
+        SFCmapFinalize(&compiled, &allocator);
+    }
+
+    /* Test that a missing cmap maps everything to zero. */
+    {
+        SFAllocator allocator;
+        SFCmap compiled;
+
+        SFAllocatorInitialize(&allocator, NULL);
+        SFCmapInitialize(&compiled, &allocator, NULL, 0);
+
+        assert(SFCmapGetGlyph(&compiled, 0x41) == 0);
+        assert(SFCmapGetGlyph(&compiled, 0x1F601) == 0);
+
+        SFCmapFinalize(&compiled, &allocator);
+    }
+}
+
+void FontTester::testParsedMetrics()
+{
+    vector<Table> tables = makeTables(false);
+    const SFFontExtendedProtocol protocol = {
+        .size = sizeof(SFFontExtendedProtocol),
+        .base = {
+            .finalize = NULL,
+            .loadTable = &loadFaceTable,
+            .getGlyphIDForCodepoint = NULL,
+            .getAdvanceForGlyph = NULL,
+        },
+        .options = SFFontOptionParsedMetrics,
+    };
+
+    /* Test with horizontal metrics only. */
+    {
+        SFFontRef font = SFFontCreateWithExtendedProtocol(&protocol, &tables, NULL, NULL, 0);
+        SFGlyphID glyphs[] = { 0, 1, 2, 0xFFFF };
+        SFAdvance advances[4];
+
+        SFFontGetAdvancesForGlyphs(font, SFFontLayoutHorizontal, glyphs, advances, 4);
+        assert(advances[0] == 500);
+        assert(advances[1] == 600);
+        assert(advances[2] == 600);
+        assert(advances[3] == 600);
+
+        SFFontGetAdvancesForGlyphs(font, SFFontLayoutVertical, glyphs, advances, 4);
+        assert(advances[0] == 1000);
+        assert(advances[3] == 1000);
+
+        SFFontRelease(font);
+    }
+
+    /* Test with vertical metrics as well. */
+    {
+        Bytes vhea(36, 0);
+        Bytes vmtx;
+
+        vhea[35] = 1;
+        appendUInt16(vmtx, 800);
+        appendUInt16(vmtx, 0);
+
+        tables.push_back({ SFTagMake('v', 'h', 'e', 'a'), vhea });
+        tables.push_back({ SFTagMake('v', 'm', 't', 'x'), vmtx });
+
+        SFFontRef font = SFFontCreateWithExtendedProtocol(&protocol, &tables, NULL, NULL, 0);
+
+        assert(SFFontGetAdvanceForGlyph(font, SFFontLayoutHorizontal, 1) == 600);
+        assert(SFFontGetAdvanceForGlyph(font, SFFontLayoutVertical, 0) == 800);
+        assert(SFFontGetAdvanceForGlyph(font, SFFontLayoutVertical, 5) == 800);
+
+        SFFontRelease(font);
+    }
+
+    /* Test that the metrics are not parsed unless requested. */
+    {
+        SFFontExtendedProtocol unparsed = protocol;
+        unparsed.options = SFFontOptionNone;
+
+        SFFontRef font = SFFontCreateWithExtendedProtocol(&unparsed, &tables, NULL, NULL, 0);
+        SFGlyphID glyphs[] = { 0, 1 };
+        SFAdvance advances[2];
+
+        SFFontGetAdvancesForGlyphs(font, SFFontLayoutHorizontal, glyphs, advances, 2);
+        assert(advances[0] == 0);
+        assert(advances[1] == 0);
+        assert(SFFontGetAdvanceForGlyph(font, SFFontLayoutVertical, 0) == 0);
+
+        SFFontRelease(font);
+    }
+
+    /* Test that the original protocol without the advance function gives zero advances. */
+    {
+        const SFFontProtocol original = {
+            .finalize = NULL,
+            .loadTable = &loadFaceTable,
+            .getGlyphIDForCodepoint = &getFaceGlyphID,
+            .getAdvanceForGlyph = NULL,
+        };
+        SFFontRef font = SFFontCreateWithProtocol(&original, &tables);
+        SFGlyphID glyphs[] = { 0, 1 };
+        SFAdvance advances[2];
+
+        SFFontGetAdvancesForGlyphs(font, SFFontLayoutHorizontal, glyphs, advances, 2);
+        assert(advances[0] == 0);
+        assert(advances[1] == 0);
+        assert(SFFontGetAdvanceForGlyph(font, SFFontLayoutHorizontal, 1) == 0);
+        assert(SFFontGetAdvanceForGlyph(font, SFFontLayoutVertical, 1) == 0);
+
+        SFFontRelease(font);
+    }
+}
+
+void FontTester::testMemoryFont()
+{
+    Bytes bytes;
+    writeFace(bytes, makeTables(false));
+
+    /* Test with a valid face. */
+    {
+        SFFontRef font = SFFontCreateWithMemory(bytes.data(), bytes.size(), 0, NULL, NULL, 0);
+        testFontFace(font, false);
+
+        assert(font->tables.gdef >= bytes.data() && font->tables.gdef < bytes.data() + bytes.size());
+
+        SFFontRelease(font);
+    }
+
+    /* Test that the font and its file use the given allocator. */
+    {
+        AllocationCounts counts = { 0, 0 };
+        SFAllocator allocator = { &CountingAllocator::Protocol, &counts };
+
+        SFFontRef font = SFFontCreateWithMemory(bytes.data(), bytes.size(), 0, &allocator, NULL, 0);
+        testFontFace(font, false);
+
+        /* The file, the font, the cmap pages and the advances. */
+        assert(counts.allocations >= 4);
+
+        SFFontRelease(font);
+        assert(counts.deallocations == counts.allocations);
+    }
+
+    /* Test that the face reuses the cache data written by an earlier font. */
+    {
+        SFFontRef font = SFFontCreateWithMemory(bytes.data(), bytes.size(), 0, NULL, NULL, 0);
+        SFUInteger length = 0;
+        SFFontWriteCache(font, NULL, &length);
+        assert(length != 0);
+
+        vector<SFUInt32> cacheData((length + 3) / 4);
+        SFFontWriteCache(font, (SFUInt8 *)cacheData.data(), &length);
+        SFFontRelease(font);
+
+        font = SFFontCreateWithMemory(bytes.data(), bytes.size(), 0, NULL, (SFUInt8 *)cacheData.data(), length);
+        testFontFace(font, false);
+
+        assert(font->cache._image == (SFUInt8 *)cacheData.data());
+
+        SFFontRelease(font);
+    }
+
+    /* Test with a missing face. */
+    {
+        AllocationCounts counts = { 0, 0 };
+        SFAllocator allocator = { &CountingAllocator::Protocol, &counts };
+
+        SFFontRef font = SFFontCreateWithMemory(bytes.data(), bytes.size(), 1, &allocator, NULL, 0);
+        assert(font == NULL);
+        assert(counts.deallocations == counts.allocations);
+    }
+
+    /* Test with a truncated table directory. */
+    {
+        SFFontRef font = SFFontCreateWithMemory(bytes.data(), 20, 0, NULL, NULL, 0);
+        assert(font == NULL);
+    }
+
+    /* Test with data that is not a font. */
+    {
+        Bytes junk(64, 0x7F);
+        SFFontRef font = SFFontCreateWithMemory(junk.data(), junk.size(), 0, NULL, NULL, 0);
+        assert(font == NULL);
+    }
+}
+
+void FontTester::testCollectionFont()
+{
+    Bytes bytes;
+
+    appendUInt32(bytes, SFTagMake('t', 't', 'c', 'f'));
+    appendUInt32(bytes, 0x00010000);
+    appendUInt32(bytes, 2);
+    appendUInt32(bytes, 0);
+    appendUInt32(bytes, 0);
+
+    setUInt32(bytes, 12, (uint32_t)bytes.size());
+    writeFace(bytes, makeTables(false));
+    setUInt32(bytes, 16, (uint32_t)bytes.size());
+    writeFace(bytes, makeTables(true));
+
+    for (SFUInteger index = 0; index < 2; index++) {
+        SFFontRef font = SFFontCreateWithMemory(bytes.data(), bytes.size(), index, NULL, NULL, 0);
+        testFontFace(font, index == 1);
+        SFFontRelease(font);
+    }
+
+    assert(SFFontCreateWithMemory(bytes.data(), bytes.size(), 2, NULL, NULL, 0) == NULL);
+}
+
+void FontTester::testFileFont()
+{
+    const char *path = "sheenfigure-font-tester.ttf";
+    Bytes bytes;
+    writeFace(bytes, makeTables(true));
+
+    FILE *file = fopen(path, "wb");
+    assert(file != NULL);
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+
+    SFFontRef font = SFFontCreateWithFile(path, 0, NULL, NULL, 0);
+    testFontFace(font, true);
+    SFFontRelease(font);
+
+    /* Test that the file is released with the allocator of the font. */
+    {
+        AllocationCounts counts = { 0, 0 };
+        SFAllocator allocator = { &CountingAllocator::Protocol, &counts };
+
+        font = SFFontCreateWithFile(path, 0, &allocator, NULL, 0);
+        testFontFace(font, true);
+
+        assert(counts.allocations >= 2);
+
+        SFFontRelease(font);
+        assert(counts.deallocations == counts.allocations);
+    }
+
+    remove(path);
+
+    assert(SFFontCreateWithFile(path, 0, NULL, NULL, 0) == NULL);
+}
+
 void FontTester::testGetGlyphIDForCodepoint()
 {
     SFFontRef font = SFFontCreateWithCompleteFunctionality();
@@ -237,6 +1100,13 @@ void FontTester::test()
     testBadProtocol();
     testFinalizeCallback();
     testLoadedTables();
+    testBorrowedTables();
+    testCompiledTables();
+    testNativeCmap();
+    testParsedMetrics();
+    testMemoryFont();
+    testCollectionFont();
+    testFileFont();
     testGetGlyphIDForCodepoint();
     testGetAdvanceForGlyph();
 }
@@ -27,6 +27,13 @@ public:
     void testBadProtocol();
     void testFinalizeCallback();
     void testLoadedTables();
+    void testBorrowedTables();
+    void testCompiledTables();
+    void testNativeCmap();
+    void testParsedMetrics();
+    void testMemoryFont();
+    void testCollectionFont();
+    void testFileFont();
     void testGetGlyphIDForCodepoint();
     void testGetAdvanceForGlyph();
 
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFGlyphDigest.h>
+}
+
+#include "GlyphDigestTester.h"
+
+using namespace SheenFigure::Tester;
+
+GlyphDigestTester::GlyphDigestTester()
+{
+}
+
+void GlyphDigestTester::testEmptyAndFull()
+{
+    SFGlyphDigest digest;
+
+    SFGlyphDigestClear(&digest);
+    for (SFUInteger glyph = 0; glyph <= 0xFFFF; glyph++) {
+        assert(!SFGlyphDigestMayHave(&digest, (SFGlyphID)glyph));
+    }
+
+    SFGlyphDigestFill(&digest);
+    for (SFUInteger glyph = 0; glyph <= 0xFFFF; glyph++) {
+        assert(SFGlyphDigestMayHave(&digest, (SFGlyphID)glyph));
+    }
+}
+
+void GlyphDigestTester::testGlyphs()
+{
+    const SFGlyphID glyphs[] = { 0, 1, 31, 32, 500, 4096, 33333, 0xFFFF };
+    const SFUInteger count = sizeof(glyphs) / sizeof(SFGlyphID);
+
+    SFGlyphDigest digest;
+    SFGlyphDigestClear(&digest);
+
+    for (SFUInteger i = 0; i < count; i++) {
+        SFGlyphDigestAddGlyph(&digest, glyphs[i]);
+    }
+
+    /* A digest must never reject an added glyph. */
+    for (SFUInteger i = 0; i < count; i++) {
+        assert(SFGlyphDigestMayHave(&digest, glyphs[i]));
+    }
+
+    /* A glyph far from all added ones should be rejected. */
+    assert(!SFGlyphDigestMayHave(&digest, 7));
+}
+
+void GlyphDigestTester::testRanges()
+{
+    const SFUInteger ranges[][2] = {
+        { 0, 0 }, { 30, 33 }, { 60, 70 }, { 1000, 1500 }, { 2047, 2049 }, { 40000, 65535 }
+    };
+
+    for (const auto &range : ranges) {
+        SFGlyphDigest digest;
+        SFGlyphDigestClear(&digest);
+        SFGlyphDigestAddRange(&digest, (SFGlyphID)range[0], (SFGlyphID)range[1]);
+
+        for (SFUInteger glyph = range[0]; glyph <= range[1]; glyph++) {
+            assert(SFGlyphDigestMayHave(&digest, (SFGlyphID)glyph));
+        }
+    }
+
+    /* A small range should not cover the whole glyph space. */
+    SFGlyphDigest digest;
+    SFGlyphDigestClear(&digest);
+    SFGlyphDigestAddRange(&digest, 100, 120);
+
+    assert(!SFGlyphDigestMayHave(&digest, 99));
+    assert(!SFGlyphDigestMayHave(&digest, 121));
+}
+
+void GlyphDigestTester::testIntersection()
+{
+    SFGlyphDigest first;
+    SFGlyphDigest second;
+
+    SFGlyphDigestClear(&first);
+    SFGlyphDigestClear(&second);
+    SFGlyphDigestAddRange(&first, 'a', 'z');
+    SFGlyphDigestAddRange(&second, 1000, 1019);
+
+    assert(!SFGlyphDigestMayIntersect(&first, &second));
+
+    SFGlyphDigestAddGlyph(&second, 'q');
+    assert(SFGlyphDigestMayIntersect(&first, &second));
+}
+
+void GlyphDigestTester::test()
+{
+    testEmptyAndFull();
+    testGlyphs();
+    testRanges();
+    testIntersection();
+}
@@ -283,6 +283,22 @@ void TextProcessorTester::testChainContextSubtable()
                             rule_chain_context { { 21, 22, 23 }, { 1 }, { 31 }, { {0, 1} } }
                          }),
                          { 21, 22, 0, 1, 31 }, { 21, 22, 0, 1, 31 }, simpleReferral);
+        /* Test with backtrack glyphs exceeding the start of text. */
+        testSubstitution(builder.createChainContext({
+                            rule_chain_context { { 21, 22, 23 }, { 1 }, { 31 }, { {0, 1} } }
+                         }),
+                         { 22, 23, 1, 31 }, { 22, 23, 1, 31 }, simpleReferral);
+        /* Test with lookahead glyphs exceeding the end of text. */
+        testSubstitution(builder.createChainContext({
+                            rule_chain_context { { 21 }, { 1 }, { 31, 32, 33 }, { {0, 1} } }
+                         }),
+                         { 21, 1, 31, 32 }, { 21, 1, 31, 32 }, simpleReferral);
+        /* Test by letting a shorter rule match after a longer one fails in a single rule set. */
+        testSubstitution(builder.createChainContext({
+                            rule_chain_context { { 21, 22 }, { 1, 2 }, { 31, 32 }, { {1, 1} } },
+                            rule_chain_context { { 22 }, { 1, 2 }, { 31 }, { {0, 1} } },
+                         }),
+                         { 22, 1, 2, 31, 33 }, { 22, 11, 2, 31, 33 }, simpleReferral);
         /* Test with unmatching first lookahead glyph. */
         testSubstitution(builder.createChainContext({
                             rule_chain_context { { 21 }, { 1 }, { 31, 32, 33 }, { {0, 1} } }
@@ -625,4 +641,8 @@ void TextProcessorTester::testExtensionSubtable()
     /* Test with a matching glyph.*/
     testSubstitution(builder.createExtension(LookupType::sSingle, builder.createSingleSubst({ 1 }, 100)),
                      { 1 }, { 101 });
+    /* Test with a contextual subtable referring to an extended lookup. */
+    testSubstitution(builder.createContext({ { 1 }, { 2 } }, { {1, 1} }),
+                     { 1, 2 }, { 1, 102 },
+                     { &builder.createExtension(LookupType::sSingle, builder.createSingleSubst({ 2 }, 100)) });
 }
@@ -0,0 +1,422 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+extern "C" {
+#include <Source/SFAllocator.h>
+#include <Source/SFBase.h>
+#include <Source/SFGlyphMap.h>
+#include <Source/SFOpenType.h>
+}
+
+#include "OpenType/Base.h"
+#include "OpenType/Common.h"
+#include "OpenType/Writer.h"
+#include "GlyphMapTester.h"
+
+using namespace std;
+using namespace SheenFigure::Tester;
+using namespace SheenFigure::Tester::OpenType;
+
+enum class Kind {
+    Direct,
+    Ranked,
+    Paged,
+    Ranges
+};
+
+static const SFAllocator *defaultAllocator()
+{
+    static SFAllocator allocator;
+    SFAllocatorInitialize(&allocator, NULL);
+
+    return &allocator;
+}
+
+static void testCoverage(CoverageTable &coverage, Kind kind)
+{
+    Writer writer;
+    writer.write(&coverage);
+
+    SFGlyphMap glyphMap;
+    SFBoolean compiled = SFGlyphMapInitializeWithCoverage(&glyphMap, defaultAllocator(), writer.data(), writer.size());
+    assert(compiled);
+    assert((glyphMap._values != NULL) == (kind == Kind::Direct));
+    assert((glyphMap._words != NULL) == (kind == Kind::Ranked));
+    assert((glyphMap._pageIndexes != NULL) == (kind == Kind::Paged));
+
+    /* Compare the index of each glyph with the one found in raw table. */
+    for (SFUInteger glyph = 0; glyph <= 0xFFFF; glyph++) {
+        SFUInteger expected = SFOpenTypeSearchCoverageIndex(writer.data(), (SFGlyphID)glyph);
+        SFUInt16 value = SFGlyphMapGetValue(&glyphMap, (SFGlyphID)glyph);
+
+        if (expected == SFInvalidIndex) {
+            assert(value == SFUInt16Max);
+        } else {
+            assert(value == expected);
+        }
+    }
+
+    SFGlyphMapFinalize(&glyphMap, defaultAllocator());
+}
+
+static void testClassDef(ClassDefTable &classDef, Kind kind)
+{
+    Writer writer;
+    writer.write(&classDef);
+
+    SFGlyphMap glyphMap;
+    SFBoolean compiled = SFGlyphMapInitializeWithClassDef(&glyphMap, defaultAllocator(), writer.data(), writer.size());
+    assert(compiled);
+    assert((glyphMap._values != NULL) == (kind == Kind::Direct));
+    assert((glyphMap._pageIndexes != NULL) == (kind == Kind::Paged));
+
+    /* Compare the class of each glyph with the one found in raw table. */
+    for (SFUInteger glyph = 0; glyph <= 0xFFFF; glyph++) {
+        SFUInt16 expected = SFOpenTypeSearchGlyphClass(writer.data(), (SFGlyphID)glyph);
+        SFUInt16 value = SFGlyphMapGetValue(&glyphMap, (SFGlyphID)glyph);
+
+        assert(value == expected);
+    }
+
+    SFGlyphMapFinalize(&glyphMap, defaultAllocator());
+}
+
+GlyphMapTester::GlyphMapTester()
+{
+}
+
+void GlyphMapTester::testCoverageFormat1()
+{
+    /* Test with glyphs lying close to each other. */
+    {
+        Glyph glyphs[] = { 10, 11, 12, 15, 20, 21, 40 };
+
+        CoverageTable coverage;
+        coverage.coverageFormat = 1;
+        coverage.format1.glyphCount = sizeof(glyphs) / sizeof(Glyph);
+        coverage.format1.glyphArray = glyphs;
+
+        testCoverage(coverage, Kind::Direct);
+    }
+
+    /* Test with glyphs spread evenly over a large span. */
+    {
+        vector<Glyph> glyphs;
+        for (SFUInteger glyph = 7; glyph < 60000; glyph += 29) {
+            glyphs.push_back((Glyph)glyph);
+        }
+
+        CoverageTable coverage;
+        coverage.coverageFormat = 1;
+        coverage.format1.glyphCount = (UInt16)glyphs.size();
+        coverage.format1.glyphArray = glyphs.data();
+
+        testCoverage(coverage, Kind::Ranked);
+    }
+
+    /* Test with glyphs scattered over the whole glyph space. */
+    {
+        vector<Glyph> glyphs;
+        for (SFUInteger glyph = 1; glyph < 0xFF00; glyph += 997) {
+            glyphs.push_back((Glyph)glyph);
+            glyphs.push_back((Glyph)(glyph + 1));
+        }
+
+        CoverageTable coverage;
+        coverage.coverageFormat = 1;
+        coverage.format1.glyphCount = (UInt16)glyphs.size();
+        coverage.format1.glyphArray = glyphs.data();
+
+        testCoverage(coverage, Kind::Ranges);
+    }
+
+    /* Test with an empty coverage. */
+    {
+        CoverageTable coverage;
+        coverage.coverageFormat = 1;
+        coverage.format1.glyphCount = 0;
+        coverage.format1.glyphArray = NULL;
+
+        testCoverage(coverage, Kind::Ranges);
+    }
+}
+
+void GlyphMapTester::testCoverageFormat2()
+{
+    /* Test with ranges lying close to each other. */
+    {
+        RangeRecord ranges[3];
+        ranges[0].start = 5;
+        ranges[0].end = 9;
+        ranges[0].startCoverageIndex = 0;
+        ranges[1].start = 10;
+        ranges[1].end = 14;
+        ranges[1].startCoverageIndex = 5;
+        ranges[2].start = 30;
+        ranges[2].end = 35;
+        ranges[2].startCoverageIndex = 10;
+
+        CoverageTable coverage;
+        coverage.coverageFormat = 2;
+        coverage.format2.rangeCount = 3;
+        coverage.format2.rangeRecord = ranges;
+
+        testCoverage(coverage, Kind::Direct);
+    }
+
+    /* Test with ranges scattered over the whole glyph space. */
+    {
+        RangeRecord ranges[4];
+        ranges[0].start = 0;
+        ranges[0].end = 2;
+        ranges[0].startCoverageIndex = 0;
+        ranges[1].start = 1000;
+        ranges[1].end = 1010;
+        ranges[1].startCoverageIndex = 3;
+        ranges[2].start = 30000;
+        ranges[2].end = 30000;
+        ranges[2].startCoverageIndex = 14;
+        ranges[3].start = 65500;
+        ranges[3].end = 65535;
+        ranges[3].startCoverageIndex = 15;
+
+        CoverageTable coverage;
+        coverage.coverageFormat = 2;
+        coverage.format2.rangeCount = 4;
+        coverage.format2.rangeRecord = ranges;
+
+        testCoverage(coverage, Kind::Ranges);
+    }
+
+    /* Test with ranges whose coverage indexes are not in the order of glyphs. */
+    {
+        vector<RangeRecord> ranges(1000);
+        for (size_t i = 0; i < ranges.size(); i++) {
+            ranges[i].start = (Glyph)(i * 50);
+            ranges[i].end = (Glyph)(i * 50 + 1);
+            ranges[i].startCoverageIndex = (UInt16)((ranges.size() - i - 1) * 2);
+        }
+
+        CoverageTable coverage;
+        coverage.coverageFormat = 2;
+        coverage.format2.rangeCount = (UInt16)ranges.size();
+        coverage.format2.rangeRecord = ranges.data();
+
+        testCoverage(coverage, Kind::Ranges);
+    }
+}
+
+void GlyphMapTester::testInvalidCoverage()
+{
+    /* Test with unsorted glyphs. */
+    {
+        Glyph glyphs[] = { 10, 9 };
+
+        CoverageTable coverage;
+        coverage.coverageFormat = 1;
+        coverage.format1.glyphCount = 2;
+        coverage.format1.glyphArray = glyphs;
+
+        Writer writer;
+        writer.write(&coverage);
+
+        SFGlyphMap glyphMap;
+        assert(!SFGlyphMapInitializeWithCoverage(&glyphMap, defaultAllocator(), writer.data(), writer.size()));
+    }
+
+    /* Test with a truncated table. */
+    {
+        Glyph glyphs[] = { 1, 2, 3 };
+
+        CoverageTable coverage;
+        coverage.coverageFormat = 1;
+        coverage.format1.glyphCount = 3;
+        coverage.format1.glyphArray = glyphs;
+
+        Writer writer;
+        writer.write(&coverage);
+
+        SFGlyphMap glyphMap;
+        assert(!SFGlyphMapInitializeWithCoverage(&glyphMap, defaultAllocator(), writer.data(), writer.size() - 1));
+    }
+}
+
+void GlyphMapTester::testClassDefFormat1()
+{
+    /* Test with a few glyphs including the ones of class zero. */
+    {
+        UInt16 classes[] = { 1, 1, 0, 2, 2, 2, 0, 0, 3, 1 };
+
+        ClassDefTable classDef;
+        classDef.classFormat = 1;
+        classDef.format1.startGlyph = 100;
+        classDef.format1.glyphCount = sizeof(classes) / sizeof(UInt16);
+        classDef.format1.classValueArray = classes;
+
+        testClassDef(classDef, Kind::Direct);
+    }
+
+    /* Test with glyphs reaching the end of glyph space. */
+    {
+        vector<UInt16> classes(4000);
+        for (size_t i = 0; i < classes.size(); i++) {
+            classes[i] = (UInt16)(i % 5);
+        }
+
+        ClassDefTable classDef;
+        classDef.classFormat = 1;
+        classDef.format1.startGlyph = (Glyph)(0x10000 - classes.size());
+        classDef.format1.glyphCount = (UInt16)classes.size();
+        classDef.format1.classValueArray = classes.data();
+
+        testClassDef(classDef, Kind::Direct);
+    }
+}
+
+void GlyphMapTester::testClassDefFormat2()
+{
+    /* Test with contiguous ranges of same class. */
+    {
+        ClassRangeRecord ranges[4];
+        ranges[0].start = 10;
+        ranges[0].end = 19;
+        ranges[0].clazz = 4;
+        ranges[1].start = 20;
+        ranges[1].end = 29;
+        ranges[1].clazz = 4;
+        ranges[2].start = 30;
+        ranges[2].end = 39;
+        ranges[2].clazz = 0;
+        ranges[3].start = 50;
+        ranges[3].end = 50;
+        ranges[3].clazz = 7;
+
+        ClassDefTable classDef;
+        classDef.classFormat = 2;
+        classDef.format2.classRangeCount = 4;
+        classDef.format2.classRangeRecord = ranges;
+
+        testClassDef(classDef, Kind::Direct);
+    }
+
+    /* Test with glyphs clustered in a few places of a large span. */
+    {
+        vector<ClassRangeRecord> ranges;
+        for (SFUInteger glyph = 100; glyph < 300; glyph++) {
+            ClassRangeRecord range;
+            range.start = (Glyph)glyph;
+            range.end = (Glyph)glyph;
+            range.clazz = (UInt16)((glyph % 7) + 1);
+
+            ranges.push_back(range);
+        }
+        for (SFUInteger glyph = 40000; glyph < 40400; glyph += 2) {
+            ClassRangeRecord range;
+            range.start = (Glyph)glyph;
+            range.end = (Glyph)glyph;
+            range.clazz = (UInt16)((glyph % 3) + 1);
+
+            ranges.push_back(range);
+        }
+
+        ClassDefTable classDef;
+        classDef.classFormat = 2;
+        classDef.format2.classRangeCount = (UInt16)ranges.size();
+        classDef.format2.classRangeRecord = ranges.data();
+
+        testClassDef(classDef, Kind::Paged);
+    }
+
+    /* Test with ranges scattered over the whole glyph space. */
+    {
+        ClassRangeRecord ranges[4];
+        ranges[0].start = 0;
+        ranges[0].end = 2;
+        ranges[0].clazz = 1;
+        ranges[1].start = 1000;
+        ranges[1].end = 1010;
+        ranges[1].clazz = 2;
+        ranges[2].start = 30000;
+        ranges[2].end = 30000;
+        ranges[2].clazz = 3;
+        ranges[3].start = 65500;
+        ranges[3].end = 65535;
+        ranges[3].clazz = 0xFFFF;
+
+        ClassDefTable classDef;
+        classDef.classFormat = 2;
+        classDef.format2.classRangeCount = 4;
+        classDef.format2.classRangeRecord = ranges;
+
+        testClassDef(classDef, Kind::Ranges);
+    }
+}
+
+void GlyphMapTester::testInvalidClassDef()
+{
+    /* Test with overlapping ranges. */
+    {
+        ClassRangeRecord ranges[2];
+        ranges[0].start = 10;
+        ranges[0].end = 20;
+        ranges[0].clazz = 1;
+        ranges[1].start = 20;
+        ranges[1].end = 30;
+        ranges[1].clazz = 2;
+
+        ClassDefTable classDef;
+        classDef.classFormat = 2;
+        classDef.format2.classRangeCount = 2;
+        classDef.format2.classRangeRecord = ranges;
+
+        Writer writer;
+        writer.write(&classDef);
+
+        SFGlyphMap glyphMap;
+        assert(!SFGlyphMapInitializeWithClassDef(&glyphMap, defaultAllocator(), writer.data(), writer.size()));
+    }
+
+    /* Test with an unknown format. */
+    {
+        ClassDefTable classDef;
+        classDef.classFormat = 2;
+        classDef.format2.classRangeCount = 0;
+        classDef.format2.classRangeRecord = NULL;
+
+        Writer writer;
+        writer.write(&classDef);
+
+        writer.data()[1] = 3;
+
+        SFGlyphMap glyphMap;
+        assert(!SFGlyphMapInitializeWithClassDef(&glyphMap, defaultAllocator(), writer.data(), writer.size()));
+    }
+}
+
+void GlyphMapTester::test()
+{
+    testCoverageFormat1();
+    testCoverageFormat2();
+    testInvalidCoverage();
+    testClassDefFormat1();
+    testClassDefFormat2();
+    testInvalidClassDef();
+}
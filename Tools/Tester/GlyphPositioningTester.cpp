@@ -131,6 +131,18 @@ void TextProcessorTester::testPairPositioning()
                             pair_rule { 5, 6, negative1, negative2 }
                         }),
                         { 5, 6 }, { {-900, -800}, {-400, -300} }, { -700, -200 });
+        /* Test by letting second glyph match in the pair set of first glyph only. */
+        testPositioning(builder.createPairPos({
+                            pair_rule { 1, 4, positive1, positive2 },
+                            pair_rule { 3, 4, negative1, negative2 }
+                        }),
+                        { 3, 4 }, { {-900, -800}, {-400, -300} }, { -700, -200 });
+        /* Test with a second glyph belonging to the pair set of another glyph. */
+        testPositioning(builder.createPairPos({
+                            pair_rule { 1, 2, positive1, positive2 },
+                            pair_rule { 3, 4, negative1, negative2 }
+                        }),
+                        { 3, 2 }, { {0, 0}, {0, 0} }, { 0, 0 });
     }
 
     /* Test the second format. */
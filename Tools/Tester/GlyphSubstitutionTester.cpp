@@ -51,6 +51,24 @@ void TextProcessorTester::testSingleSubstitution()
         /* Test with a different substitution. */
         testSubstitution(builder.createSingleSubst({ {1, 100} }), { 1 }, { 100 });
     }
+
+    /* Test the runs of consecutive lookups. */
+    {
+        /* Test with substitutions following each other. */
+        testSubstitutionRun({ &builder.createSingleSubst({ {1, 2} }),
+                              &builder.createSingleSubst({ {2, 3} }) },
+                            { 1, 2, 4 }, { 3, 3, 4 }, 1);
+        /* Test with both formats and a substitution returning to the input glyph. */
+        testSubstitutionRun({ &builder.createSingleSubst({ 1 }, 99),
+                              &builder.createSingleSubst({ {100, 1}, {5, 6} }),
+                              &builder.createSingleSubst({ 6 }, -1) },
+                            { 1, 5, 6, 7 }, { 1, 5, 5, 7 }, 1);
+        /* Test with a ligature breaking the run. */
+        testSubstitutionRun({ &builder.createSingleSubst({ {1, 2} }),
+                              &builder.createLigatureSubst({ {{ 2, 3 }, 4} }),
+                              &builder.createSingleSubst({ {4, 5} }) },
+                            { 1, 3 }, { 5 }, 0);
+    }
 }
 
 void TextProcessorTester::testMultipleSubstitution()
@@ -133,4 +151,15 @@ void TextProcessorTester::testLigatureSubstitution()
     testSubstitution(builder.createLigatureSubst({ {{ 1, 1, 1 }, 100} }), { 1, 1, 1 }, { 100 });
     /* Test with multiple zero glyphs. */
     testSubstitution(builder.createLigatureSubst({ {{ 0, 0, 0 }, 100} }), { 0, 0, 0 }, { 100 });
+    /* Test with partially matching glyphs. */
+    testSubstitution(builder.createLigatureSubst({ {{ 1, 2, 3 }, 100} }), { 1, 2 }, { 1, 2 });
+    /* Test with a preferred ligature being a prefix of another one. */
+    testSubstitution(builder.createLigatureSubst({ {{ 1, 2 }, 100}, {{ 1, 2, 3 }, 200} }),
+                     { 1, 2, 3 }, { 100, 3 });
+    /* Test with a ligature diverging from another one after first glyph. */
+    testSubstitution(builder.createLigatureSubst({ {{ 1, 2, 3 }, 100}, {{ 1, 3 }, 200} }),
+                     { 1, 3 }, { 200 });
+    /* Test with a ligature diverging from another one after second glyph. */
+    testSubstitution(builder.createLigatureSubst({ {{ 1, 2, 3 }, 100}, {{ 1, 2, 4 }, 200} }),
+                     { 1, 2, 4 }, { 200 });
 }
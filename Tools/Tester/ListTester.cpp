@@ -33,7 +33,7 @@ ListTester::ListTester()
 void ListTester::testInitialize()
 {
     SF_LIST(SFInteger) list;
-    SFListInitialize(&list, sizeof(SFInteger));
+    SFListInitialize(&list, sizeof(SFInteger), NULL);
 
     assert(list.items == NULL);
     assert(list.count == 0);
@@ -43,7 +43,7 @@ void ListTester::testInitialize()
 void ListTester::testSetCapacity()
 {
     SF_LIST(SFInteger) list;
-    SFListInitialize(&list, sizeof(SFInteger));
+    SFListInitialize(&list, sizeof(SFInteger), NULL);
 
     /* Test by setting a finite capacity. */
     SFListSetCapacity(&list, 1024);
@@ -59,7 +59,7 @@ void ListTester::testSetCapacity()
 void ListTester::testReserveRange()
 {
     SF_LIST(SFInteger) list;
-    SFListInitialize(&list, sizeof(SFInteger));
+    SFListInitialize(&list, sizeof(SFInteger), NULL);
 
     /* Test by reserving some items. */
     SFListReserveRange(&list, 0, 10);
@@ -99,7 +99,7 @@ void ListTester::testReserveRange()
 void ListTester::testAdd()
 {
     SF_LIST(SFInteger) list;
-    SFListInitialize(&list, sizeof(SFInteger));
+    SFListInitialize(&list, sizeof(SFInteger), NULL);
 
     SFListAdd(&list, 100);
     SFListAdd(&list, 200);
@@ -116,7 +116,7 @@ void ListTester::testAdd()
 void ListTester::testInsert()
 {
     SF_LIST(SFInteger) list;
-    SFListInitialize(&list, sizeof(SFInteger));
+    SFListInitialize(&list, sizeof(SFInteger), NULL);
 
     SFListInsert(&list, 0, 100);
     SFListInsert(&list, 0, 200);
@@ -133,7 +133,7 @@ void ListTester::testInsert()
 void ListTester::testRemoveAt()
 {
     SF_LIST(SFInteger) list;
-    SFListInitialize(&list, sizeof(SFInteger));
+    SFListInitialize(&list, sizeof(SFInteger), NULL);
 
     SFListReserveRange(&list, 0, 5);
     SFListSetVal(&list, 0, 100);
@@ -169,7 +169,7 @@ void ListTester::testRemoveAt()
 void ListTester::testRemoveRange()
 {
     SF_LIST(SFInteger) list;
-    SFListInitialize(&list, sizeof(SFInteger));
+    SFListInitialize(&list, sizeof(SFInteger), NULL);
     SFListReserveRange(&list, 0, 25);
 
     /* Test by removing items at the end of the list. */
@@ -209,7 +209,7 @@ void ListTester::testRemoveRange()
 void ListTester::testClear()
 {
     SF_LIST(SFInteger) list;
-    SFListInitialize(&list, sizeof(SFInteger));
+    SFListInitialize(&list, sizeof(SFInteger), NULL);
 
     SFListReserveRange(&list, 0, 5);
     SFListSetVal(&list, 0, 100);
@@ -227,7 +227,7 @@ void ListTester::testClear()
 void ListTester::testTrimExcess()
 {
     SF_LIST(SFInteger) list;
-    SFListInitialize(&list, sizeof(SFInteger));
+    SFListInitialize(&list, sizeof(SFInteger), NULL);
     SFListSetCapacity(&list, 1024);
 
     SFListReserveRange(&list, 0, 5);
@@ -249,7 +249,7 @@ void ListTester::testIndexOfItem()
     SFInteger item;
     SFUInteger index;
 
-    SFListInitialize(&list, sizeof(SFInteger));
+    SFListInitialize(&list, sizeof(SFInteger), NULL);
 
     SFListAdd(&list, -500);
     SFListAdd(&list, -400);
@@ -309,7 +309,7 @@ static int SFIntegerComparison(const void *item1, const void *item2)
 void ListTester::testSort()
 {
     SF_LIST(SFInteger) list;
-    SFListInitialize(&list, sizeof(SFInteger));
+    SFListInitialize(&list, sizeof(SFInteger), NULL);
 
     SFListAdd(&list, 300);
     SFListAdd(&list, -100);
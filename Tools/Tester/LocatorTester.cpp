@@ -20,6 +20,7 @@
 
 extern "C" {
 #include <Source/SFAlbum.h>
+#include <Source/SFFontCache.h>
 #include <Source/SFLocator.h>
 }
 
@@ -126,6 +127,44 @@ static const SFGlyphTraits TRAIT_LIST_12[] = {
     SFGlyphTraitPlaceholder,
 };
 
+static const SFGlyphTraits TRAIT_LIST_16[] = {
+    SFGlyphTraitBase,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitPlaceholder,
+    SFGlyphTraitPlaceholder,
+    SFGlyphTraitPlaceholder,
+    SFGlyphTraitPlaceholder,
+    SFGlyphTraitPlaceholder,
+    SFGlyphTraitPlaceholder,
+    SFGlyphTraitPlaceholder,
+    SFGlyphTraitPlaceholder,
+    SFGlyphTraitPlaceholder,
+    SFGlyphTraitPlaceholder,
+    SFGlyphTraitPlaceholder,
+    SFGlyphTraitLigature,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitMark,
+    SFGlyphTraitBase,
+};
+
 static const SFGlyphTraits TRAIT_LIST_13[] = {
     SFGlyphTraitNone,
     SFGlyphTraitBase,
@@ -252,8 +291,11 @@ static void testMoveNext(const SFGlyphTraits *traits, SFInteger count)
 {
     SFAlbumRef album = SFAlbumCreateWithTraits(traits, (SFUInteger)count);
 
+    SFFontCache fontCache;
+    SFFontCacheInitialize(&fontCache, NULL);
+
     SFLocator locator;
-    SFLocatorInitialize(&locator, album, NULL);
+    SFLocatorInitialize(&locator, album, &fontCache, NULL);
 
     const SFLookupFlag *lookupFlagArray = LOOKUP_FLAG_LIST;
     SFInteger lookupFlagCount = sizeof(LOOKUP_FLAG_LIST) / sizeof(SFLookupFlag);
@@ -281,6 +323,7 @@ static void testMoveNext(const SFGlyphTraits *traits, SFInteger count)
         }
     }
 
+    SFFontCacheFinalize(&fontCache);
     SFAlbumRelease(album);
 }
 
@@ -288,8 +331,11 @@ static void testSkip(const SFGlyphTraits *traits, SFInteger count)
 {
     SFAlbumRef album = SFAlbumCreateWithTraits(traits, (SFUInteger)count);
 
+    SFFontCache fontCache;
+    SFFontCacheInitialize(&fontCache, NULL);
+
     SFLocator locator;
-    SFLocatorInitialize(&locator, album, NULL);
+    SFLocatorInitialize(&locator, album, &fontCache, NULL);
 
     const SFLookupFlag *lookupFlagArray = LOOKUP_FLAG_LIST;
     SFInteger lookupFlagCount = sizeof(LOOKUP_FLAG_LIST) / sizeof(SFLookupFlag);
@@ -325,6 +371,7 @@ static void testSkip(const SFGlyphTraits *traits, SFInteger count)
         }
     }
 
+    SFFontCacheFinalize(&fontCache);
     SFAlbumRelease(album);
 }
 
@@ -332,8 +379,11 @@ static void testJumpTo(const SFGlyphTraits *traits, SFInteger count)
 {
     SFAlbumRef album = SFAlbumCreateWithTraits(traits, (SFUInteger)count);
 
+    SFFontCache fontCache;
+    SFFontCacheInitialize(&fontCache, NULL);
+
     SFLocator locator;
-    SFLocatorInitialize(&locator, album, NULL);
+    SFLocatorInitialize(&locator, album, &fontCache, NULL);
 
     const SFLookupFlag *lookupFlagArray = LOOKUP_FLAG_LIST;
     SFInteger lookupFlagCount = sizeof(LOOKUP_FLAG_LIST) / sizeof(SFLookupFlag);
@@ -363,6 +413,7 @@ static void testJumpTo(const SFGlyphTraits *traits, SFInteger count)
         }
     }
 
+    SFFontCacheFinalize(&fontCache);
     SFAlbumRelease(album);
 }
 
@@ -370,8 +421,11 @@ static void testGetAfter(const SFGlyphTraits *traits, SFInteger count)
 {
     SFAlbumRef album = SFAlbumCreateWithTraits(traits, (SFUInteger)count);
 
+    SFFontCache fontCache;
+    SFFontCacheInitialize(&fontCache, NULL);
+
     SFLocator locator;
-    SFLocatorInitialize(&locator, album, NULL);
+    SFLocatorInitialize(&locator, album, &fontCache, NULL);
 
     const SFLookupFlag *lookupFlagArray = LOOKUP_FLAG_LIST;
     SFInteger lookupFlagCount = sizeof(LOOKUP_FLAG_LIST) / sizeof(SFLookupFlag);
@@ -397,6 +451,7 @@ static void testGetAfter(const SFGlyphTraits *traits, SFInteger count)
         }
     }
 
+    SFFontCacheFinalize(&fontCache);
     SFAlbumRelease(album);
 }
 
@@ -404,8 +459,11 @@ static void testGetBefore(const SFGlyphTraits *traits, SFInteger count)
 {
     SFAlbumRef album = SFAlbumCreateWithTraits(traits, (SFUInteger)count);
 
+    SFFontCache fontCache;
+    SFFontCacheInitialize(&fontCache, NULL);
+
     SFLocator locator;
-    SFLocatorInitialize(&locator, album, NULL);
+    SFLocatorInitialize(&locator, album, &fontCache, NULL);
 
     const SFLookupFlag *lookupFlagArray = LOOKUP_FLAG_LIST;
     SFInteger lookupFlagCount = sizeof(LOOKUP_FLAG_LIST) / sizeof(SFLookupFlag);
@@ -431,6 +489,78 @@ static void testGetBefore(const SFGlyphTraits *traits, SFInteger count)
         }
     }
 
+    SFFontCacheFinalize(&fontCache);
+    SFAlbumRelease(album);
+}
+
+static void testSkipVectors(const SFGlyphTraits *traits, SFInteger count)
+{
+    SFAlbumRef album = SFAlbumCreateWithTraits(traits, (SFUInteger)count);
+    SFAlbumBeginArranging(album);
+
+    SFFontCache fontCache;
+    SFFontCacheInitialize(&fontCache, NULL);
+
+    SFSkipVectors skipVectors;
+    SFSkipVectorsInitialize(&skipVectors, NULL);
+
+    SFLocator expected;
+    SFLocatorInitialize(&expected, album, &fontCache, NULL);
+
+    SFLocator actual;
+    SFLocatorInitialize(&actual, album, &fontCache, NULL);
+    SFLocatorSetSkipVectors(&actual, &skipVectors);
+
+    const SFLookupFlag *lookupFlagArray = LOOKUP_FLAG_LIST;
+    SFInteger lookupFlagCount = sizeof(LOOKUP_FLAG_LIST) / sizeof(SFLookupFlag);
+
+    /*
+     * Exceed the number of kept vectors so that they are also rebuilt, requesting each criterion
+     * twice so that the first request scans the glyphs and the second one builds the vector.
+     */
+    for (SFInteger i = 0; i < lookupFlagCount * 4; i++) {
+        SFLookupFlag lookupFlag = lookupFlagArray[(i / 2) % lookupFlagCount];
+        bool isRepeated = (i % 2 == 1);
+
+        SFLocatorSetLookupFlag(&expected, lookupFlag);
+        SFLocatorSetLookupFlag(&actual, lookupFlag);
+
+        /* Test all subranges of the album. */
+        for (SFInteger start = 0; start < count; start++) {
+            for (SFInteger limit = start + 1; limit <= count; limit++) {
+                SFUInteger length = (SFUInteger)(limit - start);
+
+                SFLocatorReset(&expected, (SFUInteger)start, length);
+                SFLocatorReset(&actual, (SFUInteger)start, length);
+
+                for (SFInteger index = start; index < limit; index++) {
+                    assert(SFLocatorGetAfter(&actual, (SFUInteger)index) == SFLocatorGetAfter(&expected, (SFUInteger)index));
+                    assert(SFLocatorGetBefore(&actual, (SFUInteger)index) == SFLocatorGetBefore(&expected, (SFUInteger)index));
+                }
+
+                while (true) {
+                    SFBoolean hasNext = SFLocatorMoveNext(&expected);
+
+                    assert(SFLocatorMoveNext(&actual) == hasNext);
+                    assert(actual.index == expected.index);
+
+                    if (!hasNext) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (isRepeated) {
+            assert(actual._skipVector != NULL && actual._skipVector->_isBuilt);
+        } else {
+            assert(actual._skipVector == NULL && actual._scansMasks);
+        }
+    }
+
+    SFSkipVectorsFinalize(&skipVectors);
+    SFFontCacheFinalize(&fontCache);
+    SFAlbumEndArranging(album);
     SFAlbumRelease(album);
 }
 
@@ -473,8 +603,9 @@ LocatorTester::LocatorTester()
     Writer writer;
     writer.write(&gdef);
 
-    m_gdef = new uint8_t[writer.size()];
-    memcpy(m_gdef, writer.data(), (size_t)writer.size());
+    m_gdefSize = (size_t)writer.size();
+    m_gdef = new uint8_t[m_gdefSize];
+    memcpy(m_gdef, writer.data(), m_gdefSize);
 }
 
 LocatorTester::~LocatorTester()
@@ -499,6 +630,7 @@ void LocatorTester::testMoveNext()
     ::testMoveNext(TRAIT_LIST_13, sizeof(TRAIT_LIST_13) / sizeof(SFGlyphTraits));
     ::testMoveNext(TRAIT_LIST_14, sizeof(TRAIT_LIST_14) / sizeof(SFGlyphTraits));
     ::testMoveNext(TRAIT_LIST_15, sizeof(TRAIT_LIST_15) / sizeof(SFGlyphTraits));
+    ::testMoveNext(TRAIT_LIST_16, sizeof(TRAIT_LIST_16) / sizeof(SFGlyphTraits));
 }
 
 void LocatorTester::testSkip()
@@ -518,6 +650,7 @@ void LocatorTester::testSkip()
     ::testSkip(TRAIT_LIST_13, sizeof(TRAIT_LIST_13) / sizeof(SFGlyphTraits));
     ::testSkip(TRAIT_LIST_14, sizeof(TRAIT_LIST_14) / sizeof(SFGlyphTraits));
     ::testSkip(TRAIT_LIST_15, sizeof(TRAIT_LIST_15) / sizeof(SFGlyphTraits));
+    ::testSkip(TRAIT_LIST_16, sizeof(TRAIT_LIST_16) / sizeof(SFGlyphTraits));
 }
 
 void LocatorTester::testJumpTo()
@@ -537,6 +670,7 @@ void LocatorTester::testJumpTo()
     ::testJumpTo(TRAIT_LIST_13, sizeof(TRAIT_LIST_13) / sizeof(SFGlyphTraits));
     ::testJumpTo(TRAIT_LIST_14, sizeof(TRAIT_LIST_14) / sizeof(SFGlyphTraits));
     ::testJumpTo(TRAIT_LIST_15, sizeof(TRAIT_LIST_15) / sizeof(SFGlyphTraits));
+    ::testJumpTo(TRAIT_LIST_16, sizeof(TRAIT_LIST_16) / sizeof(SFGlyphTraits));
 }
 
 void LocatorTester::testGetAfter()
@@ -556,6 +690,7 @@ void LocatorTester::testGetAfter()
     ::testGetAfter(TRAIT_LIST_13, sizeof(TRAIT_LIST_13) / sizeof(SFGlyphTraits));
     ::testGetAfter(TRAIT_LIST_14, sizeof(TRAIT_LIST_14) / sizeof(SFGlyphTraits));
     ::testGetAfter(TRAIT_LIST_15, sizeof(TRAIT_LIST_15) / sizeof(SFGlyphTraits));
+    ::testGetAfter(TRAIT_LIST_16, sizeof(TRAIT_LIST_16) / sizeof(SFGlyphTraits));
 }
 
 void LocatorTester::testGetBefore()
@@ -575,6 +710,27 @@ void LocatorTester::testGetBefore()
     ::testGetBefore(TRAIT_LIST_13, sizeof(TRAIT_LIST_13) / sizeof(SFGlyphTraits));
     ::testGetBefore(TRAIT_LIST_14, sizeof(TRAIT_LIST_14) / sizeof(SFGlyphTraits));
     ::testGetBefore(TRAIT_LIST_15, sizeof(TRAIT_LIST_15) / sizeof(SFGlyphTraits));
+    ::testGetBefore(TRAIT_LIST_16, sizeof(TRAIT_LIST_16) / sizeof(SFGlyphTraits));
+}
+
+void LocatorTester::testSkipVectors()
+{
+    ::testSkipVectors(TRAIT_LIST_1, sizeof(TRAIT_LIST_1) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_2, sizeof(TRAIT_LIST_2) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_3, sizeof(TRAIT_LIST_3) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_4, sizeof(TRAIT_LIST_4) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_5, sizeof(TRAIT_LIST_5) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_6, sizeof(TRAIT_LIST_6) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_7, sizeof(TRAIT_LIST_7) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_8, sizeof(TRAIT_LIST_8) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_9, sizeof(TRAIT_LIST_9) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_10, sizeof(TRAIT_LIST_10) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_11, sizeof(TRAIT_LIST_11) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_12, sizeof(TRAIT_LIST_12) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_13, sizeof(TRAIT_LIST_13) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_14, sizeof(TRAIT_LIST_14) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_15, sizeof(TRAIT_LIST_15) / sizeof(SFGlyphTraits));
+    ::testSkipVectors(TRAIT_LIST_16, sizeof(TRAIT_LIST_16) / sizeof(SFGlyphTraits));
 }
 
 void LocatorTester::testMarkFilteringSet()
@@ -587,16 +743,32 @@ void LocatorTester::testMarkFilteringSet()
 
     SFAlbumRef album = SFAlbumCreateWithTraits(traits, (SFUInteger)count);
 
-    SFLocator locator;
-    SFLocatorInitialize(&locator, album, m_gdef);
-    SFLocatorReset(&locator, 0, (SFUInteger)count);
-    SFLocatorSetLookupFlag(&locator, SFLookupFlagUseMarkFilteringSet);
-    SFLocatorSetMarkFilteringSet(&locator, 0);
-
-    /* Zero mark filtering set contains even glyphs, so we should get only those. */
-    while (SFLocatorMoveNext(&locator)) {
-        SFGlyphID glyph = SFAlbumGetGlyph(album, locator.index);
-        assert((glyph % 2) == 0);
+    /* Test with the compiled GDEF as well as with the raw one. */
+    for (int compiled = 0; compiled < 2; compiled++) {
+        SFFontCache fontCache;
+        SFFontCacheInitialize(&fontCache, NULL);
+        if (compiled) {
+            SFFontCacheLoadGDEF(&fontCache, m_gdef, (SFUInteger)m_gdefSize);
+        }
+
+        SFLocator locator;
+        SFLocatorInitialize(&locator, album, &fontCache, m_gdef);
+        SFLocatorReset(&locator, 0, (SFUInteger)count);
+        SFLocatorSetLookupFlag(&locator, SFLookupFlagUseMarkFilteringSet);
+        SFLocatorSetMarkFilteringSet(&locator, 0);
+        assert((locator._markFilteringSet != NULL) == (compiled != 0));
+
+        int visited = 0;
+
+        /* Zero mark filtering set contains even glyphs, so we should get only those. */
+        while (SFLocatorMoveNext(&locator)) {
+            SFGlyphID glyph = SFAlbumGetGlyph(album, locator.index);
+            assert((glyph % 2) == 0);
+            visited += 1;
+        }
+        assert(visited == count / 2);
+
+        SFFontCacheFinalize(&fontCache);
     }
 
     SFAlbumRelease(album);
@@ -612,15 +784,31 @@ void LocatorTester::testMarkAttachmentType()
 
     SFAlbumRef album = SFAlbumCreateWithTraits(traits, (SFUInteger)count);
 
-    SFLocator locator;
-    SFLocatorInitialize(&locator, album, m_gdef);
-    SFLocatorReset(&locator, 0, (SFUInteger)count);
-    SFLocatorSetLookupFlag(&locator, 0x0100);
-
-    /* Class 1 contains odd glyphs, so we should get only those. */
-    while (SFLocatorMoveNext(&locator)) {
-        SFGlyphID glyph = SFAlbumGetGlyph(album, locator.index);
-        assert((glyph % 2) == 1);
+    /* Test with the compiled GDEF as well as with the raw one. */
+    for (int compiled = 0; compiled < 2; compiled++) {
+        SFFontCache fontCache;
+        SFFontCacheInitialize(&fontCache, NULL);
+        if (compiled) {
+            SFFontCacheLoadGDEF(&fontCache, m_gdef, (SFUInteger)m_gdefSize);
+        }
+
+        SFLocator locator;
+        SFLocatorInitialize(&locator, album, &fontCache, m_gdef);
+        SFLocatorReset(&locator, 0, (SFUInteger)count);
+        SFLocatorSetLookupFlag(&locator, 0x0100);
+        assert((locator._markAttachClasses != NULL) == (compiled != 0));
+
+        int visited = 0;
+
+        /* Class 1 contains odd glyphs, so we should get only those. */
+        while (SFLocatorMoveNext(&locator)) {
+            SFGlyphID glyph = SFAlbumGetGlyph(album, locator.index);
+            assert((glyph % 2) == 1);
+            visited += 1;
+        }
+        assert(visited == count / 2);
+
+        SFFontCacheFinalize(&fontCache);
     }
 
     SFAlbumRelease(album);
@@ -633,6 +821,7 @@ void LocatorTester::test()
     testJumpTo();
     testGetAfter();
     testGetBefore();
+    testSkipVectors();
     testMarkFilteringSet();
     testMarkAttachmentType();
 }
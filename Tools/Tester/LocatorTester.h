@@ -30,6 +30,7 @@ public:
     void testJumpTo();
     void testGetAfter();
     void testGetBefore();
+    void testSkipVectors();
     void testMarkFilteringSet();
     void testMarkAttachmentType();
 
@@ -37,6 +38,7 @@ public:
 
 private:
     uint8_t *m_gdef;
+    size_t m_gdefSize;
 };
 
 }
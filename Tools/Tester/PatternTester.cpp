@@ -33,7 +33,7 @@ PatternTester::PatternTester()
 
 void PatternTester::testNoFeatures()
 {
-    SFPatternRef pattern = SFPatternCreate();
+    SFPatternRef pattern = SFPatternCreate(NULL);
 
     SFPatternBuilder builder;
     SFPatternBuilderInitialize(&builder, pattern);
@@ -63,7 +63,7 @@ void PatternTester::testDistinctFeatures()
 {
     /* Test with only substitution features. */
     {
-        SFPatternRef pattern = SFPatternCreate();
+        SFPatternRef pattern = SFPatternCreate(NULL);
 
         SFPatternBuilder builder;
         SFPatternBuilderInitialize(&builder, pattern);
@@ -121,7 +121,7 @@ void PatternTester::testDistinctFeatures()
 
     /* Test with only positioning features. */
     {
-        SFPatternRef pattern = SFPatternCreate();
+        SFPatternRef pattern = SFPatternCreate(NULL);
 
         SFPatternBuilder builder;
         SFPatternBuilderInitialize(&builder, pattern);
@@ -180,7 +180,7 @@ void PatternTester::testDistinctFeatures()
 
 void PatternTester::testSimultaneousFeatures()
 {
-    SFPatternRef pattern = SFPatternCreate();
+    SFPatternRef pattern = SFPatternCreate(NULL);
 
     SFPatternBuilder builder;
     SFPatternBuilderInitialize(&builder, pattern);
@@ -243,7 +243,7 @@ void PatternTester::testLookupIndexSorting()
 {
     /* Test with no index collision. */
     {
-        SFPatternRef pattern = SFPatternCreate();
+        SFPatternRef pattern = SFPatternCreate(NULL);
 
         SFPatternBuilder builder;
         SFPatternBuilderInitialize(&builder, pattern);
@@ -308,7 +308,7 @@ void PatternTester::testLookupIndexSorting()
 
     /* Test with index collision in feature unit. */
     {
-        SFPatternRef pattern = SFPatternCreate();
+        SFPatternRef pattern = SFPatternCreate(NULL);
 
         SFPatternBuilder builder;
         SFPatternBuilderInitialize(&builder, pattern);
@@ -28,7 +28,9 @@ extern "C" {
 }
 
 #include "OpenType/Base.h"
+#include "OpenType/Builder.h"
 #include "OpenType/Common.h"
+#include "OpenType/GDEF.h"
 #include "OpenType/GSUB.h"
 #include "OpenType/Writer.h"
 #include "TextProcessorTester.h"
@@ -56,11 +58,90 @@ static void loadTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *leng
     }
 }
 
+struct FontTables {
+    Writer &gdef;
+    Writer &gsub;
+    Writer &gpos;
+};
+
+static void loadTables(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length)
+{
+    FontTables *fontTables = reinterpret_cast<FontTables *>(object);
+    Writer *writer = NULL;
+
+    switch (tag) {
+    case SFTagMake('G', 'D', 'E', 'F'):
+        writer = &fontTables->gdef;
+        break;
+    case SFTagMake('G', 'S', 'U', 'B'):
+        writer = &fontTables->gsub;
+        break;
+    case SFTagMake('G', 'P', 'O', 'S'):
+        writer = &fontTables->gpos;
+        break;
+    }
+
+    if (writer) {
+        if (buffer) {
+            memcpy(buffer, writer->data(), (size_t)writer->size());
+        }
+        if (length) {
+            *length = (SFUInteger)writer->size();
+        }
+    } else if (length) {
+        *length = 0;
+    }
+}
+
 static SFGlyphID getGlyphID(void *object, SFCodepoint codepoint)
 {
     return (SFGlyphID)codepoint;
 }
 
+struct BatchCounts {
+    size_t glyphCalls;
+    size_t advanceCalls;
+    size_t singleCalls;
+};
+
+static void loadNoTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length)
+{
+    if (length) {
+        *length = 0;
+    }
+}
+
+static SFGlyphID getSingleGlyphID(void *object, SFCodepoint codepoint)
+{
+    reinterpret_cast<BatchCounts *>(object)->singleCalls += 1;
+    return (SFGlyphID)codepoint;
+}
+
+static SFAdvance getSingleAdvance(void *object, SFFontLayout fontLayout, SFGlyphID glyphID)
+{
+    reinterpret_cast<BatchCounts *>(object)->singleCalls += 1;
+    return glyphID;
+}
+
+static void getGlyphIDs(void *object, const SFCodepoint *codepoints, SFGlyphID *glyphIDs, SFUInteger count)
+{
+    reinterpret_cast<BatchCounts *>(object)->glyphCalls += 1;
+
+    for (SFUInteger i = 0; i < count; i++) {
+        glyphIDs[i] = (SFGlyphID)(codepoints[i] - 0x20);
+    }
+}
+
+static void getAdvances(void *object, SFFontLayout fontLayout,
+    const SFGlyphID *glyphIDs, SFAdvance *advances, SFUInteger count)
+{
+    reinterpret_cast<BatchCounts *>(object)->advanceCalls += 1;
+
+    for (SFUInteger i = 0; i < count; i++) {
+        advances[i] = glyphIDs[i] * 10;
+    }
+}
+
 static void writeTable(Writer &writer,
     LookupSubtable &subtable, LookupSubtable **referrals, SFUInteger count, LookupFlag lookupFlag)
 {
@@ -146,7 +227,8 @@ static void writeTable(Writer &writer,
 static void processSubtable(SFAlbumRef album,
     const SFCodepoint *input, SFUInteger length, SFBoolean positioning,
     LookupSubtable &subtable, LookupSubtable **referrals, SFUInteger count,
-    SFBoolean isRTL = SFFalse)
+    SFBoolean isRTL = SFFalse, SFUInteger unitLookupCount = 1, SFUInteger *remapCount = NULL,
+    SFFontOptions options = SFFontOptionCompiledTables)
 {
     /* Write the table for the given lookup. */
     Writer writer;
@@ -158,18 +240,25 @@ static void processSubtable(SFAlbumRef album,
         .tag = (positioning ? SFTagMake('G', 'P', 'O', 'S') : SFTagMake('G', 'S', 'U', 'B')),
     };
 
-    /* Create the font with protocol. */
-    SFFontProtocol protocol = {
-        .finalize = NULL,
-        .loadTable = &loadTable,
-        .getGlyphIDForCodepoint = &getGlyphID,
-        .getAdvanceForGlyph = NULL,
+    /* Create the font with protocol, compiling its tables if asked. */
+    SFFontExtendedProtocol protocol = {
+        .size = sizeof(SFFontExtendedProtocol),
+        .base = {
+            .finalize = NULL,
+            .loadTable = &loadTable,
+            .getGlyphIDForCodepoint = &getGlyphID,
+            .getAdvanceForGlyph = NULL,
+        },
+        .getTable = NULL,
+        .getGlyphIDsForCodepoints = NULL,
+        .getAdvancesForGlyphs = NULL,
+        .options = options,
     };
-    SFFontRef font = SFFontCreateWithProtocol(&protocol, &object);
+    SFFontRef font = SFFontCreateWithExtendedProtocol(&protocol, &object, NULL, NULL, 0);
     SFTextDirection direction = isRTL ? SFTextDirectionRightToLeft : SFTextDirectionLeftToRight;
 
     /* Create a pattern. */
-    SFPatternRef pattern = SFPatternCreate();
+    SFPatternRef pattern = SFPatternCreate(NULL);
 
     /* Build the pattern. */
     SFPatternBuilder builder;
@@ -179,11 +268,17 @@ static void processSubtable(SFAlbumRef album,
     SFPatternBuilderSetLanguage(&builder, SFTagMake('d', 'f', 'l', 't'));
     SFPatternBuilderBeginFeatures(&builder, positioning ? SFFeatureKindPositioning : SFFeatureKindSubstitution);
     SFPatternBuilderAddFeature(&builder, SFTagMake('t', 'e', 's', 't'), 0);
-    SFPatternBuilderAddLookup(&builder, 0);
+    for (SFUInteger i = 0; i < unitLookupCount; i++) {
+        SFPatternBuilderAddLookup(&builder, (SFUInt16)i);
+    }
     SFPatternBuilderMakeFeatureUnit(&builder);
     SFPatternBuilderEndFeatures(&builder);
     SFPatternBuilderBuild(&builder);
 
+    if (remapCount) {
+        *remapCount = pattern->singleRemaps.count;
+    }
+
     /* Create the codepoint sequence. */
     SBCodepointSequence sequence;
     sequence.stringEncoding = SBStringEncodingUTF32;
@@ -216,12 +311,36 @@ void TextProcessorTester::testSubstitution(LookupSubtable &subtable,
     const vector<uint32_t> codepoints,
     const vector<Glyph> glyphs,
     const vector<LookupSubtable *> referrals)
+{
+    /* Both the raw and the compiled tables should give the same glyphs. */
+    for (SFFontOptions options : { SFFontOptionNone, SFFontOptionCompiledTables }) {
+        SFAlbum album;
+        SFAlbumInitialize(&album, NULL);
+        processSubtable(&album, &codepoints[0], codepoints.size(), SFFalse, subtable,
+                        (LookupSubtable **)referrals.data(), referrals.size(),
+                        SFFalse, 1, NULL, options);
+
+        assert(SFAlbumGetGlyphCount(&album) == glyphs.size());
+        assert(memcmp(SFAlbumGetGlyphIDsPtr(&album), glyphs.data(), sizeof(SFGlyphID) * glyphs.size()) == 0);
+
+        SFAlbumFinalize(&album);
+    }
+}
+
+void TextProcessorTester::testSubstitutionRun(const vector<LookupSubtable *> subtables,
+    const vector<uint32_t> codepoints,
+    const vector<Glyph> glyphs,
+    size_t remapCount)
 {
     SFAlbum album;
-    SFAlbumInitialize(&album);
-    processSubtable(&album, &codepoints[0], codepoints.size(), SFFalse, subtable,
-                    (LookupSubtable **)referrals.data(), referrals.size());
+    SFAlbumInitialize(&album, NULL);
+
+    SFUInteger patternRemaps;
+    processSubtable(&album, &codepoints[0], codepoints.size(), SFFalse, *subtables[0],
+                    (LookupSubtable **)subtables.data() + 1, subtables.size() - 1,
+                    SFFalse, subtables.size(), &patternRemaps);
 
+    assert(patternRemaps == remapCount);
     assert(SFAlbumGetGlyphCount(&album) == glyphs.size());
     assert(memcmp(SFAlbumGetGlyphIDsPtr(&album), glyphs.data(), sizeof(SFGlyphID) * glyphs.size()) == 0);
 }
@@ -235,14 +354,207 @@ void TextProcessorTester::testPositioning(LookupSubtable &subtable,
 {
     assert(offsets.size() == advances.size());
 
+    /* Both the raw and the compiled tables should give the same positions. */
+    for (SFFontOptions options : { SFFontOptionNone, SFFontOptionCompiledTables }) {
+        SFAlbum album;
+        SFAlbumInitialize(&album, NULL);
+        processSubtable(&album, &codepoints[0], codepoints.size(), SFTrue, subtable,
+                        (LookupSubtable **)referrals.data(), referrals.size(),
+                        isRTL, 1, NULL, options);
+
+        assert(SFAlbumGetGlyphCount(&album) == offsets.size());
+        assert(memcmp(SFAlbumGetGlyphOffsetsPtr(&album), offsets.data(), sizeof(SFPoint) * offsets.size()) == 0);
+        assert(memcmp(SFAlbumGetGlyphAdvancesPtr(&album), advances.data(), sizeof(SFInt32) * advances.size()) == 0);
+
+        SFAlbumFinalize(&album);
+    }
+}
+
+void TextProcessorTester::testBatchCallbacks()
+{
+    BatchCounts counts = { 0, 0, 0 };
+    SFFontExtendedProtocol protocol = {
+        .size = sizeof(SFFontExtendedProtocol),
+        .base = {
+            .finalize = NULL,
+            .loadTable = &loadNoTable,
+            .getGlyphIDForCodepoint = &getSingleGlyphID,
+            .getAdvanceForGlyph = &getSingleAdvance,
+        },
+        .getTable = NULL,
+        .getGlyphIDsForCodepoints = &getGlyphIDs,
+        .getAdvancesForGlyphs = &getAdvances,
+    };
+    SFFontRef font = SFFontCreateWithExtendedProtocol(&protocol, &counts, NULL, NULL, 0);
+
+    SFPatternRef pattern = SFPatternCreate(NULL);
+    SFPatternBuilder builder;
+    SFPatternBuilderInitialize(&builder, pattern);
+    SFPatternBuilderSetFont(&builder, font);
+    SFPatternBuilderSetScript(&builder, SFTagMake('d', 'f', 'l', 't'), SFTextDirectionLeftToRight);
+    SFPatternBuilderSetLanguage(&builder, SFTagMake('d', 'f', 'l', 't'));
+    SFPatternBuilderBuild(&builder);
+    SFPatternBuilderFinalize(&builder);
+
+    /* Take more code points than fit in two batches. */
+    vector<SFCodepoint> input(150);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = (SFCodepoint)('a' + (i % 26));
+    }
+
+    SBCodepointSequence sequence;
+    sequence.stringEncoding = SBStringEncodingUTF32;
+    sequence.stringBuffer = input.data();
+    sequence.stringLength = input.size();
+
+    SFCodepoints codepoints;
+    SFCodepointsInitialize(&codepoints, &sequence, SFFalse);
+
     SFAlbum album;
-    SFAlbumInitialize(&album);
-    processSubtable(&album, &codepoints[0], codepoints.size(), SFTrue, subtable,
-                    (LookupSubtable **)referrals.data(), referrals.size(), isRTL);
+    SFAlbumInitialize(&album, NULL);
+    SFAlbumReset(&album, &codepoints, input.size());
+
+    SFTextProcessor processor;
+    SFTextProcessorInitialize(&processor, pattern, &album, SFTextDirectionLeftToRight, SFTextModeForward);
+    SFTextProcessorDiscoverGlyphs(&processor);
+    SFTextProcessorSubstituteGlyphs(&processor);
+    SFTextProcessorPositionGlyphs(&processor);
+    SFTextProcessorWrapUp(&processor);
+
+    /* Test that the batch functions were preferred over the single ones. */
+    assert(counts.glyphCalls == 3);
+    assert(counts.advanceCalls == 3);
+    assert(counts.singleCalls == 0);
 
-    assert(SFAlbumGetGlyphCount(&album) == offsets.size());
-    assert(memcmp(SFAlbumGetGlyphOffsetsPtr(&album), offsets.data(), sizeof(SFPoint) * offsets.size()) == 0);
-    assert(memcmp(SFAlbumGetGlyphAdvancesPtr(&album), advances.data(), sizeof(SFInt32) * advances.size()) == 0);
+    const SFGlyphID *glyphs = SFAlbumGetGlyphIDsPtr(&album);
+    const SFInt32 *advances = SFAlbumGetGlyphAdvancesPtr(&album);
+
+    assert(SFAlbumGetGlyphCount(&album) == input.size());
+
+    for (size_t i = 0; i < input.size(); i++) {
+        assert(glyphs[i] == input[i] - 0x20);
+        assert(advances[i] == (SFInt32)(input[i] - 0x20) * 10);
+    }
+
+    SFAlbumFinalize(&album);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void TextProcessorTester::testCompactedLigatureAttachment()
+{
+    Builder builder;
+
+    /* Mark the glyph 4 so that the ligature forms across it. */
+    ClassDefTable &glyphClassDef = builder.createClassDef(4, 1, { 3 });
+
+    GDEF gdef;
+    gdef.version = 0x00010000;
+    gdef.glyphClassDef = &glyphClassDef;
+    gdef.attachList = NULL;
+    gdef.ligCaretList = NULL;
+    gdef.markAttachClassDef = NULL;
+    gdef.markGlyphSetsDef = NULL;
+
+    Writer gdefWriter;
+    gdefWriter.write(&gdef);
+
+    /* Ligate three glyphs, and then replace the ligature in a later feature unit. */
+    LookupSubtable *singleSubst = &builder.createSingleSubst({ {10, 11} });
+    Writer gsubWriter;
+    writeTable(gsubWriter, builder.createLigatureSubst({ {{1, 2, 3}, 10} }),
+               &singleSubst, 1, LookupFlag::IgnoreMarks);
+
+    /* Give each component of the replaced ligature a distinct anchor. */
+    Writer gposWriter;
+    writeTable(gposWriter, builder.createMarkToLigaturePos(1, {
+                   {4, {0, builder.createAnchor(100, 200)}}
+               }, {
+                   {11, { { builder.createAnchor(900, 800) },
+                          { builder.createAnchor(700, 600) },
+                          { builder.createAnchor(500, 400) } }}
+               }),
+               NULL, 0, (LookupFlag)0);
+
+    FontTables tables = { gdefWriter, gsubWriter, gposWriter };
+
+    /* Test with the raw tables first, and then with the compiled ones. */
+    for (SFFontOptions options : { SFFontOptionNone, SFFontOptionCompiledTables }) {
+        SFFontExtendedProtocol protocol = {
+            .size = sizeof(SFFontExtendedProtocol),
+            .base = {
+                .finalize = NULL,
+                .loadTable = &loadTables,
+                .getGlyphIDForCodepoint = &getGlyphID,
+                .getAdvanceForGlyph = NULL,
+            },
+            .getTable = NULL,
+            .getGlyphIDsForCodepoints = NULL,
+            .getAdvancesForGlyphs = NULL,
+            .options = options,
+        };
+        SFFontRef font = SFFontCreateWithExtendedProtocol(&protocol, &tables, NULL, NULL, 0);
+
+        SFPatternRef pattern = SFPatternCreate(NULL);
+        SFPatternBuilder patternBuilder;
+        SFPatternBuilderInitialize(&patternBuilder, pattern);
+        SFPatternBuilderSetFont(&patternBuilder, font);
+        SFPatternBuilderSetScript(&patternBuilder, SFTagMake('d', 'f', 'l', 't'), SFTextDirectionLeftToRight);
+        SFPatternBuilderSetLanguage(&patternBuilder, SFTagMake('d', 'f', 'l', 't'));
+        SFPatternBuilderBeginFeatures(&patternBuilder, SFFeatureKindSubstitution);
+        SFPatternBuilderAddFeature(&patternBuilder, SFTagMake('l', 'i', 'g', 'a'), 0);
+        SFPatternBuilderAddLookup(&patternBuilder, 0);
+        SFPatternBuilderMakeFeatureUnit(&patternBuilder);
+        SFPatternBuilderAddFeature(&patternBuilder, SFTagMake('t', 'e', 's', 't'), 0);
+        SFPatternBuilderAddLookup(&patternBuilder, 1);
+        SFPatternBuilderMakeFeatureUnit(&patternBuilder);
+        SFPatternBuilderEndFeatures(&patternBuilder);
+        SFPatternBuilderBeginFeatures(&patternBuilder, SFFeatureKindPositioning);
+        SFPatternBuilderAddFeature(&patternBuilder, SFTagMake('m', 'a', 'r', 'k'), 0);
+        SFPatternBuilderAddLookup(&patternBuilder, 0);
+        SFPatternBuilderMakeFeatureUnit(&patternBuilder);
+        SFPatternBuilderEndFeatures(&patternBuilder);
+        SFPatternBuilderBuild(&patternBuilder);
+        SFPatternBuilderFinalize(&patternBuilder);
+
+        /* Keep the mark after the second component of the ligature. */
+        SFCodepoint input[] = { 1, 2, 4, 3 };
+
+        SBCodepointSequence sequence;
+        sequence.stringEncoding = SBStringEncodingUTF32;
+        sequence.stringBuffer = input;
+        sequence.stringLength = 4;
+
+        SFCodepoints codepoints;
+        SFCodepointsInitialize(&codepoints, &sequence, SFFalse);
+
+        SFAlbum album;
+        SFAlbumInitialize(&album, NULL);
+        SFAlbumReset(&album, &codepoints, 4);
+
+        SFTextProcessor processor;
+        SFTextProcessorInitialize(&processor, pattern, &album, SFTextDirectionLeftToRight, SFTextModeForward);
+        SFTextProcessorDiscoverGlyphs(&processor);
+        SFTextProcessorSubstituteGlyphs(&processor);
+
+        /* Test that the placeholders of the ligature were removed before positioning. */
+        assert(SFAlbumGetGlyphCount(&album) == 2);
+
+        SFTextProcessorPositionGlyphs(&processor);
+        SFTextProcessorWrapUp(&processor);
+
+        SFGlyphID glyphs[] = { 11, 4 };
+        SFPoint offsets[] = { {0, 0}, {600, 400} };
+
+        /* Test that the mark is attached to the second component of the ligature. */
+        assert(SFAlbumGetGlyphCount(&album) == 2);
+        assert(memcmp(SFAlbumGetGlyphIDsPtr(&album), glyphs, sizeof(glyphs)) == 0);
+        assert(memcmp(SFAlbumGetGlyphOffsetsPtr(&album), offsets, sizeof(offsets)) == 0);
+
+        SFAlbumFinalize(&album);
+        SFPatternRelease(pattern);
+        SFFontRelease(font);
+    }
 }
 
 void TextProcessorTester::test()
@@ -260,4 +572,6 @@ void TextProcessorTester::test()
     testContextSubtable();
     testChainContextSubtable();
     testExtensionSubtable();
+    testBatchCallbacks();
+    testCompactedLigatureAttachment();
 }
@@ -17,6 +17,7 @@
 #ifndef __SHEENFIGURE_TESTER__TEXT_PROCESSOR_TESTER_H
 #define __SHEENFIGURE_TESTER__TEXT_PROCESSOR_TESTER_H
 
+#include <cstddef>
 #include <cstdint>
 #include <utility>
 #include <vector>
@@ -47,6 +48,9 @@ public:
     void testChainContextSubtable();
     void testExtensionSubtable();
 
+    void testBatchCallbacks();
+    void testCompactedLigatureAttachment();
+
     void test();
 
 private:
@@ -54,6 +58,10 @@ private:
                           const std::vector<uint32_t> codepoints,
                           const std::vector<OpenType::Glyph> glyphs,
                           const std::vector<OpenType::LookupSubtable *> referrals = { });
+    void testSubstitutionRun(const std::vector<OpenType::LookupSubtable *> subtables,
+                             const std::vector<uint32_t> codepoints,
+                             const std::vector<OpenType::Glyph> glyphs,
+                             size_t remapCount);
     void testPositioning(OpenType::LookupSubtable &subtable,
                          const std::vector<uint32_t> codepoints,
                          const std::vector<std::pair<int32_t, int32_t>> offsets,
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstdlib>
+
+extern "C" {
+#include <Source/SFAllocator.h>
+#include <Source/SFBase.h>
+}
+
+#include "CountingAllocator.h"
+
+using namespace SheenFigure::Tester::Utilities;
+
+static void *countingAllocate(void *object, SFUInteger size)
+{
+    reinterpret_cast<AllocationCounts *>(object)->allocations++;
+    return malloc(size);
+}
+
+static void *countingReallocate(void *object, void *pointer, SFUInteger size)
+{
+    return realloc(pointer, size);
+}
+
+static void countingDeallocate(void *object, void *pointer)
+{
+    reinterpret_cast<AllocationCounts *>(object)->deallocations++;
+    free(pointer);
+}
+
+const SFAllocatorProtocol CountingAllocator::Protocol = {
+    countingAllocate,
+    countingReallocate,
+    countingDeallocate
+};
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2017 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __SHEEN_FIGURE__TESTER__UTILITIES__COUNTING_ALLOCATOR_H
+#define __SHEEN_FIGURE__TESTER__UTILITIES__COUNTING_ALLOCATOR_H
+
+extern "C" {
+#include <Source/SFAllocator.h>
+#include <Source/SFBase.h>
+}
+
+namespace SheenFigure {
+namespace Tester {
+namespace Utilities {
+
+struct AllocationCounts {
+    SFUInteger allocations;
+    SFUInteger deallocations;
+};
+
+class CountingAllocator {
+public:
+    /* The protocol of an allocator whose object is the AllocationCounts to be updated. */
+    static const SFAllocatorProtocol Protocol;
+};
+
+}
+}
+}
+
+#endif
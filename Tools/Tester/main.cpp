@@ -20,8 +20,11 @@
 #include <Parser/UnicodeData.h>
 
 #include "AlbumTester.h"
+#include "FontCacheTester.h"
 #include "FontTester.h"
 #include "GeneralCategoryLookupTester.h"
+#include "GlyphDigestTester.h"
+#include "GlyphMapTester.h"
 #include "JoiningTypeLookupTester.h"
 #include "ListTester.h"
 #include "LocatorTester.h"
@@ -41,17 +44,23 @@ int main(int argc, const char * argv[])
     UnicodeData unicodeData(dir);
     JoiningTypeLookupTester joiningTypeLookuptester(arabicShaping);
     GeneralCategoryLookupTester generalCategoryLookupTester(unicodeData);
+    GlyphDigestTester glyphDigestTester;
+    GlyphMapTester glyphMapTester;
     ListTester listTester;
     AlbumTester albumTester;
     LocatorTester locatorTester;
+    FontCacheTester fontCacheTester;
     FontTester fontTester;
     PatternTester patternTester;
     SchemeTester schemeTester;
     TextProcessorTester textProcessorTester;
 
     albumTester.test();
+    fontCacheTester.test();
     fontTester.test();
     generalCategoryLookupTester.test();
+    glyphDigestTester.test();
+    glyphMapTester.test();
     joiningTypeLookuptester.test();
     listTester.test();
     locatorTester.test();